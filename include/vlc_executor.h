@@ -31,6 +31,22 @@ extern "C" {
 /** Executor type (opaque) */
 typedef struct vlc_executor vlc_executor_t;
 
+struct vlc_executor_deque;
+
+/**
+ * Priority of a runnable.
+ *
+ * Queued runnables of higher priority are started before those of lower
+ * priority. The priority has no effect on runnables already started.
+ */
+enum vlc_executor_priority {
+    VLC_EXECUTOR_PRIORITY_LOW,
+    VLC_EXECUTOR_PRIORITY_NORMAL,
+    VLC_EXECUTOR_PRIORITY_HIGH,
+};
+
+#define VLC_EXECUTOR_PRIORITY_COUNT (VLC_EXECUTOR_PRIORITY_HIGH + 1)
+
 /**
  * A Runnable encapsulates a task to be run from an executor thread.
  */
@@ -60,6 +76,8 @@ struct vlc_runnable {
 
     /* Private data used by the vlc_executor_t (do not touch) */
     struct vlc_list node;
+    struct vlc_executor_deque *deque;
+    enum vlc_executor_priority priority;
 };
 
 /**
@@ -145,6 +163,25 @@ vlc_executor_Delete(vlc_executor_t *executor);
 VLC_API void
 vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable);
 
+/**
+ * Submit a runnable for execution with a given priority.
+ *
+ * This is the same as vlc_executor_Submit(), except that the runnable
+ * overtakes the queued runnables of lower priority. vlc_executor_Submit()
+ * uses VLC_EXECUTOR_PRIORITY_NORMAL.
+ *
+ * Runnables of the same priority are started roughly in submission order.
+ * The order is strict only if the executor has a single thread.
+ *
+ * \param executor the executor
+ * \param runnable the task to run
+ * \param priority the priority of the task
+ */
+VLC_API void
+vlc_executor_SubmitPriority(vlc_executor_t *executor,
+                            struct vlc_runnable *runnable,
+                            enum vlc_executor_priority priority);
+
 /**
  * Cancel a runnable previously submitted.
  *
@@ -190,6 +190,27 @@ VLC_API vlc_frame_t *vlc_frame_New(const struct vlc_frame_callbacks *cbs,
  */
 VLC_API vlc_frame_t *vlc_frame_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
+/**
+ * Frame allocator statistics.
+ */
+struct vlc_frame_alloc_stats
+{
+    unsigned long long hits; /**< Allocations served from the frame caches */
+    unsigned long long misses; /**< Allocations of new cacheable frames */
+    size_t cached_bytes; /**< Memory held by the frame caches */
+};
+
+/**
+ * Gets statistics about the frame allocator.
+ *
+ * vlc_frame_Alloc() recycles the released frames up to 64 KiB through
+ * per-thread caches. The values are only a snapshot, and they are all zero
+ * if frame caching is disabled.
+ *
+ * @param stats structure to fill [OUT]
+ */
+VLC_API void vlc_frame_GetAllocStats(struct vlc_frame_alloc_stats *stats);
+
 VLC_API vlc_frame_t *vlc_frame_TryRealloc(vlc_frame_t *, ssize_t pre, size_t body) VLC_USED;
 
 /**
@@ -854,6 +875,97 @@ static inline size_t vlc_fifo_Count (vlc_fifo_t *fifo)
 
 /** @} */
 
+/**
+ * \defgroup block_spsc_fifo Single-producer single-consumer block FIFO
+ * Lock-free block queue for exactly one producer and one consumer thread
+ *
+ * This queue has the same semantics as the block FIFO, but no lock: blocks
+ * are queued and dequeued without any system call, and the consumer only
+ * sleeps while the queue is empty.
+ *
+ * Only one thread at a time may queue blocks, and only one thread at a time
+ * may dequeue blocks. The producer and consumer roles may move to another
+ * thread only if the threads synchronize with each other in between.
+ * @{
+ */
+
+typedef struct vlc_spsc_fifo vlc_spsc_fifo_t;
+
+/**
+ * Creates a single-producer single-consumer FIFO queue of blocks.
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API vlc_spsc_fifo_t *vlc_spsc_fifo_New(void) VLC_USED VLC_MALLOC;
+
+/**
+ * Delete a FIFO created by vlc_spsc_fifo_New().
+ *
+ * @note Any queued blocks are also deleted.
+ * @warning No other threads may be using the FIFO when this function is
+ * called.
+ */
+VLC_API void vlc_spsc_fifo_Delete(vlc_spsc_fifo_t *);
+
+/**
+ * Queues a (chain of) block(s) at the end of the FIFO.
+ *
+ * This function never blocks. It must only be called by the producer.
+ */
+VLC_API void vlc_spsc_fifo_Put(vlc_spsc_fifo_t *, vlc_frame_t *);
+
+/**
+ * Dequeues the first block of the FIFO, if any.
+ *
+ * This function never blocks. It must only be called by the consumer.
+ *
+ * @return the first block or NULL if the FIFO is empty
+ */
+VLC_API vlc_frame_t *vlc_spsc_fifo_TryGet(vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Dequeues the first block of the FIFO, waiting while the FIFO is empty.
+ *
+ * It must only be called by the consumer.
+ *
+ * @return the first block, or NULL if vlc_spsc_fifo_Wake() was called
+ */
+VLC_API vlc_frame_t *vlc_spsc_fifo_Get(vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Wakes up the consumer waiting in vlc_spsc_fifo_Get(), if any.
+ *
+ * This can be called from any thread. The next (or current) call to
+ * vlc_spsc_fifo_Get() returns NULL if the FIFO is empty.
+ */
+VLC_API void vlc_spsc_fifo_Wake(vlc_spsc_fifo_t *);
+
+/**
+ * Checks whether the FIFO is empty.
+ *
+ * This can be called from any thread. A block being queued concurrently
+ * may already be accounted for, even if it cannot be dequeued yet.
+ */
+VLC_API bool vlc_spsc_fifo_IsEmpty(const vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Counts the blocks in the FIFO.
+ *
+ * This can be called from any thread, with the same caveat as
+ * vlc_spsc_fifo_IsEmpty().
+ */
+VLC_API size_t vlc_spsc_fifo_GetCount(const vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Counts the bytes in the FIFO.
+ *
+ * This can be called from any thread, with the same caveat as
+ * vlc_spsc_fifo_IsEmpty().
+ */
+VLC_API size_t vlc_spsc_fifo_GetBytes(const vlc_spsc_fifo_t *) VLC_USED;
+
+/** @} */
+
 /** @} */
 
 #endif /* VLC_FRAME_H */
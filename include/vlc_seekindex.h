@@ -0,0 +1,91 @@
+/*****************************************************************************
+ * vlc_seekindex.h: persistent seek index cache
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SEEKINDEX_H
+#define VLC_SEEKINDEX_H 1
+
+/**
+ * \defgroup seekindex Seek index cache
+ * \ingroup input
+ *
+ * Demuxers that need to scan a file to be able to seek in it (missing or
+ * broken index) can save the result of the scan, and reload it the next
+ * time the same file is opened.
+ *
+ * Indexes are stored in the user cache directory. They are keyed by the
+ * stream URL, size and modification time, so that a modified file is never
+ * matched with a stale index. Streams without a known size and modification
+ * time are not cached. The cache size is bounded, and the least recently
+ * used indexes are evicted first.
+ * @{
+ */
+
+/**
+ * Seek index entry.
+ *
+ * Except for the offset, the meaning of the fields is up to the demuxer.
+ */
+typedef struct
+{
+    vlc_tick_t i_time;   /**< timestamp, or VLC_TICK_INVALID if unknown */
+    uint64_t   i_offset; /**< byte offset in the stream */
+    uint32_t   i_size;   /**< size of the data at the offset */
+    uint32_t   i_track;  /**< track identifier */
+    uint32_t   i_flags;  /**< demuxer-defined flags */
+} vlc_seekindex_entry_t;
+
+/**
+ * Loads a cached seek index.
+ *
+ * \param obj object to use for logging and options
+ * \param s stream the index refers to
+ * \param tag identifier of the index format, typically the demuxer name
+ * \param entries pointer to the table of entries [OUT], to be freed with
+ *                free() by the caller
+ * \return the number of entries, or -1 if no index was found
+ */
+VLC_API ssize_t vlc_seekindex_Load(vlc_object_t *obj, stream_t *s,
+                                   const char *tag,
+                                   vlc_seekindex_entry_t **entries);
+#define vlc_seekindex_Load(o, s, t, e) \
+    vlc_seekindex_Load(VLC_OBJECT(o), s, t, e)
+
+/**
+ * Saves a seek index to the cache.
+ *
+ * Older indexes may be evicted to stay within the configured cache size.
+ *
+ * \param obj object to use for logging and options
+ * \param s stream the index refers to
+ * \param tag identifier of the index format, typically the demuxer name
+ * \param entries table of entries
+ * \param count number of entries
+ * \return VLC_SUCCESS or an error
+ */
+VLC_API int vlc_seekindex_Store(vlc_object_t *obj, stream_t *s,
+                                const char *tag,
+                                const vlc_seekindex_entry_t *entries,
+                                size_t count);
+#define vlc_seekindex_Store(o, s, t, e, c) \
+    vlc_seekindex_Store(VLC_OBJECT(o), s, t, e, c)
+
+/** @} */
+
+#endif
@@ -50,6 +50,9 @@
 #else
 #   include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
@@ -60,12 +63,27 @@
 #endif
 #include <vlc_fs.h>
 #include <vlc_url.h>
+#include <vlc_block.h>
+#ifdef HAVE_LIBURING
+# include "uring.h"
+
+struct file_uring;
+#endif
 
 typedef struct
 {
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    /* Memory-mapped mode */
+    uint64_t offset; /* current read position */
+    uint64_t size; /* last known file size */
+    size_t page_size;
+#endif
+#ifdef HAVE_LIBURING
+    struct file_uring *uring; /* asynchronous read-ahead, or NULL */
+#endif
 } access_sys_t;
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -168,6 +186,19 @@ static bool IsRemote (const char *path)
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
+#ifdef HAVE_MMAP
+static block_t *BlockMmap (stream_t *, bool *);
+static int MmapSeek (stream_t *, uint64_t);
+
+/* Size of the mapped blocks, and of the read-ahead window after them */
+# define MMAP_BLOCK_SIZE (1 << 20)
+#endif
+#ifdef HAVE_LIBURING
+static int UringStart (stream_t *, const struct stat *);
+static void UringStop (stream_t *);
+static ssize_t UringRead (stream_t *, void *, size_t);
+static int UringSeek (stream_t *, uint64_t);
+#endif
 
 /*****************************************************************************
  * FileOpen: open the file
@@ -252,6 +283,9 @@ int FileOpen( vlc_object_t *p_this )
     p_access->pf_control = FileControl;
     p_access->p_sys = p_sys;
     p_sys->fd = fd;
+#ifdef HAVE_LIBURING
+    p_sys->uring = NULL;
+#endif
 
     if (S_ISREG (st.st_mode) || S_ISBLK (st.st_mode))
     {
@@ -270,6 +304,30 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Local regular files can be mapped instead of read, so that the
+         * blocks reference the page cache without any copy. */
+        long page_size = sysconf (_SC_PAGESIZE);
+        if (S_ISREG (st.st_mode) && page_size > 0
+         && !IsRemote (fd, p_access->psz_filepath)
+         && var_InheritBool (p_access, "file-mmap"))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = BlockMmap;
+            p_access->pf_seek = MmapSeek;
+            p_sys->offset = 0;
+            p_sys->size = st.st_size;
+            p_sys->page_size = page_size;
+            posix_fadvise (fd, 0, MMAP_BLOCK_SIZE, POSIX_FADV_WILLNEED);
+            msg_Dbg (p_access, "using memory-mapped reading");
+        }
+#endif
+#ifdef HAVE_LIBURING
+        if (p_access->pf_read == Read
+         && !IsRemote (fd, p_access->psz_filepath)
+         && var_InheritBool (p_access, "file-io-uring"))
+            UringStart (p_access, &st);
 #endif
     }
     else
@@ -292,7 +350,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_this);
         return;
@@ -300,6 +358,10 @@ void FileClose (vlc_object_t * p_this)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_LIBURING
+    if (p_sys->uring != NULL)
+        UringStop (p_access);
+#endif
     vlc_close (p_sys->fd);
 }
 
@@ -326,6 +388,289 @@ static ssize_t Read (stream_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+/*****************************************************************************
+ * BlockMmap: return the next chunk of the file as a mapped block
+ *****************************************************************************/
+static block_t *BlockMmap (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if (p_sys->offset >= p_sys->size)
+    {   /* The file may have grown since the last check */
+        struct stat st;
+
+        if (fstat (p_sys->fd, &st) == 0)
+            p_sys->size = st.st_size;
+        if (p_sys->offset >= p_sys->size)
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    /* The mapping must start on a page boundary */
+    uint64_t start = p_sys->offset & ~(uint64_t)(p_sys->page_size - 1);
+    size_t skip = p_sys->offset - start;
+    size_t length = __MIN(p_sys->size - p_sys->offset, MMAP_BLOCK_SIZE);
+
+    void *addr = mmap (NULL, skip + length, PROT_READ, MAP_PRIVATE,
+                       p_sys->fd, start);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "memory mapping failed: %s",
+                 vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+
+    /* Fault this block in ahead of the demuxer, in order */
+    posix_madvise (addr, skip + length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, skip + length, POSIX_MADV_WILLNEED);
+    /* Read-ahead of the next block while this one is being processed */
+    posix_fadvise (p_sys->fd, p_sys->offset + length, MMAP_BLOCK_SIZE,
+                   POSIX_FADV_WILLNEED);
+
+    block_t *block = block_mmap_Alloc (addr, skip + length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    block->p_buffer += skip;
+    block->i_buffer -= skip;
+    p_sys->offset += length;
+    return block;
+}
+
+static int MmapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->offset = i_pos;
+    posix_fadvise (p_sys->fd, i_pos, MMAP_BLOCK_SIZE, POSIX_FADV_WILLNEED);
+    return VLC_SUCCESS;
+}
+#endif
+
+#ifdef HAVE_LIBURING
+/*****************************************************************************
+ * io_uring read-ahead
+ *****************************************************************************
+ * A few chunks following the reading position are kept in flight on the
+ * ring shared by all streams. A chunk is resubmitted at the end of the
+ * read-ahead window as soon as it has been consumed, so the input thread
+ * only ever blocks when the storage is slower than the demuxer.
+ *****************************************************************************/
+# define URING_CHUNK_SIZE (256 << 10)
+# define URING_CHUNKS 4
+
+struct file_chunk
+{
+    struct vlc_uring_request req;
+    struct file_uring *owner;
+    uint64_t offset;
+    int result;
+    bool pending; /* protected by file_uring.lock */
+    unsigned char data[URING_CHUNK_SIZE];
+};
+
+struct file_uring
+{
+    struct vlc_uring *ring;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+
+    /* The following are only accessed by the reading thread */
+    uint64_t offset; /* reading position */
+    uint64_t next; /* offset of the next chunk to submit */
+    unsigned head; /* chunk containing the reading position */
+    bool restart; /* read-ahead must restart at the reading position */
+
+    struct file_chunk chunks[URING_CHUNKS];
+};
+
+static void ChunkComplete (struct vlc_uring_request *req, int res)
+{
+    struct file_chunk *chunk = container_of(req, struct file_chunk, req);
+    struct file_uring *u = chunk->owner;
+
+    vlc_mutex_lock (&u->lock);
+    chunk->result = res;
+    chunk->pending = false;
+    vlc_cond_signal (&u->wait);
+    vlc_mutex_unlock (&u->lock);
+}
+
+static int ChunkWait (struct file_uring *u, struct file_chunk *chunk)
+{
+    vlc_mutex_lock (&u->lock);
+    while (chunk->pending)
+        vlc_cond_wait (&u->wait, &u->lock);
+    vlc_mutex_unlock (&u->lock);
+    return chunk->result;
+}
+
+static void ChunkSubmit (stream_t *p_access, struct file_chunk *chunk)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct file_uring *u = p_sys->uring;
+
+    chunk->offset = u->next;
+    u->next += URING_CHUNK_SIZE;
+
+    vlc_mutex_lock (&u->lock);
+    chunk->pending = true;
+    vlc_mutex_unlock (&u->lock);
+
+    /* The lock must not be held here, as the submission may wait for the
+     * completion thread. */
+    int val = vlc_uring_Read (u->ring, &chunk->req, p_sys->fd, chunk->data,
+                              sizeof (chunk->data), chunk->offset);
+    if (val != 0)
+    {
+        vlc_mutex_lock (&u->lock);
+        chunk->pending = false;
+        chunk->result = -val;
+        vlc_mutex_unlock (&u->lock);
+    }
+}
+
+static void UringRestart (stream_t *p_access)
+{
+    struct file_uring *u = ((access_sys_t *)p_access->p_sys)->uring;
+
+    /* Buffers cannot be reused until the kernel is done with them */
+    for (unsigned i = 0; i < URING_CHUNKS; i++)
+        ChunkWait (u, &u->chunks[i]);
+
+    u->head = 0;
+    u->next = u->offset;
+    u->restart = false;
+
+    for (unsigned i = 0; i < URING_CHUNKS; i++)
+        ChunkSubmit (p_access, &u->chunks[i]);
+}
+
+static int UringStart (stream_t *p_access, const struct stat *st)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    /* Small files are entirely read ahead by the kernel anyway */
+    if (st->st_size < URING_CHUNKS * URING_CHUNK_SIZE)
+        return VLC_EGENERIC;
+
+    off_t offset = lseek (p_sys->fd, 0, SEEK_CUR);
+    if (offset == (off_t)-1)
+        return VLC_EGENERIC;
+
+    struct file_uring *u = malloc (sizeof (*u));
+    if (unlikely(u == NULL))
+        return VLC_ENOMEM;
+
+    u->ring = vlc_uring_Hold (VLC_OBJECT(p_access),
+                   var_InheritInteger (p_access, "file-io-uring-depth"));
+    if (u->ring == NULL)
+    {   /* Keep using read() */
+        free (u);
+        return VLC_EGENERIC;
+    }
+
+    vlc_mutex_init (&u->lock);
+    vlc_cond_init (&u->wait);
+    u->offset = offset;
+    for (unsigned i = 0; i < URING_CHUNKS; i++)
+    {
+        struct file_chunk *chunk = &u->chunks[i];
+
+        chunk->req.complete = ChunkComplete;
+        chunk->owner = u;
+        chunk->pending = false;
+    }
+
+    p_sys->uring = u;
+    UringRestart (p_access);
+
+    p_access->pf_read = UringRead;
+    p_access->pf_seek = UringSeek;
+    msg_Dbg (p_access, "using io_uring read-ahead");
+    return VLC_SUCCESS;
+}
+
+static void UringStop (stream_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct file_uring *u = p_sys->uring;
+
+    for (unsigned i = 0; i < URING_CHUNKS; i++)
+        ChunkWait (u, &u->chunks[i]);
+
+    vlc_uring_Release (u->ring);
+    free (u);
+    p_sys->uring = NULL;
+}
+
+static ssize_t UringRead (stream_t *p_access, void *p_buffer, size_t i_len)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct file_uring *u = p_sys->uring;
+
+    if (u->restart)
+        UringRestart (p_access);
+
+    struct file_chunk *chunk = &u->chunks[u->head];
+    int res = ChunkWait (u, chunk);
+    if (res < 0)
+    {   /* Retry synchronously, so that errors are reported as usual */
+        msg_Dbg (p_access, "read-ahead error: %s", vlc_strerror_c(-res));
+        u->restart = true;
+
+        ssize_t val = pread (p_sys->fd, p_buffer, i_len, u->offset);
+        if (val < 0)
+        {
+            msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+            return 0;
+        }
+        u->offset += val;
+        return val;
+    }
+
+    assert (u->offset >= chunk->offset);
+    uint64_t skip = u->offset - chunk->offset;
+    if (skip >= (unsigned)res)
+    {   /* End of file, or seek past it. Read again next time, in case the
+         * file has grown. */
+        u->restart = true;
+        return 0;
+    }
+
+    size_t copy = __MIN(i_len, res - skip);
+
+    memcpy (p_buffer, chunk->data + skip, copy);
+    u->offset += copy;
+
+    if (u->offset == chunk->offset + URING_CHUNK_SIZE)
+    {   /* Recycle the chunk at the end of the read-ahead window */
+        ChunkSubmit (p_access, chunk);
+        u->head = (u->head + 1) % URING_CHUNKS;
+    }
+    else if (u->offset == chunk->offset + res)
+        /* Short read: refresh the read-ahead on the next call */
+        u->restart = true;
+    return copy;
+}
+
+static int UringSeek (stream_t *p_access, uint64_t i_pos)
+{
+    struct file_uring *u = ((access_sys_t *)p_access->p_sys)->uring;
+    const struct file_chunk *chunk = &u->chunks[u->head];
+
+    /* Data within the current chunk is already (being) read */
+    if (i_pos < chunk->offset || i_pos >= chunk->offset + URING_CHUNK_SIZE)
+        u->restart = true;
+    u->offset = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -37,6 +37,21 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+#ifdef HAVE_MMAP
+    add_bool("file-mmap", false, N_("Memory-mapped reading"),
+             N_("Map local files into memory instead of copying their "
+                "content. This reduces CPU usage with large files, but the "
+                "process may crash if a file is truncated while being read."))
+#endif
+#ifdef HAVE_LIBURING
+    add_bool("file-io-uring", false, N_("Asynchronous read-ahead"),
+             N_("Read local files ahead of the demuxer with io_uring. "
+                "The same ring is shared by all the opened files."))
+    add_integer("file-io-uring-depth", 64, N_("io_uring queue depth"),
+                N_("Maximum number of read requests in flight across all "
+                   "the opened files."))
+        change_integer_range(4, 4096)
+#endif
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
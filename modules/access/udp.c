@@ -47,6 +47,7 @@
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
+#include <errno.h>
 
 /* Buffer can be max theoretical datagram content minus anticipated MTU.
  * IPv6 headers are larger than IPv4, ignore IPv6 jumbograms.
@@ -59,6 +60,18 @@ typedef struct {
 
     size_t length;
     char *offset;
+#ifdef HAVE_RECVMMSG
+    struct {
+        struct mmsghdr *msgs;
+        struct iovec *iovs;
+        char *bufs;
+        unsigned size; /* datagram slots */
+        unsigned count; /* received datagrams */
+        unsigned next; /* next datagram to read */
+        uint64_t calls;
+        uint64_t datagrams;
+    } batch;
+#endif
     char buf[MRU];
 } access_sys_t;
 
@@ -132,6 +145,95 @@ static ssize_t Read(stream_t *access, void *buf, size_t len)
     return val;
 }
 
+#ifdef HAVE_RECVMMSG
+/* Drains a burst of datagrams per system call, and feeds the reads from
+ * the ring of received datagrams. */
+static ssize_t ReadBatch(stream_t *access, void *buf, size_t len)
+{
+    access_sys_t *sys = access->p_sys;
+
+    while (sys->length == 0) {
+        if (sys->batch.next < sys->batch.count) {
+            unsigned i = sys->batch.next++;
+
+            /* empty (0 bytes) payloads are skipped */
+            sys->offset = sys->batch.iovs[i].iov_base;
+            sys->length = sys->batch.msgs[i].msg_len;
+            continue;
+        }
+
+        struct pollfd ufd[1];
+
+        ufd[0].fd = sys->fd;
+        ufd[0].events = POLLIN;
+
+        switch (vlc_poll_i11e(ufd, 1, sys->timeout)) {
+            case 0:
+                msg_Err(access, "receive time-out");
+                return 0;
+            case -1:
+                return -1;
+        }
+
+        int val = recvmmsg(sys->fd, sys->batch.msgs, sys->batch.size,
+                           MSG_DONTWAIT, NULL);
+        if (val <= 0) {
+            if (val < 0 && errno == ENOSYS) {
+                msg_Warn(access, "multiple datagrams receive not supported");
+                access->pf_read = Read;
+            }
+            return -1;
+        }
+
+        sys->batch.count = val;
+        sys->batch.next = 0;
+        sys->batch.calls++;
+        sys->batch.datagrams += val;
+    }
+
+    if (len > sys->length)
+        len = sys->length;
+
+    memcpy(buf, sys->offset, len);
+    sys->offset += len;
+    sys->length -= len;
+    return len;
+}
+
+static int OpenBatch(stream_t *access, unsigned size)
+{
+    access_sys_t *sys = access->p_sys;
+
+    sys->batch.msgs = vlc_alloc(size, sizeof (*sys->batch.msgs));
+    sys->batch.iovs = vlc_alloc(size, sizeof (*sys->batch.iovs));
+    /* Only the pages of the actual datagram sizes end up being used */
+    sys->batch.bufs = vlc_alloc(size, MRU);
+    if (unlikely(sys->batch.msgs == NULL || sys->batch.iovs == NULL
+              || sys->batch.bufs == NULL)) {
+        free(sys->batch.msgs);
+        free(sys->batch.iovs);
+        free(sys->batch.bufs);
+        return VLC_ENOMEM;
+    }
+
+    for (unsigned i = 0; i < size; i++) {
+        sys->batch.iovs[i].iov_base = sys->batch.bufs + (size_t)i * MRU;
+        sys->batch.iovs[i].iov_len = MRU;
+        memset(&sys->batch.msgs[i], 0, sizeof (sys->batch.msgs[i]));
+        sys->batch.msgs[i].msg_hdr.msg_iov = &sys->batch.iovs[i];
+        sys->batch.msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    sys->batch.size = size;
+    sys->batch.count = 0;
+    sys->batch.next = 0;
+    sys->batch.calls = 0;
+    sys->batch.datagrams = 0;
+    access->pf_read = ReadBatch;
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -217,6 +319,16 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    sys->batch.size = 0;
+    unsigned batch = var_InheritInteger( p_access, "udp-batch" );
+    if( batch > 1 && OpenBatch( p_access, batch ) != VLC_SUCCESS )
+    {
+        net_Close( sys->fd );
+        return VLC_ENOMEM;
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -229,9 +341,27 @@ static void Close( vlc_object_t *p_this )
     access_sys_t *sys = p_access->p_sys;
 
     net_Close( sys->fd );
+
+#ifdef HAVE_RECVMMSG
+    if( sys->batch.size > 0 )
+    {
+        if( sys->batch.calls > 0 )
+            msg_Dbg( p_access, "received %"PRIu64" datagrams in %"PRIu64
+                     " calls (average batch fill %.1f/%u)",
+                     sys->batch.datagrams, sys->batch.calls,
+                     (double)sys->batch.datagrams / sys->batch.calls,
+                     sys->batch.size );
+        free( sys->batch.msgs );
+        free( sys->batch.iovs );
+        free( sys->batch.bufs );
+    }
+#endif
 }
 
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Datagrams per receive call")
+#define BATCH_LONGTEXT N_("Maximum number of datagrams received with a " \
+    "single system call. Use 1 to receive datagrams one by one.")
 
 vlc_module_begin()
     set_shortname(N_("UDP"))
@@ -240,6 +370,9 @@ vlc_module_begin()
 
     add_obsolete_integer("udp-buffer") /* since 3.0.0 */
     add_integer("udp-timeout", -1, TIMEOUT_TEXT, NULL)
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range("udp-batch", 32, 1, 1024, BATCH_TEXT, BATCH_LONGTEXT)
+#endif
 
     set_capability("access", 0)
     add_shortcut("udp", "udpstream", "udp4", "udp6")
@@ -0,0 +1,319 @@
+/*****************************************************************************
+ * uring.c: shared io_uring instance for asynchronous file reads
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include <liburing.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+#include "uring.h"
+
+struct vlc_uring
+{
+    struct io_uring ring;
+    vlc_mutex_t lock; /* serializes submissions */
+    vlc_cond_t wait;
+    unsigned inflight;
+    unsigned max_inflight;
+    struct vlc_list pending; /* requests in flight */
+    int error; /* error number once the ring failed, or 0 */
+    unsigned refs; /* protected by shared_lock */
+    vlc_thread_t thread;
+};
+
+static vlc_mutex_t shared_lock = VLC_STATIC_MUTEX;
+static struct vlc_uring *shared = NULL;
+
+static void IgnoreCompletion(struct vlc_uring_request *req, int res)
+{
+    (void) req; (void) res;
+}
+
+/* Placeholder for queue entries whose submission failed */
+static struct vlc_uring_request ignored = { .complete = IgnoreCompletion };
+
+/* Gets the next completion after the ring failed. */
+static int Reap(struct vlc_uring *ring, struct io_uring_cqe **cqe)
+{
+    int val = io_uring_wait_cqe(&ring->ring, cqe);
+    if (val < 0 && val != -EINTR)
+    {   /* Waiting does not work anymore: poll until the kernel is done */
+        vlc_tick_sleep(VLC_TICK_FROM_MS(10));
+        val = io_uring_peek_cqe(&ring->ring, cqe);
+    }
+    return val;
+}
+
+/* Cancels all the requests in flight, and completes them with an error once
+ * the kernel is done with their buffers. New requests are refused. */
+static void Fail(struct vlc_uring *ring, int err)
+{
+    struct vlc_uring_request *req;
+
+    vlc_mutex_lock(&ring->lock);
+    ring->error = err;
+    vlc_cond_broadcast(&ring->wait);
+
+    vlc_list_foreach(req, &ring->pending, node)
+    {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring->ring);
+        if (sqe == NULL)
+            break; /* the remaining requests will complete on their own */
+        io_uring_prep_cancel(sqe, req, 0);
+        io_uring_sqe_set_data(sqe, &ignored);
+    }
+    io_uring_submit(&ring->ring);
+
+    while (!vlc_list_is_empty(&ring->pending))
+    {
+        struct io_uring_cqe *cqe;
+
+        vlc_mutex_unlock(&ring->lock);
+        int val = Reap(ring, &cqe);
+        vlc_mutex_lock(&ring->lock);
+        /* Both the completion thread and the releasing thread can fail the
+         * ring: only take the completion that is still there. */
+        if (val < 0 || io_uring_peek_cqe(&ring->ring, &cqe) != 0)
+            continue;
+
+        req = io_uring_cqe_get_data(cqe);
+        io_uring_cqe_seen(&ring->ring, cqe);
+
+        if (req == NULL || req == &ignored)
+            continue; /* cancellation, termination or no-op */
+
+        vlc_list_remove(&req->node);
+        vlc_mutex_unlock(&ring->lock);
+        req->complete(req, -err);
+        vlc_mutex_lock(&ring->lock);
+    }
+    vlc_mutex_unlock(&ring->lock);
+}
+
+static void *Thread(void *data)
+{
+    struct vlc_uring *ring = data;
+
+    vlc_thread_set_name("vlc-uring");
+
+    for (;;)
+    {
+        struct io_uring_cqe *cqe;
+        int val = io_uring_wait_cqe(&ring->ring, &cqe);
+        if (val == -EINTR)
+            continue; /* interrupted by a signal */
+        if (val < 0)
+        {
+            Fail(ring, -val);
+            break;
+        }
+
+        vlc_mutex_lock(&ring->lock);
+        if (ring->error != 0)
+        {   /* failed on release, which reaps the remaining completions */
+            vlc_mutex_unlock(&ring->lock);
+            break;
+        }
+
+        struct vlc_uring_request *req = io_uring_cqe_get_data(cqe);
+        int res = cqe->res;
+
+        io_uring_cqe_seen(&ring->ring, cqe);
+
+        if (req == NULL)
+        {
+            vlc_mutex_unlock(&ring->lock);
+            break; /* terminating the ring */
+        }
+
+        assert(ring->inflight > 0);
+        ring->inflight--;
+        if (req != &ignored)
+            vlc_list_remove(&req->node);
+        vlc_cond_signal(&ring->wait);
+        vlc_mutex_unlock(&ring->lock);
+
+        req->complete(req, res);
+    }
+    return NULL;
+}
+
+/* Gets a submission queue entry for a new request, with the lock held. */
+static struct io_uring_sqe *GetSQE(struct vlc_uring *ring)
+{
+    while (ring->inflight >= ring->max_inflight && ring->error == 0)
+        vlc_cond_wait(&ring->wait, &ring->lock);
+    if (ring->error != 0)
+        return NULL;
+
+    /* Entries are submitted as soon as they are filled, so the submission
+     * queue can only be full if the previous submission failed. */
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring->ring);
+    if (sqe != NULL)
+        ring->inflight++;
+    return sqe;
+}
+
+static int Submit(struct vlc_uring *ring, struct io_uring_sqe *sqe)
+{
+    int val = io_uring_submit(&ring->ring);
+    if (val >= 0)
+        return 0;
+
+    /* The entry stays in the queue and will go with the next submission.
+     * Turn it into a no-op so that it does not refer to the caller. */
+    io_uring_prep_nop(sqe);
+    io_uring_sqe_set_data(sqe, &ignored);
+    return -val;
+}
+
+int vlc_uring_Read(struct vlc_uring *ring, struct vlc_uring_request *req,
+                   int fd, void *buf, size_t length, uint64_t offset)
+{
+    int val;
+
+    vlc_mutex_lock(&ring->lock);
+    struct io_uring_sqe *sqe = GetSQE(ring);
+    if (likely(sqe != NULL))
+    {
+        io_uring_prep_read(sqe, fd, buf, length, offset);
+        io_uring_sqe_set_data(sqe, req);
+        val = Submit(ring, sqe);
+        if (val == 0)
+            vlc_list_append(&req->node, &ring->pending);
+    }
+    else
+        val = ring->error != 0 ? ring->error : EAGAIN;
+    vlc_mutex_unlock(&ring->lock);
+    return val;
+}
+
+/* Submits the termination request, and returns an error number if it cannot
+ * be. The lock is released between the attempts, so that the completion
+ * thread can drain the completion queue meanwhile. */
+static int Terminate(struct vlc_uring *ring)
+{
+    struct io_uring_sqe *sqe = NULL;
+    int err = 0;
+
+    vlc_mutex_lock(&ring->lock);
+    for (unsigned i = 0; ring->error == 0; i++)
+    {
+        /* The queue can still be full of entries whose submission failed */
+        if (sqe == NULL && (sqe = io_uring_get_sqe(&ring->ring)) != NULL)
+        {
+            io_uring_prep_nop(sqe);
+            io_uring_sqe_set_data(sqe, NULL);
+        }
+
+        int val = io_uring_submit(&ring->ring);
+        if (val >= 0 && sqe != NULL)
+            break;
+        if (i == 50)
+        {
+            err = val < 0 ? -val : EBUSY;
+            break;
+        }
+
+        vlc_cond_timedwait(&ring->wait, &ring->lock,
+                           vlc_tick_now() + VLC_TICK_FROM_MS(10));
+    }
+    vlc_mutex_unlock(&ring->lock);
+    return err;
+}
+
+struct vlc_uring *vlc_uring_Hold(vlc_object_t *obj, unsigned depth)
+{
+    vlc_mutex_lock(&shared_lock);
+
+    struct vlc_uring *ring = shared;
+    if (ring != NULL)
+    {
+        ring->refs++;
+        goto out;
+    }
+
+    ring = malloc(sizeof (*ring));
+    if (unlikely(ring == NULL))
+        goto out;
+
+    int val = io_uring_queue_init(depth, &ring->ring, 0);
+    if (val < 0)
+    {
+        msg_Dbg(obj, "io_uring not available: %s", vlc_strerror_c(-val));
+        free(ring);
+        ring = NULL;
+        goto out;
+    }
+
+    vlc_mutex_init(&ring->lock);
+    vlc_cond_init(&ring->wait);
+    ring->inflight = 0;
+    /* One entry is kept in reserve for the termination request. */
+    ring->max_inflight = depth - 1;
+    vlc_list_init(&ring->pending);
+    ring->error = 0;
+    ring->refs = 1;
+
+    if (vlc_clone(&ring->thread, Thread, ring))
+    {
+        io_uring_queue_exit(&ring->ring);
+        free(ring);
+        ring = NULL;
+        goto out;
+    }
+
+    msg_Dbg(obj, "io_uring created with depth %u", depth);
+    shared = ring;
+out:
+    vlc_mutex_unlock(&shared_lock);
+    return ring;
+}
+
+void vlc_uring_Release(struct vlc_uring *ring)
+{
+    vlc_mutex_lock(&shared_lock);
+    assert(ring == shared);
+
+    if (--ring->refs > 0)
+    {
+        vlc_mutex_unlock(&shared_lock);
+        return;
+    }
+    shared = NULL;
+    vlc_mutex_unlock(&shared_lock);
+
+    /* Wake the completion thread up with a request without data, unless it
+     * already exited on failure. */
+    int err = Terminate(ring);
+    if (err != 0)
+        Fail(ring, err);
+
+    vlc_join(ring->thread, NULL);
+    io_uring_queue_exit(&ring->ring);
+    free(ring);
+}
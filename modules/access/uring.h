@@ -0,0 +1,76 @@
+/*****************************************************************************
+ * uring.h: shared io_uring instance for asynchronous file reads
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_ACCESS_URING_H
+#define VLC_ACCESS_URING_H 1
+
+#include <vlc_list.h>
+
+/**
+ * A single io_uring instance is shared by all the streams of the process.
+ * A single thread reaps the completions and invokes the request callbacks,
+ * so the callbacks must not block.
+ */
+struct vlc_uring;
+
+struct vlc_uring_request
+{
+    /**
+     * Completion callback.
+     *
+     * \param res number of bytes read, or a negated error number
+     */
+    void (*complete)(struct vlc_uring_request *req, int res);
+
+    struct vlc_list node; /* private to the ring */
+};
+
+/**
+ * Gets a reference to the shared ring, creating it if needed.
+ *
+ * \param depth submission queue depth (only used if the ring is created)
+ * \return the ring, or NULL if io_uring is not usable
+ */
+struct vlc_uring *vlc_uring_Hold(vlc_object_t *obj, unsigned depth);
+
+/**
+ * Releases a reference to the shared ring.
+ *
+ * All the requests submitted through this reference must have completed.
+ */
+void vlc_uring_Release(struct vlc_uring *ring);
+
+/**
+ * Queues an asynchronous positional read.
+ *
+ * The buffer must remain valid until the completion callback is invoked.
+ * Submission may block if too many requests are already in flight.
+ *
+ * If the ring fails, the requests in flight are cancelled and complete with
+ * the error once the kernel no longer uses their buffers, and later requests
+ * are not queued.
+ *
+ * \return 0 on success, or an error number if the request was not queued
+ * (the callback is then not invoked)
+ */
+int vlc_uring_Read(struct vlc_uring *ring, struct vlc_uring_request *req,
+                   int fd, void *buf, size_t length, uint64_t offset);
+
+#endif
@@ -30,11 +30,15 @@
 #endif
 
 #include <assert.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_UIO_H
+#   include <sys/uio.h>
+#endif
 #ifdef __OS2__
 #   include <io.h>      /* setmode() */
 #endif
@@ -55,131 +59,251 @@
 #ifndef _POSIX_REALTIME_SIGNALS
 # define _POSIX_REALTIME_SIGNALS (-1)
 #endif
+#ifndef IOV_MAX
+#   define IOV_MAX 16
+#endif
+
+#define DIRECT_BUFFER_SIZE (4 << 20)
 
 #define SOUT_CFG_PREFIX "sout-file-"
 
+#define CHAIN_IOV_MAX (IOV_MAX < 256 ? IOV_MAX : 256)
+
+typedef struct
+{
+    int fd;
+#ifdef O_DIRECT
+    uint8_t *direct_buf; /* O_DIRECT staging buffer, NULL if not in use */
+    size_t direct_size;
+    size_t direct_fill;
+    size_t direct_align;
+#endif
+} sout_access_out_sys_t;
+
 /*****************************************************************************
  * Read: standard read on a file descriptor.
  *****************************************************************************/
 static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
     ssize_t val;
 
     do
-        val = read(fd, p_buffer->p_buffer, p_buffer->i_buffer);
+        val = read(p_sys->fd, p_buffer->p_buffer, p_buffer->i_buffer);
     while (val == -1 && errno == EINTR);
     return val;
 }
 
 /*****************************************************************************
- * Write: standard write on a file descriptor.
+ * WriteChain: gather-write a block chain with as few calls as possible.
  *****************************************************************************/
-static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+static ssize_t WriteChain(sout_access_out_t *access, block_t *block,
+                          ssize_t (*writev_cb)(int, const struct iovec *, int))
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
-    size_t i_write = 0;
+    sout_access_out_sys_t *sys = access->p_sys;
+    ssize_t total = 0;
 
-    while( p_buffer )
+    while (block != NULL)
     {
-        ssize_t val = write(fd, p_buffer->p_buffer, p_buffer->i_buffer);
-        if (val <= 0)
+        struct iovec iov[CHAIN_IOV_MAX];
+        int count = 0;
+
+        for (block_t *b = block; b != NULL && count < CHAIN_IOV_MAX;
+             b = b->p_next)
         {
-            if (errno == EINTR)
+            if (b->i_buffer == 0)
                 continue;
-            block_ChainRelease (p_buffer);
-            msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
-            return -1;
+            iov[count].iov_base = b->p_buffer;
+            iov[count].iov_len = b->i_buffer;
+            count++;
         }
 
-        if ((size_t)val >= p_buffer->i_buffer)
+        size_t val = 0;
+
+        if (count > 0)
         {
-            block_t *p_next = p_buffer->p_next;
-            block_Release (p_buffer);
-            p_buffer = p_next;
+            ssize_t ret = writev_cb(sys->fd, iov, count);
+            if (ret <= 0)
+            {   /* FIXME: errno is meaningless if ret is zero */
+                if (ret < 0 && errno == EINTR)
+                    continue;
+                block_ChainRelease(block);
+                msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
+                return -1;
+            }
+            val = ret;
+            total += ret;
         }
-        else
+
+        /* Release the blocks fully written, skip what was partially written */
+        while (block != NULL && val >= block->i_buffer)
         {
-            p_buffer->p_buffer += val;
-            p_buffer->i_buffer -= val;
+            block_t *next = block->p_next;
+
+            val -= block->i_buffer;
+            block_Release(block);
+            block = next;
+        }
+
+        if (val > 0)
+        {
+            assert(block != NULL && val < block->i_buffer);
+            block->p_buffer += val;
+            block->i_buffer -= val;
         }
-        i_write += val;
     }
-    return i_write;
+    return total;
+}
+
+/*****************************************************************************
+ * Write: standard write on a file descriptor.
+ *****************************************************************************/
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    return WriteChain(p_access, p_buffer, writev);
 }
 
 static ssize_t WritePipe(sout_access_out_t *access, block_t *block)
 {
-    int *fdp = access->p_sys, fd = *fdp;
-    ssize_t total = 0;
+    return WriteChain(access, block, vlc_writev);
+}
 
-    while (block != NULL)
-    {
-        if (block->i_buffer == 0)
-        {
-            block_t *next = block->p_next;
-            block_Release(block);
-            block = next;
-            continue;
-        }
+#ifdef S_ISSOCK
+static ssize_t SendV(int fd, const struct iovec *iov, int count)
+{
+    struct msghdr msg = {
+        .msg_iov = (struct iovec *)iov,
+        .msg_iovlen = count,
+    };
+
+    return vlc_sendmsg(fd, &msg, 0);
+}
+
+static ssize_t Send(sout_access_out_t *access, block_t *block)
+{
+    return WriteChain(access, block, SendV);
+}
+#endif
+
+#ifdef O_DIRECT
+/*****************************************************************************
+ * Direct I/O: the data is staged in an aligned buffer and written out by
+ * whole buffers, bypassing the page cache. Only the final tail of the file,
+ * which is not a multiple of the alignment, goes through the page cache.
+ *****************************************************************************/
+static int WriteDirectBuffer(sout_access_out_t *access, size_t len)
+{
+    sout_access_out_sys_t *sys = access->p_sys;
+    size_t done = 0;
 
-        /* TODO: vectorized I/O with writev() */
-        ssize_t val = vlc_write(fd, block->p_buffer, block->i_buffer);
-        if (val < 0)
+    while (done < len)
+    {
+        ssize_t val = write(sys->fd, sys->direct_buf + done, len - done);
+        if (val <= 0)
         {
-            if (errno == EINTR)
+            if (val < 0 && errno == EINTR)
                 continue;
-
-            block_ChainRelease(block);
             msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
-            total = -1;
-            break;
+            return -1;
         }
-
-        total += val;
-
-        assert((size_t)val <= block->i_buffer);
-        block->p_buffer += val;
-        block->i_buffer -= val;
+        done += val;
     }
-
-    return total;
+    return 0;
 }
 
-#ifdef S_ISSOCK
-static ssize_t Send(sout_access_out_t *access, block_t *block)
+static ssize_t WriteDirect(sout_access_out_t *access, block_t *block)
 {
-    int *fdp = access->p_sys, fd = *fdp;
-    size_t total = 0;
+    sout_access_out_sys_t *sys = access->p_sys;
+    ssize_t total = 0;
 
     while (block != NULL)
     {
+        size_t len = sys->direct_size - sys->direct_fill;
+        if (len > block->i_buffer)
+            len = block->i_buffer;
+
+        memcpy(sys->direct_buf + sys->direct_fill, block->p_buffer, len);
+        sys->direct_fill += len;
+        block->p_buffer += len;
+        block->i_buffer -= len;
+        total += len;
+
+        if (sys->direct_fill == sys->direct_size)
+        {
+            if (WriteDirectBuffer(access, sys->direct_size))
+            {
+                block_ChainRelease(block);
+                return -1;
+            }
+            sys->direct_fill = 0;
+        }
+
         if (block->i_buffer == 0)
         {
             block_t *next = block->p_next;
             block_Release(block);
             block = next;
-            continue;
         }
+    }
+    return total;
+}
 
-        /* TODO: vectorized I/O with sendmsg() */
-        ssize_t val = vlc_send(fd, block->p_buffer, block->i_buffer, 0);
-        if (val <= 0)
-        {   /* FIXME: errno is meaningless if val is zero */
-            if (errno == EINTR)
-                continue;
-            block_ChainRelease(block);
-            msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
-            return -1;
-        }
+/* Flushes the staging buffer and leaves direct I/O mode for good */
+static int StopDirect(sout_access_out_t *access)
+{
+    sout_access_out_sys_t *sys = access->p_sys;
+    size_t aligned = sys->direct_fill - (sys->direct_fill % sys->direct_align);
+    int ret = WriteDirectBuffer(access, aligned);
 
-        total += val;
+    int flags = fcntl(sys->fd, F_GETFL);
+    if (flags != -1)
+        fcntl(sys->fd, F_SETFL, flags & ~O_DIRECT);
 
-        assert((size_t)val <= block->i_buffer);
-        block->p_buffer += val;
-        block->i_buffer -= val;
+    if (ret == 0)
+    {
+        memmove(sys->direct_buf, sys->direct_buf + aligned,
+                sys->direct_fill - aligned);
+        sys->direct_fill -= aligned;
+        ret = WriteDirectBuffer(access, sys->direct_fill);
     }
-    return total;
+
+    free(sys->direct_buf);
+    sys->direct_buf = NULL;
+    sys->direct_fill = 0;
+    access->pf_write = Write;
+    return ret;
+}
+
+static void StartDirect(sout_access_out_t *access, const struct stat *st)
+{
+    sout_access_out_sys_t *sys = access->p_sys;
+    size_t align = st->st_blksize;
+
+    if (align < 512 || (align & (align - 1)) != 0)
+        align = 4096;
+
+    /* The file offset must be aligned too (when appending) */
+    off_t offset = lseek(sys->fd, 0, SEEK_CUR);
+    size_t size = (DIRECT_BUFFER_SIZE + align - 1) & ~(align - 1);
+
+    if (offset != -1 && (offset % align) == 0)
+        sys->direct_buf = aligned_alloc(align, size);
+
+    if (sys->direct_buf == NULL)
+    {
+        msg_Warn(access, "cannot use direct I/O");
+        int flags = fcntl(sys->fd, F_GETFL);
+        if (flags != -1)
+            fcntl(sys->fd, F_SETFL, flags & ~O_DIRECT);
+        return;
+    }
+
+    sys->direct_size = size;
+    sys->direct_fill = 0;
+    sys->direct_align = align;
+    access->pf_write = WriteDirect;
+    msg_Dbg(access, "using direct I/O (%zu bytes buffer, %zu bytes alignment)",
+            size, align);
 }
 #endif
 
@@ -188,9 +312,14 @@ static ssize_t Send(sout_access_out_t *access, block_t *block)
  *****************************************************************************/
 static int Seek( sout_access_out_t *p_access, uint64_t i_pos )
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
 
-    return lseek(fd, i_pos, SEEK_SET);
+#ifdef O_DIRECT
+    /* Muxers seek to rewrite headers: give up on direct I/O */
+    if (p_sys->direct_buf != NULL && StopDirect(p_access))
+        return -1;
+#endif
+    return lseek(p_sys->fd, i_pos, SEEK_SET);
 }
 
 static int Control( sout_access_out_t *p_access, int i_query, va_list args )
@@ -223,6 +352,9 @@ static const char *const ppsz_sout_options[] = {
     "overwrite",
 #ifdef O_SYNC
     "sync",
+#endif
+#ifdef O_DIRECT
+    "direct",
 #endif
     NULL
 };
@@ -234,10 +366,13 @@ static int Open( vlc_object_t *p_this )
 {
     sout_access_out_t   *p_access = (sout_access_out_t*)p_this;
     int fd;
-    int *fdp = vlc_obj_malloc(p_this, sizeof (*fdp));
+    sout_access_out_sys_t *p_sys = vlc_obj_malloc(p_this, sizeof (*p_sys));
 
-    if (unlikely(fdp == NULL))
+    if (unlikely(p_sys == NULL))
         return VLC_ENOMEM;
+#ifdef O_DIRECT
+    p_sys->direct_buf = NULL;
+#endif
 
     config_ChainParse( p_access, SOUT_CFG_PREFIX, ppsz_sout_options, p_access->p_cfg );
 
@@ -297,10 +432,22 @@ static int Open( vlc_object_t *p_this )
 #ifdef O_SYNC
         if (var_GetBool (p_access, SOUT_CFG_PREFIX"sync"))
             flags |= O_SYNC;
+#endif
+#ifdef O_DIRECT
+        if (var_GetBool (p_access, SOUT_CFG_PREFIX"direct"))
+            flags |= O_DIRECT;
 #endif
         do
         {
             fd = vlc_open (path, flags, 0666);
+#ifdef O_DIRECT
+            if (fd == -1 && errno == EINVAL && (flags & O_DIRECT))
+            {   /* File system without direct I/O support */
+                msg_Warn (p_access, "cannot use direct I/O on %s", path);
+                flags &= ~O_DIRECT;
+                fd = vlc_open (path, flags, 0666);
+            }
+#endif
             if (fd != -1)
                 break;
             if (fd == -1)
@@ -321,8 +468,8 @@ static int Open( vlc_object_t *p_this )
             return VLC_EGENERIC;
     }
 
-    *fdp = fd;
-    p_access->p_sys = fdp;
+    p_sys->fd = fd;
+    p_access->p_sys = p_sys;
 
     struct stat st;
 
@@ -358,6 +505,16 @@ static int Open( vlc_object_t *p_this )
     if (append)
         lseek (fd, 0, SEEK_END);
 
+#ifdef O_DIRECT
+    int fl = fcntl (fd, F_GETFL);
+    if (fl != -1 && (fl & O_DIRECT))
+    {
+        if (p_access->pf_write == Write)
+            StartDirect (p_access, &st);
+        else
+            fcntl (fd, F_SETFL, fl & ~O_DIRECT);
+    }
+#endif
     return VLC_SUCCESS;
 }
 
@@ -367,9 +524,13 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
-    int *fdp = p_access->p_sys, fd = *fdp;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
 
-    vlc_close(fd);
+#ifdef O_DIRECT
+    if (p_sys->direct_buf != NULL)
+        StopDirect(p_access);
+#endif
+    vlc_close(p_sys->fd);
     msg_Dbg( p_access, "file access output closed" );
 }
 
@@ -384,6 +545,10 @@ static void Close( vlc_object_t * p_this )
     "on the file path")
 #define SYNC_TEXT N_("Synchronous writing")
 #define SYNC_LONGTEXT N_( "Open the file with synchronous writing.")
+#define DIRECT_TEXT N_("Direct I/O")
+#define DIRECT_LONGTEXT N_( "Write the file with aligned buffers, " \
+    "bypassing the operating system cache. This is meant for long " \
+    "recordings that will not be read back soon.")
 
 vlc_module_begin ()
     set_description( N_("File stream output") )
@@ -397,6 +562,9 @@ vlc_module_begin ()
     add_bool( SOUT_CFG_PREFIX "format", false, FORMAT_TEXT, FORMAT_LONGTEXT )
 #ifdef O_SYNC
     add_bool( SOUT_CFG_PREFIX "sync", false, SYNC_TEXT,SYNC_LONGTEXT )
+#endif
+#ifdef O_DIRECT
+    add_bool( SOUT_CFG_PREFIX "direct", false, DIRECT_TEXT, DIRECT_LONGTEXT )
 #endif
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -152,6 +152,8 @@ bool PlaylistManager::init(bool b_preparsing)
 {
     this->b_preparsing = b_preparsing;
 
+    resources->getConnManager()->setLive(playlist->isLive());
+
     if(!setupPeriod())
         return false;
 
@@ -705,9 +707,6 @@ void PlaylistManager::setBufferingRunState(bool b)
 void PlaylistManager::Run()
 {
     mutex_locker locker {lock};
-    const vlc_tick_t i_min_buffering = bufferingLogic->getMinBuffering(playlist);
-    const vlc_tick_t i_max_buffering = bufferingLogic->getMaxBuffering(playlist);
-    const vlc_tick_t i_target_buffering = bufferingLogic->getStableBuffering(playlist);
     while(1)
     {
         while(!b_buffering && !b_canceled)
@@ -723,6 +722,13 @@ void PlaylistManager::Run()
                 failedupdates++;
         }
 
+        /* Low latency can only be known once the media playlists are loaded */
+        const vlc_tick_t i_min_buffering = bufferingLogic->getMinBuffering(playlist);
+        const vlc_tick_t i_max_buffering = bufferingLogic->getMaxBuffering(playlist);
+        const vlc_tick_t i_target_buffering = bufferingLogic->getStableBuffering(playlist);
+        resources->getConnManager()->setLowLatency(bufferingLogic->isLowLatency(playlist));
+        resources->getConnManager()->setLive(playlist->isLive());
+
         vlc_mutex_lock(&demux.lock);
         Times pcr = demux.times;
         vlc_mutex_unlock(&demux.lock);
@@ -940,6 +946,9 @@ AbstractBufferingLogic *PlaylistManager::createBufferingLogic() const
         v = var_InheritInteger(p_demux, "adaptive-maxbuffer");
         if(v)
             bl->setUserMaxBuffering(VLC_TICK_FROM_MS(v));
+        int lowlatency = var_InheritInteger(p_demux, "adaptive-lowlatency");
+        if(lowlatency != -1)
+            bl->setLowDelay(lowlatency);
     }
     return bl;
 }
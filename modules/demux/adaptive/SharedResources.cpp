@@ -25,8 +25,11 @@
 #include "http/AuthStorage.hpp"
 #include "http/HTTPConnectionManager.h"
 #include "http/HTTPConnection.hpp"
+#include "http/DiskCache.hpp"
 #include "encryption/Keyring.hpp"
 
+#include <vlc_configuration.h>
+
 using namespace adaptive;
 
 SharedResources::SharedResources(AuthStorage *auth, Keyring *ring,
@@ -59,17 +62,48 @@ AbstractConnectionManager * SharedResources::getConnManager()
     return connManager;
 }
 
+static DiskCache * createDiskCache(vlc_object_t *obj)
+{
+    size_t size = var_InheritInteger(obj, "adaptive-cache-size");
+    if(size == 0)
+        return nullptr;
+
+    std::string dir;
+    char *psz_dir = var_InheritString(obj, "adaptive-cache-dir");
+    if(psz_dir == nullptr)
+    {
+        char *psz_cache = config_GetUserDir(VLC_CACHE_DIR);
+        if(psz_cache == nullptr)
+            return nullptr;
+        dir = std::string(psz_cache) + DIR_SEP "adaptive";
+        free(psz_cache);
+    }
+    else
+    {
+        dir = std::string(psz_dir);
+        free(psz_dir);
+    }
+
+    return new DiskCache(obj, dir, size << 20);
+}
+
 SharedResources * SharedResources::createDefault(vlc_object_t *obj,
                                                  const std::string & playlisturl)
 {
     AuthStorage *auth = new AuthStorage(obj);
     Keyring *keyring = new Keyring(obj);
-    HTTPConnectionManager *m = new HTTPConnectionManager(obj);
+    HTTPConnectionManager *m =
+        new HTTPConnectionManager(obj,
+                                  var_InheritInteger(obj, "adaptive-maxconnections"),
+                                  var_InheritInteger(obj, "adaptive-stream-maxconnections"),
+                                  var_InheritInteger(obj, "adaptive-splitsize") * 1024);
     if(!var_InheritBool(obj, "adaptive-use-access")) /* only use http from access */
         m->addFactory(new LibVLCHTTPConnectionFactory(auth));
     m->addFactory(new StreamUrlConnectionFactory());
     ConnectionParams params(playlisturl);
     if(params.isLocal())
         m->setLocalConnectionsAllowed();
+    else
+        m->setDiskCache(createDiskCache(obj));
     return new SharedResources(auth, keyring, m);
 }
@@ -81,6 +81,28 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_CONNECTIONS_TEXT N_("Maximum parallel downloads")
+#define ADAPT_CONNECTIONS_LONGTEXT N_("Number of segments or segment parts " \
+    "downloaded at the same time")
+
+#define ADAPT_STREAM_CONNECTIONS_TEXT N_("Maximum parallel downloads per stream")
+#define ADAPT_STREAM_CONNECTIONS_LONGTEXT N_("Parallel downloads of a " \
+    "stream share its bandwidth, so that each of them lowers the estimated " \
+    "rate used to select the representation")
+
+#define ADAPT_SPLITSIZE_TEXT N_("Segment part size (KiB)")
+#define ADAPT_SPLITSIZE_LONGTEXT N_("Download segments with a known byte range " \
+    "in parts of this size over several connections. 0 disables splitting.")
+
+#define ADAPT_CACHESIZE_TEXT N_("Disk cache size (MiB)")
+#define ADAPT_CACHESIZE_LONGTEXT N_("Keep downloaded segments of non live streams on disk, " \
+    "for replaying or seeking back without downloading them again. " \
+    "0 disables the disk cache.")
+
+#define ADAPT_CACHEDIR_TEXT N_("Disk cache directory")
+#define ADAPT_CACHEDIR_LONGTEXT N_("Directory where the segments are cached. " \
+    "Defaults to a subdirectory of the user cache directory.")
+
 #define ADAPT_LOWLATENCY_TEXT N_("Low latency")
 #define ADAPT_LOWLATENCY_LONGTEXT N_("Overrides low latency parameters")
 
@@ -141,6 +163,21 @@ vlc_module_begin ()
         add_integer( "adaptive-maxbuffer",
                      MS_FROM_VLC_TICK(AbstractBufferingLogic::DEFAULT_MAX_BUFFERING),
                      ADAPT_MAXBUFFER_TEXT, nullptr )
+        add_integer( "adaptive-maxconnections", 4,
+                     ADAPT_CONNECTIONS_TEXT, ADAPT_CONNECTIONS_LONGTEXT )
+            change_integer_range( 1, 16 )
+        add_integer( "adaptive-stream-maxconnections", 1,
+                     ADAPT_STREAM_CONNECTIONS_TEXT,
+                     ADAPT_STREAM_CONNECTIONS_LONGTEXT )
+            change_integer_range( 1, 16 )
+        add_integer( "adaptive-splitsize", 0,
+                     ADAPT_SPLITSIZE_TEXT, ADAPT_SPLITSIZE_LONGTEXT )
+            change_integer_range( 0, 65536 )
+        add_integer( "adaptive-cache-size", 0,
+                     ADAPT_CACHESIZE_TEXT, ADAPT_CACHESIZE_LONGTEXT )
+            change_integer_range( 0, 65536 )
+        add_directory( "adaptive-cache-dir", nullptr,
+                       ADAPT_CACHEDIR_TEXT, ADAPT_CACHEDIR_LONGTEXT )
         add_integer( "adaptive-lowlatency", -1, ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT )
             change_integer_list(rgi_latency, ppsz_latency)
         set_callbacks( Open, Close )
@@ -29,6 +29,7 @@
 #include "HTTPConnection.hpp"
 #include "HTTPConnectionManager.h"
 #include "Downloader.hpp"
+#include "DiskCache.hpp"
 
 #include <vlc_common.h>
 #include <vlc_block.h>
@@ -121,7 +122,24 @@ block_t * AbstractChunk::doRead(size_t size, bool b_block)
     if(block)
     {
         if(bytesRead == 0)
+        {
+            /* Chunked transfers can deliver partial headers */
+            while(needsMoreHeader(block) && source->hasMoreData())
+            {
+                block_t *more = (b_block) ? source->readBlock() : source->read(size);
+                if(!more)
+                    break;
+                block->p_next = more;
+                block_t *gathered = block_ChainGather(block);
+                if(!gathered)
+                {
+                    block_ChainRelease(block);
+                    return nullptr;
+                }
+                block = gathered;
+            }
             block->i_flags |= BLOCK_FLAG_HEADER;
+        }
         bytesRead += block->i_buffer;
         onDownload(&block);
         block->i_flags &= ~BLOCK_FLAG_HEADER;
@@ -130,6 +148,11 @@ block_t * AbstractChunk::doRead(size_t size, bool b_block)
     return block;
 }
 
+bool AbstractChunk::needsMoreHeader(const block_t *) const
+{
+    return false;
+}
+
 bool AbstractChunk::hasMoreData() const
 {
     return source->hasMoreData();
@@ -260,7 +283,7 @@ void HTTPChunkSource::recycle()
 
 StorageID HTTPChunkSource::makeStorageID(const std::string &s, const BytesRange &r)
 {
-    return std::to_string(r.getStartByte())+ std::to_string(r.getEndByte()) + '@' + s;
+    return std::to_string(r.getStartByte()) + '-' + std::to_string(r.getEndByte()) + '@' + s;
 }
 
 std::string HTTPChunkSource::getContentType() const
@@ -277,6 +300,17 @@ void HTTPChunkSource::setIdentifier(const std::string &s, const BytesRange &r)
     storeid =  makeStorageID(s, r);
 }
 
+/* Scales a download time to the share of the link this download had, from
+ * the request to its end, while other downloads were running */
+vlc_tick_t HTTPChunkSource::getLinkShare(vlc_tick_t time) const
+{
+    const vlc_tick_t wall = downloadEndTime - requestStartTime;
+    const vlc_tick_t link = connManager->getLinkTime(downloadEndTime) - linkStartTime;
+    if(wall <= 0 || link <= 0 || link >= wall)
+        return time;
+    return time * link / wall;
+}
+
 bool HTTPChunkSource::prepare()
 {
     if(prepared)
@@ -285,39 +319,50 @@ bool HTTPChunkSource::prepare()
     if(!connManager)
         return false;
 
-    ConnectionParams connparams = params; /* can be changed on 301 */
-
     requestStartTime = vlc_tick_now();
+    linkStartTime = connManager->getLinkTime(requestStartTime);
+
+    if(!request(&connection, bytesRange, requeststatus))
+        return false;
+
+    /* Because we don't know Chunk size at start, we need to get size
+           from content length */
+    contentLength = connection->getContentLength();
+    prepared = true;
+    responseTime = vlc_tick_now();
+    return true;
+}
+
+bool HTTPChunkSource::request(AbstractConnection **pconn, const BytesRange &range,
+                              RequestStatus &status)
+{
+    ConnectionParams connparams = params; /* can be changed on 301 */
 
     unsigned int i_redirects = 0;
     while(i_redirects++ < http::MAX_REDIRECTS)
     {
-        if(!connection)
+        if(!*pconn)
         {
-            connection = connManager->getConnection(connparams);
-            if(!connection)
+            *pconn = connManager->getConnection(connparams);
+            if(!*pconn)
                 break;
         }
 
-        requeststatus = connection->request(connparams.getPath(), bytesRange);
-        if(requeststatus != RequestStatus::Success)
+        (*pconn)->setValidator(validator);
+        status = (*pconn)->request(connparams.getPath(), range);
+        if(status != RequestStatus::Success)
         {
-            if(requeststatus == RequestStatus::Redirection)
+            if(status == RequestStatus::Redirection)
             {
-                connparams = connection->getRedirection();
-                connection->setUsed(false);
-                connection = nullptr;
+                connparams = (*pconn)->getRedirection();
+                (*pconn)->setUsed(false);
+                *pconn = nullptr;
                 if(!connparams.getUrl().empty())
                     continue;
             }
             break;
         }
 
-        /* Because we don't know Chunk size at start, we need to get size
-               from content length */
-        contentLength = connection->getContentLength();
-        prepared = true;
-        responseTime = vlc_tick_now();
         return true;
     }
 
@@ -329,6 +374,8 @@ block_t * HTTPChunkSource::readBlock()
     return read(HTTPChunkSource::CHUNK_SIZE);
 }
 
+const vlc_tick_t HTTPChunkBufferedSource::IDLE_READ_TIME = VLC_TICK_FROM_MS(50);
+
 HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, AbstractConnectionManager *manager,
                                                  const adaptive::ID &sourceid,
                                                  ChunkType type, const BytesRange &range,
@@ -343,6 +390,19 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     held = false;
     p_read = nullptr;
     inblockreadoffset = 0;
+    merged = 0;
+    unsplit = false;
+    unsplitpart = 0;
+    diskcache = nullptr;
+    cachefresh = false;
+    fromcache = false;
+    stored = false;
+    lowlatency = false;
+    activesize = 0;
+    activetime = 0;
+    burststart = VLC_TICK_INVALID;
+    burstend = VLC_TICK_INVALID;
+    burstsize = 0;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -363,6 +423,15 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
         pp_tail = &p_head;
     }
     buffered = 0;
+
+    /* the first part connection is released by HTTPChunkSource */
+    for(size_t i = 0; i < parts.size(); i++)
+    {
+        if(parts[i].p_head)
+            block_ChainRelease(parts[i].p_head);
+        if(i > 0 && parts[i].connection)
+            parts[i].connection->setUsed(false);
+    }
 }
 
 bool HTTPChunkBufferedSource::isDone() const
@@ -386,14 +455,26 @@ void HTTPChunkBufferedSource::release()
 
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
+    bool b_cached;
+    {
+        mutex_locker locker {lock};
+        b_cached = cachefresh && !prepared;
+    }
+    if(b_cached && loadFromDiskCache())
+        return;
+
     {
         mutex_locker locker {lock};
         if(!prepare())
         {
-            done = true;
-            eof = true;
-            avail.signal();
-            return;
+            if(requeststatus != RequestStatus::NotModified)
+            {
+                done = true;
+                eof = true;
+                avail.signal();
+                return;
+            }
+            b_cached = true;
         }
 
         if(readsize < HTTPChunkSource::CHUNK_SIZE)
@@ -403,6 +484,29 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
             readsize = contentLength - buffered;
     }
 
+    /* Our copy is still valid */
+    if(b_cached)
+    {
+        if(loadFromDiskCache())
+        {
+            diskcache->refresh(storeid, connection->getCacheControl());
+            return;
+        }
+        /* Vanished meanwhile, refetch */
+        mutex_locker locker {lock};
+        connection->setUsed(false);
+        connection = nullptr;
+        if(!prepare())
+        {
+            done = true;
+            eof = true;
+            avail.signal();
+            return;
+        }
+        if(contentLength && readsize > contentLength - buffered)
+            readsize = contentLength - buffered;
+    }
+
     block_t *p_block = block_Alloc(readsize);
     if(!p_block)
     {
@@ -417,6 +521,12 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_tick_t latency;
     } rate = {0,0,0};
 
+    if(lowlatency)
+    {
+        bufferizeLowLatency(p_block, readsize);
+        return;
+    }
+
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
@@ -426,26 +536,20 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         done = true;
         downloadEndTime = vlc_tick_now();
         rate.size = buffered;
-        rate.time = downloadEndTime - requestStartTime;
+        rate.time = getLinkShare(downloadEndTime - requestStartTime);
         rate.latency = responseTime - requestStartTime;
     }
     else
     {
         p_block->i_buffer = (size_t) ret;
         mutex_locker locker {lock};
-        buffered += p_block->i_buffer;
-        block_ChainLastAppend(&pp_tail, p_block);
-        if(p_read == nullptr)
-        {
-            p_read = p_block;
-            inblockreadoffset = 0;
-        }
+        appendBlock(p_block);
         if((size_t) ret < readsize)
         {
             done = true;
             downloadEndTime = vlc_tick_now();
             rate.size = buffered;
-            rate.time = downloadEndTime - requestStartTime;
+            rate.time = getLinkShare(downloadEndTime - requestStartTime);
             rate.latency = responseTime - requestStartTime;
         }
     }
@@ -459,17 +563,420 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     avail.signal();
 }
 
+void HTTPChunkBufferedSource::bufferizeLowLatency(block_t *p_block, size_t readsize)
+{
+    struct
+    {
+        size_t size;
+        vlc_tick_t time;
+        vlc_tick_t latency;
+    } rate = {0,0,0};
+
+    /* Returns as soon as the server sent anything */
+    const vlc_tick_t start = vlc_tick_now();
+    ssize_t ret = connection->readPartial(p_block->p_buffer, readsize);
+    const vlc_tick_t end = vlc_tick_now();
+
+    {
+        mutex_locker locker {lock};
+        if(ret > 0)
+        {
+            p_block->i_buffer = (size_t) ret;
+            appendBlock(p_block);
+            /* A long wait is the server waiting for the encoder, not the link.
+             * It ends the burst, and its data only marks the next one start. */
+            if(end - start >= IDLE_READ_TIME)
+            {
+                if(burstsize)
+                {
+                    activesize += burstsize;
+                    activetime += burstend - burststart;
+                }
+                burststart = end;
+                burstsize = 0;
+            }
+            else
+            {
+                if(burststart == VLC_TICK_INVALID)
+                    burststart = start;
+                burstsize += ret;
+            }
+            burstend = end;
+        }
+        else block_Release(p_block);
+
+        /* The size of a segment being produced is usually unknown */
+        if(ret <= 0 || (contentLength && buffered >= contentLength))
+        {
+            done = true;
+            downloadEndTime = end;
+            if(burstsize)
+            {
+                activesize += burstsize;
+                activetime += burstend - burststart;
+                burstsize = 0;
+            }
+            if(activesize && activetime)
+            {
+                rate.size = activesize;
+                rate.time = activetime;
+            }
+            else
+            {
+                rate.size = buffered;
+                rate.time = downloadEndTime - requestStartTime;
+            }
+            rate.latency = responseTime - requestStartTime;
+        }
+    }
+
+    if(rate.size && rate.time && type == ChunkType::Segment)
+    {
+        connManager->updateDownloadRate(sourceid, rate.size,
+                                        rate.time, rate.latency);
+    }
+
+    avail.signal();
+}
+
+void HTTPChunkBufferedSource::appendBlock(block_t *p_block)
+{
+    buffered += p_block->i_buffer;
+    block_ChainLastAppend(&pp_tail, p_block);
+    if(p_read == nullptr)
+    {
+        p_read = p_block;
+        inblockreadoffset = 0;
+    }
+}
+
+void HTTPChunkBufferedSource::setDiskCache(DiskCache *cache)
+{
+    mutex_locker locker {lock};
+    diskcache = cache;
+    if(!diskcache->lookup(storeid, &cachefresh, &validator))
+    {
+        cachefresh = false;
+        validator.clear();
+    }
+}
+
+bool HTTPChunkBufferedSource::loadFromDiskCache()
+{
+    std::string type;
+    block_t *p_block = diskcache->read(storeid, &type);
+
+    mutex_locker locker {lock};
+    cachefresh = false;
+    validator.clear();
+    if(p_block == nullptr)
+        return false;
+
+    appendBlock(p_block);
+    contentLength = buffered;
+    cachedContentType = type;
+    requeststatus = RequestStatus::Success;
+    prepared = true;
+    fromcache = true;
+    done = true;
+    avail.signal();
+    return true;
+}
+
+void HTTPChunkBufferedSource::storeToDiskCache()
+{
+    std::string cachecontrol, etag, type;
+    {
+        mutex_locker locker {lock};
+        /* Only complete downloads */
+        if(!diskcache || fromcache || stored || !done || !connection ||
+           requeststatus != RequestStatus::Success ||
+           contentLength == 0 || buffered != contentLength)
+            return;
+        /* Split parts can complete the download on any worker */
+        stored = true;
+        cachecontrol = connection->getCacheControl();
+        etag = connection->getETag();
+        type = connection->getContentType();
+    }
+
+    /* Done: the blocks are no longer modified until recycled */
+    diskcache->store(storeid, p_head, buffered, cachecontrol, etag, type);
+}
+
+void HTTPChunkBufferedSource::setLowLatency(bool b)
+{
+    mutex_locker locker {lock};
+    lowlatency = b;
+}
+
+bool HTTPChunkBufferedSource::split(size_t partsize)
+{
+    mutex_locker locker {lock};
+    if(prepared || !parts.empty() || partsize == 0 || lowlatency ||
+       cachefresh || !validator.empty() ||
+       !bytesRange.isValid() || bytesRange.getEndByte() == 0)
+        return false;
+
+    /* HTTP ranges include the end byte */
+    const size_t start = bytesRange.getStartByte();
+    const size_t length = bytesRange.getEndByte() - start + 1;
+    if(length < partsize * 2)
+        return false;
+
+    parts.resize(length / partsize);
+    for(size_t i = 0; i < parts.size(); i++)
+    {
+        Part &part = parts[i];
+        const size_t partstart = start + i * partsize;
+        const size_t partend = (i + 1 < parts.size()) ? partstart + partsize - 1
+                                                      : bytesRange.getEndByte();
+        part.range = BytesRange(partstart, partend);
+        part.connection = nullptr;
+        part.p_head = nullptr;
+        part.pp_tail = &part.p_head;
+        part.length = partend - partstart + 1;
+        part.buffered = 0;
+        part.done = false;
+    }
+
+    contentLength = length;
+    merged = 0;
+    unsplit = false;
+    requestStartTime = VLC_TICK_INVALID;
+    responseTime = VLC_TICK_INVALID;
+    return true;
+}
+
+unsigned HTTPChunkBufferedSource::getPartCount() const
+{
+    mutex_locker locker {lock};
+    return parts.empty() ? 1 : parts.size();
+}
+
+bool HTTPChunkBufferedSource::isPartDone(unsigned index) const
+{
+    mutex_locker locker {lock};
+    return done || (!parts.empty() && parts[index].done);
+}
+
+void HTTPChunkBufferedSource::mergeParts()
+{
+    while(merged < parts.size() && parts[merged].done)
+    {
+        if(++merged == parts.size())
+        {
+            done = true;
+            downloadEndTime = vlc_tick_now();
+            break;
+        }
+
+        /* Data received ahead by the next part can now be read */
+        Part &next = parts[merged];
+        block_t *p_block = next.p_head;
+        next.p_head = nullptr;
+        next.pp_tail = &next.p_head;
+        while(p_block)
+        {
+            block_t *p_next = p_block->p_next;
+            p_block->p_next = nullptr;
+            appendBlock(p_block);
+            p_block = p_next;
+        }
+    }
+}
+
+void HTTPChunkBufferedSource::failPart(unsigned index, RequestStatus status)
+{
+    if(unsplit)
+    {
+        /* The remaining parts were dropped: only the single request counts */
+        if(index == unsplitpart)
+        {
+            requeststatus = (status != RequestStatus::Success) ? status
+                                                               : RequestStatus::GenericError;
+            done = true;
+        }
+        avail.signal();
+        return;
+    }
+
+    /* Once only, the failed part requests everything after the data
+     * already merged, and the data received ahead by the others is dropped */
+    unsplit = true;
+    unsplitpart = index;
+    for(size_t i = merged; i < parts.size(); i++)
+    {
+        Part &other = parts[i];
+        if(other.p_head)
+        {
+            block_ChainRelease(other.p_head);
+            other.p_head = nullptr;
+            other.pp_tail = &other.p_head;
+        }
+        other.done = (i != index);
+    }
+
+    Part &part = parts[index];
+    if(part.connection)
+        part.connection->setUsed(false);
+    if(connection == part.connection)
+        connection = nullptr;
+    part.connection = nullptr;
+}
+
+void HTTPChunkBufferedSource::bufferizePart(unsigned index, size_t readsize)
+{
+    if(parts.empty())
+    {
+        bufferize(readsize);
+        return;
+    }
+
+    /* Only one worker downloads a given part */
+    Part &part = parts[index];
+    AbstractConnection *conn;
+    BytesRange range;
+    size_t remain;
+    bool b_unsplit;
+    {
+        mutex_locker locker {lock};
+        if(done || part.done)
+            return;
+        conn = part.connection;
+        b_unsplit = unsplit;
+        if(b_unsplit)
+        {
+            range = BytesRange(bytesRange.getStartByte() + buffered,
+                               bytesRange.getEndByte());
+            remain = contentLength - buffered;
+        }
+        else
+        {
+            range = part.range;
+            remain = part.length - part.buffered;
+        }
+        if(requestStartTime == VLC_TICK_INVALID)
+        {
+            requestStartTime = vlc_tick_now();
+            linkStartTime = connManager->getLinkTime(requestStartTime);
+        }
+    }
+
+    if(conn == nullptr)
+    {
+        RequestStatus status = RequestStatus::Success;
+        bool b_ok = connManager && request(&conn, range, status);
+
+        mutex_locker locker {lock};
+        part.connection = conn;
+        if(index == 0)
+            connection = conn;
+        /* The server must honor the range */
+        if(!b_ok || conn->getContentLength() != remain)
+        {
+            failPart(index, status);
+            return;
+        }
+        prepared = true;
+        if(responseTime == VLC_TICK_INVALID)
+            responseTime = vlc_tick_now();
+    }
+
+    if(readsize < HTTPChunkSource::CHUNK_SIZE)
+        readsize = HTTPChunkSource::CHUNK_SIZE;
+    if(readsize > remain)
+        readsize = remain;
+
+    block_t *p_block = block_Alloc(readsize);
+    ssize_t ret = p_block ? conn->read(p_block->p_buffer, readsize) : -1;
+
+    struct
+    {
+        size_t size;
+        vlc_tick_t time;
+        vlc_tick_t latency;
+    } rate = {0,0,0};
+
+    {
+        mutex_locker locker {lock};
+        if(ret <= 0 || done || unsplit != b_unsplit)
+        {
+            /* Truncated part, or dropped meanwhile for the single request */
+            if(p_block)
+                block_Release(p_block);
+            if(ret <= 0 && !done && unsplit == b_unsplit)
+                failPart(index, RequestStatus::Success);
+        }
+        else
+        {
+            p_block->i_buffer = (size_t) ret;
+            if(unsplit)
+            {
+                appendBlock(p_block);
+                if(buffered == contentLength)
+                {
+                    part.done = true;
+                    done = true;
+                    downloadEndTime = vlc_tick_now();
+                }
+            }
+            else
+            {
+                part.buffered += p_block->i_buffer;
+                if(index == merged)
+                    appendBlock(p_block);
+                else
+                    block_ChainLastAppend(&part.pp_tail, p_block);
+                if(part.buffered == part.length)
+                {
+                    part.done = true;
+                    mergeParts();
+                }
+            }
+
+            if(done)
+            {
+                rate.size = buffered;
+                rate.time = getLinkShare(downloadEndTime - requestStartTime);
+                rate.latency = responseTime - requestStartTime;
+            }
+        }
+        avail.signal();
+    }
+
+    if(rate.size && rate.time && type == ChunkType::Segment)
+    {
+        connManager->updateDownloadRate(sourceid, rate.size,
+                                        rate.time, rate.latency);
+    }
+}
+
 bool HTTPChunkBufferedSource::hasMoreData() const
 {
     mutex_locker locker {lock};
     return !eof;
 }
 
+std::string HTTPChunkBufferedSource::getContentType() const
+{
+    {
+        mutex_locker locker {lock};
+        if(fromcache)
+            return cachedContentType;
+    }
+    return HTTPChunkSource::getContentType();
+}
+
 void HTTPChunkBufferedSource::recycle()
 {
-    p_read = p_head;
-    inblockreadoffset = 0;
-    consumed = 0;
+    {
+        /* can still be downloading */
+        mutex_locker locker {lock};
+        p_read = p_head;
+        inblockreadoffset = 0;
+        consumed = 0;
+    }
     HTTPChunkSource::recycle();
 }
 
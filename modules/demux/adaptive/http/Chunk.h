@@ -27,6 +27,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "BytesRange.hpp"
 #include "ConnectionParams.hpp"
@@ -43,6 +44,7 @@ namespace adaptive
         class AbstractConnection;
         class AbstractConnectionManager;
         class AbstractChunk;
+        class DiskCache;
 
         enum class ChunkType
         {
@@ -108,6 +110,8 @@ namespace adaptive
                 AbstractChunk(AbstractChunkSource *);
                 AbstractChunkSource *source;
                 virtual void        onDownload      (block_t **) = 0;
+                /* Whether the first block must be completed before onDownload */
+                virtual bool        needsMoreHeader (const block_t *) const;
 
             private:
                 size_t              bytesRead;
@@ -138,9 +142,13 @@ namespace adaptive
                                 bool = false);
 
                 virtual bool        prepare();
+                bool                request(AbstractConnection **, const BytesRange &,
+                                            RequestStatus &);
                 void                setIdentifier(const std::string &, const BytesRange &);
+                vlc_tick_t          getLinkShare(vlc_tick_t) const;
                 AbstractConnection    *connection;
                 AbstractConnectionManager *connManager;
+                std::string         validator; /* ETag of the disk cached copy */
                 mutable vlc::threads::mutex lock;
                 size_t              consumed; /* read pointer */
                 bool                prepared;
@@ -149,6 +157,7 @@ namespace adaptive
                 vlc_tick_t          requestStartTime;
                 vlc_tick_t          responseTime;
                 vlc_tick_t          downloadEndTime;
+                vlc_tick_t          linkStartTime; /* shared link time at request */
 
             private:
                 bool init(const std::string &);
@@ -165,6 +174,7 @@ namespace adaptive
                 virtual block_t *  readBlock       ()  override;
                 virtual block_t *  read            (size_t)  override;
                 virtual bool       hasMoreData     () const  override;
+                virtual std::string getContentType () const  override;
                 virtual void        recycle() override;
 
             protected:
@@ -176,7 +186,43 @@ namespace adaptive
                 void               hold();
                 void               release();
 
+                /* Byte range splitting. Each part is downloaded over its own
+                 * connection, and appended to the read buffer in order. If a
+                 * part fails, the rest of the segment is requested at once. */
+                bool               split(size_t);
+                unsigned           getPartCount() const;
+                void               bufferizePart(unsigned, size_t);
+                bool               isPartDone(unsigned) const;
+
+                /* Disk cache. A fresh copy is used without any request,
+                 * a stale one is revalidated with its ETag. Complete
+                 * downloads are stored by the downloader thread. */
+                void               setDiskCache(DiskCache *);
+                void               storeToDiskCache();
+
+                /* Low latency. Segments still being produced are read as
+                 * their data arrives, and the download rate only accounts
+                 * the bursts of data, not the server idle waits between. */
+                void               setLowLatency(bool);
+                static const vlc_tick_t IDLE_READ_TIME;
+
             private:
+                class Part
+                {
+                    public:
+                        BytesRange          range;
+                        AbstractConnection *connection;
+                        block_t            *p_head; /* data not merged yet */
+                        block_t           **pp_tail;
+                        size_t              length;
+                        size_t              buffered;
+                        bool                done;
+                };
+                void               appendBlock(block_t *);
+                void               bufferizeLowLatency(block_t *, size_t);
+                void               mergeParts();
+                void               failPart(unsigned, RequestStatus);
+                bool               loadFromDiskCache();
                 block_t            *p_head; /* read cache buffer */
                 block_t           **pp_tail;
                 const block_t      *p_read;
@@ -186,6 +232,21 @@ namespace adaptive
                 bool                eof;
                 vlc::threads::condition_variable avail;
                 bool                held;
+                std::vector<Part>   parts; /* empty if not split */
+                unsigned            merged; /* part appended to the read buffer */
+                bool                unsplit; /* rest downloaded by a single part */
+                unsigned            unsplitpart;
+                DiskCache          *diskcache;
+                bool                cachefresh;
+                bool                fromcache;
+                bool                stored;
+                std::string         cachedContentType;
+                bool                lowlatency;
+                size_t              activesize; /* low latency rate accounting */
+                vlc_tick_t          activetime;
+                vlc_tick_t          burststart; /* first byte after idle */
+                vlc_tick_t          burstend;
+                size_t              burstsize;
         };
 
         class HTTPChunk : public AbstractChunk
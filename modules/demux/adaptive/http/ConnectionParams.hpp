@@ -33,6 +33,7 @@ namespace adaptive
         {
             Success,
             Redirection,
+            NotModified,
             Unauthorized,
             NotFound,
             GenericError,
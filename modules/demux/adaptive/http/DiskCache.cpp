@@ -0,0 +1,435 @@
+/*
+ * DiskCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "DiskCache.hpp"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_hash.h>
+#include <vlc_strings.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <sys/stat.h>
+
+using namespace adaptive::http;
+using vlc::threads::mutex_locker;
+
+const int64_t DiskCache::TEMP_FILE_MAX_AGE = 3600;
+
+namespace
+{
+    /* Start of each cache file, followed by the ID, the ETag,
+     * the content type and the data */
+    struct FileHeader
+    {
+        char     magic[8];
+        uint32_t idlength;
+        uint32_t etaglength;
+        uint32_t typelength;
+        uint32_t reserved;
+        int64_t  expires;
+        uint64_t size;
+    };
+
+    const char fileMagic[8] = { 'V', 'L', 'C', 'A', 'D', 'C', '0', '1' };
+
+    bool readString(FILE *f, size_t length, std::string *str)
+    {
+        str->resize(length);
+        return length == 0 || fread(&(*str)[0], length, 1, f) == 1;
+    }
+
+    bool readHeader(FILE *f, FileHeader *header, std::string *id,
+                    std::string *etag, std::string *type)
+    {
+        return fread(header, sizeof(*header), 1, f) == 1 &&
+               !memcmp(header->magic, fileMagic, sizeof(fileMagic)) &&
+               header->idlength <= 65536 && header->etaglength <= 4096 &&
+               header->typelength <= 4096 &&
+               readString(f, header->idlength, id) &&
+               readString(f, header->etaglength, etag) &&
+               readString(f, header->typelength, type);
+    }
+
+    uint64_t getFileSize(const FileHeader &header)
+    {
+        return sizeof(header) + header.idlength + header.etaglength +
+               header.typelength + header.size;
+    }
+}
+
+DiskCache::DiskCache(vlc_object_t *obj, const std::string &dir_, size_t maxsize_)
+{
+    p_object = obj;
+    dir = dir_;
+    maxsize = maxsize_;
+    total = 0;
+    stats = {};
+
+    /* The parent of the cache directory might not exist yet */
+    size_t sep = dir.find_last_of(DIR_SEP_CHAR);
+    if(sep != std::string::npos && sep > 0)
+        vlc_mkdir(dir.substr(0, sep).c_str(), 0700);
+    vlc_mkdir(dir.c_str(), 0700);
+
+    scan();
+}
+
+DiskCache::~DiskCache()
+{
+    msg_Dbg(p_object, "disk cache: %u lookups, %u hits (%u revalidated), "
+            "%u misses, %" PRIu64 " bytes read, %u stored, %u evicted, "
+            "%zu bytes used", stats.lookups, stats.hits, stats.revalidated,
+            stats.lookups - std::min(stats.lookups, stats.hits),
+            stats.bytesread, stats.stored, stats.evicted, total);
+}
+
+std::string DiskCache::getPath(const std::string &filename) const
+{
+    return dir + DIR_SEP + filename;
+}
+
+std::string DiskCache::makeFileName(const StorageID &id)
+{
+    vlc_hash_md5_t md5;
+    uint8_t digest[VLC_HASH_MD5_DIGEST_SIZE];
+    char hex[VLC_HASH_MD5_DIGEST_HEX_SIZE];
+
+    vlc_hash_md5_Init(&md5);
+    vlc_hash_md5_Update(&md5, id.c_str(), id.length());
+    vlc_hash_md5_Finish(&md5, digest, sizeof(digest));
+    vlc_hex_encode_binary(digest, sizeof(digest), hex);
+    return std::string(hex);
+}
+
+int64_t DiskCache::getExpiration(const std::string &cachecontrol, bool *nostore)
+{
+    const int64_t now = time(nullptr);
+    int64_t expires = 0; /* without directive, segments are kept until evicted */
+    bool nocache = false;
+
+    *nostore = false;
+
+    size_t pos = 0;
+    while(pos < cachecontrol.length())
+    {
+        size_t end = cachecontrol.find(',', pos);
+        if(end == std::string::npos)
+            end = cachecontrol.length();
+        std::string directive = cachecontrol.substr(pos, end - pos);
+        pos = end + 1;
+
+        directive.erase(0, directive.find_first_not_of(" \t"));
+        const char *psz = directive.c_str();
+        if(!vlc_ascii_strncasecmp(psz, "no-store", 8))
+            *nostore = true;
+        else if(!vlc_ascii_strncasecmp(psz, "no-cache", 8))
+            nocache = true;
+        else if(!vlc_ascii_strncasecmp(psz, "max-age=", 8))
+            expires = now + strtoll(psz + 8, nullptr, 10);
+    }
+
+    /* Stored, but revalidated on every use */
+    if(nocache || expires < 0)
+        expires = now;
+
+    return expires;
+}
+
+void DiskCache::scan()
+{
+    vlc_DIR *d = vlc_opendir(dir.c_str());
+    if(d == nullptr)
+    {
+        msg_Warn(p_object, "cannot open disk cache directory %s", dir.c_str());
+        return;
+    }
+
+    std::vector<std::pair<time_t, Entry>> found;
+    const char *name;
+    while((name = vlc_readdir(d)) != nullptr)
+    {
+        if(name[0] == '.')
+            continue;
+
+        const std::string path = getPath(name);
+        struct stat st;
+        if(vlc_stat(path.c_str(), &st) || !S_ISREG(st.st_mode))
+            continue;
+
+        /* Being written by another instance, unless left by an interrupted
+         * store. The entry names have no dot. */
+        if(strchr(name, '.') != nullptr)
+        {
+            if(time(nullptr) - st.st_mtime > TEMP_FILE_MAX_AGE)
+                vlc_unlink(path.c_str());
+            continue;
+        }
+
+        FILE *f = vlc_fopen(path.c_str(), "rb");
+        if(f == nullptr)
+            continue;
+
+        FileHeader header;
+        Entry entry;
+        std::string type;
+        bool b_valid = readHeader(f, &header, &entry.id, &entry.etag, &type) &&
+                       makeFileName(entry.id) == name &&
+                       (uint64_t) st.st_size == getFileSize(header);
+        fclose(f);
+
+        if(!b_valid)
+        {
+            vlc_unlink(path.c_str());
+            continue;
+        }
+
+        entry.filename = name;
+        entry.expires = header.expires;
+        entry.size = header.size;
+        found.push_back(std::make_pair(st.st_mtime, entry));
+    }
+    vlc_closedir(d);
+
+    std::sort(found.begin(), found.end(),
+              [](const std::pair<time_t, Entry> &a, const std::pair<time_t, Entry> &b)
+              { return a.first < b.first; });
+
+    mutex_locker locker {lock};
+    for(const auto &f : found)
+    {
+        entries.push_back(f.second);
+        index[f.second.id] = std::prev(entries.end());
+        total += f.second.size;
+    }
+    evict(0);
+
+    msg_Dbg(p_object, "disk cache %s: %zu entries, %zu bytes",
+            dir.c_str(), entries.size(), total);
+}
+
+void DiskCache::remove(EntryList::iterator it)
+{
+    vlc_unlink(getPath(it->filename).c_str());
+    total -= it->size;
+    index.erase(it->id);
+    entries.erase(it);
+}
+
+void DiskCache::evict(size_t size)
+{
+    while(!entries.empty() && total + size > maxsize)
+    {
+        remove(entries.begin());
+        stats.evicted++;
+    }
+}
+
+bool DiskCache::lookup(const StorageID &id, bool *fresh, std::string *etag)
+{
+    mutex_locker locker {lock};
+    stats.lookups++;
+
+    auto it = index.find(id);
+    if(it == index.end())
+        return false;
+
+    const Entry &entry = *it->second;
+    if(entry.expires == 0 || entry.expires > time(nullptr))
+    {
+        *fresh = true;
+        etag->clear();
+        return true;
+    }
+
+    if(!entry.etag.empty())
+    {
+        *fresh = false;
+        *etag = entry.etag;
+        return true;
+    }
+
+    /* Stale and can't be revalidated */
+    remove(it->second);
+    return false;
+}
+
+block_t * DiskCache::read(const StorageID &id, std::string *type)
+{
+    std::string path;
+    size_t size;
+    {
+        mutex_locker locker {lock};
+        auto it = index.find(id);
+        if(it == index.end())
+            return nullptr;
+        /* most recently used */
+        entries.splice(entries.end(), entries, it->second);
+        path = getPath(it->second->filename);
+        size = it->second->size;
+    }
+
+    block_t *p_block = nullptr;
+    FILE *f = vlc_fopen(path.c_str(), "rb");
+    if(f != nullptr)
+    {
+        FileHeader header;
+        std::string fileid, etag;
+        if(readHeader(f, &header, &fileid, &etag, type) && fileid == id &&
+           header.size == size && (p_block = block_Alloc(size)) != nullptr &&
+           fread(p_block->p_buffer, 1, size, f) != size)
+        {
+            block_Release(p_block);
+            p_block = nullptr;
+        }
+        fclose(f);
+    }
+
+    mutex_locker locker {lock};
+    auto it = index.find(id);
+    if(p_block == nullptr)
+    {
+        msg_Warn(p_object, "cannot read disk cache entry %s", path.c_str());
+        if(it != index.end())
+            remove(it->second);
+        return nullptr;
+    }
+
+    stats.hits++;
+    stats.bytesread += size;
+    return p_block;
+}
+
+void DiskCache::store(const StorageID &id, const block_t *p_chain, size_t size,
+                      const std::string &cachecontrol, const std::string &etag,
+                      const std::string &type)
+{
+    bool nostore;
+    const int64_t expires = getExpiration(cachecontrol, &nostore);
+    if(nostore || size == 0 || size > maxsize)
+        return;
+
+    Entry entry;
+    entry.id = id;
+    entry.filename = makeFileName(id);
+    entry.etag = etag;
+    entry.expires = expires;
+    entry.size = size;
+
+    {
+        mutex_locker locker {lock};
+        auto it = index.find(id);
+        if(it != index.end() && it->second->size == size &&
+           (it->second->expires == 0 || it->second->expires > time(nullptr)))
+            return; /* already there */
+    }
+
+    FileHeader header;
+    memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.idlength = id.length();
+    header.etaglength = etag.length();
+    header.typelength = type.length();
+    header.reserved = 0;
+    header.expires = expires;
+    header.size = size;
+
+    /* Written aside, then renamed, so that readers never see a partial file.
+     * Unique, as another instance might be storing the same entry. */
+    const std::string path = getPath(entry.filename);
+    std::string tmppath = path + ".XXXXXX";
+    int fd = vlc_mkstemp(&tmppath[0]);
+    if(fd == -1)
+        return;
+    FILE *f = fdopen(fd, "wb");
+    if(f == nullptr)
+    {
+        vlc_close(fd);
+        vlc_unlink(tmppath.c_str());
+        return;
+    }
+
+    size_t written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                     fwrite(id.c_str(), 1, id.length(), f) == id.length() &&
+                     fwrite(etag.c_str(), 1, etag.length(), f) == etag.length() &&
+                     fwrite(type.c_str(), 1, type.length(), f) == type.length();
+    if(written)
+    {
+        written = 0;
+        for(const block_t *p_block = p_chain; p_block; p_block = p_block->p_next)
+            written += fwrite(p_block->p_buffer, 1, p_block->i_buffer, f);
+    }
+    if(fclose(f) || written != size || vlc_rename(tmppath.c_str(), path.c_str()))
+    {
+        msg_Warn(p_object, "cannot write disk cache entry %s", path.c_str());
+        vlc_unlink(tmppath.c_str());
+        return;
+    }
+
+    mutex_locker locker {lock};
+    /* Replaced by the rename */
+    auto it = index.find(id);
+    if(it != index.end())
+    {
+        total -= it->second->size;
+        entries.erase(it->second);
+        index.erase(it);
+    }
+    evict(size);
+    entries.push_back(entry);
+    index[id] = std::prev(entries.end());
+    total += size;
+    stats.stored++;
+}
+
+void DiskCache::refresh(const StorageID &id, const std::string &cachecontrol)
+{
+    bool nostore;
+    const int64_t expires = getExpiration(cachecontrol, &nostore);
+
+    mutex_locker locker {lock};
+    auto it = index.find(id);
+    if(it == index.end())
+        return;
+
+    stats.revalidated++;
+    if(nostore)
+    {
+        remove(it->second);
+        return;
+    }
+
+    it->second->expires = expires;
+    FILE *f = vlc_fopen(getPath(it->second->filename).c_str(), "r+b");
+    if(f != nullptr)
+    {
+        if(fseek(f, offsetof(FileHeader, expires), SEEK_SET) == 0)
+            fwrite(&expires, sizeof(expires), 1, f);
+        fclose(f);
+    }
+}
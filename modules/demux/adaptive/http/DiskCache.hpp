@@ -0,0 +1,102 @@
+/*
+ * DiskCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef DISKCACHE_HPP
+#define DISKCACHE_HPP
+
+#include "Chunk.h"
+
+#include <vlc_common.h>
+#include <vlc_cxx_helpers.hpp>
+
+#include <list>
+#include <map>
+#include <string>
+
+namespace adaptive
+{
+    namespace http
+    {
+        /* Size bounded, least recently used, on disk cache of downloaded
+         * chunks, keyed by their storage ID (URL and byte range).
+         * Entries outlive the playback, and are shared by all the
+         * instances using the same directory. */
+        class DiskCache
+        {
+            public:
+                DiskCache(vlc_object_t *, const std::string &, size_t);
+                ~DiskCache();
+
+                /* Returns true if the entry can be used. If it is not fresh
+                 * anymore, it must be revalidated with the returned ETag. */
+                bool lookup(const StorageID &, bool *, std::string *);
+                /* Returns the data, and its content type */
+                block_t *read(const StorageID &, std::string *);
+                /* Stores the data, with the Cache-Control, ETag and
+                 * Content-Type of the response */
+                void store(const StorageID &, const block_t *, size_t,
+                           const std::string &, const std::string &,
+                           const std::string &);
+                /* Updates the freshness of a revalidated entry */
+                void refresh(const StorageID &, const std::string &);
+                /* Age, in seconds, after which an unfinished store is
+                 * considered interrupted */
+                static const int64_t TEMP_FILE_MAX_AGE;
+
+            private:
+                class Entry
+                {
+                    public:
+                        StorageID id;
+                        std::string filename;
+                        std::string etag;
+                        int64_t expires; /* seconds since the epoch, 0 if never */
+                        size_t size;
+                };
+                using EntryList = std::list<Entry>;
+
+                void scan();
+                void evict(size_t);
+                void remove(EntryList::iterator);
+                std::string getPath(const std::string &) const;
+                static std::string makeFileName(const StorageID &);
+                static int64_t getExpiration(const std::string &, bool *);
+
+                vlc_object_t *p_object;
+                std::string dir;
+                size_t maxsize;
+                size_t total;
+                vlc::threads::mutex lock;
+                EntryList entries; /* least recently used first */
+                std::map<StorageID, EntryList::iterator> index;
+
+                struct
+                {
+                    unsigned lookups;
+                    unsigned hits;
+                    unsigned revalidated;
+                    unsigned stored;
+                    unsigned evicted;
+                    uint64_t bytesread;
+                } stats;
+        };
+    }
+}
+
+#endif // DISKCACHE_HPP
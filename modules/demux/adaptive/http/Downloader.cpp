@@ -22,68 +22,86 @@
 #endif
 
 #include "Downloader.hpp"
+#include "HTTPConnectionManager.h"
 
 #include <vlc_threads.h>
 
-#include <atomic>
+#include <algorithm>
 
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned workers_, unsigned maxperstream_)
 {
     killed = false;
-    thread_handle_valid = false;
-    current = nullptr;
-    cancel_current = false;
+    workers = workers_ ? workers_ : 1;
+    maxperstream = maxperstream_ ? maxperstream_ : 1;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread, static_cast<void *>(this)))
+    while(threads.size() < workers)
     {
-        return false;
+        vlc_thread_t thread;
+        if(vlc_clone(&thread, downloaderThread, static_cast<void *>(this)))
+            break;
+        threads.push_back(thread);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
     kill();
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, nullptr);
+    for(vlc_thread_t thread : threads)
+        vlc_join(thread, nullptr);
 }
 
 void Downloader::kill()
 {
     vlc::threads::mutex_locker locker {lock};
     killed = true;
-    wait_cond.signal();
+    wait_cond.broadcast();
 }
 
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc::threads::mutex_locker locker {lock};
     source->hold();
-    chunks.push_back(source);
-    wait_cond.signal();
+
+    auto it = std::find_if(queues.begin(), queues.end(),
+                           [source](const Queue &q){ return q.sourceid == source->sourceid; });
+    if(it == queues.end())
+    {
+        queues.emplace_back();
+        it = std::prev(queues.end());
+        it->sourceid = source->sourceid;
+        it->active = 0;
+    }
+    it->entries.push_back({source, 0, 0, false});
+    wait_cond.broadcast();
 }
 
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc::threads::mutex_locker locker {lock};
-    while (current == source)
-    {
-        cancel_current = true;
-        updated_cond.wait(lock);
-    }
-
-    if(!source->isDone())
+    for(auto qit = queues.begin(); qit != queues.end(); ++qit)
     {
-        chunks.remove(source);
-        source->release();
+        for(auto it = qit->entries.begin(); it != qit->entries.end(); ++it)
+        {
+            if(it->source != source)
+                continue;
+
+            it->cancel = true;
+            while(it->active)
+                updated_cond.wait(lock);
+
+            qit->entries.erase(it);
+            source->release();
+            if(qit->entries.empty() && qit->active == 0)
+                queues.erase(qit);
+            return;
+        }
     }
 }
 
@@ -95,33 +113,98 @@ void * Downloader::downloaderThread(void *opaque)
     return nullptr;
 }
 
+bool Downloader::pick(Queue **pp_queue, Entry **pp_entry, unsigned *p_part)
+{
+    for(auto qit = queues.begin(); qit != queues.end(); ++qit)
+    {
+        if(qit->active >= maxperstream)
+            continue;
+
+        for(Entry &entry : qit->entries)
+        {
+            if(entry.cancel || entry.nextpart >= entry.source->getPartCount() ||
+               entry.source->isDone())
+                continue;
+
+            *p_part = entry.nextpart++;
+            if(entry.active++ == 0)
+                transferStarted(entry.source);
+            qit->active++;
+            *pp_entry = &entry;
+            *pp_queue = &(*qit);
+            /* round robin between the streams */
+            queues.splice(queues.end(), queues, qit);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Downloader::done(Queue *queue, Entry *entry)
+{
+    if(--entry->active == 0)
+        transferEnded(entry->source);
+    queue->active--;
+
+    if(!entry->cancel && entry->active == 0 &&
+       (entry->nextpart >= entry->source->getPartCount() || entry->source->isDone()))
+    {
+        entry->source->release();
+        queue->entries.remove_if([entry](const Entry &e){ return &e == entry; });
+        if(queue->entries.empty() && queue->active == 0)
+            queues.remove_if([queue](const Queue &q){ return &q == queue; });
+    }
+
+    updated_cond.broadcast();
+    wait_cond.broadcast();
+}
+
+/* The low latency downloads mostly wait for the segment to be produced, and
+ * measure their rate over the bursts of data only */
+void Downloader::transferStarted(HTTPChunkBufferedSource *source)
+{
+    if(!source->lowlatency)
+        source->connManager->transferStarted();
+}
+
+void Downloader::transferEnded(HTTPChunkBufferedSource *source)
+{
+    if(!source->lowlatency)
+        source->connManager->transferEnded();
+}
+
 void Downloader::Run()
 {
+    lock.lock();
     while(1)
     {
-        lock.lock();
+        Queue *queue;
+        Entry *entry;
+        unsigned part;
 
-        while(chunks.empty() && !killed)
+        while(!killed && !pick(&queue, &entry, &part))
             wait_cond.wait(lock);
 
         if(killed)
-        {
-            lock.unlock();
             break;
-        }
 
-        current = chunks.front();
+        HTTPChunkBufferedSource *source = entry->source;
+        bool stop = false;
         lock.unlock();
-        current->bufferize(HTTPChunkSource::CHUNK_SIZE);
-        lock.lock();
-        if(current->isDone() || cancel_current)
+        while(!stop)
         {
-            chunks.pop_front();
-            current->release();
+            source->bufferizePart(part, HTTPChunkSource::CHUNK_SIZE);
+            if(source->isPartDone(part))
+                break;
+            lock.lock();
+            stop = killed || entry->cancel;
+            lock.unlock();
         }
-        cancel_current = false;
-        current = nullptr;
-        updated_cond.signal();
-        lock.unlock();
+        /* Still held: write the cache copy here instead of the reader */
+        if(!stop)
+            source->storeToDiskCache();
+        lock.lock();
+        done(queue, entry);
     }
+    lock.unlock();
 }
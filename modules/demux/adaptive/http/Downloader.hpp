@@ -26,6 +26,7 @@
 #include <vlc_threads.h>
 #include <vlc_cxx_helpers.hpp>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -36,25 +37,46 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1, unsigned = 1);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
 
             private:
+                class Entry
+                {
+                    public:
+                        HTTPChunkBufferedSource *source;
+                        unsigned nextpart; /* next part to hand out */
+                        unsigned active;   /* parts being downloaded */
+                        bool     cancel;
+                };
+
+                /* Chunks of a stream, downloaded in order */
+                class Queue
+                {
+                    public:
+                        ID sourceid;
+                        std::list<Entry> entries;
+                        unsigned active;
+                };
+
                 static void * downloaderThread(void *);
                 void Run();
                 void kill();
-                vlc_thread_t thread_handle;
+                bool pick(Queue **, Entry **, unsigned *);
+                void done(Queue *, Entry *);
+                void transferStarted(HTTPChunkBufferedSource *);
+                void transferEnded(HTTPChunkBufferedSource *);
+                std::vector<vlc_thread_t> threads;
+                unsigned     workers;
+                unsigned     maxperstream; /* concurrent downloads per stream */
                 vlc::threads::mutex lock;
                 vlc::threads::condition_variable wait_cond;
                 vlc::threads::condition_variable updated_cond;
-                bool         thread_handle_valid;
                 bool         killed;
-                bool         cancel_current;
-                std::list<HTTPChunkBufferedSource *> chunks;
-                HTTPChunkBufferedSource *current;
+                std::list<Queue> queues;
         };
 
     }
@@ -63,6 +63,11 @@ bool AbstractConnection::prepare(const ConnectionParams &params_)
     return true;
 }
 
+ssize_t AbstractConnection::readPartial(void *p_buffer, size_t len)
+{
+    return read(p_buffer, len);
+}
+
 size_t AbstractConnection::getContentLength() const
 {
     return contentLength;
@@ -83,6 +88,21 @@ const ConnectionParams & AbstractConnection::getRedirection() const
     return locationparams;
 }
 
+const std::string & AbstractConnection::getCacheControl() const
+{
+    return cacheControl;
+}
+
+const std::string & AbstractConnection::getETag() const
+{
+    return etag;
+}
+
+void AbstractConnection::setValidator(const std::string &v)
+{
+    validator = v;
+}
+
 class adaptive::http::LibVLCHTTPSource : public adaptive::AbstractSource
 {
      friend class LibVLCHTTPConnection;
@@ -147,6 +167,9 @@ class adaptive::http::LibVLCHTTPSource : public adaptive::AbstractSource
                         return -1;
                 }
             }
+            if(!validator.empty() &&
+               vlc_http_msg_add_header(req, "If-None-Match", "%s", validator.c_str()))
+                return -1;
             return 0;
         }
 
@@ -187,15 +210,18 @@ class adaptive::http::LibVLCHTTPSource : public adaptive::AbstractSource
         size_t totalRead;
         struct vlc_http_mgr *http_mgr;
         BytesRange range;
+        std::string validator;
 
     public:
         struct vlc_http_resource *http_res;
         int create(const char *uri,const std::string &ua,
-                   const std::string &ref, const BytesRange &range)
+                   const std::string &ref, const BytesRange &range,
+                   const std::string &validator)
         {
             struct restuple *tpl = new struct restuple;
             tpl->source = this;
             this->range = range;
+            this->validator = validator;
             if (vlc_http_res_init(&tpl->resource, &this->callbacks, http_mgr, uri,
                                   ua.empty() ? nullptr : ua.c_str(),
                                   ref.empty() ? nullptr : ref.c_str()))
@@ -273,6 +299,8 @@ void LibVLCHTTPConnection::reset()
     }
     bytesRange = BytesRange();
     contentType = std::string();
+    cacheControl = std::string();
+    etag = std::string();
     bytesRead = 0;
     contentLength = 0;
 }
@@ -303,7 +331,7 @@ RequestStatus LibVLCHTTPConnection::request(const std::string &path,
     else
         msg_Dbg(p_object, "Retrieving %s", params.getUrl().c_str());
 
-    if(source->create(params.getUrl().c_str(), useragent,referer, range))
+    if(source->create(params.getUrl().c_str(), useragent,referer, range, validator))
         return RequestStatus::GenericError;
 
     struct vlc_credential crd;
@@ -371,6 +399,14 @@ RequestStatus LibVLCHTTPConnection::request(const std::string &path,
     vlc_UrlClean(&crd_url);
     free(psz_realm);
 
+    if (status == 304 && !validator.empty())
+    {
+        const char *cc = vlc_http_msg_get_header(source->http_res->response, "Cache-Control");
+        if(cc)
+            cacheControl = std::string(cc);
+        return RequestStatus::NotModified;
+    }
+
     if (status >= 400)
         return RequestStatus::GenericError;
 
@@ -399,6 +435,14 @@ RequestStatus LibVLCHTTPConnection::request(const std::string &path,
     if(s)
         contentType = std::string(s);
 
+    s = vlc_http_msg_get_header(source->http_res->response, "Cache-Control");
+    if(s)
+        cacheControl = std::string(s);
+
+    s = vlc_http_msg_get_header(source->http_res->response, "ETag");
+    if(s)
+        etag = std::string(s);
+
     s = vlc_http_msg_get_header(source->http_res->response, "Content-Encoding");
     if(s && stream && (strstr(s, "deflate") || strstr(s, "gzip")))
     {
@@ -420,6 +464,13 @@ ssize_t LibVLCHTTPConnection::read(void *p_buffer, size_t len)
     return read;
 }
 
+ssize_t LibVLCHTTPConnection::readPartial(void *p_buffer, size_t len)
+{
+    ssize_t read = vlc_stream_ReadPartial(stream, p_buffer, len);
+    bytesRead = source->totalRead;
+    return read;
+}
+
 void LibVLCHTTPConnection::setUsed( bool b )
 {
     available = !b;
@@ -535,6 +586,32 @@ ssize_t StreamUrlConnection::read(void *p_buffer, size_t len)
     return ret;
 }
 
+ssize_t StreamUrlConnection::readPartial(void *p_buffer, size_t len)
+{
+    if( !p_streamurl )
+        return VLC_EGENERIC;
+
+    if(len == 0)
+        return VLC_SUCCESS;
+
+    const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
+    if (toRead == 0)
+        return VLC_SUCCESS;
+
+    if(len > toRead)
+        len = toRead;
+
+    /* short reads are not EOF here */
+    ssize_t ret = vlc_stream_ReadPartial(p_streamurl, p_buffer, len);
+    if(ret > 0)
+        bytesRead += ret;
+
+    if(ret <= 0 || contentLength == bytesRead)
+        reset();
+
+    return ret;
+}
+
 void StreamUrlConnection::setUsed( bool b )
 {
     available = !b;
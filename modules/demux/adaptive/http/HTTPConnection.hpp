@@ -52,11 +52,19 @@ namespace adaptive
                 virtual RequestStatus request(const std::string& path,
                                               const BytesRange & = BytesRange()) = 0;
                 virtual ssize_t read        (void *p_buffer, size_t len) = 0;
+                /* Returns once any data is available, for content
+                 * still being produced by the server */
+                virtual ssize_t readPartial (void *p_buffer, size_t len);
 
                 virtual size_t  getContentLength() const;
                 virtual size_t  getBytesRead() const;
                 virtual const std::string & getContentType() const;
                 virtual const ConnectionParams &getRedirection() const;
+                virtual const std::string & getCacheControl() const;
+                virtual const std::string & getETag() const;
+                /* ETag of the cached copy, the request then
+                 * returns NotModified if it is still valid */
+                void            setValidator(const std::string &);
                 virtual void    setUsed( bool ) = 0;
 
             protected:
@@ -66,6 +74,9 @@ namespace adaptive
                 bool               available;
                 size_t             contentLength;
                 std::string        contentType;
+                std::string        cacheControl;
+                std::string        etag;
+                std::string        validator;
                 BytesRange         bytesRange;
                 size_t             bytesRead;
         };
@@ -81,6 +92,7 @@ namespace adaptive
                virtual RequestStatus request(const std::string& path,
                                              const BytesRange & = BytesRange()) override;
                virtual ssize_t read         (void *p_buffer, size_t len) override;
+               virtual ssize_t readPartial  (void *p_buffer, size_t len) override;
                virtual void    setUsed      ( bool ) override;
 
             private:
@@ -103,6 +115,7 @@ namespace adaptive
                 virtual RequestStatus request(const std::string& path,
                                               const BytesRange & = BytesRange()) override;
                 virtual ssize_t read        (void *p_buffer, size_t len) override;
+                virtual ssize_t readPartial (void *p_buffer, size_t len) override;
 
                 virtual void    setUsed( bool ) override;
 
@@ -29,6 +29,7 @@
 #include "HTTPConnection.hpp"
 #include "ConnectionParams.hpp"
 #include "Downloader.hpp"
+#include "DiskCache.hpp"
 #include "../tools/Debug.hpp"
 #include <vlc_url.h>
 #include <vlc_http.h>
@@ -42,6 +43,12 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = nullptr;
+    lowLatency = false;
+    live = false;
+    vlc_mutex_init(&linklock);
+    transfers = 0;
+    linktime = 0;
+    linkupdate = vlc_tick_now();
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
@@ -67,22 +74,68 @@ void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *o
     rateObserver = obs;
 }
 
+void AbstractConnectionManager::setLowLatency(bool b)
+{
+    lowLatency = b;
+}
+
+void AbstractConnectionManager::setLive(bool b)
+{
+    live = b;
+}
+
+void AbstractConnectionManager::updateLinkTime(vlc_tick_t now)
+{
+    if(now <= linkupdate)
+        return;
+    if(transfers)
+        linktime += (now - linkupdate) / transfers;
+    linkupdate = now;
+}
+
+void AbstractConnectionManager::transferStarted()
+{
+    vlc_mutex_locker locker(&linklock);
+    updateLinkTime(vlc_tick_now());
+    transfers++;
+}
+
+void AbstractConnectionManager::transferEnded()
+{
+    vlc_mutex_locker locker(&linklock);
+    updateLinkTime(vlc_tick_now());
+    assert(transfers > 0);
+    transfers--;
+}
+
+vlc_tick_t AbstractConnectionManager::getLinkTime(vlc_tick_t now)
+{
+    vlc_mutex_locker locker(&linklock);
+    updateLinkTime(now);
+    return linktime;
+}
+
 void AbstractConnectionManager::deleteSource(AbstractChunkSource *source)
 {
     delete source;
 }
 
-HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_)
+HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_,
+                                                 unsigned maxconnections,
+                                                 unsigned maxstreamconnections,
+                                                 size_t splitsize_)
     : AbstractConnectionManager( p_object_ ),
       localAllowed(false)
 {
     vlc_mutex_init(&lock);
-    downloader = new Downloader();
+    downloader = new Downloader(maxconnections, maxstreamconnections);
     downloaderhp = new Downloader();
     downloader->start();
     downloaderhp->start();
     cache_total = 0;
     cache_max = 1 << 19;
+    splitsize = splitsize_;
+    diskcache = nullptr;
 }
 
 HTTPConnectionManager::~HTTPConnectionManager   ()
@@ -99,6 +152,7 @@ HTTPConnectionManager::~HTTPConnectionManager   ()
     }
     delete downloader;
     delete downloaderhp;
+    delete diskcache;
     this->closeAllConnections();
     while(!factories.empty())
     {
@@ -191,6 +245,23 @@ AbstractChunkSource *HTTPConnectionManager::makeSource(const std::string &url,
             }
             // fallthrough
         case ChunkType::Segment:
+            /* Still being produced, nothing to cache */
+            if(lowLatency && type == ChunkType::Segment)
+            {
+                HTTPChunkBufferedSource *s =
+                        new HTTPChunkBufferedSource(url, this, id, type, range);
+                s->setLowLatency(true);
+                return s;
+            }
+            /* Live servers can reuse the segment names */
+            if(diskcache && !live)
+            {
+                HTTPChunkBufferedSource *s =
+                        new HTTPChunkBufferedSource(url, this, id, type, range);
+                s->setDiskCache(diskcache);
+                return s;
+            }
+            // fallthrough
         case ChunkType::Key:
         case ChunkType::Playlist:
         default:
@@ -257,7 +328,11 @@ void HTTPConnectionManager::start(AbstractChunkSource *source)
 {
     HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
     if(src && !src->isDone())
+    {
+        if(splitsize && src->getChunkType() == ChunkType::Segment)
+            src->split(splitsize);
         getDownloadQueue(src)->schedule(src);
+    }
 }
 
 void HTTPConnectionManager::cancel(AbstractChunkSource *source)
@@ -276,3 +351,9 @@ void HTTPConnectionManager::addFactory(AbstractConnectionFactory *factory)
 {
     factories.push_back(factory);
 }
+
+void HTTPConnectionManager::setDiskCache(DiskCache *cache)
+{
+    delete diskcache;
+    diskcache = cache;
+}
@@ -31,6 +31,7 @@
 #include <vlc_common.h>
 #include <vlc_threads.h>
 
+#include <atomic>
 #include <vector>
 #include <list>
 #include <string>
@@ -45,6 +46,7 @@ namespace adaptive
         class Downloader;
         class AbstractChunkSource;
         class HTTPChunkBufferedSource;
+        class DiskCache;
         enum class ChunkType;
 
         class AbstractConnectionManager : public IDownloadRateObserver
@@ -65,19 +67,38 @@ namespace adaptive
                 virtual void updateDownloadRate(const ID &, size_t,
                                                 vlc_tick_t, vlc_tick_t) override;
                 void setDownloadRateObserver(IDownloadRateObserver *);
+                /* Segments are then read while being produced */
+                void setLowLatency(bool);
+                /* Live segments are not kept on disk */
+                void setLive(bool);
+                /* Downloads running at the same time share the link. The
+                 * link time only advances by the wall time divided by the
+                 * number of downloads, so that their rates add up. */
+                void transferStarted();
+                void transferEnded();
+                vlc_tick_t getLinkTime(vlc_tick_t);
 
             protected:
                 void deleteSource(AbstractChunkSource *);
                 vlc_object_t                                       *p_object;
+                std::atomic<bool>                                   lowLatency;
+                std::atomic<bool>                                   live;
 
             private:
+                void updateLinkTime(vlc_tick_t);
                 IDownloadRateObserver                              *rateObserver;
+                vlc_mutex_t                                         linklock;
+                unsigned                                            transfers;
+                vlc_tick_t                                          linktime;
+                vlc_tick_t                                          linkupdate;
         };
 
         class HTTPConnectionManager : public AbstractConnectionManager
         {
             public:
-                HTTPConnectionManager           (vlc_object_t *p_object);
+                HTTPConnectionManager           (vlc_object_t *p_object,
+                                                 unsigned = 1, unsigned = 1,
+                                                 size_t = 0);
                 virtual ~HTTPConnectionManager  ();
 
                 virtual void    closeAllConnections ()  override;
@@ -91,6 +112,7 @@ namespace adaptive
                 virtual void cancel(AbstractChunkSource *)  override;
                 void         setLocalConnectionsAllowed();
                 void         addFactory(AbstractConnectionFactory *);
+                void         setDiskCache(DiskCache *);
 
             private:
                 void    releaseAllConnections ();
@@ -105,6 +127,8 @@ namespace adaptive
                 std::list<HTTPChunkBufferedSource *> cache;
                 size_t cache_total;
                 size_t cache_max;
+                size_t splitsize;
+                DiskCache *diskcache;
         };
     }
 }
@@ -40,6 +40,8 @@ const vlc_tick_t AbstractBufferingLogic::BUFFERING_LOWEST_LIMIT = VLC_TICK_FROM_
 const vlc_tick_t AbstractBufferingLogic::DEFAULT_MIN_BUFFERING = VLC_TICK_FROM_SEC(6);
 const vlc_tick_t AbstractBufferingLogic::DEFAULT_MAX_BUFFERING = VLC_TICK_FROM_SEC(30);
 const vlc_tick_t AbstractBufferingLogic::DEFAULT_LIVE_BUFFERING = VLC_TICK_FROM_SEC(15);
+const vlc_tick_t AbstractBufferingLogic::LOW_LATENCY_LOWEST_LIMIT = VLC_TICK_FROM_MS(500);
+const vlc_tick_t AbstractBufferingLogic::DEFAULT_LOW_LATENCY_DELAY = VLC_TICK_FROM_SEC(2);
 
 AbstractBufferingLogic::AbstractBufferingLogic()
 {
@@ -102,7 +104,7 @@ uint64_t DefaultBufferingLogic::getStartSegmentNumber(BaseRepresentation *rep) c
 vlc_tick_t DefaultBufferingLogic::getMinBuffering(const BasePlaylist *p) const
 {
     if(isLowLatency(p))
-        return BUFFERING_LOWEST_LIMIT;
+        return getLowLatencyDelay(p);
 
     vlc_tick_t buffering = userMinBuffering ? userMinBuffering
                                             : DEFAULT_MIN_BUFFERING;
@@ -157,6 +159,7 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
 
     /* Get buffering offset min <= max <= live delay */
     vlc_tick_t i_buffering = getBufferingOffset(playlist);
+    const unsigned safety_edge_offset = getSafetyEdgeOffset(playlist);
 
     SegmentList *segmentList = rep->inheritSegmentList();
     SegmentBase *segmentBase = rep->inheritSegmentBase();
@@ -178,7 +181,7 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
         uint64_t safeMinElementNumber = timeline->minElementNumber();
         uint64_t safeMaxElementNumber = timeline->maxElementNumber();
         stime_t safeedgetime, safestarttime, duration;
-        for(unsigned i=0; i<SAFETY_BUFFERING_EDGE_OFFSET; i++)
+        for(unsigned i=0; i<safety_edge_offset; i++)
         {
             if(safeMinElementNumber == safeMaxElementNumber)
                 break;
@@ -242,6 +245,9 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
             /* Compute playback offset and effective finished segment from wall time */
             vlc_tick_t now = vlc_tick_from_sec(time(nullptr));
             vlc_tick_t playbacktime = now - i_buffering;
+            /* Chunked segments are available before their completion */
+            if(isLowLatency(playlist))
+                playbacktime += mediaSegmentTemplate->inheritAvailabilityTimeOffset();
             vlc_tick_t minavailtime = playlist->availabilityStartTime.Get() + rep->getPeriodStart();
             const uint64_t startnumber = mediaSegmentTemplate->inheritStartNumber();
             const Timescale timescale = mediaSegmentTemplate->inheritTimescale();
@@ -272,7 +278,7 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
             }
 
             const uint64_t max_safety_offset = playbacktime - minavailtime / duration;
-            const uint64_t safety_offset = std::min((uint64_t)SAFETY_BUFFERING_EDGE_OFFSET,
+            const uint64_t safety_offset = std::min((uint64_t)safety_edge_offset,
                                                     max_safety_offset);
             if(startnumber + safety_offset <= start)
                 start -= safety_offset;
@@ -317,7 +323,7 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
 
         uint64_t safeedgenumber = back->getSequenceNumber() -
                         std::min((uint64_t)list.size() - 1,
-                                 (uint64_t)SAFETY_BUFFERING_EDGE_OFFSET);
+                                 (uint64_t)safety_edge_offset);
         uint64_t safestartnumber = availableliststartnumber;
 
         for(unsigned i=0; i<SAFETY_EXPURGING_OFFSET; i++)
@@ -369,8 +375,8 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
         if(start == std::numeric_limits<uint64_t>::max())
             return list.front()->getSequenceNumber();
 
-        if(segmentBase->getSequenceNumber() + SAFETY_BUFFERING_EDGE_OFFSET <= start)
-            start -= SAFETY_BUFFERING_EDGE_OFFSET;
+        if(segmentBase->getSequenceNumber() + safety_edge_offset <= start)
+            start -= safety_edge_offset;
         else
             start = segmentBase->getSequenceNumber();
 
@@ -385,6 +391,25 @@ vlc_tick_t DefaultBufferingLogic::getBufferingOffset(const BasePlaylist *p) cons
     return p->isLive() ? getLiveDelay(p) : getMaxBuffering(p);
 }
 
+vlc_tick_t DefaultBufferingLogic::getLowLatencyDelay(const BasePlaylist *p) const
+{
+    vlc_tick_t delay = DEFAULT_LOW_LATENCY_DELAY;
+    if(userLiveDelay)
+        delay = userLiveDelay;
+    else if(p->targetLatency.Get())
+        delay = p->targetLatency.Get();
+    if(p->timeShiftBufferDepth.Get())
+        delay = std::min(delay, p->timeShiftBufferDepth.Get());
+    return std::max(delay, LOW_LATENCY_LOWEST_LIMIT);
+}
+
+unsigned DefaultBufferingLogic::getSafetyEdgeOffset(const BasePlaylist *p) const
+{
+    /* Low latency segments are read while being produced,
+     * so the edge segment is the one to start from */
+    return isLowLatency(p) ? 0 : SAFETY_BUFFERING_EDGE_OFFSET;
+}
+
 bool DefaultBufferingLogic::isLowLatency(const BasePlaylist *p) const
 {
     if(userLowLatency.isSet())
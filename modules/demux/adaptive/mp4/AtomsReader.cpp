@@ -43,12 +43,68 @@ void AtomsReader::clean()
     rootbox = nullptr;
 }
 
+/* Returns the box size, or 0 if the header is incomplete or invalid */
+static uint64_t GetBoxSize(const uint8_t *p, size_t i, vlc_fourcc_t *pi_type)
+{
+    if(i < 8)
+        return 0;
+    uint64_t i_size = GetDWBE(p);
+    *pi_type = VLC_FOURCC(p[4], p[5], p[6], p[7]);
+    if(i_size == 1)
+    {
+        if(i < 16)
+            return 0;
+        i_size = GetQWBE(&p[8]);
+        if(i_size < 16)
+            return 0;
+    }
+    /* 0 extends up to the end of a file we don't have */
+    return (i_size < 8) ? 0 : i_size;
+}
+
+bool AtomsReader::isComplete(const block_t *p_block, vlc_fourcc_t i_type)
+{
+    const uint8_t *p = p_block->p_buffer;
+    size_t i = p_block->i_buffer;
+    for(;;)
+    {
+        vlc_fourcc_t i_boxtype;
+        if(i < 8)
+            return false;
+        uint64_t i_size = GetBoxSize(p, i, &i_boxtype);
+        if(i_boxtype == ATOM_mdat)
+            return true;
+        if(i_size == 0)
+            return i >= 16; /* invalid, no point waiting */
+        if(i_size > i)
+            return false;
+        if(i_boxtype == i_type)
+            return true;
+        p += i_size;
+        i -= i_size;
+    }
+}
+
 bool AtomsReader::parseBlock(block_t *p_block)
 {
     if(rootbox)
         clean();
 
-    stream_t *stream = vlc_stream_MemoryNew( object, p_block->p_buffer, p_block->i_buffer, true);
+    /* Chunked segments can end within a box */
+    size_t i_complete = 0;
+    for(;;)
+    {
+        vlc_fourcc_t i_type;
+        uint64_t i_size = GetBoxSize(&p_block->p_buffer[i_complete],
+                                     p_block->i_buffer - i_complete, &i_type);
+        if(i_size == 0 || i_size > p_block->i_buffer - i_complete)
+            break;
+        i_complete += i_size;
+    }
+    if(i_complete == 0)
+        return false;
+
+    stream_t *stream = vlc_stream_MemoryNew( object, p_block->p_buffer, i_complete, true);
     if (stream)
     {
         rootbox = MP4_BoxNew(ATOM_root);
@@ -59,7 +115,7 @@ bool AtomsReader::parseBlock(block_t *p_block)
         }
         memset(rootbox, 0, sizeof(*rootbox));
         rootbox->i_type = ATOM_root;
-        rootbox->i_size = p_block->i_buffer;
+        rootbox->i_size = i_complete;
         if ( MP4_ReadBoxContainerChildren( stream, rootbox, nullptr ) == 1 )
         {
 #ifndef NDEBUG
@@ -34,7 +34,11 @@ namespace adaptive
                 AtomsReader(vlc_object_t *);
                 ~AtomsReader();
                 void clean();
+                /* Parses the leading complete boxes only */
                 bool parseBlock(block_t *);
+                /* Whether the leading boxes are received up to the given
+                 * box, or up to the media data, from a partial segment */
+                static bool isComplete(const block_t *, vlc_fourcc_t);
 
             protected:
                 vlc_object_t *object;
@@ -74,6 +74,7 @@ namespace adaptive
                 Property<vlc_tick_t>                   timeShiftBufferDepth;
                 Property<vlc_tick_t>                   suggestedPresentationDelay;
                 Property<vlc_tick_t>                   presentationStartOffset;
+                Property<vlc_tick_t>                   targetLatency;
 
             protected:
                 vlc_object_t                       *p_object;
@@ -115,6 +115,17 @@ void SegmentList::updateWith(AbstractMultipleSegmentBaseType *updated_,
         const Segment * prevSegment = segments.back();
         const uint64_t oldest = updated->segments.front()->getSequenceNumber();
 
+        /* Low latency segments were listed with an estimated
+         * duration while being produced */
+        for(const Segment *seg : updated->segments)
+        {
+            if(seg->getSequenceNumber() == prevSegment->getSequenceNumber())
+            {
+                segments.back()->duration.Set(seg->duration.Get());
+                break;
+            }
+        }
+
         /* filter out known segments from the update */
         updated->pruneBySegmentNumber(prevSegment->getSequenceNumber() + 1);
 
@@ -0,0 +1,188 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../http/DiskCache.hpp"
+
+#include "../test.hpp"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sys/stat.h>
+#include <utime.h>
+
+using namespace adaptive::http;
+
+static const size_t ENTRY_SIZE = 1000;
+
+/* Split in two blocks, as the chunks are stored from the read buffer chain */
+static block_t * makeData(char c)
+{
+    block_t *p_first = block_Alloc(ENTRY_SIZE / 2);
+    block_t *p_second = block_Alloc(ENTRY_SIZE - ENTRY_SIZE / 2);
+    memset(p_first->p_buffer, c, p_first->i_buffer);
+    memset(p_second->p_buffer, c + 1, p_second->i_buffer);
+    p_first->p_next = p_second;
+    return p_first;
+}
+
+static bool checkData(block_t *p_block, char c)
+{
+    bool b_ok = p_block && p_block->i_buffer == ENTRY_SIZE &&
+                p_block->p_buffer[0] == c &&
+                p_block->p_buffer[ENTRY_SIZE / 2 - 1] == c &&
+                p_block->p_buffer[ENTRY_SIZE / 2] == c + 1 &&
+                p_block->p_buffer[ENTRY_SIZE - 1] == c + 1;
+    if(p_block)
+        block_Release(p_block);
+    return b_ok;
+}
+
+static void store(DiskCache &cache, const StorageID &id, char c,
+                  const std::string &cachecontrol, const std::string &etag)
+{
+    block_t *p_data = makeData(c);
+    cache.store(id, p_data, ENTRY_SIZE, cachecontrol, etag, "video/mp4");
+    block_ChainRelease(p_data);
+}
+
+static void cleanup(const std::string &dir)
+{
+    vlc_DIR *d = vlc_opendir(dir.c_str());
+    if(d)
+    {
+        const char *name;
+        while((name = vlc_readdir(d)) != nullptr)
+        {
+            if(name[0] != '.')
+                vlc_unlink((dir + DIR_SEP + name).c_str());
+        }
+        vlc_closedir(d);
+    }
+    remove(dir.c_str());
+}
+
+int DiskCache_test()
+{
+    char tmpl[] = "adaptive-diskcache-XXXXXX";
+    int fd = vlc_mkstemp(tmpl);
+    if(fd == -1)
+        return 1;
+    vlc_close(fd);
+    vlc_unlink(tmpl);
+    const std::string dir = std::string(tmpl) + ".d";
+
+    DiskCache *cache = nullptr;
+    try
+    {
+        cache = new DiskCache(nullptr, dir, ENTRY_SIZE * 3);
+        bool fresh;
+        std::string etag, type;
+
+        Expect(HTTPChunkSource::makeStorageID("a", BytesRange(1, 123)) !=
+               HTTPChunkSource::makeStorageID("a", BytesRange(11, 23)));
+
+        Expect(!cache->lookup("a", &fresh, &etag));
+        store(*cache, "a", 'a', "public, max-age=3600", "\"a1\"");
+        store(*cache, "b", 'b', "", "");
+        Expect(cache->lookup("a", &fresh, &etag));
+        Expect(fresh);
+        Expect(etag.empty());
+        Expect(checkData(cache->read("a", &type), 'a'));
+        Expect(type == "video/mp4");
+
+        /* b is now the least recently used */
+        store(*cache, "c", 'c', "", "");
+        store(*cache, "d", 'd', "", "");
+        Expect(!cache->lookup("b", &fresh, &etag));
+        Expect(cache->lookup("a", &fresh, &etag));
+        Expect(cache->lookup("d", &fresh, &etag));
+
+        /* Stale, with and without validator */
+        store(*cache, "e", 'e', "no-cache", "\"e1\"");
+        Expect(cache->lookup("e", &fresh, &etag));
+        Expect(!fresh);
+        Expect(etag == "\"e1\"");
+        cache->refresh("e", "max-age=60");
+        Expect(cache->lookup("e", &fresh, &etag));
+        Expect(fresh);
+        Expect(checkData(cache->read("e", &type), 'e'));
+
+        store(*cache, "f", 'f', "max-age=0", "");
+        Expect(!cache->lookup("f", &fresh, &etag));
+        store(*cache, "g", 'g', "private, no-store", "\"g1\"");
+        Expect(!cache->lookup("g", &fresh, &etag));
+
+        /* Larger than the whole cache */
+        block_t *p_data = block_Alloc(ENTRY_SIZE * 4);
+        cache->store("h", p_data, p_data->i_buffer, "", "", "");
+        block_Release(p_data);
+        Expect(!cache->lookup("h", &fresh, &etag));
+
+        /* Entries persist */
+        delete cache;
+        cache = new DiskCache(nullptr, dir, ENTRY_SIZE * 3);
+        Expect(cache->lookup("e", &fresh, &etag));
+        Expect(fresh);
+        Expect(checkData(cache->read("e", &type), 'e'));
+        Expect(type == "video/mp4");
+        delete cache;
+
+        /* Shrunk: evicted on startup */
+        cache = new DiskCache(nullptr, dir, ENTRY_SIZE);
+        unsigned count = 0;
+        for(const char *id : {"a", "c", "d", "e"})
+            count += cache->lookup(id, &fresh, &etag);
+        Expect(count == 1);
+        delete cache;
+        cache = nullptr;
+
+        /* Unfinished stores are only purged once old enough */
+        const std::string tmppath = dir + DIR_SEP + "0123abcd.XXXXXX";
+        FILE *f = vlc_fopen(tmppath.c_str(), "wb");
+        Expect(f != nullptr);
+        fclose(f);
+        struct stat st;
+        cache = new DiskCache(nullptr, dir, ENTRY_SIZE);
+        delete cache;
+        cache = nullptr;
+        Expect(vlc_stat(tmppath.c_str(), &st) == 0);
+        struct utimbuf times;
+        times.actime = times.modtime = time(nullptr) -
+                                       DiskCache::TEMP_FILE_MAX_AGE - 60;
+        Expect(utime(tmppath.c_str(), &times) == 0);
+        cache = new DiskCache(nullptr, dir, ENTRY_SIZE);
+        Expect(vlc_stat(tmppath.c_str(), &st) != 0);
+    } catch(...) {
+        delete cache;
+        cleanup(dir);
+        return 1;
+    }
+
+    delete cache;
+    cleanup(dir);
+    return 0;
+}
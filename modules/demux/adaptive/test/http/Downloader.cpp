@@ -0,0 +1,526 @@
+/*****************************************************************************
+ * Downloader.cpp: segment download pool tests
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../http/HTTPConnectionManager.h"
+#include "../../http/HTTPConnection.hpp"
+#include "../../http/Chunk.h"
+#include "../../http/DiskCache.hpp"
+#include "../../ID.hpp"
+
+#include "../test.hpp"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_threads.h>
+
+#include <atomic>
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+static const size_t SEGMENT_SIZE = 300000;
+
+static uint8_t byteAt(size_t offset)
+{
+    return (offset * 7) ^ (offset >> 9);
+}
+
+/* Shared by all the connections of a test */
+class FakeServer
+{
+    public:
+        FakeServer(bool b = false)
+            : waitparallel(b), reading(0), maxreading(0), requests(0),
+              partialsize(0), linkrate(0), sharedrate(0),
+              sharedtime(VLC_TICK_INVALID), ignorerange(false),
+              cutrequest(0), cutsize(0) {}
+
+        /* Holds the first reads until another connection is reading, to check
+         * that the downloads really run in parallel */
+        void enterRead()
+        {
+            vlc::threads::mutex_locker locker {lock};
+            if(++reading > maxreading)
+                maxreading = reading;
+            cond.broadcast();
+            if(!waitparallel)
+                return;
+            vlc_tick_t deadline = vlc_tick_now() + VLC_TICK_FROM_SEC(5);
+            while(maxreading < 2 && vlc_tick_now() < deadline)
+                cond.timedwait(lock, deadline);
+        }
+
+        void leaveRead()
+        {
+            vlc::threads::mutex_locker locker {lock};
+            --reading;
+        }
+
+        /* Waits for the data to go through the link shared by all the
+         * connections, in the order of the reads */
+        void transmit(size_t len)
+        {
+            vlc_tick_t deadline;
+            {
+                vlc::threads::mutex_locker locker {lock};
+                if(!sharedrate)
+                    return;
+                const vlc_tick_t now = vlc_tick_now();
+                if(sharedtime == VLC_TICK_INVALID || sharedtime < now)
+                    sharedtime = now;
+                sharedtime += vlc_tick_from_samples(len, sharedrate);
+                deadline = sharedtime;
+            }
+            vlc_tick_wait(deadline);
+        }
+
+        vlc::threads::mutex lock;
+        vlc::threads::condition_variable cond;
+        bool waitparallel;
+        unsigned reading;
+        unsigned maxreading;
+        std::atomic<unsigned> requests;
+        /* Segment being produced: sent in small parts, with a pause
+         * every stallsize bytes */
+        size_t partialsize;
+        size_t stallsize;
+        /* bytes per second of the partial reads, unlimited if 0 */
+        size_t linkrate;
+        /* bytes per second of all the reads together, unlimited if 0 */
+        size_t sharedrate;
+        vlc_tick_t sharedtime; /* end of the last transmission */
+        /* Always sends the whole segment */
+        bool ignorerange;
+        /* Response ending after cutsize bytes, 0 for none */
+        unsigned cutrequest;
+        size_t cutsize;
+        std::string cachecontrol;
+        std::string etag;
+};
+
+class FakeConnection : public AbstractConnection
+{
+    public:
+        FakeConnection(FakeServer *s) : AbstractConnection(nullptr), server(s),
+                                        linktime(VLC_TICK_INVALID) {}
+        virtual ~FakeConnection() = default;
+        virtual bool canReuse(const ConnectionParams &) const override
+        {
+            return available;
+        }
+        virtual RequestStatus request(const std::string &,
+                                      const BytesRange &range) override
+        {
+            offset = range.isValid() ? range.getStartByte() : 0;
+            end = (range.isValid() && range.getEndByte()) ? range.getEndByte() + 1
+                                                          : SEGMENT_SIZE;
+            if(server->ignorerange)
+            {
+                offset = 0;
+                end = SEGMENT_SIZE;
+            }
+            contentLength = end - offset;
+            bytesRead = 0;
+            linktime = VLC_TICK_INVALID;
+            if(++server->requests == server->cutrequest)
+                end = offset + server->cutsize;
+            cacheControl = server->cachecontrol;
+            etag = server->etag;
+            if(!validator.empty() && validator == etag)
+                return RequestStatus::NotModified;
+            return RequestStatus::Success;
+        }
+        virtual ssize_t read(void *p_buffer, size_t len) override
+        {
+            server->enterRead();
+            if(len > end - offset)
+                len = end - offset;
+            server->transmit(len);
+            uint8_t *p = static_cast<uint8_t *>(p_buffer);
+            for(size_t i = 0; i < len; i++)
+                p[i] = byteAt(offset + i);
+            offset += len;
+            bytesRead += len;
+            server->leaveRead();
+            return len;
+        }
+        virtual ssize_t readPartial(void *p_buffer, size_t len) override
+        {
+            if(!server->partialsize)
+                return read(p_buffer, len);
+            if(len > server->partialsize)
+                len = server->partialsize;
+            if(offset && offset % server->stallsize == 0)
+            {
+                vlc_tick_wait(vlc_tick_now() + VLC_TICK_FROM_MS(100));
+                linktime = VLC_TICK_INVALID;
+            }
+            else if(len > server->stallsize - offset % server->stallsize)
+                len = server->stallsize - offset % server->stallsize;
+            /* The data keeps arriving while nobody reads */
+            if(server->linkrate)
+            {
+                if(linktime == VLC_TICK_INVALID)
+                    linktime = vlc_tick_now();
+                linktime += vlc_tick_from_samples(len, server->linkrate);
+                vlc_tick_wait(linktime);
+            }
+            return read(p_buffer, len);
+        }
+        virtual void setUsed(bool b) override
+        {
+            available = !b;
+        }
+
+    private:
+        FakeServer *server;
+        size_t offset;
+        size_t end;
+        vlc_tick_t linktime; /* arrival of the data read so far */
+};
+
+class FakeConnectionFactory : public AbstractConnectionFactory
+{
+    public:
+        FakeConnectionFactory(FakeServer *s) : server(s) {}
+        virtual ~FakeConnectionFactory() = default;
+        virtual AbstractConnection * createConnection(vlc_object_t *,
+                                                      const ConnectionParams &) override
+        {
+            return new FakeConnection(server);
+        }
+
+    private:
+        FakeServer *server;
+};
+
+class RateObserver : public IDownloadRateObserver
+{
+    public:
+        RateObserver() : count(0), size(0), time(0) {}
+        virtual void updateDownloadRate(const ID &, size_t s,
+                                        vlc_tick_t t, vlc_tick_t) override
+        {
+            count++;
+            size += s;
+            time += t;
+        }
+        std::atomic<unsigned> count;
+        std::atomic<size_t> size;
+        std::atomic<vlc_tick_t> time;
+};
+
+static bool readAll(ChunkInterface *chunk, size_t start, size_t length)
+{
+    size_t total = 0;
+    while(chunk->hasMoreData())
+    {
+        block_t *b = chunk->readBlock();
+        if(!b)
+            break;
+        for(size_t i = 0; i < b->i_buffer; i++)
+        {
+            if(b->p_buffer[i] != byteAt(start + total + i))
+            {
+                block_Release(b);
+                return false;
+            }
+        }
+        total += b->i_buffer;
+        block_Release(b);
+    }
+    return total == length;
+}
+
+static int Sequential_test()
+{
+    FakeServer server;
+    HTTPConnectionManager manager(nullptr);
+    manager.addFactory(new FakeConnectionFactory(&server));
+    RateObserver observer;
+    manager.setDownloadRateObserver(&observer);
+
+    try
+    {
+        HTTPChunk *chunk = new HTTPChunk("http://fake.invalid/seg", &manager,
+                                         ID("video"), ChunkType::Segment,
+                                         BytesRange());
+        Expect(readAll(chunk, 0, SEGMENT_SIZE));
+        delete chunk;
+        Expect(observer.count == 1);
+        Expect(observer.size == SEGMENT_SIZE);
+        Expect(server.maxreading == 1);
+    } catch(...) {
+        return 1;
+    }
+    return 0;
+}
+
+static int Streams_test()
+{
+    FakeServer server(true);
+    /* one download per stream, but the two streams at once */
+    HTTPConnectionManager manager(nullptr, 4, 1);
+    manager.addFactory(new FakeConnectionFactory(&server));
+
+    try
+    {
+        HTTPChunk *video = new HTTPChunk("http://fake.invalid/video", &manager,
+                                         ID("video"), ChunkType::Segment,
+                                         BytesRange());
+        HTTPChunk *audio = new HTTPChunk("http://fake.invalid/audio", &manager,
+                                         ID("audio"), ChunkType::Segment,
+                                         BytesRange());
+        Expect(readAll(audio, 0, SEGMENT_SIZE));
+        Expect(readAll(video, 0, SEGMENT_SIZE));
+        delete video;
+        delete audio;
+        Expect(server.maxreading == 2);
+        Expect(server.requests == 2);
+
+        /* Cancelling while downloading */
+        for(int i = 0; i < 8; i++)
+            delete new HTTPChunk("http://fake.invalid/cancel", &manager,
+                                 ID("video"), ChunkType::Segment, BytesRange());
+    } catch(...) {
+        return 1;
+    }
+    return 0;
+}
+
+static int Rate_test()
+{
+    FakeServer server;
+    server.sharedrate = 2000000;
+    HTTPConnectionManager manager(nullptr, 4, 1);
+    manager.addFactory(new FakeConnectionFactory(&server));
+    RateObserver observer;
+    manager.setDownloadRateObserver(&observer);
+
+    try
+    {
+        HTTPChunk *video = new HTTPChunk("http://fake.invalid/video", &manager,
+                                         ID("video"), ChunkType::Segment,
+                                         BytesRange());
+        HTTPChunk *audio = new HTTPChunk("http://fake.invalid/audio", &manager,
+                                         ID("audio"), ChunkType::Segment,
+                                         BytesRange());
+        Expect(readAll(audio, 0, SEGMENT_SIZE));
+        Expect(readAll(video, 0, SEGMENT_SIZE));
+        delete video;
+        delete audio;
+        Expect(server.maxreading == 2);
+        Expect(observer.count == 2);
+        /* the streams shared the link, and their rates add up to it */
+        Expect(observer.size == 2 * SEGMENT_SIZE);
+        Expect(observer.time > 0);
+        const uint64_t measured = observer.size * CLOCK_FREQ / observer.time;
+        Expect(measured > server.sharedrate * 2 / 3);
+        Expect(measured < server.sharedrate * 3 / 2);
+    } catch(...) {
+        return 1;
+    }
+    return 0;
+}
+
+static int Split_test()
+{
+    FakeServer server(true);
+    HTTPConnectionManager manager(nullptr, 4, 4, 65536);
+    manager.addFactory(new FakeConnectionFactory(&server));
+    RateObserver observer;
+    manager.setDownloadRateObserver(&observer);
+
+    try
+    {
+        const size_t start = 1000;
+        const size_t length = SEGMENT_SIZE - start;
+        HTTPChunk *chunk = new HTTPChunk("http://fake.invalid/seg", &manager,
+                                         ID("video"), ChunkType::Segment,
+                                         BytesRange(start, SEGMENT_SIZE - 1));
+        Expect(readAll(chunk, start, length));
+        delete chunk;
+        /* 4 parts, the last one with the remainder */
+        Expect(server.requests == 4);
+        Expect(server.maxreading >= 2);
+        /* a single measurement for the whole segment */
+        Expect(observer.count == 1);
+        Expect(observer.size == length);
+
+        /* Too small to be split */
+        server.requests = 0;
+        chunk = new HTTPChunk("http://fake.invalid/seg", &manager,
+                              ID("video"), ChunkType::Segment,
+                              BytesRange(0, 100000));
+        Expect(readAll(chunk, 0, 100001));
+        delete chunk;
+        Expect(server.requests == 1);
+
+        /* A part cut short: the rest is requested at once */
+        server.requests = 0;
+        server.cutrequest = 2;
+        server.cutsize = 1000;
+        chunk = new HTTPChunk("http://fake.invalid/seg", &manager,
+                              ID("video"), ChunkType::Segment,
+                              BytesRange(start, SEGMENT_SIZE - 1));
+        Expect(readAll(chunk, start, length));
+        Expect(chunk->getRequestStatus() == RequestStatus::Success);
+        delete chunk;
+        Expect(server.requests > 2);
+        Expect(server.requests <= 5);
+        server.cutrequest = 0;
+
+        /* Ranges refused, also for the single request */
+        server.ignorerange = true;
+        chunk = new HTTPChunk("http://fake.invalid/seg", &manager,
+                              ID("video"), ChunkType::Segment,
+                              BytesRange(start, SEGMENT_SIZE - 1));
+        Expect(!readAll(chunk, start, length));
+        Expect(chunk->getRequestStatus() != RequestStatus::Success);
+        delete chunk;
+        server.ignorerange = false;
+    } catch(...) {
+        return 1;
+    }
+    return 0;
+}
+
+static int LowLatency_test()
+{
+    FakeServer server;
+    server.partialsize = 16384;
+    server.stallsize = 100000;
+    server.linkrate = 4000000;
+    HTTPConnectionManager manager(nullptr, 4, 4, 65536);
+    manager.addFactory(new FakeConnectionFactory(&server));
+    manager.setLowLatency(true);
+    RateObserver observer;
+    manager.setDownloadRateObserver(&observer);
+
+    try
+    {
+        HTTPChunk *chunk = new HTTPChunk("http://fake.invalid/seg", &manager,
+                                         ID("video"), ChunkType::Segment,
+                                         BytesRange());
+        Expect(readAll(chunk, 0, SEGMENT_SIZE));
+        delete chunk;
+        /* never split, as the end is not available yet */
+        Expect(server.requests == 1);
+        Expect(observer.count == 1);
+        /* the waits for the producer are not accounted */
+        Expect(observer.size > 0);
+        Expect(observer.size < SEGMENT_SIZE);
+        /* but the time between the reads of a burst is */
+        Expect(observer.time > 0);
+        const uint64_t measured = observer.size * CLOCK_FREQ / observer.time;
+        Expect(measured > server.linkrate * 2 / 3);
+        Expect(measured < server.linkrate * 3 / 2);
+    } catch(...) {
+        return 1;
+    }
+    return 0;
+}
+
+static int Cache_test()
+{
+    char tmpl[] = "adaptive-downloader-XXXXXX";
+    int fd = vlc_mkstemp(tmpl);
+    if(fd == -1)
+        return 1;
+    vlc_close(fd);
+    vlc_unlink(tmpl);
+    const std::string dir = std::string(tmpl) + ".d";
+
+    FakeServer server;
+    server.cachecontrol = "no-cache";
+    server.etag = "\"v1\"";
+    HTTPConnectionManager *manager = new HTTPConnectionManager(nullptr);
+    manager->addFactory(new FakeConnectionFactory(&server));
+    manager->setDiskCache(new DiskCache(nullptr, dir, 1 << 20));
+    RateObserver observer;
+    manager->setDownloadRateObserver(&observer);
+
+    int ret = 0;
+    try
+    {
+        const char *urls[] = { "http://fake.invalid/seg", "http://fake.invalid/seg2" };
+        auto fetch = [&](const char *url) {
+            HTTPChunk *chunk = new HTTPChunk(url, manager, ID("video"),
+                                             ChunkType::Segment, BytesRange());
+            bool b_ok = readAll(chunk, 0, SEGMENT_SIZE);
+            delete chunk;
+            return b_ok;
+        };
+
+        Expect(fetch(urls[0]));
+        Expect(server.requests == 1);
+        Expect(observer.count == 1);
+
+        /* Revalidated, then read from disk */
+        Expect(fetch(urls[0]));
+        Expect(server.requests == 2);
+        Expect(observer.count == 1);
+
+        /* Modified */
+        server.etag = "\"v2\"";
+        Expect(fetch(urls[0]));
+        Expect(server.requests == 3);
+        Expect(observer.count == 2);
+
+        /* Fresh, without any request */
+        server.cachecontrol = "max-age=3600";
+        Expect(fetch(urls[1]));
+        Expect(fetch(urls[1]));
+        Expect(server.requests == 4);
+        Expect(observer.count == 3);
+
+        /* Never for live streams */
+        manager->setLive(true);
+        Expect(fetch(urls[1]));
+        Expect(server.requests == 5);
+    } catch(...) {
+        ret = 1;
+    }
+
+    delete manager;
+
+    vlc_DIR *d = vlc_opendir(dir.c_str());
+    if(d)
+    {
+        const char *name;
+        while((name = vlc_readdir(d)) != nullptr)
+        {
+            if(name[0] != '.')
+                vlc_unlink((dir + DIR_SEP + name).c_str());
+        }
+        vlc_closedir(d);
+    }
+    remove(dir.c_str());
+    return ret;
+}
+
+int Downloader_test()
+{
+    return Sequential_test() || Streams_test() || Rate_test() || Split_test() ||
+           LowLatency_test() || Cache_test();
+}
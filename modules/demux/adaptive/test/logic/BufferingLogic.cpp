@@ -144,6 +144,20 @@ int BufferingLogic_test()
         Expect(bufferinglogic.getMinBuffering(playlist) >= DefaultBufferingLogic::BUFFERING_LOWEST_LIMIT);
         Expect(bufferinglogic.getLiveDelay(playlist) >= DefaultBufferingLogic::BUFFERING_LOWEST_LIMIT);
 
+        playlist->targetLatency.Set(VLC_TICK_FROM_MS(1500));
+        Expect(bufferinglogic.getMinBuffering(playlist) == VLC_TICK_FROM_MS(1500));
+        Expect(bufferinglogic.getMaxBuffering(playlist) == VLC_TICK_FROM_MS(1500));
+        Expect(bufferinglogic.getLiveDelay(playlist) == VLC_TICK_FROM_MS(1500));
+        Expect(bufferinglogic.getStableBuffering(playlist) == VLC_TICK_FROM_MS(1500));
+
+        playlist->targetLatency.Set(DefaultBufferingLogic::LOW_LATENCY_LOWEST_LIMIT / 2);
+        Expect(bufferinglogic.getMinBuffering(playlist) == DefaultBufferingLogic::LOW_LATENCY_LOWEST_LIMIT);
+
+        bufferinglogic.setUserLiveDelay(VLC_TICK_FROM_SEC(3));
+        Expect(bufferinglogic.getLiveDelay(playlist) == VLC_TICK_FROM_SEC(3));
+        bufferinglogic.setUserLiveDelay(0);
+        playlist->targetLatency.Set(0);
+
         playlist->b_lowlatency = false;
         Expect(bufferinglogic.getStartSegmentNumber(rep) == number);
 
@@ -163,6 +177,13 @@ int BufferingLogic_test()
         Expect(bufferinglogic.getStartSegmentNumber(rep) >=
                22 + DefaultBufferingLogic::SAFETY_EXPURGING_OFFSET);
 
+        /* low latency starts closer to the edge, which it can reach */
+        const uint64_t regularstart = bufferinglogic.getStartSegmentNumber(rep);
+        playlist->b_lowlatency = true;
+        Expect(bufferinglogic.getStartSegmentNumber(rep) > regularstart);
+        Expect(bufferinglogic.getStartSegmentNumber(rep) <= number);
+        playlist->b_lowlatency = false;
+
         delete playlist;
     } catch(...) {
         delete playlist;
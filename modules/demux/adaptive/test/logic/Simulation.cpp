@@ -0,0 +1,159 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../sim/Simulator.hpp"
+#include "../sim/Trace.hpp"
+#include "../../playlist/BasePlaylist.hpp"
+
+#include "../test.hpp"
+
+#include <sstream>
+
+using namespace adaptive;
+using namespace adaptive::logic;
+using namespace adaptive::playlist;
+using namespace adaptive::sim;
+
+static const unsigned SEGMENTS = 15;
+static const unsigned SEGMENT_DURATION = 4;
+static const unsigned RATES[] = { 200000, 400000, 800000 };
+
+static void addContent(SimConnectionManager *manager)
+{
+    std::ostringstream master;
+    master << "#EXTM3U\n";
+    for(unsigned rate : RATES)
+    {
+        const std::string base = "sim://host/" + std::to_string(rate);
+        master << "#EXT-X-STREAM-INF:BANDWIDTH=" << rate << "\n"
+               << base << ".m3u8\n";
+
+        std::ostringstream media;
+        media << "#EXTM3U\n"
+              << "#EXT-X-TARGETDURATION:" << SEGMENT_DURATION << "\n"
+              << "#EXT-X-PLAYLIST-TYPE:VOD\n";
+        for(unsigned i = 0; i < SEGMENTS; i++)
+        {
+            const std::string url = base + "-" + std::to_string(i) + ".ts";
+            media << "#EXTINF:" << SEGMENT_DURATION << ".0,\n" << url << "\n";
+            manager->addContent(url, std::string(rate / 8 * SEGMENT_DURATION, '\0'));
+        }
+        media << "#EXT-X-ENDLIST\n";
+        manager->addContent(base + ".m3u8", media.str());
+    }
+    manager->addContent("sim://host/master.m3u8", master.str());
+}
+
+static Results Simulate(const Trace &trace, AbstractAdaptationLogic::LogicType type)
+{
+    Simulator sim(&trace);
+    addContent(sim.getConnManager());
+    BasePlaylist *playlist = sim.loadPlaylist("sim://host/master.m3u8");
+    if(!playlist)
+        return Results();
+    Results results = sim.run(playlist, type);
+    delete playlist;
+    return results;
+}
+
+static void Trace_test()
+{
+    Trace trace;
+    std::istringstream in("# time Mbit/s latency\n"
+                          "10 1 100\n"
+                          "11 0\n"
+                          "\n"
+                          "12 1\n");
+    Expect(trace.load(in));
+    Expect(trace.getAverageRate() == 2000000 / 3);
+
+    vlc_tick_t latency;
+    Expect(trace.getTransferTime(0, 125000, &latency) == VLC_TICK_FROM_MS(1100) + VLC_TICK_FROM_SEC(1));
+    Expect(latency == VLC_TICK_FROM_MS(100));
+    Expect(trace.getTransferTime(VLC_TICK_FROM_MS(500), 62500, &latency) == VLC_TICK_FROM_MS(1600));
+    /* loops */
+    Expect(trace.getTransferTime(VLC_TICK_FROM_SEC(3), 62500, &latency) == VLC_TICK_FROM_MS(600));
+    Expect(trace.getTransferTime(VLC_TICK_FROM_SEC(7), 0, &latency) == VLC_TICK_FROM_SEC(1));
+
+    std::istringstream bad("1 1\n0 1\n");
+    Expect(!trace.load(bad));
+}
+
+int Simulation_test()
+{
+    try
+    {
+        Trace_test();
+
+        Trace fast;
+        fast.addSample(0, 2000000);
+
+        Results r = Simulate(fast, AbstractAdaptationLogic::LogicType::AlwaysLowest);
+        Expect(r.completed);
+        Expect(r.segments == SEGMENTS);
+        Expect(r.played == VLC_TICK_FROM_SEC(SEGMENTS * SEGMENT_DURATION));
+        Expect(r.stalls == 0);
+        Expect(r.switches == 0);
+        Expect(r.level == 1.0);
+        Expect(r.bitrate == RATES[0]);
+        Expect(r.startup > 0 && r.startup < VLC_TICK_FROM_SEC(2));
+
+        r = Simulate(fast, AbstractAdaptationLogic::LogicType::AlwaysBest);
+        Expect(r.completed);
+        Expect(r.stalls == 0);
+        Expect(r.level == 3.0);
+
+        /* Anything below the link rate never stalls */
+        for(auto type : { AbstractAdaptationLogic::LogicType::RateBased,
+                          AbstractAdaptationLogic::LogicType::NearOptimal,
+                          AbstractAdaptationLogic::LogicType::Predictive })
+        {
+            r = Simulate(fast, type);
+            Expect(r.completed);
+            Expect(r.segments == SEGMENTS);
+            Expect(r.stalls == 0);
+            Expect(r.rebuffering == 0);
+        }
+
+        /* Highest is above, lowest below the link rate */
+        Trace slow;
+        slow.addSample(0, 300000);
+
+        r = Simulate(slow, AbstractAdaptationLogic::LogicType::AlwaysBest);
+        Expect(r.completed);
+        Expect(r.stalls > 0);
+        Expect(r.rebuffering > 0);
+
+        r = Simulate(slow, AbstractAdaptationLogic::LogicType::AlwaysLowest);
+        Expect(r.completed);
+        Expect(r.stalls == 0);
+
+        r = Simulate(slow, AbstractAdaptationLogic::LogicType::NearOptimal);
+        Expect(r.completed);
+        Expect(r.bitrate < RATES[2]);
+    } catch(...) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -532,8 +532,85 @@ int M3U8Playlist_test()
         Expect(m3u->isLive() == true);
         BaseRepresentation *rep = m3u->getFirstPeriod()->getAdaptationSets().front()->
                                   getRepresentations().front();
+        /* no safety segment, up to the live edge */
         Expect(bufferingLogic.getStartSegmentNumber(rep) ==
-               (UINT64_C(14) - SEC_FROM_VLC_TICK(DefaultBufferingLogic::BUFFERING_LOWEST_LIMIT)));
+               (UINT64_C(15) - SEC_FROM_VLC_TICK(DefaultBufferingLogic::DEFAULT_LOW_LATENCY_DELAY)));
+
+        delete m3u;
+    }
+    catch (...)
+    {
+        delete m3u;
+        return 1;
+    }
+
+    /* Manifest 6, low latency with parts as ranges */
+    const char manifest6[] =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.5,HOLD-BACK=12\n"
+    "#EXT-X-PART-INF:PART-TARGET=0.5\n"
+    "#EXT-X-MEDIA-SEQUENCE:10\n"
+    "#EXTINF:4\n"
+    "seg10.mp4\n"
+    "#EXT-X-PART:DURATION=0.5,URI=\"seg11.mp4\",BYTERANGE=\"1000@0\"\n"
+    "#EXTINF:4\n"
+    "seg11.mp4\n"
+    "#EXT-X-PART:DURATION=0.5,URI=\"seg12.mp4\",BYTERANGE=\"1000@0\"\n"
+    "#EXT-X-PART:DURATION=0.5,URI=\"seg12.mp4\",BYTERANGE=\"1000@1000\"\n"
+    "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg12.mp4\",BYTERANGE-START=2000\n";
+
+    m3u = ParseM3U8(obj, manifest6, sizeof(manifest6));
+    try
+    {
+        bufferingLogic = DefaultBufferingLogic();
+        Expect(m3u);
+        Expect(m3u->isLive() == true);
+        Expect(m3u->isLowLatency() == true);
+        Expect(m3u->targetLatency.Get() == VLC_TICK_FROM_MS(1500));
+        Expect(bufferingLogic.getMinBuffering(m3u) == VLC_TICK_FROM_MS(1500));
+        Expect(bufferingLogic.getMaxBuffering(m3u) == VLC_TICK_FROM_MS(1500));
+        BaseRepresentation *rep = m3u->getFirstPeriod()->getAdaptationSets().front()->
+                                  getRepresentations().front();
+        /* segment in progress */
+        const Segment *seg = rep->getMediaSegment(12);
+        Expect(seg);
+        Expect(seg->getUrlSegment().toString().find("seg12.mp4") != std::string::npos);
+        Expect(rep->getMediaSegment(13) == nullptr);
+        Expect(bufferingLogic.getStartSegmentNumber(rep) == 12);
+
+        delete m3u;
+    }
+    catch (...)
+    {
+        delete m3u;
+        return 1;
+    }
+
+    /* Manifest 7, low latency with parts as resources */
+    const char manifest7[] =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-SERVER-CONTROL:HOLD-BACK=12\n"
+    "#EXT-X-PART-INF:PART-TARGET=0.5\n"
+    "#EXT-X-MEDIA-SEQUENCE:10\n"
+    "#EXTINF:4\n"
+    "seg10.mp4\n"
+    "#EXTINF:4\n"
+    "seg11.mp4\n"
+    "#EXT-X-PART:DURATION=0.5,URI=\"seg12.0.mp4\"\n"
+    "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg12.1.mp4\"\n";
+
+    m3u = ParseM3U8(obj, manifest7, sizeof(manifest7));
+    try
+    {
+        Expect(m3u);
+        Expect(m3u->isLowLatency() == true);
+        Expect(m3u->targetLatency.Get() == VLC_TICK_FROM_SEC(12));
+        BaseRepresentation *rep = m3u->getFirstPeriod()->getAdaptationSets().front()->
+                                  getRepresentations().front();
+        Expect(rep->getMediaSegment(11));
+        Expect(rep->getMediaSegment(12) == nullptr);
 
         delete m3u;
     }
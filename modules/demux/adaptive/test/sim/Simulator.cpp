@@ -0,0 +1,511 @@
+/*
+ * Simulator.cpp
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "Simulator.hpp"
+#include "Trace.hpp"
+
+#include "../../SegmentTracker.hpp"
+#include "../../SharedResources.hpp"
+#include "../../Time.hpp"
+#include "../../encryption/Keyring.hpp"
+#include "../../logic/AlwaysBestAdaptationLogic.h"
+#include "../../logic/AlwaysLowestAdaptationLogic.hpp"
+#include "../../logic/BufferingLogic.hpp"
+#include "../../logic/NearOptimalAdaptationLogic.hpp"
+#include "../../logic/PredictiveAdaptationLogic.hpp"
+#include "../../logic/RateBasedAdaptationLogic.h"
+#include "../../playlist/BaseAdaptationSet.h"
+#include "../../playlist/BasePeriod.h"
+#include "../../playlist/BasePlaylist.hpp"
+#include "../../playlist/BaseRepresentation.h"
+#include "../../tools/Retrieve.hpp"
+#include "../../../hls/playlist/M3U8.hpp"
+#include "../../../hls/playlist/Parser.hpp"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace adaptive;
+using namespace adaptive::http;
+using namespace adaptive::logic;
+using namespace adaptive::playlist;
+using namespace adaptive::sim;
+
+namespace
+{
+    class SimChunkSource : public AbstractChunkSource
+    {
+        public:
+            SimChunkSource(AbstractConnectionManager *m, ChunkType t,
+                           const BytesRange &range, bool found, std::string &&d)
+                : AbstractChunkSource(t, range), manager(m),
+                  data(std::move(d)), offset(0)
+            {
+                requeststatus = found ? RequestStatus::Success : RequestStatus::NotFound;
+                contentLength = data.size();
+            }
+            virtual ~SimChunkSource() = default;
+
+            virtual void recycle() override
+            {
+                manager->recycleSource(this);
+            }
+            virtual block_t * readBlock() override
+            {
+                return read(data.size() - offset);
+            }
+            virtual block_t * read(size_t size) override
+            {
+                size = std::min(size, data.size() - offset);
+                if(size == 0)
+                    return nullptr;
+                block_t *p_block = block_Alloc(size);
+                if(p_block)
+                {
+                    memcpy(p_block->p_buffer, &data[offset], size);
+                    offset += size;
+                }
+                return p_block;
+            }
+            virtual bool hasMoreData() const override { return offset < data.size(); }
+            virtual size_t getBytesRead() const override { return offset; }
+
+        private:
+            AbstractConnectionManager *manager;
+            std::string data;
+            size_t offset;
+    };
+
+    class SimTrackerListener : public SegmentTrackerListenerInterface
+    {
+        public:
+            SimTrackerListener() : switches(0), duration(0), rep(nullptr) {}
+            virtual ~SimTrackerListener() = default;
+            virtual void trackerEvent(const TrackerEvent &event) override
+            {
+                switch(event.getType())
+                {
+                    case TrackerEvent::Type::RepresentationSwitch:
+                    {
+                        const RepresentationSwitchEvent &e =
+                                static_cast<const RepresentationSwitchEvent &>(event);
+                        if(e.prev && e.next && e.prev != e.next)
+                            switches++;
+                        if(e.next)
+                            rep = e.next;
+                        break;
+                    }
+                    case TrackerEvent::Type::SegmentChange:
+                    {
+                        const SegmentChangedEvent &e =
+                                static_cast<const SegmentChangedEvent &>(event);
+                        if(e.duration != VLC_TICK_INVALID)
+                            duration = e.duration;
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+            unsigned switches;
+            vlc_tick_t duration;
+            const BaseRepresentation *rep;
+    };
+}
+
+SimConnectionManager::SimConnectionManager(const Trace *t)
+    : AbstractConnectionManager(nullptr)
+{
+    trace = t;
+    now = 0;
+    takeTransfers();
+}
+
+AbstractConnection * SimConnectionManager::getConnection(ConnectionParams &)
+{
+    return nullptr;
+}
+
+void SimConnectionManager::addContent(const std::string &url, const std::string &data)
+{
+    contents[url] = data;
+}
+
+bool SimConnectionManager::getContent(const std::string &url, const BytesRange &range,
+                                      std::string *data) const
+{
+    auto it = contents.find(url);
+    if(it != contents.end())
+    {
+        *data = it->second;
+    }
+    else
+    {
+        char *psz_path = vlc_uri2path(url.c_str());
+        if(!psz_path)
+            return false;
+        FILE *f = vlc_fopen(psz_path, "rb");
+        free(psz_path);
+        if(!f)
+            return false;
+        char buf[65536];
+        size_t read;
+        while((read = fread(buf, 1, sizeof(buf), f)) > 0)
+            data->append(buf, read);
+        fclose(f);
+    }
+
+    if(range.isValid())
+    {
+        if(range.getStartByte() >= data->size())
+        {
+            data->clear();
+            return false;
+        }
+        size_t length = std::string::npos;
+        if(range.getEndByte() > 0)
+            length = range.getEndByte() - range.getStartByte() + 1;
+        *data = data->substr(range.getStartByte(), length);
+    }
+    return true;
+}
+
+AbstractChunkSource * SimConnectionManager::makeSource(const std::string &url,
+                                                       const ID &id, ChunkType type,
+                                                       const BytesRange &range)
+{
+    std::string data;
+    bool found = getContent(url, range, &data);
+
+    vlc_tick_t latency;
+    const vlc_tick_t time = trace->getTransferTime(now + transfers.elapsed,
+                                                   data.size(), &latency);
+    transfers.elapsed += time;
+    transfers.bytes += data.size();
+    if(type == ChunkType::Segment)
+    {
+        transfers.segments++;
+        if(found && data.size())
+            updateDownloadRate(id, data.size(), time, latency);
+    }
+
+    return new SimChunkSource(this, type, range, found, std::move(data));
+}
+
+void SimConnectionManager::recycleSource(AbstractChunkSource *source)
+{
+    deleteSource(source);
+}
+
+SimConnectionManager::Transfers SimConnectionManager::takeTransfers()
+{
+    Transfers t = transfers;
+    transfers.elapsed = 0;
+    transfers.bytes = 0;
+    transfers.segments = 0;
+    return t;
+}
+
+void SimConnectionManager::setTime(vlc_tick_t t)
+{
+    now = t;
+}
+
+Results::Results()
+{
+    completed = false;
+    startup = 0;
+    rebuffering = 0;
+    stalls = 0;
+    switches = 0;
+    segments = 0;
+    downloaded = 0;
+    played = 0;
+    bitrate = 0;
+    level = 0.0;
+}
+
+Simulator::Simulator(const Trace *t)
+{
+    trace = t;
+    connManager = new SimConnectionManager(t);
+    resources = new SharedResources(nullptr, new Keyring(nullptr), connManager);
+}
+
+Simulator::~Simulator()
+{
+    delete resources;
+}
+
+SharedResources * Simulator::getResources() const
+{
+    return resources;
+}
+
+SimConnectionManager * Simulator::getConnManager() const
+{
+    return connManager;
+}
+
+BasePlaylist * Simulator::loadPlaylist(const std::string &url)
+{
+    block_t *p_block = Retrieve::HTTP(resources, ChunkType::Playlist, url);
+    if(!p_block)
+        return nullptr;
+
+    hls::playlist::M3U8 *playlist = nullptr;
+    stream_t *substream = vlc_stream_MemoryNew(nullptr, p_block->p_buffer,
+                                               p_block->i_buffer, true);
+    if(substream)
+    {
+        hls::playlist::M3U8Parser parser(resources);
+        playlist = parser.parse(nullptr, substream, url);
+        vlc_stream_Delete(substream);
+    }
+    block_Release(p_block);
+    connManager->takeTransfers();
+    return playlist;
+}
+
+const std::vector<std::string> & Simulator::getLogicNames()
+{
+    static const std::vector<std::string> names = {
+        "predictive", "nearoptimal", "rate", "fixedrate", "lowest", "highest",
+    };
+    return names;
+}
+
+bool Simulator::getLogicType(const std::string &name,
+                             AbstractAdaptationLogic::LogicType *type)
+{
+    static const AbstractAdaptationLogic::LogicType types[] = {
+        AbstractAdaptationLogic::LogicType::Predictive,
+        AbstractAdaptationLogic::LogicType::NearOptimal,
+        AbstractAdaptationLogic::LogicType::RateBased,
+        AbstractAdaptationLogic::LogicType::FixedRate,
+        AbstractAdaptationLogic::LogicType::AlwaysLowest,
+        AbstractAdaptationLogic::LogicType::AlwaysBest,
+    };
+    const std::vector<std::string> &names = getLogicNames();
+    auto it = std::find(names.cbegin(), names.cend(), name);
+    if(it == names.cend())
+        return false;
+    *type = types[std::distance(names.cbegin(), it)];
+    return true;
+}
+
+AbstractAdaptationLogic * Simulator::createLogic(AbstractAdaptationLogic::LogicType type)
+{
+    /* Same as the PlaylistManager, with the fixed rate being the trace average */
+    AbstractAdaptationLogic *logic = nullptr;
+    switch(type)
+    {
+        case AbstractAdaptationLogic::LogicType::FixedRate:
+            logic = new FixedRateAdaptationLogic(nullptr, trace->getAverageRate());
+            break;
+        case AbstractAdaptationLogic::LogicType::AlwaysLowest:
+            logic = new AlwaysLowestAdaptationLogic(nullptr);
+            break;
+        case AbstractAdaptationLogic::LogicType::AlwaysBest:
+            logic = new AlwaysBestAdaptationLogic(nullptr);
+            break;
+        case AbstractAdaptationLogic::LogicType::RateBased:
+        {
+            RateBasedAdaptationLogic *ratelogic = new RateBasedAdaptationLogic(nullptr);
+            connManager->setDownloadRateObserver(ratelogic);
+            logic = ratelogic;
+            break;
+        }
+        case AbstractAdaptationLogic::LogicType::Predictive:
+        {
+            PredictiveAdaptationLogic *predictivelogic = new PredictiveAdaptationLogic(nullptr);
+            connManager->setDownloadRateObserver(predictivelogic);
+            logic = predictivelogic;
+            break;
+        }
+        case AbstractAdaptationLogic::LogicType::Default:
+        case AbstractAdaptationLogic::LogicType::NearOptimal:
+        {
+            NearOptimalAdaptationLogic *noplogic = new NearOptimalAdaptationLogic(nullptr);
+            connManager->setDownloadRateObserver(noplogic);
+            logic = noplogic;
+            break;
+        }
+    }
+    return logic;
+}
+
+Results Simulator::run(BasePlaylist *playlist, AbstractAdaptationLogic::LogicType type)
+{
+    Results results;
+
+    BasePeriod *period = playlist->getFirstPeriod();
+    if(!period || period->getAdaptationSets().empty())
+        return results;
+    BaseAdaptationSet *set = period->getAdaptationSets().front();
+
+    std::vector<uint64_t> rates;
+    for(const BaseRepresentation *rep : set->getRepresentations())
+        rates.push_back(rep->getBandwidth());
+    std::sort(rates.begin(), rates.end());
+    rates.erase(std::unique(rates.begin(), rates.end()), rates.end());
+
+    AbstractAdaptationLogic *logic = createLogic(type);
+    DefaultBufferingLogic bufferingLogic;
+    SynchronizationReferences syncrefs;
+    SimTrackerListener listener;
+
+    const vlc_tick_t minbuffering = bufferingLogic.getMinBuffering(playlist);
+    const vlc_tick_t maxbuffering = bufferingLogic.getMaxBuffering(playlist);
+    const vlc_tick_t targetbuffering = bufferingLogic.getStableBuffering(playlist);
+
+    vlc_tick_t clock = 0;
+    vlc_tick_t buffer = 0;
+    vlc_tick_t stallstart = 0;
+    vlc_tick_t media = 0;
+    bool playing = false;
+    bool started = false;
+    double bits = 0.0;
+    double levels = 0.0;
+
+    auto advance = [&](vlc_tick_t duration)
+    {
+        if(playing)
+        {
+            if(buffer >= duration)
+            {
+                buffer -= duration;
+                results.played += duration;
+            }
+            else
+            {
+                results.played += buffer;
+                stallstart = clock + buffer;
+                buffer = 0;
+                playing = false;
+                results.stalls++;
+            }
+        }
+        clock += duration;
+    };
+
+    auto play = [&]()
+    {
+        playing = true;
+        if(started)
+        {
+            results.rebuffering += clock - stallstart;
+        }
+        else
+        {
+            results.startup = clock;
+            started = true;
+        }
+    };
+
+    connManager->setTime(0);
+    connManager->takeTransfers();
+
+    {
+        SegmentTracker tracker(resources, logic, &bufferingLogic, set, &syncrefs);
+        tracker.registerListener(&listener);
+        tracker.notifyBufferingState(true);
+
+        if(tracker.setStartPosition())
+        {
+            for(;;)
+            {
+                /* Same as the manager, which sleeps when the demuxers are full */
+                if(buffer >= maxbuffering)
+                {
+                    advance(VLC_TICK_FROM_MS(100));
+                    continue;
+                }
+
+                tracker.notifyBufferingLevel(minbuffering, maxbuffering,
+                                             buffer, targetbuffering);
+                connManager->setTime(clock);
+
+                ChunkInterface *chunk = tracker.getNextChunk(true);
+                if(chunk)
+                {
+                    while(chunk->hasMoreData())
+                    {
+                        block_t *p_block = chunk->readBlock();
+                        if(!p_block)
+                            break;
+                        block_Release(p_block);
+                    }
+                    delete chunk;
+                }
+
+                const SimConnectionManager::Transfers transfers = connManager->takeTransfers();
+                advance(transfers.elapsed);
+                results.downloaded += transfers.bytes;
+                if(!chunk)
+                    break;
+
+                if(transfers.segments && listener.rep)
+                {
+                    const vlc_tick_t duration = listener.duration;
+                    const uint64_t bandwidth = listener.rep->getBandwidth();
+                    const size_t level = std::distance(rates.cbegin(),
+                            std::lower_bound(rates.cbegin(), rates.cend(), bandwidth)) + 1;
+                    buffer += duration;
+                    media += duration;
+                    bits += (double) bandwidth * duration;
+                    levels += (double) level * duration;
+                    results.segments++;
+
+                    if(!playing && buffer > 0 && (started || buffer >= minbuffering))
+                        play();
+                }
+            }
+
+            /* Play out what remains */
+            if(!playing && buffer > 0)
+                play();
+            advance(buffer);
+            results.completed = results.segments > 0;
+        }
+
+        tracker.notifyBufferingState(false);
+    }
+
+    connManager->setDownloadRateObserver(nullptr);
+    delete logic;
+
+    results.switches = listener.switches;
+    if(media > 0)
+    {
+        results.bitrate = bits / media;
+        results.level = levels / media;
+    }
+    return results;
+}
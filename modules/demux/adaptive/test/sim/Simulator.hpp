@@ -0,0 +1,129 @@
+/*
+ * Simulator.hpp
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef ADAPTIVE_SIM_SIMULATOR_HPP
+#define ADAPTIVE_SIM_SIMULATOR_HPP
+
+#include "../../http/HTTPConnectionManager.h"
+#include "../../logic/AbstractAdaptationLogic.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace adaptive
+{
+    class SharedResources;
+
+    namespace playlist
+    {
+        class BasePlaylist;
+    }
+
+    namespace sim
+    {
+        class Trace;
+
+        /* Serves the registered content, or local files from file:// URLs,
+         * and accounts the time the transfers would take over the trace */
+        class SimConnectionManager : public http::AbstractConnectionManager
+        {
+            public:
+                SimConnectionManager(const Trace *);
+                virtual ~SimConnectionManager() = default;
+
+                virtual void closeAllConnections() override {}
+                virtual http::AbstractConnection * getConnection(http::ConnectionParams &) override;
+                virtual http::AbstractChunkSource *makeSource(const std::string &,
+                                                              const ID &, http::ChunkType,
+                                                              const http::BytesRange &) override;
+                virtual void recycleSource(http::AbstractChunkSource *) override;
+                virtual void start(http::AbstractChunkSource *) override {}
+                virtual void cancel(http::AbstractChunkSource *) override {}
+
+                void addContent(const std::string &, const std::string &);
+
+                class Transfers
+                {
+                    public:
+                        vlc_tick_t elapsed;
+                        size_t     bytes;
+                        unsigned   segments;
+                };
+                /* Transfers since the last call */
+                Transfers takeTransfers();
+                void setTime(vlc_tick_t);
+
+            private:
+                bool getContent(const std::string &, const http::BytesRange &,
+                                std::string *) const;
+                const Trace *trace;
+                vlc_tick_t now;
+                Transfers transfers;
+                std::map<std::string, std::string> contents;
+        };
+
+        class Results
+        {
+            public:
+                Results();
+                bool       completed;
+                vlc_tick_t startup;     /* until playback starts */
+                vlc_tick_t rebuffering; /* stalled after the start */
+                unsigned   stalls;
+                unsigned   switches;
+                unsigned   segments;
+                size_t     downloaded;
+                vlc_tick_t played;
+                uint64_t   bitrate;     /* played media average, bit/s */
+                double     level;       /* played representation average,
+                                           from 1 for the lowest */
+        };
+
+        /* Plays the first adaptation set of a playlist with a given logic,
+         * against a virtual clock driven by the trace. The segments are
+         * fetched through the same SegmentTracker and buffering logic
+         * as the PlaylistManager, and played out in real time once the
+         * minimum buffering is reached. */
+        class Simulator
+        {
+            public:
+                Simulator(const Trace *);
+                ~Simulator();
+
+                SharedResources *getResources() const;
+                SimConnectionManager *getConnManager() const;
+                /* Fetches and parses a HLS playlist through the connection manager */
+                playlist::BasePlaylist *loadPlaylist(const std::string &);
+                Results run(playlist::BasePlaylist *, logic::AbstractAdaptationLogic::LogicType);
+
+                static bool getLogicType(const std::string &,
+                                         logic::AbstractAdaptationLogic::LogicType *);
+                static const std::vector<std::string> & getLogicNames();
+
+            private:
+                logic::AbstractAdaptationLogic *createLogic(logic::AbstractAdaptationLogic::LogicType);
+                const Trace *trace;
+                SimConnectionManager *connManager;
+                SharedResources *resources;
+        };
+    }
+}
+
+#endif // ADAPTIVE_SIM_SIMULATOR_HPP
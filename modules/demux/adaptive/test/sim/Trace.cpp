@@ -0,0 +1,159 @@
+/*
+ * Trace.cpp
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace adaptive::sim;
+
+Trace::Trace()
+{
+}
+
+bool Trace::load(std::istream &in)
+{
+    samples.clear();
+
+    std::string line;
+    double first = -1.0;
+    while(std::getline(in, line))
+    {
+        size_t pos = line.find_first_not_of(" \t\r");
+        if(pos == std::string::npos || line[pos] == '#')
+            continue;
+
+        std::istringstream ss(line);
+        ss.imbue(std::locale("C"));
+        double time, mbps, latency = 0.0;
+        if(!(ss >> time >> mbps) || time < 0.0 || mbps < 0.0)
+            return false;
+        if(!(ss >> latency))
+            latency = 0.0;
+
+        if(first < 0.0)
+            first = time;
+        vlc_tick_t start = (time - first) * CLOCK_FREQ;
+        if(!samples.empty() && start <= samples.back().start)
+            return false;
+        addSample(start, mbps * 1000000, latency * CLOCK_FREQ / 1000);
+    }
+
+    return isValid();
+}
+
+bool Trace::load(const std::string &path)
+{
+    std::ifstream in(path);
+    if(!in.is_open() || !load(in))
+        return false;
+
+    size_t sep = path.find_last_of("/\\");
+    name = (sep == std::string::npos) ? path : path.substr(sep + 1);
+    return true;
+}
+
+void Trace::addSample(vlc_tick_t start, uint64_t bps, vlc_tick_t latency)
+{
+    Sample sample;
+    sample.start = start;
+    sample.bps = bps;
+    sample.latency = latency;
+    samples.push_back(sample);
+}
+
+bool Trace::isValid() const
+{
+    return !samples.empty() && samples.front().start == 0 &&
+           std::any_of(samples.cbegin(), samples.cend(),
+                       [](const Sample &s){ return s.bps > 0; });
+}
+
+const std::string & Trace::getName() const
+{
+    return name;
+}
+
+vlc_tick_t Trace::getSampleEnd(size_t index) const
+{
+    if(index + 1 < samples.size())
+        return samples[index + 1].start;
+    /* the last sample lasts as long as the previous one */
+    if(samples.size() > 1)
+        return samples[index].start + samples[index].start - samples[index - 1].start;
+    return CLOCK_FREQ;
+}
+
+size_t Trace::findSample(vlc_tick_t time) const
+{
+    auto it = std::upper_bound(samples.cbegin(), samples.cend(), time,
+                               [](vlc_tick_t t, const Sample &s){ return t < s.start; });
+    return std::distance(samples.cbegin(), it) - 1;
+}
+
+vlc_tick_t Trace::getTransferTime(vlc_tick_t time, size_t size, vlc_tick_t *latency) const
+{
+    const vlc_tick_t period = getSampleEnd(samples.size() - 1);
+    vlc_tick_t base = time - time % period;
+    size_t index = findSample(time - base);
+
+    *latency = samples[index].latency;
+    vlc_tick_t now = time + *latency;
+
+    uint64_t remain = (uint64_t) size * 8; /* bits */
+    for(;;)
+    {
+        while(now - base >= getSampleEnd(index))
+        {
+            if(++index == samples.size())
+            {
+                index = 0;
+                base += period;
+            }
+        }
+
+        const Sample &sample = samples[index];
+        const vlc_tick_t end = base + getSampleEnd(index);
+        const uint64_t capacity = sample.bps * (end - now) / CLOCK_FREQ;
+        if(sample.bps && capacity >= remain)
+        {
+            now += (remain * CLOCK_FREQ + sample.bps - 1) / sample.bps;
+            break;
+        }
+        remain -= capacity;
+        now = end;
+    }
+
+    return now - time;
+}
+
+uint64_t Trace::getAverageRate() const
+{
+    const vlc_tick_t period = getSampleEnd(samples.size() - 1);
+    uint64_t bits = 0;
+    for(size_t i = 0; i < samples.size(); i++)
+        bits += samples[i].bps * (getSampleEnd(i) - samples[i].start) / CLOCK_FREQ;
+    return bits * CLOCK_FREQ / period;
+}
@@ -0,0 +1,68 @@
+/*
+ * Trace.hpp
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef ADAPTIVE_SIM_TRACE_HPP
+#define ADAPTIVE_SIM_TRACE_HPP
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace adaptive
+{
+    namespace sim
+    {
+        /* Recorded network conditions, as a step function of time.
+         * Each line is "<seconds> <Mbit/s> [<latency ms>]", and each sample
+         * lasts until the next one. The trace loops when exhausted. */
+        class Trace
+        {
+            public:
+                Trace();
+                bool load(std::istream &);
+                bool load(const std::string &);
+                void addSample(vlc_tick_t, uint64_t, vlc_tick_t = 0);
+                bool isValid() const;
+
+                /* Time to fetch the given amount of bytes when requested at
+                 * the given time, and the latency part of it */
+                vlc_tick_t getTransferTime(vlc_tick_t, size_t, vlc_tick_t *) const;
+                uint64_t getAverageRate() const; /* bit/s */
+                const std::string & getName() const;
+
+            private:
+                class Sample
+                {
+                    public:
+                        vlc_tick_t start;
+                        uint64_t   bps;
+                        vlc_tick_t latency;
+                };
+                size_t findSample(vlc_tick_t) const;
+                vlc_tick_t getSampleEnd(size_t) const;
+                std::vector<Sample> samples;
+                std::string name;
+        };
+    }
+}
+
+#endif // ADAPTIVE_SIM_TRACE_HPP
@@ -0,0 +1,143 @@
+/*
+ * adaptive_sim.cpp: replays network traces against the adaptation logics
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "Simulator.hpp"
+#include "Trace.hpp"
+
+#include "../../playlist/BasePlaylist.hpp"
+
+#include <vlc_common.h>
+#include <vlc_url.h>
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+using namespace adaptive;
+using namespace adaptive::logic;
+using namespace adaptive::playlist;
+using namespace adaptive::sim;
+
+extern const char vlc_module_name[] = "adaptive_sim";
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-l logic[,logic...]] <playlist> <trace> [trace...]\n"
+                    "\n"
+                    "Plays a local VOD HLS playlist, by path or file:// URL,\n"
+                    "over each network trace with each adaptation logic.\n"
+                    "Trace lines are \"<seconds> <Mbit/s> [<latency ms>]\".\n"
+                    "\n"
+                    "logics:", name);
+    for(const std::string &logic : Simulator::getLogicNames())
+        fprintf(stderr, " %s", logic.c_str());
+    fprintf(stderr, " (default: all)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> logics;
+    int i = 1;
+    if(i + 1 < argc && !strcmp(argv[i], "-l"))
+    {
+        std::istringstream ss(argv[i + 1]);
+        std::string logic;
+        while(std::getline(ss, logic, ','))
+            logics.push_back(logic);
+        i += 2;
+    }
+    if(argc - i < 2)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if(logics.empty())
+        logics = Simulator::getLogicNames();
+
+    std::vector<AbstractAdaptationLogic::LogicType> types;
+    for(const std::string &logic : logics)
+    {
+        AbstractAdaptationLogic::LogicType type;
+        if(!Simulator::getLogicType(logic, &type))
+        {
+            fprintf(stderr, "unknown logic %s\n", logic.c_str());
+            usage(argv[0]);
+            return 1;
+        }
+        types.push_back(type);
+    }
+
+    std::string url = argv[i++];
+    if(url.find("://") == std::string::npos)
+    {
+        char *psz_uri = vlc_path2uri(url.c_str(), nullptr);
+        if(!psz_uri)
+            return 1;
+        url = psz_uri;
+        free(psz_uri);
+    }
+
+    int ret = 0;
+    for(; i < argc; i++)
+    {
+        Trace trace;
+        if(!trace.load(std::string(argv[i])))
+        {
+            fprintf(stderr, "can't load trace %s\n", argv[i]);
+            ret = 1;
+            continue;
+        }
+
+        printf("%s (average %.2f Mbit/s)\n", trace.getName().c_str(),
+               trace.getAverageRate() / 1000000.0);
+        printf("  %-12s %9s %9s %7s %9s %9s %6s\n", "logic", "startup", "rebuffer",
+               "stalls", "switches", "kbit/s", "level");
+
+        for(size_t j = 0; j < types.size(); j++)
+        {
+            /* Fresh playlist and estimators for each run */
+            Simulator sim(&trace);
+            BasePlaylist *playlist = sim.loadPlaylist(url);
+            if(!playlist)
+            {
+                fprintf(stderr, "can't load playlist %s\n", url.c_str());
+                return 1;
+            }
+
+            const Results r = sim.run(playlist, types[j]);
+            delete playlist;
+            if(!r.completed)
+            {
+                printf("  %-12s failed\n", logics[j].c_str());
+                ret = 1;
+                continue;
+            }
+            printf("  %-12s %8.2fs %8.2fs %7u %9u %9" PRIu64 " %6.2f\n",
+                   logics[j].c_str(), secf_from_vlc_tick(r.startup),
+                   secf_from_vlc_tick(r.rebuffering), r.stalls, r.switches,
+                   r.bitrate / 1000, r.level);
+        }
+    }
+
+    return ret;
+}
@@ -49,5 +49,8 @@ int CommandsQueue_test();
 int BufferingLogic_test();
 int FakeEsOut_test();
 int SegmentTracker_test();
+int Downloader_test();
+int DiskCache_test();
+int Simulation_test();
 
 #endif
@@ -44,6 +44,7 @@
 #include <vlc_codecs.h>
 #include <vlc_charset.h>
 #include <vlc_arrays.h>
+#include <vlc_seekindex.h>
 
 #include "libavi.h"
 #include "../rawdv.h"
@@ -2749,6 +2750,83 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
+/* Rebuilds the tracks index from a previous AVI_IndexCreate() run */
+static bool AVI_IndexLoadCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    vlc_seekindex_entry_t *p_entries;
+
+    ssize_t i_count = vlc_seekindex_Load( p_demux, p_demux->s, "avi",
+                                          &p_entries );
+    if( i_count < 0 )
+        return false;
+
+    for( ssize_t i = 0; i < i_count; i++ )
+    {
+        if( p_entries[i].i_track >= p_sys->i_track )
+        {
+            for( unsigned j = 0; j < p_sys->i_track; j++ )
+            {
+                avi_index_Clean( &p_sys->track[j]->idx );
+                avi_index_Init( &p_sys->track[j]->idx );
+            }
+            free( p_entries );
+            return false;
+        }
+
+        avi_entry_t index;
+        index.i_flags   = p_entries[i].i_flags;
+        index.i_pos     = p_entries[i].i_offset;
+        index.i_length  = p_entries[i].i_size;
+        index.i_lengthtotal = p_entries[i].i_size;
+        avi_index_Append( &p_sys->track[p_entries[i].i_track]->idx,
+                          &p_sys->i_movi_lastchunk_pos, &index );
+    }
+    free( p_entries );
+    return true;
+}
+
+static void AVI_IndexStoreCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_count = 0;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        i_count += p_sys->track[i]->idx.i_size;
+
+    vlc_seekindex_entry_t *p_entries = vlc_alloc( i_count ? i_count : 1,
+                                                  sizeof(*p_entries) );
+    if( !p_entries )
+        return;
+
+    vlc_seekindex_entry_t *p_entry = p_entries;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+        for( uint32_t j = 0; j < p_index->i_size; j++ )
+        {
+            p_entry->i_time   = VLC_TICK_INVALID;
+            p_entry->i_offset = p_index->p_entry[j].i_pos;
+            p_entry->i_size   = p_index->p_entry[j].i_length;
+            p_entry->i_track  = i;
+            p_entry->i_flags  = p_index->p_entry[j].i_flags;
+            p_entry++;
+        }
+    }
+
+    vlc_seekindex_Store( p_demux, p_demux->s, "avi", p_entries, i_count );
+    free( p_entries );
+}
+
+/* Tells if the scan stopped at the end of the file, rather than on a read
+ * error, which would leave the index incomplete */
+static bool AVI_IndexScanEnded( demux_t *p_demux )
+{
+    uint64_t i_size = stream_Size( p_demux->s );
+
+    return i_size > 0 && vlc_stream_Tell( p_demux->s ) + 16 > i_size;
+}
+
 static void AVI_IndexCreate( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2761,6 +2839,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     vlc_tick_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    bool b_store = true; /* only a complete index is cached */
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0, true );
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0, true );
@@ -2774,6 +2853,13 @@ static void AVI_IndexCreate( demux_t *p_demux )
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
+    /* Skip the whole file scan if it was already done */
+    if( AVI_IndexLoadCache( p_demux ) )
+    {
+        b_store = false;
+        goto print_stat;
+    }
+
     i_movi_end = __MIN( (uint32_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
                         stream_Size( p_demux->s ) );
 
@@ -2799,7 +2885,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && vlc_tick_now() - i_dialog_update > VLC_TICK_FROM_MS(100) )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_store = false; /* incomplete */
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2810,7 +2899,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         }
 
         if( AVI_PacketGetHeader( p_demux, &pk ) )
+        {
+            b_store = AVI_IndexScanEnded( p_demux );
             break;
+        }
 
         if( pk.i_stream < p_sys->i_track &&
             pk.i_cat == p_sys->track[pk.i_stream]->fmt.i_cat )
@@ -2838,7 +2930,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
                     msg_Dbg( p_demux, "looking for new RIFF chunk" );
                     if( !p_sysx || vlc_stream_Seek( p_demux->s,
                                          p_sysx->i_chunk_pos + 24 ) )
+                    {
+                        b_store = false;
                         goto print_stat;
+                    }
                     break;
                 }
                 goto print_stat;
@@ -2856,14 +2951,18 @@ static void AVI_IndexCreate( demux_t *p_demux )
                 if( AVI_PacketSearch( p_demux ) )
                 {
                     msg_Warn( p_demux, "lost sync, abord index creation" );
+                    b_store = AVI_IndexScanEnded( p_demux );
                     goto print_stat;
                 }
             }
         }
 
-        if( ( !p_sys->b_odml && pk.i_pos + pk.i_size >= i_movi_end ) ||
-            AVI_PacketNext( p_demux ) )
+        if( !p_sys->b_odml && pk.i_pos + pk.i_size >= i_movi_end )
+            break;
+
+        if( AVI_PacketNext( p_demux ) )
         {
+            b_store = AVI_IndexScanEnded( p_demux );
             break;
         }
     }
@@ -2872,6 +2971,9 @@ print_stat:
     if( p_dialog_id != NULL )
         vlc_dialog_release( p_demux, p_dialog_id );
 
+    if( b_store )
+        AVI_IndexStoreCache( p_demux );
+
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
     {
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
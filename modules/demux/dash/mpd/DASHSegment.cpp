@@ -57,6 +57,11 @@ void DashIndexChunk::onDownload(block_t **pp_block)
     br.parseIndex(*pp_block, rep, getStartByteInFile());
 }
 
+bool DashIndexChunk::needsMoreHeader(const block_t *p_block) const
+{
+    return !IndexReader::isComplete(p_block, ATOM_sidx);
+}
+
 DashIndexSegment::DashIndexSegment(ICanonicalUrl *parent) :
     IndexSegment(parent)
 {
@@ -41,6 +41,7 @@ namespace dash
                 DashIndexChunk(AbstractChunkSource *, BaseRepresentation *);
                 ~DashIndexChunk();
                 virtual void onDownload(block_t **) override;
+                virtual bool needsMoreHeader(const block_t *) const override;
         };
 
         class DashIndexSegment : public IndexSegment
@@ -29,6 +29,8 @@
 #include "HLSSegment.hpp"
 #include "../../adaptive/playlist/BaseAdaptationSet.h"
 #include "../../adaptive/playlist/SegmentList.h"
+#include "../../adaptive/SharedResources.hpp"
+#include "../../adaptive/http/HTTPConnectionManager.h"
 
 #include <ctime>
 #include <limits>
@@ -44,6 +46,7 @@ HLSRepresentation::HLSRepresentation  ( BaseAdaptationSet *set ) :
     updateFailureCount = 0;
     lastUpdateTime = 0;
     targetDuration = 0;
+    partTarget = 0;
     streamFormat = StreamFormat::Type::Unknown;
     channels = 0;
 }
@@ -62,6 +65,11 @@ bool HLSRepresentation::isLive() const
     return b_live;
 }
 
+bool HLSRepresentation::isLowLatency() const
+{
+    return b_live && partTarget;
+}
+
 bool HLSRepresentation::initialized() const
 {
     return b_loaded;
@@ -136,6 +144,9 @@ bool HLSRepresentation::needsUpdate(uint64_t number) const
         vlc_tick_t duration = targetDuration
                             ? vlc_tick_from_sec(targetDuration)
                             : VLC_TICK_FROM_SEC(2);
+        /* The segment in progress is only replaced once complete */
+        if(isLowLatency())
+            duration = partTarget;
         if(updateFailureCount)
             duration /= 2;
         if(elapsed < duration)
@@ -167,6 +178,8 @@ bool HLSRepresentation::runLocalUpdates(SharedResources *res)
     {
         updateFailureCount = 0;
         b_loaded = true;
+        /* Only known once the media playlists are loaded */
+        res->getConnManager()->setLive(playlist->isLive());
         return true;
     }
 }
@@ -46,6 +46,7 @@ namespace hls
                 void setPlaylistUrl(const std::string &);
                 Url getPlaylistUrl() const;
                 bool isLive() const;
+                bool isLowLatency() const;
                 bool initialized() const;
                 virtual void scheduleNextUpdate(uint64_t, bool) override;
                 virtual bool needsUpdate(uint64_t) const override;
@@ -60,6 +61,7 @@ namespace hls
 
             protected:
                 time_t targetDuration;
+                vlc_tick_t partTarget; /* set for low latency */
                 Url playlistUrl;
 
             private:
@@ -67,3 +67,20 @@ bool M3U8::isLive() const
     return b_live;
 }
 
+
+bool M3U8::isLowLatency() const
+{
+    for(const BasePeriod *period : periods)
+    {
+        for(const BaseAdaptationSet *adaptSet : period->getAdaptationSets())
+        {
+            for(const BaseRepresentation *baserep : adaptSet->getRepresentations())
+            {
+                const HLSRepresentation *rep = dynamic_cast<const HLSRepresentation *>(baserep);
+                if(rep && rep->initialized() && rep->isLowLatency())
+                    return true;
+            }
+        }
+    }
+    return false;
+}
@@ -279,6 +279,32 @@ static bool parseEncryption(const AttributesTag *keytag, const Url &playlistUrl,
     }
 }
 
+/* Low latency parts can only be read as their segment being produced when
+ * they are ranges of a same resource, and not resources of their own */
+static std::string getPartsResource(const std::list<const AttributesTag *> &parts,
+                                    const AttributesTag *preloadhint)
+{
+    std::string uri;
+    std::list<const AttributesTag *> tags(parts);
+    if(preloadhint)
+    {
+        if(!preloadhint->getAttributeByName("BYTERANGE-START"))
+            return std::string();
+        tags.push_back(preloadhint);
+    }
+    for(const AttributesTag *tag : tags)
+    {
+        const Attribute *uriAttr = tag->getAttributeByName("URI");
+        if(!uriAttr || (tag != preloadhint && !tag->getAttributeByName("BYTERANGE")))
+            return std::string();
+        if(uri.empty())
+            uri = uriAttr->quotedString();
+        else if(uri != uriAttr->quotedString())
+            return std::string();
+    }
+    return uri;
+}
+
 void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std::list<Tag *> &tagslist)
 {
     bool b_pdt = tagslist.cend() != std::find_if(tagslist.cbegin(), tagslist.cend(),
@@ -301,9 +327,15 @@ void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std
     const SingleValueTag *ctx_byterange = nullptr;
     CommonEncryption encryption;
     const ValuesListTag *ctx_extinf = nullptr;
+    std::list<const AttributesTag *> ctx_parts; /* of the segment in progress */
+    const AttributesTag *ctx_preloadhint = nullptr;
+    vlc_tick_t holdBack = 0;
+    vlc_tick_t partHoldBack = 0;
 
     std::list<HLSSegment *> segmentstoappend;
 
+    rep->partTarget = 0;
+
     std::list<Tag *>::const_iterator it;
     for(it = tagslist.begin(); it != tagslist.end(); ++it)
     {
@@ -333,6 +365,10 @@ void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std
                     break;
                 }
 
+                /* parts were the ones of this complete segment */
+                ctx_parts.clear();
+                ctx_preloadhint = nullptr;
+
                 HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
                 if(!segment)
                     break;
@@ -437,6 +473,40 @@ void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std
             }
             break;
 
+            case AttributesTag::EXTXSERVERCONTROL:
+            {
+                const AttributesTag *controltag = static_cast<const AttributesTag *>(tag);
+                const Attribute *attr = controltag->getAttributeByName("HOLD-BACK");
+                if(attr)
+                    holdBack = vlc_tick_from_sec(attr->floatingPoint());
+                attr = controltag->getAttributeByName("PART-HOLD-BACK");
+                if(attr)
+                    partHoldBack = vlc_tick_from_sec(attr->floatingPoint());
+            }
+            break;
+
+            case AttributesTag::EXTXPARTINF:
+            {
+                const Attribute *targetAttr =
+                        static_cast<const AttributesTag *>(tag)->getAttributeByName("PART-TARGET");
+                if(targetAttr)
+                    rep->partTarget = vlc_tick_from_sec(targetAttr->floatingPoint());
+            }
+            break;
+
+            case AttributesTag::EXTXPART:
+                ctx_parts.push_back(static_cast<const AttributesTag *>(tag));
+                break;
+
+            case AttributesTag::EXTXPRELOADHINT:
+            {
+                const AttributesTag *hinttag = static_cast<const AttributesTag *>(tag);
+                const Attribute *typeAttr = hinttag->getAttributeByName("TYPE");
+                if(typeAttr && typeAttr->value == "PART")
+                    ctx_preloadhint = hinttag;
+            }
+            break;
+
             case SingleValueTag::EXTXDISCONTINUITYSEQUENCE:
                 discontinuitySequence = static_cast<const SingleValueTag *>(tag)->getValue().decimal();
                 break;
@@ -451,6 +521,37 @@ void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std
         }
     }
 
+    /* Low latency: the segment being produced is announced by its parts.
+     * Its duration is unknown until complete, and refreshed on updates. */
+    if(rep->isLowLatency() && (!ctx_parts.empty() || ctx_preloadhint))
+    {
+        const std::string uri = getPartsResource(ctx_parts, ctx_preloadhint);
+        HLSSegment *segment;
+        if(!uri.empty() &&
+           (segment = new (std::nothrow) HLSSegment(rep, sequenceNumber)))
+        {
+            const vlc_tick_t nzDuration = vlc_tick_from_sec(rep->targetDuration);
+            segment->setSourceUrl(uri);
+            segment->duration.Set(timescale.ToScaled(nzDuration));
+            segment->startTime.Set(timescale.ToScaled(nzStartTime));
+            if(absReferenceTime != VLC_TICK_INVALID)
+                segment->setDisplayTime(absReferenceTime);
+            segment->setDiscontinuitySequenceNumber(discontinuitySequence);
+            segment->discontinuity = discontinuity;
+            if(encryption.method != CommonEncryption::Method::None)
+                segment->setEncryption(encryption);
+            segmentstoappend.push_back(segment);
+        }
+    }
+
+    if(rep->isLive())
+    {
+        if(rep->partTarget && partHoldBack)
+            rep->getPlaylist()->targetLatency.Set(partHoldBack);
+        else if(holdBack)
+            rep->getPlaylist()->targetLatency.Set(holdBack);
+    }
+
     for(HLSSegment *seg : segmentstoappend)
         segmentList->addSegment(seg);
     segmentstoappend.clear();
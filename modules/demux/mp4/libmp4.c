@@ -2996,7 +2996,7 @@ static int MP4_ReadBox_stsd( stream_t *p_stream, MP4_Box_t *p_box )
 
 static void MP4_FreeBox_stsz( MP4_Box_t *p_box )
 {
-    free( p_box->data.p_stsz->i_entry_size );
+    MP4_SampleSizes_Clean( &p_box->data.p_stsz->sizes );
 }
 
 static int MP4_ReadBox_stsz( stream_t *p_stream, MP4_Box_t *p_box )
@@ -3016,18 +3016,10 @@ static int MP4_ReadBox_stsz( stream_t *p_stream, MP4_Box_t *p_box )
         if( UINT64_C(4) * count > i_read )
             MP4_READBOX_EXIT( 0 );
 
-        p_box->data.p_stsz->i_entry_size =
-            vlc_alloc( count, sizeof(uint32_t) );
-        if( unlikely( !p_box->data.p_stsz->i_entry_size ) )
+        /* Packed as read, without expanding the entries */
+        if( MP4_SampleSizes_Init( &p_box->data.p_stsz->sizes, p_peek, 32, count ) )
             MP4_READBOX_EXIT( 0 );
-
-        for( uint32_t i = 0; i < count; i++ )
-        {
-            MP4_GET4BYTES( p_box->data.p_stsz->i_entry_size[i] );
-        }
     }
-    else
-        p_box->data.p_stsz->i_entry_size = NULL;
 
 #ifdef MP4_VERBOSE
     msg_Dbg( p_stream, "read box: \"stsz\" sample-size %d sample-count %d",
@@ -3061,43 +3053,9 @@ static int MP4_ReadBox_stz2( stream_t *p_stream, MP4_Box_t *p_box )
     if( ( (uint64_t)field_size * count + 7 ) / 8 > i_read )
         MP4_READBOX_EXIT( 0 );
 
-    p_box->data.p_stsz->i_entry_size =
-            vlc_alloc( count, sizeof(uint32_t) );
-    if( unlikely( p_box->data.p_stsz->i_entry_size == NULL ) )
+    if( MP4_SampleSizes_Init( &p_box->data.p_stsz->sizes, p_peek, field_size, count ) )
         MP4_READBOX_EXIT( 0 );
 
-    if( field_size == 16 )
-    {
-        for( uint32_t i = 0; i < count; i++ )
-            MP4_GET2BYTES( p_box->data.p_stsz->i_entry_size[i] );
-    }
-    else if( field_size == 8 )
-    {
-        for( uint32_t i = 0; i < count; i++ )
-            MP4_GET1BYTE( p_box->data.p_stsz->i_entry_size[i] );
-    }
-    else
-    {
-        vlc_assert( field_size == 4 );
-        count &= ~1;
-        for( uint32_t i = 0; i < count; i += 2 )
-        {
-            uint8_t entry;
-            MP4_GET1BYTE( entry );
-            p_box->data.p_stsz->i_entry_size[i] = entry >> 4;
-            p_box->data.p_stsz->i_entry_size[i + 1] = entry & 0x0F;
-        }
-        if( count < p_box->data.p_stsz->i_sample_count )
-        {
-            uint8_t entry;
-            /* ISO-14496-12: if the sizes do not fill an integral number of
-             * bytes, the last byte is padded with zeros.
-             */
-            MP4_GET1BYTE( entry );
-            p_box->data.p_stsz->i_entry_size[count] = entry >> 4;
-        }
-    }
-
 #ifdef MP4_VERBOSE
     msg_Dbg( p_stream, "read box: \"stz2\" field-size %d sample-count %d",
              field_size,
@@ -25,6 +25,7 @@
 #include <vlc_es.h>
 #include <vlc_codecs.h>
 #include "coreaudio.h"
+#include "samplesizes.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -924,7 +925,7 @@ typedef struct MP4_Box_data_stsz_s
     uint32_t i_sample_size;
     uint32_t i_sample_count;
 
-    uint32_t *i_entry_size; /* array , empty if i_sample_size != 0 */
+    mp4_samplesizes_t sizes; /* empty if i_sample_size != 0 */
 
 } MP4_Box_data_stsz_t;
 
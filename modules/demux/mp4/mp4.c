@@ -469,31 +469,66 @@ static es_out_id_t * MP4_CreateES( es_out_t *out, const es_format_t *p_fmt,
     return p_es;
 }
 
-static int MP4_ChunkAllocEntries( size_t entries, uint32_t *smallbuf,
-                                  uint32_t **dst0, uint32_t **dst1 )
+/* Walks the entries of a stts or ctts table over the samples of a chunk */
+typedef struct
+{
+    const uint32_t *pi_sample_count;
+    uint32_t        i_entry_count;
+    uint32_t        i_entry;  /* next entry */
+    uint32_t        i_skip;   /* samples of the next entry before the chunk */
+    uint32_t        i_left;   /* samples of the chunk not walked yet */
+} mp4_chunk_entries_t;
+
+static void MP4_ChunkDTSEntries( mp4_chunk_entries_t *p_it,
+                                 const mp4_track_t *p_track,
+                                 const mp4_chunk_t *p_chunk )
 {
-    uint32_t *buf;
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
+    p_it->pi_sample_count = stts ? stts->pi_sample_count : NULL;
+    p_it->i_entry_count = stts ? stts->i_entry_count : 0;
+    p_it->i_entry = p_chunk->i_dts_entry;
+    p_it->i_skip = p_chunk->i_dts_skip;
+    p_it->i_left = p_chunk->i_sample_count;
+}
 
-    if( entries > MP4_CHUNK_SMALLBUF_ENTRIES )
-    {
-        buf = calloc( entries, sizeof( buf[0] ) * 2 );
-        if( unlikely(buf == NULL) )
-            return VLC_ENOMEM;
-    }
-    else buf = smallbuf;
+static void MP4_ChunkPTSEntries( mp4_chunk_entries_t *p_it,
+                                 const mp4_track_t *p_track,
+                                 const mp4_chunk_t *p_chunk )
+{
+    const MP4_Box_data_ctts_t *ctts = p_track->p_ctts;
+    p_it->pi_sample_count = ctts ? ctts->pi_sample_count : NULL;
+    p_it->i_entry_count = ctts ? ctts->i_entry_count : 0;
+    p_it->i_entry = p_chunk->i_pts_entry;
+    p_it->i_skip = p_chunk->i_pts_skip;
+    p_it->i_left = p_chunk->i_sample_count;
+}
+
+/* Returns the next table entry, and how many samples of the chunk it covers */
+static bool MP4_ChunkEntriesNext( mp4_chunk_entries_t *p_it,
+                                  uint32_t *pi_entry, uint32_t *pi_count )
+{
+    if( p_it->i_left == 0 || p_it->i_entry >= p_it->i_entry_count )
+        return false;
 
-    *dst0 = buf;
-    *dst1 = &buf[entries];
+    uint32_t i_count = p_it->pi_sample_count[p_it->i_entry] - p_it->i_skip;
+    if( i_count > p_it->i_left )
+        i_count = p_it->i_left;
 
-    return VLC_SUCCESS;
+    *pi_entry = p_it->i_entry++;
+    *pi_count = i_count;
+    p_it->i_skip = 0;
+    p_it->i_left -= i_count;
+    return true;
 }
 
-static void MP4_ChunkDestroy( mp4_chunk_t *ck )
+static stime_t MP4_TrackGetCTSDelta( const mp4_track_t *p_track,
+                                     uint32_t i_entry )
 {
-    if( ck->p_sample_count_dts != ck->small_dts_buf )
-        free( ck->p_sample_count_dts );
-    if( ck->p_sample_count_pts != ck->small_pts_buf )
-        free( ck->p_sample_count_pts );
+    int64_t i_ctsdelta = p_track->p_ctts->pi_sample_offset[i_entry] +
+                         p_track->i_cts_shift;
+    if( i_ctsdelta < 0 ) /* should not */
+        i_ctsdelta = 0;
+    return (uint32_t) i_ctsdelta;
 }
 
 static stime_t MP4_MapTrackTimeIntoTimeline( const mp4_track_t *p_track,
@@ -542,42 +577,48 @@ static stime_t MP4_MapMediaTimelineToTrackTime( const mp4_track_t *p_track,
     return i_time;
 }
 
-static stime_t MP4_ChunkGetSampleDTS( const mp4_chunk_t *p_chunk,
+static stime_t MP4_ChunkGetSampleDTS( const mp4_track_t *p_track,
+                                      const mp4_chunk_t *p_chunk,
                                       uint32_t i_sample )
 {
-    uint32_t i_index = 0;
+    mp4_chunk_entries_t it;
+    uint32_t i_entry, i_count;
     stime_t sdts = p_chunk->i_first_dts;
-    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
+
+    MP4_ChunkDTSEntries( &it, p_track, p_chunk );
+    while( i_sample > 0 && MP4_ChunkEntriesNext( &it, &i_entry, &i_count ) )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        const uint32_t i_delta = p_track->p_stts->pi_sample_delta[i_entry];
+        if( i_sample > i_count )
         {
-            sdts += (stime_t)p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index++];
+            sdts += (stime_t)i_count * i_delta;
+            i_sample -= i_count;
         }
         else
         {
-            sdts += (stime_t)i_sample * p_chunk->p_sample_delta_dts[i_index];
+            sdts += (stime_t)i_sample * i_delta;
             break;
         }
     }
     return sdts;
 }
 
-static bool MP4_ChunkGetSampleCTSDelta( const mp4_chunk_t *p_chunk,
+static bool MP4_ChunkGetSampleCTSDelta( const mp4_track_t *p_track,
+                                        const mp4_chunk_t *p_chunk,
                                         uint32_t i_sample, stime_t *pi_delta )
 {
-    if( p_chunk->p_sample_count_pts && p_chunk->p_sample_offset_pts )
+    mp4_chunk_entries_t it;
+    uint32_t i_entry, i_count;
+
+    MP4_ChunkPTSEntries( &it, p_track, p_chunk );
+    while( MP4_ChunkEntriesNext( &it, &i_entry, &i_count ) )
     {
-        for( uint32_t i_index = 0; i_index < p_chunk->i_entries_pts ; i_index++ )
+        if( i_sample < i_count )
         {
-            if( i_sample < p_chunk->p_sample_count_pts[i_index] )
-            {
-                *pi_delta = p_chunk->p_sample_offset_pts[i_index];
-                return true;
-            }
-            i_sample -= p_chunk->p_sample_count_pts[i_index];
+            *pi_delta = MP4_TrackGetCTSDelta( p_track, i_entry );
+            return true;
         }
+        i_sample -= i_count;
     }
     return false;
 }
@@ -618,44 +659,41 @@ static vlc_tick_t MP4_TrackGetDTSPTS( demux_t *p_demux, const mp4_track_t *p_tra
     return i_dts;
 }
 
-static stime_t MP4_GetChunkSamplesDuration( const mp4_chunk_t *p_chunk,
+static stime_t MP4_GetChunkSamplesDuration( const mp4_track_t *p_track,
+                                            const mp4_chunk_t *p_chunk,
                                             uint32_t i_start_sample,
                                             uint32_t i_nb_samples )
 {
     stime_t i_duration = 0;
+    mp4_chunk_entries_t it;
+    uint32_t i_entry, i_count;
+
+    /* Samples to skip before the start sample */
+    uint32_t i_remain = i_start_sample > p_chunk->i_sample_first
+                      ? i_start_sample - p_chunk->i_sample_first : 0;
 
-    /* Forward to right index, and set remaining count in that index */
-    uint32_t i_index = 0;
-    uint32_t i_remain = 0;
-    for( uint32_t i = p_chunk->i_sample_first;
-         i<i_start_sample && i_index < p_chunk->i_entries_dts; )
+    MP4_ChunkDTSEntries( &it, p_track, p_chunk );
+    while( i_nb_samples > 0 && MP4_ChunkEntriesNext( &it, &i_entry, &i_count ) )
     {
-        if( i_start_sample - i >= p_chunk->p_sample_count_dts[i_index] )
-        {
-            i += p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
+        /* Forward to right entry, and set remaining count in that entry */
+        if( i_remain >= i_count )
         {
-            i_remain = i_start_sample - i;
-            break;
+            i_remain -= i_count;
+            continue;
         }
-    }
+        i_count -= i_remain;
+        i_remain = 0;
 
-    /* Compute total duration from all samples from index */
-    while( i_nb_samples > 0 && i_index < p_chunk->i_entries_dts )
-    {
-        if( i_nb_samples >= p_chunk->p_sample_count_dts[i_index] - i_remain )
+        /* Compute total duration from all samples from entry */
+        const uint32_t i_delta = p_track->p_stts->pi_sample_delta[i_entry];
+        if( i_nb_samples >= i_count )
         {
-            i_duration += (p_chunk->p_sample_count_dts[i_index] - i_remain) *
-                          (int64_t) p_chunk->p_sample_delta_dts[i_index];
-            i_nb_samples -= (p_chunk->p_sample_count_dts[i_index] - i_remain);
-            i_index++;
-            i_remain = 0;
+            i_duration += (stime_t)i_count * i_delta;
+            i_nb_samples -= i_count;
         }
         else
         {
-            i_duration += (stime_t)i_nb_samples * p_chunk->p_sample_delta_dts[i_index];
+            i_duration += (stime_t)i_nb_samples * i_delta;
             break;
         }
     }
@@ -666,7 +704,8 @@ static stime_t MP4_GetChunkSamplesDuration( const mp4_chunk_t *p_chunk,
 static inline vlc_tick_t MP4_GetSamplesDuration( const mp4_track_t *p_track,
                                                  uint32_t i_nb_samples )
 {
-    stime_t i_duration = MP4_GetChunkSamplesDuration( &p_track->chunk[p_track->i_chunk],
+    stime_t i_duration = MP4_GetChunkSamplesDuration( p_track,
+                                                      &p_track->chunk[p_track->i_chunk],
                                                       p_track->i_sample,
                                                       i_nb_samples );
     return MP4_rescale_mtime( i_duration, p_track->i_timescale );
@@ -2641,12 +2680,10 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->i_offset = BOXDATA(p_co64)->i_chunk_offset[i_chunk];
 
         ck->i_first_dts = 0;
-        ck->i_entries_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->i_entries_pts = 0;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
+        ck->i_dts_entry = 0;
+        ck->i_dts_skip = 0;
+        ck->i_pts_entry = 0;
+        ck->i_pts_skip = 0;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -2708,54 +2745,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
-{
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
-    {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
-        {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_EINVAL;
-        }
-
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
-        }
-    }
-
-    return VLC_SUCCESS;
-}
-
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -2789,22 +2778,13 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     {
         /* 1: all sample have the same size, so no need to construct a table */
         p_demux_track->i_sample_size = stsz->i_sample_size;
-        p_demux_track->p_sample_size = NULL;
     }
     else
     {
         /* 2: each sample can have a different size */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        /* Packed when the box was read, and kept there */
+        p_demux_track->p_sample_sizes = &stsz->sizes;
     }
 
     if ( p_demux_track->i_chunk_count && p_demux_track->i_sample_size == 0 )
@@ -2817,11 +2797,12 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         }
     }
 
-    /* Use stts table to create a sample number -> dts table.
+    /* Use stts table to map sample numbers to dts.
      * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
+     *  the box! so each chunk only records where its first sample is in
+     *  the table, and the entries are walked from there on demand (problem
+     *  with raw stream where a sample is sometime just
+     *  channels*bits_per_sample/8 */
 
      /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
       *        differing in 2/2 fields and 1 signedness */
@@ -2842,96 +2823,46 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        /* Locate the first sample of each chunk in the table, the entries
+         * are decoded on demand from there */
+        uint32_t i_entry = 0;
+        uint32_t i_skip = 0;
+
+        p_demux_track->p_stts = stts;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
+            uint32_t i_sample_count = ck->i_sample_count;
 
             /* save first dts */
             ck->i_first_dts = i_next_dts;
+            ck->i_dts_entry = i_entry;
+            ck->i_dts_skip = i_skip;
 
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            i_ret = MP4_ChunkAllocEntries( ck->i_entries_dts,
-                                           ck->small_dts_buf,
-                                           &ck->p_sample_count_dts,
-                                           &ck->p_sample_delta_dts );
-            if( i_ret )
-            {
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return i_ret;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
+            while( i_sample_count > 0 && i_entry < stts->i_entry_count )
             {
-                if ( i_current_index_samples_left )
+                uint32_t i_count = stts->pi_sample_count[i_entry] - i_skip;
+                if( i_count > i_sample_count )
                 {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += (int64_t)ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += (int64_t)ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_current_index_samples_left ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
+                    /* keep building from same entry */
+                    i_next_dts += (int64_t)i_sample_count * stts->pi_sample_delta[i_entry];
+                    i_skip += i_sample_count;
+                    i_sample_count = 0;
                 }
                 else
                 {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += (int64_t)ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += (int64_t)ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( stts->pi_sample_count[i_index] ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
+                    i_next_dts += (int64_t)i_count * stts->pi_sample_delta[i_entry];
+                    i_sample_count -= i_count;
+                    i_skip = 0;
+                    i_entry++;
                 }
-
             }
+            ck->i_duration = i_next_dts - ck->i_first_dts;
+
+            if( i_sample_count > 0 )
+                msg_Err( p_demux, "invalid index counting total samples %u %u",
+                         i_entry, stts->i_entry_count );
         }
     }
 
@@ -2962,87 +2893,34 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         }
         p_demux_track->i_cts_shift = i_cts_shift;
 
-        /* Create pts-dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        /* Locate the first sample of each chunk in the table */
+        uint32_t i_entry = 0;
+        uint32_t i_skip = 0;
+
+        p_demux_track->p_ctts = ctts;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            i_ret = MP4_ChunkAllocEntries( ck->i_entries_pts,
-                                           ck->small_pts_buf,
-                                           &ck->p_sample_count_pts,
-                                           &ck->p_sample_offset_pts );
-            if( i_ret )
-            {
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return i_ret;
-            }
+            uint32_t i_sample_count = ck->i_sample_count;
 
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
+            ck->i_pts_entry = i_entry;
+            ck->i_pts_skip = i_skip;
 
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
+            while( i_sample_count > 0 && i_entry < ctts->i_entry_count )
             {
-                int64_t i_ctsdelta = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                if( i_ctsdelta < 0 ) /* should not */
-                    i_ctsdelta = 0;
-                if ( i_current_index_samples_left )
+                uint32_t i_count = ctts->pi_sample_count[i_entry] - i_skip;
+                if( i_count > i_sample_count )
                 {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = i_ctsdelta;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = i_ctsdelta;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
+                    i_skip += i_sample_count;
+                    i_sample_count = 0;
                 }
                 else
                 {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = i_ctsdelta;
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = i_ctsdelta;
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
+                    i_sample_count -= i_count;
+                    i_skip = 0;
+                    i_entry++;
                 }
-
-
             }
         }
     }
@@ -3437,22 +3315,24 @@ static int STTSToSampleChunk(const mp4_track_t *p_track, uint64_t i_dts,
     /* *** find sample in the chunk *** */
     uint32_t i_sample = ck->i_sample_first;
     uint64_t i_entrydts = ck->i_first_dts;
+    mp4_chunk_entries_t it;
+    uint32_t i_entry, i_count;
 
-    for( uint_fast32_t i = 0;
-         i < ck->i_entries_dts && i_sample < ck->i_sample_count;
-         i++ )
+    MP4_ChunkDTSEntries( &it, p_track, ck );
+    while( i_sample < ck->i_sample_count &&
+           MP4_ChunkEntriesNext( &it, &i_entry, &i_count ) )
     {
-        uint64_t i_entry_duration = ck->p_sample_count_dts[i] * (uint64_t)
-                                    ck->p_sample_delta_dts[i];
+        const uint32_t i_delta = p_track->p_stts->pi_sample_delta[i_entry];
+        uint64_t i_entry_duration = i_count * (uint64_t) i_delta;
         if( i_entrydts + i_entry_duration < i_dts )
         {
             i_entrydts += i_entry_duration;
-            i_sample += ck->p_sample_count_dts[i];
+            i_sample += i_count;
         }
         else
         {
-            if( ck->p_sample_delta_dts[i] > 0 )
-                i_sample += ( i_dts - i_entrydts ) / ck->p_sample_delta_dts[i];
+            if( i_delta > 0 )
+                i_sample += ( i_dts - i_entrydts ) / i_delta;
             break;
         }
     }
@@ -3696,7 +3576,8 @@ static void TrackUpdateStarttimes( mp4_track_t *p_track )
 
     /* Probe the 16 first B frames */
     uint32_t i_chunk = p_track->i_chunk;
-    if( !p_track->chunk[i_chunk].i_entries_pts )
+    if( !p_track->p_ctts || !p_track->chunk[i_chunk].i_sample_count ||
+        p_track->chunk[i_chunk].i_pts_entry >= p_track->p_ctts->i_entry_count )
         return;
 
     stime_t lowest = p_track->i_start_dts;
@@ -3719,9 +3600,9 @@ static void TrackUpdateStarttimes( mp4_track_t *p_track )
             break;
         assert(i_nextsample >= ck->i_sample_first);
         stime_t pts;
-        stime_t dts = pts = MP4_ChunkGetSampleDTS( ck, i_nextsample - ck->i_sample_first );
+        stime_t dts = pts = MP4_ChunkGetSampleDTS( p_track, ck, i_nextsample - ck->i_sample_first );
         stime_t delta = UNKNOWN_DELTA;
-        if( MP4_ChunkGetSampleCTSDelta( ck, i_nextsample - ck->i_sample_first, &delta ) )
+        if( MP4_ChunkGetSampleCTSDelta( p_track, ck, i_nextsample - ck->i_sample_first, &delta ) )
             pts += delta;
         if( pts < lowest )
         {
@@ -3737,9 +3618,9 @@ static void TrackUpdateSampleAndTimes( mp4_track_t *p_track )
     uint32_t i_chunk_sample = p_track->i_sample - p_chunk->i_sample_first;
     if( i_chunk_sample > p_chunk->i_sample_count && p_chunk->i_sample_count )
         i_chunk_sample = p_chunk->i_sample_count - 1;
-    p_track->i_next_dts = MP4_ChunkGetSampleDTS( p_chunk, i_chunk_sample );
+    p_track->i_next_dts = MP4_ChunkGetSampleDTS( p_track, p_chunk, i_chunk_sample );
     stime_t i_next_delta;
-    if( !MP4_ChunkGetSampleCTSDelta( p_chunk, i_chunk_sample, &i_next_delta ) )
+    if( !MP4_ChunkGetSampleCTSDelta( p_track, p_chunk, i_chunk_sample, &i_next_delta ) )
         p_track->i_next_delta = UNKNOWN_DELTA;
     else
         p_track->i_next_delta = i_next_delta;
@@ -4036,16 +3917,8 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( out, p_track->p_es );
 
-    if( p_track->chunk )
-    {
-        for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            MP4_ChunkDestroy( &p_track->chunk[i_chunk] );
-    }
     free( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     ASFPacketTrackReset( &p_track->asfinfo );
 
     free( p_track->context.runs.p_array );
@@ -4218,7 +4091,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         *pi_nb_samples = 1;
 
         if( p_track->i_sample_size == 0 ) /* all sizes are different */
-            return p_track->p_sample_size[p_track->i_sample];
+            return MP4_SampleSizes_Get( p_track->p_sample_sizes, p_track->i_sample );
         else
             return p_track->i_sample_size;
     }
@@ -4256,7 +4129,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         if( p_track->i_sample_size == 0 )
         {
             *pi_nb_samples = 1;
-            return p_track->p_sample_size[p_track->i_sample];
+            return MP4_SampleSizes_Get( p_track->p_sample_sizes, p_track->i_sample );
         }
 
         /* If we are compressed but not v2 LPCM frames extensions */
@@ -4266,7 +4139,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
             if ( p_track->i_sample_size )
                 return p_track->i_sample_size;
             else
-                return p_track->p_sample_size[p_track->i_sample];
+                return MP4_SampleSizes_Get( p_track->p_sample_sizes, p_track->i_sample );
         }
 
         /* More regular V0 cases */
@@ -4346,7 +4219,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
                  i<p_track->i_sample_count;
                  i++ )
             {
-                i_size += p_track->p_sample_size[i];
+                i_size += MP4_SampleSizes_Get( p_track->p_sample_sizes, i );
                 (*pi_nb_samples)++;
 
                 /* Try to detect compression in ISO */
@@ -4403,7 +4276,7 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
         for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
              i_sample < p_track->i_sample; i_sample++ )
         {
-            i_pos += p_track->p_sample_size[i_sample];
+            i_pos += MP4_SampleSizes_Get( p_track->p_sample_sizes, i_sample );
         }
     }
 
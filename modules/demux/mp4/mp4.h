@@ -28,10 +28,9 @@
 #include <vlc_common.h>
 #include "libmp4.h"
 #include "fragments.h"
+#include "samplesizes.h"
 #include "../asf/asfpacket.h"
 
-#define MP4_CHUNK_SMALLBUF_ENTRIES 2
-
 /* Contain all information about a chunk */
 typedef struct
 {
@@ -48,15 +47,12 @@ typedef struct
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_duration;    /* total duration of all samples */
 
-    uint32_t     i_entries_dts;
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
-    uint32_t     small_dts_buf[MP4_CHUNK_SMALLBUF_ENTRIES * 2];
-
-    uint32_t     i_entries_pts;
-    uint32_t     *p_sample_count_pts;
-    uint32_t     *p_sample_offset_pts;  /* pts-dts */
-    uint32_t     small_pts_buf[MP4_CHUNK_SMALLBUF_ENTRIES * 2];
+    /* the stts and ctts tables are run-length coded, and decoded on demand
+       from the entry containing the first sample of the chunk */
+    uint32_t     i_dts_entry;   /* stts entry of the first sample */
+    uint32_t     i_dts_skip;    /* samples of that entry in previous chunks */
+    uint32_t     i_pts_entry;   /* ctts entry of the first sample */
+    uint32_t     i_pts_skip;    /* samples of that entry in previous chunks */
 
     /* TODO if needed add pts
         but quickly *add* support for edts and seeking */
@@ -136,6 +132,8 @@ typedef struct
     stime_t          i_start_dts;
     stime_t          i_next_dts;
     int64_t          i_cts_shift;
+    const MP4_Box_data_stts_t *p_stts; /* owned by the stts box */
+    const MP4_Box_data_ctts_t *p_ctts; /* owned by the ctts box, or NULL */
     vlc_tick_t       i_pts_offset;
     stime_t          i_decoder_delay;
     /* give the next sample to read, i_chunk is to find quickly where
@@ -148,11 +146,10 @@ typedef struct
 
     mp4_chunk_t    *chunk; /* always defined  for each chunk */
 
-    /* sample size, p_sample_size defined only if i_sample_size == 0
+    /* sample size, p_sample_sizes defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-//                                    too much time to do sumations each time*/
+    const mp4_samplesizes_t *p_sample_sizes; /* owned by the stsz box */
 
     const MP4_Box_t *p_track;
     const MP4_Box_t *p_stbl;  /* will contain all timing information */
@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * samplesizes.c: compact MP4 sample sizes table
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "samplesizes.h"
+
+static unsigned BitsFor( uint32_t i_value )
+{
+    return i_value ? 32 - vlc_clz( i_value ) : 0;
+}
+
+static uint32_t GetEntry( const uint8_t *p_entries, unsigned i_field_size,
+                          uint32_t i )
+{
+    switch( i_field_size )
+    {
+        case 32:
+            return GetDWBE( &p_entries[4 * i] );
+        case 16:
+            return GetWBE( &p_entries[2 * i] );
+        case 8:
+            return p_entries[i];
+        default:
+            assert( i_field_size == 4 );
+            return (i & 1) ? p_entries[i / 2] & 0x0F : p_entries[i / 2] >> 4;
+    }
+}
+
+int MP4_SampleSizes_Init( mp4_samplesizes_t *p_table, const uint8_t *p_entries,
+                          unsigned i_field_size, uint32_t i_count )
+{
+    const uint32_t i_blocks = (i_count + MP4_SAMPLESIZES_BLOCK - 1) /
+                              MP4_SAMPLESIZES_BLOCK;
+
+    p_table->i_count = i_count;
+    p_table->p_words = NULL;
+    p_table->p_blocks = vlc_alloc( i_blocks, sizeof(*p_table->p_blocks) );
+    if( i_blocks && !p_table->p_blocks )
+        return VLC_ENOMEM;
+
+    /* First pass: block bases and widths */
+    uint64_t i_words = 0;
+    for( uint32_t i = 0; i < i_blocks; i++ )
+    {
+        const uint32_t i_first = i * MP4_SAMPLESIZES_BLOCK;
+        const uint32_t i_last = __MIN(i_count, i_first + MP4_SAMPLESIZES_BLOCK);
+        uint32_t i_min = UINT32_MAX, i_max = 0;
+        for( uint32_t j = i_first; j < i_last; j++ )
+        {
+            const uint32_t i_size = GetEntry( p_entries, i_field_size, j );
+            i_min = __MIN(i_min, i_size);
+            i_max = __MAX(i_max, i_size);
+        }
+
+        mp4_samplesizes_block_t *p_block = &p_table->p_blocks[i];
+        p_block->i_base = i_min;
+        p_block->i_bits = BitsFor( i_max - i_min );
+        p_block->i_word = i_words;
+        i_words += p_block->i_bits;
+    }
+
+    if( i_words > UINT32_MAX )
+    {
+        free( p_table->p_blocks );
+        p_table->p_blocks = NULL;
+        return VLC_EGENERIC;
+    }
+
+    if( i_words == 0 )
+        return VLC_SUCCESS;
+
+    p_table->p_words = calloc( i_words, sizeof(*p_table->p_words) );
+    if( !p_table->p_words )
+    {
+        free( p_table->p_blocks );
+        p_table->p_blocks = NULL;
+        return VLC_ENOMEM;
+    }
+
+    /* Second pass: pack the differences */
+    for( uint32_t i = 0; i < i_count; i++ )
+    {
+        const mp4_samplesizes_block_t *p_block =
+                &p_table->p_blocks[i / MP4_SAMPLESIZES_BLOCK];
+        if( p_block->i_bits == 0 )
+            continue;
+
+        const uint64_t i_value = GetEntry( p_entries, i_field_size, i ) -
+                                 p_block->i_base;
+        const unsigned i_pos = (i % MP4_SAMPLESIZES_BLOCK) * p_block->i_bits;
+        uint64_t *p_word = &p_table->p_words[p_block->i_word + i_pos / 64];
+        const unsigned i_shift = i_pos % 64;
+
+        p_word[0] |= i_value << i_shift;
+        if( i_shift + p_block->i_bits > 64 )
+            p_word[1] |= i_value >> (64 - i_shift);
+    }
+
+    return VLC_SUCCESS;
+}
+
+void MP4_SampleSizes_Clean( mp4_samplesizes_t *p_table )
+{
+    free( p_table->p_blocks );
+    free( p_table->p_words );
+    p_table->p_blocks = NULL;
+    p_table->p_words = NULL;
+    p_table->i_count = 0;
+}
@@ -0,0 +1,78 @@
+/*****************************************************************************
+ * samplesizes.h: compact MP4 sample sizes table
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_MP4_SAMPLESIZES_H_
+#define VLC_MP4_SAMPLESIZES_H_
+
+#include <assert.h>
+
+#include <vlc_common.h>
+
+/* Sample sizes are stored by blocks of MP4_SAMPLESIZES_BLOCK samples.
+ * Each block keeps its smallest size, and the difference to it for every
+ * sample, packed with just enough bits for the largest difference.
+ * Any sample size can then be decoded in constant time, and sizes of
+ * consecutive frames, which usually are close, take much less than the
+ * 32 bits per sample of the stsz box. */
+#define MP4_SAMPLESIZES_BLOCK 64
+
+typedef struct
+{
+    uint32_t i_base;  /* smallest sample size of the block */
+    uint32_t i_word;  /* index of the first packed word of the block */
+    uint8_t  i_bits;  /* bits per packed value, 0 if all sizes are equal */
+} mp4_samplesizes_block_t;
+
+typedef struct
+{
+    uint32_t i_count;
+    mp4_samplesizes_block_t *p_blocks;
+    uint64_t *p_words;
+} mp4_samplesizes_t;
+
+/* Builds the table straight from the stsz/stz2 box entries: i_count
+ * big endian fields of i_field_size (4, 8, 16 or 32) bits */
+int  MP4_SampleSizes_Init( mp4_samplesizes_t *, const uint8_t *p_entries,
+                           unsigned i_field_size, uint32_t i_count );
+void MP4_SampleSizes_Clean( mp4_samplesizes_t * );
+
+static inline uint32_t MP4_SampleSizes_Get( const mp4_samplesizes_t *p_table,
+                                            uint32_t i_sample )
+{
+    assert( i_sample < p_table->i_count );
+
+    const mp4_samplesizes_block_t *p_block =
+            &p_table->p_blocks[i_sample / MP4_SAMPLESIZES_BLOCK];
+    const unsigned i_bits = p_block->i_bits;
+    if( i_bits == 0 )
+        return p_block->i_base;
+
+    /* A block of N bits values fills exactly N words */
+    const unsigned i_pos = (i_sample % MP4_SAMPLESIZES_BLOCK) * i_bits;
+    const uint64_t *p_word = &p_table->p_words[p_block->i_word + i_pos / 64];
+    const unsigned i_shift = i_pos % 64;
+
+    uint64_t i_value = p_word[0] >> i_shift;
+    if( i_shift + i_bits > 64 )
+        i_value |= p_word[1] << (64 - i_shift);
+
+    return p_block->i_base + (i_value & ((UINT64_C(1) << i_bits) - 1));
+}
+
+#endif
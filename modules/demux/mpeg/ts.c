@@ -34,6 +34,7 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_atomic.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -41,6 +42,8 @@
 #include "ts_pes.h"
 #include "ts_psi.h"
 #include "ts_si.h"
+#include "ts_si_worker.h"
+#include "ts_arib.h"
 #include "ts_psip.h"
 
 #include "ts_hotfixes.h"
@@ -123,6 +126,18 @@ static void Close ( vlc_object_t * );
 #define TS_OFFSETFIX_TEXT   "Try to fix too early PCR (or late DTS)"
 #define TS_GENERATED_PCR_OFFSET_TEXT "Offset in ms for generated PCR"
 
+#define READ_BATCH_TEXT N_("TS packets per read")
+#define READ_BATCH_LONGTEXT N_( \
+    "Number of TS packets fetched from the input in a single read. " \
+    "Packets are then handed out without being copied. " \
+    "Use 1 to read packets one by one." )
+
+#define SI_THREAD_TEXT N_("Parse SI tables in a separate thread")
+#define SI_THREAD_LONGTEXT N_( \
+    "Gather and decode the DVB service information (SDT, EIT, TDT) " \
+    "in a separate thread, so that heavy EPG traffic does not delay " \
+    "the elementary streams." )
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -163,6 +178,9 @@ vlc_module_begin ()
     add_bool( "ts-pcr-offsetfix", true, TS_OFFSETFIX_TEXT, NULL )
     add_integer_with_range( "ts-generated-pcr-offset", 120, 0, 500,
                             TS_GENERATED_PCR_OFFSET_TEXT, NULL )
+    add_integer_with_range( "ts-read-batch", 7 * 16, 1, 7 * 256,
+                            READ_BATCH_TEXT, READ_BATCH_LONGTEXT )
+    add_bool( "ts-si-thread", false, SI_THREAD_TEXT, SI_THREAD_LONGTEXT )
 
     set_capability( "demux", 10 )
     set_callbacks( Open, Close )
@@ -194,6 +212,9 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, stime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static void DropTSChunk( demux_sys_t *p_sys );
+static uint64_t StreamTell( demux_sys_t *p_sys );
+static int StreamSeek( demux_sys_t *p_sys, uint64_t i_pos );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, stime_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, stime_t );
@@ -405,6 +426,9 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->i_ts_batch = var_InheritInteger( p_demux, "ts-read-batch" );
+    p_sys->p_chunk = NULL;
+    p_sys->p_si_worker = NULL;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
     p_sys->record_dir_path = NULL;
@@ -443,6 +467,13 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_check_pcr_offset = p_sys->b_trust_pcr && var_CreateGetBool(p_demux, "ts-pcr-offsetfix" );
     p_sys->i_generated_pcr_dpb_offset = VLC_TICK_FROM_MS(var_CreateGetInteger( p_demux, "ts-generated-pcr-offset" ));
 
+    if( var_InheritBool( p_demux, "ts-si-thread" ) )
+    {
+        p_sys->p_si_worker = ts_si_worker_New( p_demux );
+        if( !p_sys->p_si_worker )
+            msg_Warn( p_demux, "cannot start SI thread, parsing inline" );
+    }
+
     /* We handle description of an extra PMT */
     char* psz_string = var_CreateGetString( p_demux, "ts-extra-pmt" );
     p_sys->b_user_pmt = false;
@@ -567,8 +598,16 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if( p_sys->p_si_worker )
+    {
+        ts_si_worker_Delete( p_sys->p_si_worker );
+        p_sys->p_si_worker = NULL;
+    }
+
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
+    DropTSChunk( p_sys );
+
     vlc_mutex_lock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
@@ -640,6 +679,10 @@ static int Demux( demux_t *p_demux )
         p_sys->patfix.status = PAT_FIXTRIED;
     }
 
+    /* Apply the SI tables decoded by the parsing thread */
+    if( p_sys->p_si_worker )
+        ts_si_worker_Drain( p_sys->p_si_worker );
+
     /* We read at most 100 TS packet or until a frame is completed */
     for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
@@ -754,7 +797,15 @@ static int Demux( demux_t *p_demux )
 
         case TYPE_SI:
             if( (p_pkt->i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
+            {
+                /* ARIB CDT logos are small, rare and stored as raw sections */
+                if( p_sys->p_si_worker && p_pid->i_pid != TS_ARIB_CDT_PID )
+                {
+                    ts_si_worker_Push( p_sys->p_si_worker, p_pid, p_pkt );
+                    break;
+                }
                 ts_si_Packet_Push( p_pid, p_pkt->p_buffer );
+            }
             block_Release( p_pkt );
             break;
 
@@ -960,7 +1011,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = StreamTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -1007,7 +1058,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            StreamSeek( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1158,9 +1209,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        DropTSChunk( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        DropTSChunk( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
                                      args );
 
@@ -1798,20 +1851,209 @@ static void PESDataChainHandle( vlc_object_t *p_obj, void *priv, block_t *p_data
     ParsePESDataChain( (demux_t *)p_obj, (ts_pid_t *) priv, p_data, i_flags, i_appendpcr );
 }
 
+static void ReadTSEOF( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    int64_t size = stream_Size( p_sys->stream );
+    if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
+        msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
+    else
+        msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
+}
+
+/*****************************************************************************
+ * Batched packets reading:
+ * TS packets are fetched from the stream by chunks of i_ts_batch packets.
+ * Each packet is then handed out as a block view on the chunk memory, so
+ * that we don't have to allocate and copy every single 188 bytes packet.
+ * The chunk is released once all the views on it have been released.
+ * Bytes that can't make a packet yet are carried to the next chunk.
+ *****************************************************************************/
+typedef struct
+{
+    block_t     b;
+    ts_chunk_t *p_chunk;
+} ts_packet_view_t;
+
+struct ts_chunk_t
+{
+    atomic_uint      refs;      /* views not yet released + reader */
+    unsigned         i_count;   /* valid packets views */
+    unsigned         i_next;    /* next view to hand out */
+    size_t           i_end;     /* data bytes, carry included */
+    size_t           i_carry;   /* offset of the bytes to carry over */
+    bool             b_lost;    /* carried bytes are not synchronized */
+    uint8_t         *p_data;
+    ts_packet_view_t views[];
+};
+
+static void TSChunkRelease( ts_chunk_t *p_chunk, unsigned i_refs )
+{
+    if( atomic_fetch_sub_explicit( &p_chunk->refs, i_refs,
+                                   memory_order_acq_rel ) == i_refs )
+        free( p_chunk );
+}
+
+static void TSPacketViewRelease( block_t *p_block )
+{
+    ts_packet_view_t *p_view = container_of( p_block, ts_packet_view_t, b );
+    TSChunkRelease( p_view->p_chunk, 1 );
+}
+
+static const struct vlc_block_callbacks ts_packet_view_cbs =
+{
+    TSPacketViewRelease,
+};
+
+static void DropTSChunk( demux_sys_t *p_sys )
+{
+    ts_chunk_t *p_chunk = p_sys->p_chunk;
+    if( p_chunk == NULL )
+        return;
+    p_sys->p_chunk = NULL;
+
+    /* Views not handed out, and our own reference */
+    TSChunkRelease( p_chunk, p_chunk->i_count - p_chunk->i_next + 1 );
+}
+
+static uint64_t StreamTell( demux_sys_t *p_sys )
+{
+    uint64_t i_pos = vlc_stream_Tell( p_sys->stream );
+    const ts_chunk_t *p_chunk = p_sys->p_chunk;
+
+    /* Logical position is the one of the next packet to hand out */
+    if( p_chunk )
+    {
+        size_t i_next = p_chunk->i_carry;
+        if( p_chunk->i_next < p_chunk->i_count )
+            i_next = p_chunk->views[p_chunk->i_next].b.p_start - p_chunk->p_data;
+        i_pos -= p_chunk->i_end - i_next;
+    }
+    return i_pos;
+}
+
+static int StreamSeek( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    DropTSChunk( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+static ts_chunk_t * ReadTSChunk( demux_t *p_demux, const ts_chunk_t *p_prev )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_size = p_sys->i_packet_size;
+    const size_t i_header = p_sys->i_packet_header_size;
+    const size_t i_max = i_size * p_sys->i_ts_batch;
+    const size_t i_carried = p_prev ? p_prev->i_end - p_prev->i_carry : 0;
+
+    /* Carried bytes are less than two packets */
+    size_t i_offset = sizeof(ts_chunk_t) +
+                      sizeof(ts_packet_view_t) * (p_sys->i_ts_batch + 2);
+    i_offset = (i_offset + 63) & ~(size_t)63;
+    ts_chunk_t *p_chunk = malloc( i_offset + i_carried + i_max );
+    if( unlikely(p_chunk == NULL) )
+        return NULL;
+    p_chunk->p_data = (uint8_t *) p_chunk + i_offset;
+    p_chunk->i_count = 0;
+    p_chunk->i_next = 0;
+
+    uint8_t *p_data = p_chunk->p_data;
+    if( i_carried )
+        memcpy( p_data, &p_prev->p_data[p_prev->i_carry], i_carried );
+
+    /* Don't wait for the whole chunk on live inputs,
+     * only take what the stream already has */
+    ssize_t i_read = vlc_stream_ReadPartial( p_sys->stream,
+                                             &p_data[i_carried], i_max );
+    if( i_read <= 0 )
+    {
+        free( p_chunk );
+        return NULL;
+    }
+    p_chunk->i_end = i_carried + i_read;
+
+    const size_t i_end = p_chunk->i_end;
+    bool b_lost = p_prev && p_prev->b_lost;
+    i_offset = 0;
+    for( ;; )
+    {
+        if( b_lost )
+        {
+            /* Re-sync on two consecutive sync bytes */
+            size_t i_skip = i_offset;
+            while( i_skip + i_header + i_size < i_end &&
+                  (p_data[i_skip + i_header] != 0x47 ||
+                   p_data[i_skip + i_header + i_size] != 0x47) )
+                i_skip++;
+            i_offset = i_skip;
+            if( i_offset + i_header + i_size >= i_end )
+                break; /* Need more data to decide */
+            msg_Dbg( p_demux, "resynced at %" PRIu64,
+                     vlc_stream_Tell( p_sys->stream ) - (i_end - i_offset) );
+            b_lost = false;
+        }
+
+        /* Sync bytes checks, and views creation */
+        while( i_offset + i_size <= i_end && p_data[i_offset + i_header] == 0x47 )
+        {
+            ts_packet_view_t *p_view = &p_chunk->views[p_chunk->i_count++];
+            block_Init( &p_view->b, &ts_packet_view_cbs,
+                        &p_data[i_offset], i_size );
+            /* Skip header (BluRay streams). */
+            p_view->b.p_buffer += i_header;
+            p_view->b.i_buffer -= i_header;
+            p_view->p_chunk = p_chunk;
+            i_offset += i_size;
+        }
+
+        if( i_offset + i_size > i_end )
+            break;
+
+        msg_Warn( p_demux, "lost synchro" );
+        b_lost = true;
+        i_offset++;
+    }
+
+    p_chunk->i_carry = i_offset;
+    p_chunk->b_lost = b_lost;
+    atomic_init( &p_chunk->refs, p_chunk->i_count + 1 );
+    return p_chunk;
+}
+
+static block_t* ReadTSPacketBatched( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_chunk_t *p_chunk = p_sys->p_chunk;
+
+    while( p_chunk == NULL || p_chunk->i_next == p_chunk->i_count )
+    {
+        ts_chunk_t *p_new = ReadTSChunk( p_demux, p_chunk );
+        if( p_new == NULL )
+        {
+            ReadTSEOF( p_demux );
+            return NULL;
+        }
+        if( p_chunk )
+            TSChunkRelease( p_chunk, 1 );
+        p_sys->p_chunk = p_chunk = p_new;
+    }
+
+    return &p_chunk->views[p_chunk->i_next++].b;
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     block_t     *p_pkt;
 
+    if( p_sys->i_ts_batch > 1 )
+        return ReadTSPacketBatched( p_demux );
+
     /* Get a new TS packet */
     if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
     {
-        int64_t size = stream_Size( p_sys->stream );
-        if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
-            msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
-        else
-            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
+        ReadTSEOF( p_demux );
         return NULL;
     }
 
@@ -1993,13 +2235,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return StreamSeek( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -2015,7 +2257,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( StreamSeek( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
@@ -2029,7 +2271,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = StreamTell( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -2086,7 +2328,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) != VLC_SUCCESS )
+        if( StreamSeek( p_sys, i_initial_pos ) != VLC_SUCCESS )
             msg_Err( p_demux, "Can't seek back to %" PRIu64, i_initial_pos );
         return VLC_EGENERIC;
     }
@@ -2172,7 +2414,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, bool *pb_fou
                         if( b_end )
                         {
                             p_pmt->i_last_dts = i_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = StreamTell( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2200,7 +2442,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, bool *pb_fou
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2212,7 +2454,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = (int64_t)p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( StreamSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         int i_count =  ProbeChunk( p_demux, i_program, false, &b_found );
@@ -2224,7 +2466,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
     } while( i_pos < i_stream_size && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( StreamSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2233,7 +2475,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2245,7 +2487,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( StreamSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         int i_count = ProbeChunk( p_demux, i_program, true, &b_found );
@@ -2257,7 +2499,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
     } while( i_pos > 0 && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( StreamSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2312,14 +2554,14 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, stime_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            StreamTell( p_sys ) > p_pmt->i_last_dts_byte )
         {
             if( p_pmt->i_last_dts_byte == 0 ) /* first run */
                 p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
             else
             {
                 p_pmt->i_last_dts = i_pcr;
-                p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                p_pmt->i_last_dts_byte = StreamTell( p_sys );
             }
         }
     }
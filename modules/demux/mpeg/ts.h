@@ -26,6 +26,8 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_chunk_t ts_chunk_t;
+typedef struct ts_si_worker_t ts_si_worker_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -72,6 +74,14 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* how many TS packet we fetch from the stream in a single read,
+     * and the chunk the next packets are handed out from */
+    unsigned    i_ts_batch;
+    ts_chunk_t *p_chunk;
+
+    /* SI sections parsing thread, or NULL to parse inline */
+    ts_si_worker_t *p_si_worker;
+
     bool        b_cc_check;
     bool        b_ignore_time_for_positions;
 
@@ -39,6 +39,7 @@
 #include <dvbpsi/psi.h>
 
 #include "ts_si.h"
+#include "ts_si_worker.h"
 #include "ts_arib.h"
 #include "ts_decoders.h"
 
@@ -337,6 +338,23 @@ static void SDTCallBack( demux_t *p_demux, dvbpsi_sdt_t *p_sdt )
     dvbpsi_sdt_delete( p_sdt );
 }
 
+static void SDTRelease( void *p_sdt )
+{
+    dvbpsi_sdt_delete( p_sdt );
+}
+
+static void SDTDispatch( dvbpsi_t *h, dvbpsi_sdt_t *p_sdt )
+{
+    demux_t *p_demux = (demux_t *) h->p_sys;
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_si_worker_t *p_worker = p_sys->p_si_worker;
+    if( p_worker )
+        ts_si_worker_Post( p_worker, h, (ts_si_handler_cb) SDTCallBack,
+                           SDTRelease, p_sdt );
+    else
+        SDTCallBack( p_demux, p_sdt );
+}
+
 static void EITDecodeMjd( int i_mjd, int *p_y, int *p_m, int *p_d )
 {
     const int yp = (int)( ( (double)i_mjd - 15078.2)/365.25 );
@@ -393,15 +411,33 @@ static void TDTCallBack( demux_t *p_demux, dvbpsi_tot_t *p_tdt )
         p_sys->i_network_time += 9 * 3600;
     }
 
-    /* Because libdvbpsi is broken and deduplicating timestamp tables,
-     * we need to reset it to get next timestamp callback */
-    ts_pid_t *pid = ts_pid_Get( &p_sys->pids, TS_SI_TDT_PID );
-    dvbpsi_decoder_reset( pid->u.p_si->handle->p_decoder, true );
     dvbpsi_tot_delete(p_tdt);
 
     es_out_Control( p_demux->out, ES_OUT_SET_EPG_TIME, (int64_t) p_sys->i_network_time );
 }
 
+static void TDTRelease( void *p_tdt )
+{
+    dvbpsi_tot_delete( p_tdt );
+}
+
+static void TDTDispatch( dvbpsi_t *h, dvbpsi_tot_t *p_tdt )
+{
+    demux_t *p_demux = (demux_t *) h->p_sys;
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_si_worker_t *p_worker = p_sys->p_si_worker;
+
+    /* Because libdvbpsi is broken and deduplicating timestamp tables,
+     * we need to reset it to get next timestamp callback */
+    dvbpsi_decoder_reset( h->p_decoder, true );
+
+    if( p_worker )
+        ts_si_worker_Post( p_worker, h, (ts_si_handler_cb) TDTCallBack,
+                           TDTRelease, p_tdt );
+    else
+        TDTCallBack( p_demux, p_tdt );
+}
+
 static void EITExtractDrDescItems( demux_t *p_demux, const dvbpsi_extended_event_dr_t *pE,
                                    vlc_epg_event_t *p_evt )
 {
@@ -694,6 +730,23 @@ static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
     dvbpsi_eit_delete( p_eit );
 }
 
+static void EITRelease( void *p_eit )
+{
+    dvbpsi_eit_delete( p_eit );
+}
+
+static void EITDispatch( dvbpsi_t *h, dvbpsi_eit_t *p_eit )
+{
+    demux_t *p_demux = (demux_t *) h->p_sys;
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_si_worker_t *p_worker = p_sys->p_si_worker;
+    if( p_worker )
+        ts_si_worker_Post( p_worker, h, (ts_si_handler_cb) EITCallBack,
+                           EITRelease, p_eit );
+    else
+        EITCallBack( p_demux, p_eit );
+}
+
 static void ARIB_CDT_RawCallback( dvbpsi_t *p_handle, const dvbpsi_psi_section_t* p_section,
                                   void *p_cdtpid )
 {
@@ -776,7 +829,7 @@ static void SINewTableCallBack( dvbpsi_t *h, uint8_t i_table_id,
 #endif
     if( p_pid->i_pid == TS_SI_SDT_PID && i_table_id == 0x42 )
     {
-        if( !dvbpsi_sdt_attach( h, i_table_id, i_extension, (dvbpsi_sdt_callback)SDTCallBack, p_demux ) )
+        if( !dvbpsi_sdt_attach( h, i_table_id, i_extension, (dvbpsi_sdt_callback)SDTDispatch, h ) )
             msg_Err( p_demux, "SINewTableCallback: failed attaching SDTCallback" );
     }
     else if( p_pid->i_pid == TS_SI_EIT_PID &&
@@ -784,13 +837,13 @@ static void SINewTableCallBack( dvbpsi_t *h, uint8_t i_table_id,
                (i_table_id >= 0x50 && i_table_id <= 0x5f) ) ) /* Schedule */
     {
         if( !dvbpsi_eit_attach( h, i_table_id, i_extension,
-                                (dvbpsi_eit_callback)EITCallBack, p_demux ) )
+                                (dvbpsi_eit_callback)EITDispatch, h ) )
             msg_Err( p_demux, "SINewTableCallback: failed attaching EITCallback" );
     }
     else if( p_pid->i_pid == TS_SI_TDT_PID &&
             (i_table_id == TS_SI_TDT_TABLE_ID || i_table_id == TS_SI_TOT_TABLE_ID) )
     {
-        if( !dvbpsi_tot_attach( h, i_table_id, i_extension, (dvbpsi_tot_callback)TDTCallBack, p_demux ) )
+        if( !dvbpsi_tot_attach( h, i_table_id, i_extension, (dvbpsi_tot_callback)TDTDispatch, h ) )
             msg_Err( p_demux, "SINewTableCallback: failed attaching TDTCallback" );
     }
     else if( p_pid->i_pid == TS_ARIB_CDT_PID && i_table_id == TS_ARIB_CDT_TABLE_ID )
@@ -0,0 +1,277 @@
+/*****************************************************************************
+ * ts_si_worker.c : TS demuxer SI sections parsing thread
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_block.h>
+#include <vlc_threads.h>
+#include <vlc_atomic.h>
+
+#include "ts_si.h"
+#include "ts_si_worker.h"
+
+#include <assert.h>
+
+typedef struct ts_si_job_t ts_si_job_t;
+struct ts_si_job_t
+{
+    ts_si_job_t *p_next;
+    ts_pid_t    *p_pid;
+    block_t     *p_pkt;
+};
+
+typedef struct ts_si_result_t ts_si_result_t;
+struct ts_si_result_t
+{
+    ts_si_result_t  *p_next;
+    const dvbpsi_t  *p_handle;
+    ts_si_handler_cb pf_handler;
+    ts_si_release_cb pf_release;
+    void            *p_table;
+};
+
+struct ts_si_worker_t
+{
+    demux_t      *p_demux;
+    vlc_thread_t  thread;
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait_jobs;
+    vlc_cond_t    wait_idle;
+    bool          b_busy;
+    bool          b_exit;
+
+    ts_si_job_t    *p_jobs;
+    ts_si_job_t   **pp_jobs_last;
+
+    ts_si_result_t  *p_results;
+    ts_si_result_t **pp_results_last;
+    atomic_bool      b_results; /* lockless check from the packets loop */
+};
+
+static void ReleaseJobs( ts_si_job_t *p_job )
+{
+    while( p_job )
+    {
+        ts_si_job_t *p_next = p_job->p_next;
+        block_Release( p_job->p_pkt );
+        free( p_job );
+        p_job = p_next;
+    }
+}
+
+static void ReleaseResults( ts_si_result_t *p_result )
+{
+    while( p_result )
+    {
+        ts_si_result_t *p_next = p_result->p_next;
+        p_result->pf_release( p_result->p_table );
+        free( p_result );
+        p_result = p_next;
+    }
+}
+
+static void *Run( void *data )
+{
+    ts_si_worker_t *p_worker = data;
+
+    vlc_thread_set_name( "vlc-ts-si" );
+
+    vlc_mutex_lock( &p_worker->lock );
+    for( ;; )
+    {
+        while( p_worker->p_jobs == NULL && !p_worker->b_exit )
+        {
+            p_worker->b_busy = false;
+            vlc_cond_broadcast( &p_worker->wait_idle );
+            vlc_cond_wait( &p_worker->wait_jobs, &p_worker->lock );
+        }
+        if( p_worker->b_exit )
+            break;
+
+        ts_si_job_t *p_job = p_worker->p_jobs;
+        p_worker->p_jobs = NULL;
+        p_worker->pp_jobs_last = &p_worker->p_jobs;
+        p_worker->b_busy = true;
+        vlc_mutex_unlock( &p_worker->lock );
+
+        /* Section gathering and table decoding. Callbacks post the decoded
+         * tables with ts_si_worker_Post(). */
+        while( p_job )
+        {
+            ts_si_job_t *p_next = p_job->p_next;
+            ts_si_Packet_Push( p_job->p_pid, p_job->p_pkt->p_buffer );
+            block_Release( p_job->p_pkt );
+            free( p_job );
+            p_job = p_next;
+        }
+
+        vlc_mutex_lock( &p_worker->lock );
+    }
+    vlc_mutex_unlock( &p_worker->lock );
+    return NULL;
+}
+
+ts_si_worker_t * ts_si_worker_New( demux_t *p_demux )
+{
+    ts_si_worker_t *p_worker = malloc( sizeof(*p_worker) );
+    if( !p_worker )
+        return NULL;
+
+    p_worker->p_demux = p_demux;
+    vlc_mutex_init( &p_worker->lock );
+    vlc_cond_init( &p_worker->wait_jobs );
+    vlc_cond_init( &p_worker->wait_idle );
+    p_worker->b_busy = false;
+    p_worker->b_exit = false;
+    p_worker->p_jobs = NULL;
+    p_worker->pp_jobs_last = &p_worker->p_jobs;
+    p_worker->p_results = NULL;
+    p_worker->pp_results_last = &p_worker->p_results;
+    atomic_init( &p_worker->b_results, false );
+
+    if( vlc_clone( &p_worker->thread, Run, p_worker ) )
+    {
+        free( p_worker );
+        return NULL;
+    }
+    return p_worker;
+}
+
+void ts_si_worker_Delete( ts_si_worker_t *p_worker )
+{
+    vlc_mutex_lock( &p_worker->lock );
+    p_worker->b_exit = true;
+    vlc_cond_signal( &p_worker->wait_jobs );
+    vlc_mutex_unlock( &p_worker->lock );
+
+    vlc_join( p_worker->thread, NULL );
+
+    ReleaseJobs( p_worker->p_jobs );
+    ReleaseResults( p_worker->p_results );
+    free( p_worker );
+}
+
+void ts_si_worker_Push( ts_si_worker_t *p_worker, ts_pid_t *p_pid,
+                        block_t *p_pkt )
+{
+    ts_si_job_t *p_job = malloc( sizeof(*p_job) );
+    if( unlikely(!p_job) )
+    {
+        block_Release( p_pkt );
+        return;
+    }
+    p_job->p_next = NULL;
+    p_job->p_pid = p_pid;
+    p_job->p_pkt = p_pkt;
+
+    vlc_mutex_lock( &p_worker->lock );
+    *p_worker->pp_jobs_last = p_job;
+    p_worker->pp_jobs_last = &p_job->p_next;
+    if( !p_worker->b_busy )
+        vlc_cond_signal( &p_worker->wait_jobs );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+void ts_si_worker_Post( ts_si_worker_t *p_worker, const dvbpsi_t *p_handle,
+                        ts_si_handler_cb pf_handler,
+                        ts_si_release_cb pf_release, void *p_table )
+{
+    ts_si_result_t *p_result = malloc( sizeof(*p_result) );
+    if( unlikely(!p_result) )
+    {
+        pf_release( p_table );
+        return;
+    }
+    p_result->p_next = NULL;
+    p_result->p_handle = p_handle;
+    p_result->pf_handler = pf_handler;
+    p_result->pf_release = pf_release;
+    p_result->p_table = p_table;
+
+    vlc_mutex_lock( &p_worker->lock );
+    *p_worker->pp_results_last = p_result;
+    p_worker->pp_results_last = &p_result->p_next;
+    atomic_store_explicit( &p_worker->b_results, true, memory_order_relaxed );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+static ts_si_result_t * TakeResults( ts_si_worker_t *p_worker )
+{
+    ts_si_result_t *p_results = p_worker->p_results;
+    p_worker->p_results = NULL;
+    p_worker->pp_results_last = &p_worker->p_results;
+    atomic_store_explicit( &p_worker->b_results, false, memory_order_relaxed );
+    return p_results;
+}
+
+void ts_si_worker_Drain( ts_si_worker_t *p_worker )
+{
+    if( !atomic_load_explicit( &p_worker->b_results, memory_order_relaxed ) )
+        return;
+
+    vlc_mutex_lock( &p_worker->lock );
+    ts_si_result_t *p_result = TakeResults( p_worker );
+    vlc_mutex_unlock( &p_worker->lock );
+
+    /* Handlers may flush the worker, which only discards the tables posted
+     * after this point */
+    while( p_result )
+    {
+        ts_si_result_t *p_next = p_result->p_next;
+        p_result->pf_handler( p_worker->p_demux, p_result->p_table );
+        free( p_result );
+        p_result = p_next;
+    }
+}
+
+void ts_si_worker_Flush( ts_si_worker_t *p_worker, const dvbpsi_t *p_handle )
+{
+    ts_si_result_t *p_results = NULL;
+    ts_si_result_t **pp_results_last = &p_results;
+
+    vlc_mutex_lock( &p_worker->lock );
+    while( p_worker->p_jobs != NULL || p_worker->b_busy )
+        vlc_cond_wait( &p_worker->wait_idle, &p_worker->lock );
+
+    /* Only the tables of that handle are discarded, the other SI PIDs
+     * keep their pending tables */
+    ts_si_result_t **pp_result = &p_worker->p_results;
+    while( *pp_result )
+    {
+        ts_si_result_t *p_result = *pp_result;
+        if( p_result->p_handle == p_handle )
+        {
+            *pp_result = p_result->p_next;
+            p_result->p_next = NULL;
+            *pp_results_last = p_result;
+            pp_results_last = &p_result->p_next;
+        }
+        else
+            pp_result = &p_result->p_next;
+    }
+    p_worker->pp_results_last = pp_result;
+    atomic_store_explicit( &p_worker->b_results, p_worker->p_results != NULL,
+                           memory_order_relaxed );
+    vlc_mutex_unlock( &p_worker->lock );
+
+    ReleaseResults( p_results );
+}
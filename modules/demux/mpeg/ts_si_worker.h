@@ -0,0 +1,50 @@
+/*****************************************************************************
+ * ts_si_worker.h : TS demuxer SI sections parsing thread
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifndef VLC_TS_SI_WORKER_H
+#define VLC_TS_SI_WORKER_H
+
+#include "ts_pid_fwd.h"
+
+/* SI packets are gathered into sections and decoded by a worker thread.
+ * Decoded tables are handed back, in order, to the demux thread which
+ * applies them to the programs and ES output. */
+typedef struct ts_si_worker_t ts_si_worker_t;
+typedef struct dvbpsi_s dvbpsi_t;
+
+typedef void (*ts_si_handler_cb)( demux_t *, void * );
+typedef void (*ts_si_release_cb)( void * );
+
+ts_si_worker_t * ts_si_worker_New( demux_t * );
+void ts_si_worker_Delete( ts_si_worker_t * );
+
+/* Demux thread: queues a SI packet (takes ownership) */
+void ts_si_worker_Push( ts_si_worker_t *, ts_pid_t *, block_t * );
+/* Demux thread: runs the handlers of the tables decoded so far */
+void ts_si_worker_Drain( ts_si_worker_t * );
+/* Demux thread: waits for queued packets and discards the pending tables
+ * decoded by the handle. Must be called before a SI decoder handle is
+ * deleted. */
+void ts_si_worker_Flush( ts_si_worker_t *, const dvbpsi_t * );
+
+/* Worker thread: hands a table decoded by the handle back to the demux
+ * thread. pf_release disposes of the table if its handler is never run. */
+void ts_si_worker_Post( ts_si_worker_t *, const dvbpsi_t *, ts_si_handler_cb,
+                        ts_si_release_cb pf_release, void * );
+
+#endif
@@ -46,6 +46,7 @@
 #include "ts.h"
 
 #include "ts_psip.h"
+#include "ts_si_worker.h"
 
 static inline bool handle_Init( demux_t *p_demux, dvbpsi_t **handle )
 {
@@ -342,6 +343,12 @@ ts_si_t *ts_si_New( demux_t *p_demux )
 
 void ts_si_Del( demux_t *p_demux, ts_si_t *si )
 {
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* The parsing thread must be done with the handle */
+    if( p_sys->p_si_worker )
+        ts_si_worker_Flush( p_sys->p_si_worker, si->handle );
+
     if( dvbpsi_decoder_present( si->handle ) )
         dvbpsi_DetachDemux( si->handle );
     dvbpsi_delete( si->handle );
@@ -64,6 +64,12 @@ void SmoothSegmentChunk::onDownload(block_t **pp_block)
     }
 }
 
+bool SmoothSegmentChunk::needsMoreHeader(const block_t *p_block) const
+{
+    /* fixups and tfrf need the whole moof */
+    return !SmoothIndexReader::isComplete(p_block, ATOM_moof);
+}
+
 SmoothSegmentTemplateSegment::SmoothSegmentTemplateSegment(ICanonicalUrl *parent)
     : SegmentTemplateSegment(parent)
 {
@@ -35,6 +35,7 @@ namespace smooth
                 SmoothSegmentChunk(AbstractChunkSource *, BaseRepresentation *);
                 virtual ~SmoothSegmentChunk();
                 virtual void onDownload(block_t **) override;
+                virtual bool needsMoreHeader(const block_t *) const override;
         };
 
         class SmoothSegmentTemplateSegment : public SegmentTemplateSegment
@@ -20,10 +20,37 @@
  *****************************************************************************/
 #include <vlc_bits.h>
 
+#include "startcode_helper.h"
+
+/* Forwards of at least that many bytes look up the next escape sequence
+ * instead of checking every byte */
+#define HXXX_EP3B_SCAN_MIN 32
+
 static inline uint8_t *hxxx_ep3b_to_rbsp( uint8_t *p, uint8_t *end, unsigned *pi_prev, size_t i_count )
 {
     for( size_t i=0; i<i_count; i++ )
     {
+        const size_t i_left = i_count - i;
+        /* After 2 bytes, the state only reflects the bytes at p[-1] and p[0] */
+        if( i >= 2 && i_left >= HXXX_EP3B_SCAN_MIN &&
+            (size_t)(end - p) > i_left + 1 )
+        {
+            const uint8_t *seq = startcode_FindPrefix( p - 1, p + i_left + 1, 0x03 );
+            if( seq == NULL )
+            {
+                p += i_left;
+                *pi_prev = (!p[-1] << 1) | (!p[0]);
+                return p;
+            }
+            /* Move right before the escape byte */
+            if( seq >= p )
+            {
+                i += seq + 1 - p;
+                p = (uint8_t *) seq + 1;
+                *pi_prev = 0x03;
+            }
+        }
+
         if( ++p >= end )
             return p;
 
@@ -22,6 +22,14 @@
 
 #include <vlc_cpu.h>
 
+#ifdef HAVE_AVX2_INTRINSICS
+#  include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define STARTCODE_NEON
+#endif
+
 #ifdef CAN_COMPILE_SSE2
 #  if defined __has_attribute
 #    if __has_attribute(__vector_size__)
@@ -150,16 +158,114 @@ static inline const uint8_t * startcode_FindAnnexB_Bits( const uint8_t *p, const
 }
 #undef TRY_MATCH
 
-#ifdef CAN_COMPILE_SSE2
+/* Looks up a 0x00 0x00 x sequence, x being non zero.
+ * A third byte that is neither 0 nor x cannot belong to any sequence
+ * starting at one of the 3 positions before it, so they are all skipped. */
+static inline const uint8_t * startcode_FindPrefix_C( const uint8_t *p, const uint8_t *end,
+                                                      uint8_t x )
+{
+    for (end -= 2; p < end; ) {
+        if (p[2] != 0 && p[2] != x)
+            p += 3;
+        else if (p[2] == x && p[1] == 0 && p[0] == 0)
+            return p;
+        else
+            p++;
+    }
+    return NULL;
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+/* Compares the 3 bytes of the sequence at 32 positions at once,
+ * using unaligned loads shifted by one byte. */
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * startcode_FindPrefix_AVX2( const uint8_t *p, const uint8_t *end,
+                                                         uint8_t x )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i last = _mm256_set1_epi8( x );
+
+    for( ; end - p >= 32 + 2; p += 32 )
+    {
+        __m256i v0 = _mm256_loadu_si256( (const __m256i *) p );
+        __m256i v1 = _mm256_loadu_si256( (const __m256i *) (p + 1) );
+        __m256i v2 = _mm256_loadu_si256( (const __m256i *) (p + 2) );
+        __m256i m = _mm256_and_si256( _mm256_cmpeq_epi8( v0, zero ),
+                                      _mm256_cmpeq_epi8( v1, zero ) );
+        m = _mm256_and_si256( m, _mm256_cmpeq_epi8( v2, last ) );
+
+        uint32_t match = _mm256_movemask_epi8( m );
+        if( match )
+            return p + vlc_ctz( match );
+    }
+
+    return startcode_FindPrefix_C( p, end, x );
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * startcode_FindAnnexB_AVX2( const uint8_t *p, const uint8_t *end )
+{
+    return startcode_FindPrefix_AVX2( p, end, 1 );
+}
+#endif
+
+#ifdef STARTCODE_NEON
+static inline const uint8_t * startcode_FindPrefix_NEON( const uint8_t *p, const uint8_t *end,
+                                                         uint8_t x )
+{
+    const uint8x16_t last = vdupq_n_u8( x );
+
+    for( ; end - p >= 16 + 2; p += 16 )
+    {
+        uint8x16_t m = vandq_u8( vceqzq_u8( vld1q_u8( p ) ),
+                                 vceqzq_u8( vld1q_u8( p + 1 ) ) );
+        m = vandq_u8( m, vceqq_u8( vld1q_u8( p + 2 ), last ) );
+
+        /* Narrow each byte of the mask to a nibble, as NEON lacks movemask */
+        uint64_t match = vget_lane_u64( vreinterpret_u64_u8(
+                            vshrn_n_u16( vreinterpretq_u16_u8( m ), 4 ) ), 0 );
+        if( match )
+            return p + vlc_ctzll( match ) / 4;
+    }
+
+    return startcode_FindPrefix_C( p, end, x );
+}
+
+static inline const uint8_t * startcode_FindAnnexB_NEON( const uint8_t *p, const uint8_t *end )
+{
+    return startcode_FindPrefix_NEON( p, end, 1 );
+}
+#endif
+
+static inline const uint8_t * startcode_FindPrefix( const uint8_t *p, const uint8_t *end,
+                                                    uint8_t x )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return startcode_FindPrefix_AVX2(p, end, x);
+#endif
+#ifdef STARTCODE_NEON
+    if (vlc_CPU_ARM_NEON())
+        return startcode_FindPrefix_NEON(p, end, x);
+#endif
+    return startcode_FindPrefix_C(p, end, x);
+}
+
 static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint8_t *end )
 {
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return startcode_FindAnnexB_AVX2(p, end);
+#endif
+#ifdef STARTCODE_NEON
+    if (vlc_CPU_ARM_NEON())
+        return startcode_FindAnnexB_NEON(p, end);
+#endif
+#ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return startcode_FindAnnexB_SSE2(p, end);
-    else
-        return startcode_FindAnnexB_Bits(p, end);
-}
-#else
-    #define startcode_FindAnnexB startcode_FindAnnexB_Bits
 #endif
+    return startcode_FindAnnexB_Bits(p, end);
+}
 
 #endif
@@ -0,0 +1,190 @@
+/*****************************************************************************
+ * dgram_helper.c: batched datagrams sending
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_network.h>
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
+#ifdef __linux__
+# include <netinet/udp.h>
+#endif
+
+#include "dgram_helper.h"
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+void vlc_dgram_sender_Init(struct vlc_dgram_sender *s, bool gso)
+{
+    s->gso = gso;
+    s->calls = 0;
+    s->datagrams = 0;
+}
+
+static size_t msg_Length(const struct msghdr *msg)
+{
+    size_t len = 0;
+
+    for (size_t i = 0; i < (size_t)msg->msg_iovlen; i++)
+        len += msg->msg_iov[i].iov_len;
+    return len;
+}
+
+#ifdef UDP_SEGMENT
+# define GSO_MAX_SIZE 65000
+# define GSO_MAX_IOV 256
+
+/**
+ * Sends equally sized datagrams (but possibly the last one) as a single
+ * segmented message, so that the kernel or the NIC splits it.
+ * @return the number of datagrams sent, or -1 on error
+ */
+static ssize_t SendSegmented(struct vlc_dgram_sender *s, int fd,
+                             const struct msghdr *msgs, unsigned count)
+{
+    const size_t segsize = msg_Length(&msgs[0]);
+    struct iovec iov[GSO_MAX_IOV];
+    unsigned iovlen = 0, n = 0;
+    size_t total = 0;
+
+    if (segsize == 0)
+        return 0;
+
+    while (n < count && n < 64) {
+        size_t len = msg_Length(&msgs[n]);
+
+        if (len > segsize || total + len > GSO_MAX_SIZE
+         || iovlen + msgs[n].msg_iovlen > GSO_MAX_IOV)
+            break;
+
+        memcpy(&iov[iovlen], msgs[n].msg_iov,
+               msgs[n].msg_iovlen * sizeof (*iov));
+        iovlen += msgs[n].msg_iovlen;
+        total += len;
+        n++;
+
+        if (len < segsize)
+            break; /* only the last segment can be shorter */
+    }
+
+    if (n <= 1)
+        return 0;
+
+    union {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = iovlen,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (uint16_t));
+    memcpy(CMSG_DATA(cmsg), &(uint16_t){ segsize }, sizeof (uint16_t));
+
+    s->calls++;
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0)
+        return -1;
+
+    s->datagrams += n;
+    return n;
+}
+#endif
+
+ssize_t vlc_dgram_SendBatch(struct vlc_dgram_sender *s, int fd,
+                            const struct msghdr *msgs, unsigned count)
+{
+    unsigned sent = 0;
+
+#ifdef UDP_SEGMENT
+    while (s->gso && sent < count) {
+        ssize_t val = SendSegmented(s, fd, msgs + sent, count - sent);
+
+        if (val > 0) {
+            sent += val;
+            continue;
+        }
+        if (val == 0)
+            break; /* not segmentable, send what follows as is */
+
+        switch (errno) {
+            case EINVAL:
+            case EIO:
+            case ENOPROTOOPT:
+            case EOPNOTSUPP:
+                s->gso = false; /* not supported here */
+                break;
+            default:
+                return sent ? (ssize_t)sent : -1;
+        }
+    }
+#endif
+
+#ifdef HAVE_SENDMMSG
+    while (sent < count) {
+        struct mmsghdr mmsg[VLC_DGRAM_BATCH_MAX];
+        unsigned n = count - sent;
+
+        if (n > ARRAY_SIZE(mmsg))
+            n = ARRAY_SIZE(mmsg);
+
+        for (unsigned i = 0; i < n; i++) {
+            mmsg[i].msg_hdr = msgs[sent + i];
+            mmsg[i].msg_len = 0;
+        }
+
+        s->calls++;
+        int val = sendmmsg(fd, mmsg, n, MSG_NOSIGNAL);
+        if (val <= 0) {
+            if (val < 0 && errno == ENOSYS)
+                break; /* send one by one */
+            return sent ? (ssize_t)sent : -1;
+        }
+
+        s->datagrams += val;
+        sent += val;
+    }
+#endif
+
+    while (sent < count) {
+        s->calls++;
+        if (vlc_sendmsg(fd, &msgs[sent], 0) < 0)
+            return sent ? (ssize_t)sent : -1;
+
+        s->datagrams++;
+        sent++;
+    }
+
+    return sent;
+}
@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * dgram_helper.h: batched datagrams sending
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SOUT_DGRAM_H
+#define VLC_SOUT_DGRAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct msghdr;
+
+/** Maximum number of datagrams handed to the kernel at once */
+#define VLC_DGRAM_BATCH_MAX 64
+
+/**
+ * Per socket batched sending state.
+ */
+struct vlc_dgram_sender
+{
+    bool gso; /**< UDP segmentation offload not known to be unusable */
+    uint64_t calls; /**< system calls issued */
+    uint64_t datagrams; /**< datagrams sent */
+};
+
+void vlc_dgram_sender_Init(struct vlc_dgram_sender *, bool gso);
+
+/**
+ * Sends a batch of datagrams on a connected socket.
+ *
+ * Datagrams are sent with as few system calls as possible, with UDP
+ * segmentation offload (if enabled and supported) or sendmmsg().
+ * The message headers shall have no address nor control data.
+ *
+ * @return the number of datagrams sent, or -1 if none could be sent
+ * (errno is then set)
+ */
+ssize_t vlc_dgram_SendBatch(struct vlc_dgram_sender *, int fd,
+                            const struct msghdr *msgs, unsigned count);
+
+#endif
@@ -54,6 +54,7 @@
 
 #include "rtp.h"
 #include "sdp_helper.h"
+#include "dgram_helper.h"
 
 #include <sys/types.h>
 #include <unistd.h>
@@ -159,6 +160,20 @@ static const char *const ppsz_protocols[] = {
 #define RFC3016_LONGTEXT N_( \
     "This allows you to stream MPEG4 LATM audio streams (see RFC3016)." )
 
+#define BATCH_TEXT N_("Packets per send call")
+#define BATCH_LONGTEXT N_( "Maximum number of RTP packets sent to a " \
+    "destination with a single system call. Use 1 to send packets one " \
+    "by one." )
+
+#define BATCH_WINDOW_TEXT N_("Batching window (ms)")
+#define BATCH_WINDOW_LONGTEXT N_( "Packets due within this delay are " \
+    "sent along with the current packet. The default is 0 (only packets " \
+    "already due are sent together)." )
+
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_( "Send batches of RTP packets over UDP as single " \
+    "segmented messages, where the operating system supports it." )
+
 #define RTSP_TIMEOUT_TEXT N_( "RTSP session timeout (s)" )
 #define RTSP_TIMEOUT_LONGTEXT N_( "RTSP sessions will be closed after " \
     "not receiving any RTSP request for this long. Setting it to a " \
@@ -218,6 +233,11 @@ vlc_module_begin ()
               RTCP_MUX_TEXT, RTCP_MUX_LONGTEXT )
     add_integer( SOUT_CFG_PREFIX "caching", MS_FROM_VLC_TICK(DEFAULT_PTS_DELAY),
                  CACHING_TEXT, CACHING_LONGTEXT )
+    add_integer_with_range( SOUT_CFG_PREFIX "batch", 32, 1,
+                            VLC_DGRAM_BATCH_MAX, BATCH_TEXT, BATCH_LONGTEXT )
+    add_integer_with_range( SOUT_CFG_PREFIX "batch-window", 0, 0, 100,
+                            BATCH_WINDOW_TEXT, BATCH_WINDOW_LONGTEXT )
+    add_bool( SOUT_CFG_PREFIX "gso", true, GSO_TEXT, GSO_LONGTEXT )
     add_integer( "rtsp-timeout", 60, RTSP_TIMEOUT_TEXT,
                  RTSP_TIMEOUT_LONGTEXT )
     add_string( "sout-rtsp-user", "",
@@ -243,6 +263,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "dst", "name", "cat", "port", "port-audio", "port-video", "*sdp", "ttl",
     "mux", "sap", "description", "proto", "rtcp-mux", "caching",
+    "batch", "batch-window", "gso",
 #ifdef HAVE_SRTP
     "key", "salt",
 #endif
@@ -317,6 +338,7 @@ typedef struct rtp_sink_t
 {
     int rtp_fd;
     rtcp_sender_t *rtcp;
+    struct vlc_dgram_sender sender;
 } rtp_sink_t;
 
 struct sout_stream_id_sys_t
@@ -357,6 +379,9 @@ struct sout_stream_id_sys_t
     } listen;
 
     vlc_tick_t        i_caching;
+    unsigned          i_batch;
+    vlc_tick_t        i_batch_window;
+    bool              b_gso;
 };
 
 static int Control(sout_stream_t *stream, int query, va_list args)
@@ -956,6 +981,12 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt, const char
     id->b_first_packet = true;
     id->i_caching =
         VLC_TICK_FROM_MS(var_GetInteger( p_stream, SOUT_CFG_PREFIX "caching"));
+    id->i_batch = var_GetInteger( p_stream, SOUT_CFG_PREFIX "batch" );
+    if( id->i_batch < 1 || id->i_batch > VLC_DGRAM_BATCH_MAX )
+        id->i_batch = 1;
+    id->i_batch_window = VLC_TICK_FROM_MS(
+        var_GetInteger( p_stream, SOUT_CFG_PREFIX "batch-window" ) );
+    id->b_gso = var_GetBool( p_stream, SOUT_CFG_PREFIX "gso" );
 
     vlc_rand_bytes (&id->i_sequence, sizeof (id->i_sequence));
     vlc_rand_bytes (id->ssrc, sizeof (id->ssrc));
@@ -1340,6 +1371,52 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
+#ifdef HAVE_SRTP
+static block_t *ProtectRTP( sout_stream_id_sys_t *id, block_t *out )
+{
+    /* FIXME: this is awfully inefficient */
+    size_t len = out->i_buffer;
+    out = block_Realloc( out, 0, len + 10 );
+    out->i_buffer = len;
+
+    int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+    if( val )
+    {
+        msg_Dbg( id->p_stream, "SRTP sending error: %s",
+                 vlc_strerror_c(val) );
+        block_Release( out );
+        return NULL;
+    }
+    out->i_buffer = len;
+    return out;
+}
+#endif
+
+/* Dequeues the packets due within the batching window after the first one */
+static unsigned DequeueBatch( sout_stream_id_sys_t *id, block_t **batch,
+                              vlc_tick_t deadline )
+{
+    unsigned count = 1;
+
+    vlc_queue_Lock( &id->queue );
+    while( count < id->i_batch && !vlc_queue_IsEmpty( &id->queue ) )
+    {
+        const block_t *next = (const block_t *)id->queue.first;
+        if( next->i_dts + id->i_caching > deadline )
+            break;
+
+        block_t *out = vlc_queue_DequeueUnlocked( &id->queue );
+        out->p_next = NULL;
+#ifdef HAVE_SRTP
+        if( id->srtp && (out = ProtectRTP( id, out )) == NULL )
+            continue;
+#endif
+        batch[count++] = out;
+    }
+    vlc_queue_Unlock( &id->queue );
+    return count;
+}
+
 static void* ThreadSend( void *data )
 {
     vlc_thread_set_name("vlc-rt-send");
@@ -1359,26 +1436,28 @@ static void* ThreadSend( void *data )
     while ((out = vlc_queue_DequeueKillable(&id->queue, &id->dead)) != NULL)
     {
 #ifdef HAVE_SRTP
-        if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
-
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            if( val )
-            {
-                msg_Dbg( id->p_stream, "SRTP sending error: %s",
-                         vlc_strerror_c(val) );
-                block_Release( out );
-                continue;
-            }
-            out->i_buffer = len;
-        }
+        if( id->srtp && (out = ProtectRTP( id, out )) == NULL )
+            continue;
 #endif
         vlc_tick_wait (out->i_dts + i_caching);
 
-        ssize_t len = out->i_buffer;
+        /* Coalesce the packets due within the batching window */
+        block_t *batch[VLC_DGRAM_BATCH_MAX];
+        struct iovec iov[VLC_DGRAM_BATCH_MAX];
+        struct msghdr msgs[VLC_DGRAM_BATCH_MAX];
+
+        batch[0] = out;
+        unsigned count = 1;
+        if( id->i_batch > 1 )
+            count = DequeueBatch( id, batch,
+                                  vlc_tick_now() + id->i_batch_window );
+
+        for( unsigned i = 0; i < count; i++ )
+        {
+            iov[i].iov_base = batch[i]->p_buffer;
+            iov[i].iov_len = batch[i]->i_buffer;
+            msgs[i] = (struct msghdr) { .msg_iov = &iov[i], .msg_iovlen = 1 };
+        }
 
         vlc_mutex_lock( &id->lock_sink );
         unsigned deadc = 0; /* How many dead sockets? */
@@ -1386,29 +1465,42 @@ static void* ThreadSend( void *data )
 
         for( int i = 0; i < id->sinkc; i++ )
         {
+            rtp_sink_t *sink = &id->sinkv[i];
+
 #ifdef HAVE_SRTP
             if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+                for( unsigned j = 0; j < count; j++ )
+                    SendRTCP( sink->rtcp, batch[j] );
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
+            ssize_t sent = vlc_dgram_SendBatch( &sink->sender, sink->rtp_fd,
+                                                msgs, count );
+            if( sent < (ssize_t)count
              && net_errno != EAGAIN && net_errno != EWOULDBLOCK
              && net_errno != ENOBUFS && net_errno != ENOMEM )
             {
                 int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
+                getsockopt( sink->rtp_fd, SOL_SOCKET, SO_TYPE,
                             &type, &(socklen_t){ sizeof(type) });
                 if( type == SOCK_DGRAM )
+                {
                     /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
+                    if( sent < 0 )
+                        sent = 0;
+                    vlc_dgram_SendBatch( &sink->sender, sink->rtp_fd,
+                                         msgs + sent, count - sent );
+                }
                 else
                     /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
+                    deadv[deadc++] = sink->rtp_fd;
             }
         }
+        out = batch[count - 1];
         id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
         vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+
+        for( unsigned i = 0; i < count; i++ )
+            block_Release( batch[i] );
 
         for( unsigned i = 0; i < deadc; i++ )
         {
@@ -1445,12 +1537,17 @@ static void *rtp_listen_thread( void *data )
 
 int rtp_add_sink( sout_stream_id_sys_t *id, int fd, bool rtcp_mux, uint16_t *seq )
 {
-    rtp_sink_t sink = { fd, NULL };
+    rtp_sink_t sink = { .rtp_fd = fd, .rtcp = NULL };
     sink.rtcp = OpenRTCP( VLC_OBJECT( id->p_stream ), fd, IPPROTO_UDP,
                           rtcp_mux );
     if( sink.rtcp == NULL )
         msg_Err( id->p_stream, "RTCP failed!" );
 
+    int type = SOCK_DGRAM;
+    getsockopt( fd, SOL_SOCKET, SO_TYPE, &type,
+                &(socklen_t){ sizeof(type) } );
+    vlc_dgram_sender_Init( &sink.sender, id->b_gso && type == SOCK_DGRAM );
+
     vlc_mutex_lock( &id->lock_sink );
     TAB_APPEND(id->sinkc, id->sinkv, sink);
     if( seq != NULL )
@@ -1461,7 +1558,7 @@ int rtp_add_sink( sout_stream_id_sys_t *id, int fd, bool rtcp_mux, uint16_t *seq
 
 void rtp_del_sink( sout_stream_id_sys_t *id, int fd )
 {
-    rtp_sink_t sink = { fd, NULL };
+    rtp_sink_t sink = { .rtp_fd = fd, .rtcp = NULL };
 
     /* NOTE: must be safe to use if fd is not included */
     vlc_mutex_lock( &id->lock_sink );
@@ -1476,6 +1573,12 @@ void rtp_del_sink( sout_stream_id_sys_t *id, int fd )
     }
     vlc_mutex_unlock( &id->lock_sink );
 
+    if( sink.sender.calls > 0 )
+        msg_Dbg( id->p_stream, "socket %d: sent %"PRIu64" packets in %"PRIu64
+                 " calls (average batch %.1f)", fd, sink.sender.datagrams,
+                 sink.sender.calls,
+                 (double)sink.sender.datagrams / sink.sender.calls );
+
     CloseRTCP( sink.rtcp );
     net_Close( sink.rtp_fd );
 }
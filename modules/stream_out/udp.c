@@ -39,6 +39,7 @@
 #include <vlc_network.h>
 #include <vlc_memstream.h>
 #include "sdp_helper.h"
+#include "dgram_helper.h"
 
 struct sout_stream_udp
 {
@@ -47,6 +48,7 @@ struct sout_stream_udp
     session_descriptor_t *sap;
     int fd;
     uint_fast16_t mtu;
+    struct vlc_dgram_sender sender;
 };
 
 static void *
@@ -154,33 +156,45 @@ static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
     ssize_t total = 0;
 
     while (block != NULL) {
-        struct iovec iov[16];
+        struct iovec iov[VLC_DGRAM_BATCH_MAX][16];
+        struct msghdr msgs[VLC_DGRAM_BATCH_MAX];
+        size_t tosend[VLC_DGRAM_BATCH_MAX];
         block_t *unsent = block;
-        unsigned iovlen = 0;
-        size_t tosend = 0;
+        unsigned count = 0;
 
-        /* Count how many blocks to gather */
+        /* Gather blocks into datagrams, and datagrams into a batch */
         do {
-            if (iovlen >= ARRAY_SIZE(iov))
-                break;
-            if (unsent->i_buffer + tosend > sys->mtu && likely(iovlen > 0))
-                break;
-
-            iov[iovlen].iov_base = unsent->p_buffer;
-            iov[iovlen].iov_len = unsent->i_buffer;
-            iovlen++;
-            tosend += unsent->i_buffer;
-            unsent = unsent->p_next;
-        } while (unsent != NULL);
+            unsigned iovlen = 0;
+
+            tosend[count] = 0;
+            do {
+                if (iovlen >= ARRAY_SIZE(iov[count]))
+                    break;
+                if (unsent->i_buffer + tosend[count] > sys->mtu
+                 && likely(iovlen > 0))
+                    break;
+
+                iov[count][iovlen].iov_base = unsent->p_buffer;
+                iov[count][iovlen].iov_len = unsent->i_buffer;
+                iovlen++;
+                tosend[count] += unsent->i_buffer;
+                unsent = unsent->p_next;
+            } while (unsent != NULL);
+
+            msgs[count] = (struct msghdr) {
+                .msg_iov = iov[count], .msg_iovlen = iovlen,
+            };
+            count++;
+        } while (unsent != NULL && count < ARRAY_SIZE(msgs));
 
         /* Send */
-        struct msghdr hdr = { .msg_iov = iov, .msg_iovlen = iovlen };
-        ssize_t val = sendmsg(sys->fd, &hdr, 0);
+        ssize_t val = vlc_dgram_SendBatch(&sys->sender, sys->fd, msgs, count);
 
         if (val < 0)
             msg_Err(access, "send error: %s", vlc_strerror_c(errno));
         else
-            total += val;
+            for (ssize_t i = 0; i < val; i++)
+                total += tosend[i];
 
         /* Free */
         do {
@@ -198,6 +212,10 @@ static void Close(sout_stream_t *stream)
 {
     struct sout_stream_udp *sys = stream->p_sys;
 
+    if (sys->sender.calls > 0)
+        msg_Dbg(stream, "sent %"PRIu64" datagrams in %"PRIu64" calls",
+                sys->sender.datagrams, sys->sender.calls);
+
     if (sys->sap != NULL)
         sout_AnnounceUnRegister(stream, sys->sap);
 
@@ -217,7 +235,7 @@ static const struct sout_stream_operations ops = {
 };
 
 static const char *const chain_options[] = {
-    "avformat", "dst", "sap", "name", "description", NULL
+    "avformat", "dst", "sap", "name", "description", "gso", NULL
 };
 
 #define DEFAULT_PORT 1234
@@ -315,6 +333,8 @@ static int Open(vlc_object_t *obj)
     sys->access = access;
     sys->fd = fd;
     sys->mtu = var_InheritInteger(stream, "mtu");
+    vlc_dgram_sender_Init(&sys->sender,
+                          var_GetBool(stream, SOUT_CFG_PREFIX "gso"));
 
     sout_mux_t *mux = sout_MuxNew(access, muxmod);
     if (mux == NULL) {
@@ -353,6 +373,10 @@ error:
 #define DESC_TEXT N_("SAP description")
 #define DESC_LONGTEXT N_( \
     "Short description of the stream that will be announced with SAP.")
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_( \
+    "Send batches of datagrams as single segmented messages, " \
+    "where the operating system supports it.")
 
 vlc_module_begin()
     set_shortname(N_("UDP"))
@@ -366,6 +390,7 @@ vlc_module_begin()
     add_bool(SOUT_CFG_PREFIX "sap", false, SAP_TEXT, SAP_LONGTEXT)
     add_string(SOUT_CFG_PREFIX "name", "", NAME_TEXT, NAME_LONGTEXT)
     add_string(SOUT_CFG_PREFIX "description", "", DESC_TEXT, DESC_LONGTEXT)
+    add_bool(SOUT_CFG_PREFIX "gso", true, GSO_TEXT, GSO_LONGTEXT)
 
     set_callback(Open)
 vlc_module_end()
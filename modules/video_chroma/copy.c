@@ -130,8 +130,156 @@ void CopyCleanCache(copy_cache_t *cache)
 # define vlc_CPU_SSSE3() (0)
 # undef vlc_CPU_SSE2
 # define vlc_CPU_SSE2() (0)
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() (0)
+#elif defined(COPY_TEST) && defined(CAN_COMPILE_AVX2)
+/* Allows comparing the SSE and AVX2 versions */
+static bool copy_test_avx2 = true;
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() (copy_test_avx2 && (vlc_CPU() & VLC_CPU_AVX2) != 0)
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+/* Same as COPY16/COPY64 with 32/128 bytes and AVX2 instructions. */
+
+#define COPY32_SHIFTR(x) \
+    "vpsrlw "x", %%ymm1, %%ymm1\n"
+#define COPY32_SHIFTL(x) \
+    "vpsllw "x", %%ymm1, %%ymm1\n"
+
+#define COPY32_S(dstp, srcp, load, store, shiftstr) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        shiftstr                        \
+        store " %%ymm1,    0(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1")
+
+#define COPY32(dstp, srcp, load, store) COPY32_S(dstp, srcp, load, store, "")
+
+#define COPY128_SHIFTR(x) \
+    "vpsrlw "x", %%ymm1, %%ymm1\n" \
+    "vpsrlw "x", %%ymm2, %%ymm2\n" \
+    "vpsrlw "x", %%ymm3, %%ymm3\n" \
+    "vpsrlw "x", %%ymm4, %%ymm4\n"
+#define COPY128_SHIFTL(x) \
+    "vpsllw "x", %%ymm1, %%ymm1\n" \
+    "vpsllw "x", %%ymm2, %%ymm2\n" \
+    "vpsllw "x", %%ymm3, %%ymm3\n" \
+    "vpsllw "x", %%ymm4, %%ymm4\n"
+
+#define COPY128_S(dstp, srcp, load, store, shiftstr) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        load " 32(%[src]), %%ymm2\n"    \
+        load " 64(%[src]), %%ymm3\n"    \
+        load " 96(%[src]), %%ymm4\n"    \
+        shiftstr                        \
+        store " %%ymm1,    0(%[dst])\n" \
+        store " %%ymm2,   32(%[dst])\n" \
+        store " %%ymm3,   64(%[dst])\n" \
+        store " %%ymm4,   96(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1", "xmm2", "xmm3", "xmm4")
+
+#define COPY128(dstp, srcp, load, store) \
+    COPY128_S(dstp, srcp, load, store, "")
+
+/* The upper halves of the ymm registers must be cleared before going back to
+ * legacy SSE code, unless the compiler generates AVX code itself. */
+#ifdef __AVX__
+# define AVX2_ZEROUPPER() do { } while (0)
+#else
+# define AVX2_ZEROUPPER() asm volatile ("vzeroupper")
+#endif
+
+VLC_SSE
+static void AVX2_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height, int bitshift)
+{
+    asm volatile ("mfence");
+
+    /* vmovntdqa needs aligned loads: the first 32 bytes are copied unaligned,
+     * then the copy restarts from the first aligned source address. */
+#define AVX2_USWC_COPY(shiftstr32, shiftstr128) \
+    for (unsigned y = 0; y < height; y++) { \
+        unsigned x = 0; \
+        if (width >= 32) { \
+            x = (-(uintptr_t)src) & 0x1f; \
+            if (x) \
+                COPY32_S(dst, src, "vmovdqu", "vmovdqu", shiftstr32); \
+            for (; x+127 < width; x += 128) \
+                COPY128_S(&dst[x], &src[x], "vmovntdqa", "vmovdqu", shiftstr128); \
+            for (; x+31 < width; x += 32) \
+                COPY32_S(&dst[x], &src[x], "vmovntdqa", "vmovdqu", shiftstr32); \
+        } \
+        if (x < width) \
+            CopyPlane(&dst[x], dst_pitch - x, &src[x], src_pitch - x, 1, bitshift); \
+        src += src_pitch; \
+        dst += dst_pitch; \
+    }
+
+    switch (bitshift)
+    {
+        case 0:
+            AVX2_USWC_COPY("", "")
+            break;
+        case -6:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$6"), COPY128_SHIFTL("$6"))
+            break;
+        case 6:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$6"), COPY128_SHIFTR("$6"))
+            break;
+        case 2:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$2"), COPY128_SHIFTR("$2"))
+            break;
+        case -2:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$2"), COPY128_SHIFTL("$2"))
+            break;
+        case 4:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$4"), COPY128_SHIFTR("$4"))
+            break;
+        case -4:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$4"), COPY128_SHIFTL("$4"))
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+#undef AVX2_USWC_COPY
+
+    AVX2_ZEROUPPER();
+    asm volatile ("mfence");
+}
+
+VLC_SSE
+static void AVX2_Copy2d(uint8_t *dst, size_t dst_pitch,
+                        const uint8_t *src, size_t src_pitch,
+                        unsigned width, unsigned height)
+{
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        bool unaligned = ((intptr_t)dst & 0x1f) != 0;
+        if (!unaligned) {
+            for (; x+127 < width; x += 128)
+                COPY128(&dst[x], &src[x], "vmovdqu", "vmovntdq");
+        } else {
+            for (; x+127 < width; x += 128)
+                COPY128(&dst[x], &src[x], "vmovdqu", "vmovdqu");
+        }
+        for (; x+31 < width; x += 32)
+            COPY32(&dst[x], &src[x], "vmovdqu", "vmovdqu");
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+
+    AVX2_ZEROUPPER();
+}
+#endif /* CAN_COMPILE_AVX2 */
+
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
  * as used by some video surface.
  * XXX It is really efficient only when SSE4.1 is available.
@@ -143,6 +291,12 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
 {
     assert(((intptr_t)dst & 0x0f) == 0 && (dst_pitch & 0x0f) == 0);
 
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_CopyFromUswc(dst, dst_pitch, src, src_pitch,
+                                 width, height, bitshift);
+#endif
+
     asm volatile ("mfence");
 
 #define SSE_USWC_COPY(shiftstr16, shiftstr64) \
@@ -196,7 +350,7 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
             SSE_USWC_COPY(COPY16_SHIFTR("$4"), COPY64_SHIFTR("$4"))
             break;
         case -4:
-            SSE_USWC_COPY(COPY16_SHIFTL("$2"), COPY64_SHIFTL("$2"))
+            SSE_USWC_COPY(COPY16_SHIFTL("$4"), COPY64_SHIFTL("$4"))
             break;
         default:
             vlc_assert_unreachable();
@@ -213,6 +367,11 @@ static void Copy2d(uint8_t *dst, size_t dst_pitch,
 {
     assert(((intptr_t)src & 0x0f) == 0 && (src_pitch & 0x0f) == 0);
 
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_Copy2d(dst, dst_pitch, src, src_pitch, width, height);
+#endif
+
     for (unsigned y = 0; y < height; y++) {
         unsigned x = 0;
 
@@ -280,6 +439,38 @@ SSE_InterleaveUV(uint8_t *dst, size_t dst_pitch,
     "movdqu %%xmm2, 0x20(%[dst])\n"     \
     "movdqu %%xmm3, 0x30(%[dst])\n"
 
+#ifdef CAN_COMPILE_AVX2
+        /* The 256-bit unpacks work within 128-bit lanes: they interleave
+         * pixels 0-7|16-23 and 8-15|24-31, which are then put back in
+         * order. */
+#define INTERLEAVE64(unpackl, unpackh)                  \
+    asm volatile                                        \
+        (                                               \
+            "vmovdqu (%[src1]), %%ymm0\n"               \
+            "vmovdqu (%[src2]), %%ymm1\n"               \
+            unpackl " %%ymm1, %%ymm0, %%ymm2\n"         \
+            unpackh " %%ymm1, %%ymm0, %%ymm3\n"         \
+            "vperm2i128 $0x20, %%ymm3, %%ymm2, %%ymm0\n" \
+            "vperm2i128 $0x31, %%ymm3, %%ymm2, %%ymm1\n" \
+            "vmovdqu %%ymm0, 0x00(%[dst])\n"            \
+            "vmovdqu %%ymm1, 0x20(%[dst])\n"            \
+            : : [dst]"r"(dst+2*x),                      \
+                [src1]"r"(srcu+x), [src2]"r"(srcv+x)    \
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3"  \
+        )
+
+        if (vlc_CPU_AVX2())
+        {
+            if (pixel_size == 1)
+                for (x = 0; x < (width & ~31); x += 32)
+                    INTERLEAVE64("vpunpcklbw", "vpunpckhbw");
+            else
+                for (x = 0; x < (width & ~31); x += 32)
+                    INTERLEAVE64("vpunpcklwd", "vpunpckhwd");
+        }
+        else
+#undef INTERLEAVE64
+#endif
 #ifdef CAN_COMPILE_SSSE3
         if (vlc_CPU_SSSE3())
             for (x = 0; x < (width & ~31); x += 32)
@@ -347,6 +538,11 @@ SSE_InterleaveUV(uint8_t *dst, size_t dst_pitch,
         srcv += srcv_pitch;
         dst += dst_pitch;
     }
+
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        AVX2_ZEROUPPER();
+#endif
 }
 
 VLC_SSE
@@ -384,6 +580,26 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
         const uint8_t *shuffle = pixel_size == 1 ? shuffle_8 : shuffle_16;
         for (unsigned y = 0; y < height; y++) {
             unsigned x = 0;
+#ifdef CAN_COMPILE_AVX2
+            /* vpshufb splits each lane into U and V halves, vpermq groups
+             * the U and V halves of both lanes, and the 2 vectors are then
+             * recombined. */
+            if (vlc_CPU_AVX2())
+                for (; x < (width & ~31); x += 32)
+                    asm volatile (
+                        "vbroadcasti128 (%[shuffle]), %%ymm7\n"
+                        "vmovdqu  0(%[src]), %%ymm0\n"
+                        "vmovdqu 32(%[src]), %%ymm1\n"
+                        "vpshufb %%ymm7, %%ymm0, %%ymm0\n"
+                        "vpshufb %%ymm7, %%ymm1, %%ymm1\n"
+                        "vpermq $0xd8, %%ymm0, %%ymm0\n"
+                        "vpermq $0xd8, %%ymm1, %%ymm1\n"
+                        "vperm2i128 $0x20, %%ymm1, %%ymm0, %%ymm2\n"
+                        "vperm2i128 $0x31, %%ymm1, %%ymm0, %%ymm3\n"
+                        "vmovdqu %%ymm2, (%[dst1])\n"
+                        "vmovdqu %%ymm3, (%[dst2])\n"
+                        : : [dst1]"r"(&dstu[x]), [dst2]"r"(&dstv[x]), [src]"r"(&src[2*x]), [shuffle]"r"(shuffle) : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+#endif
             for (; x < (width & ~31); x += 32) {
                 asm volatile (
                     "movdqu (%[shuffle]), %%xmm7\n"
@@ -415,6 +631,10 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
             dstu += dstu_pitch;
             dstv += dstv_pitch;
         }
+#ifdef CAN_COMPILE_AVX2
+        if (vlc_CPU_AVX2())
+            AVX2_ZEROUPPER();
+#endif
     } else
 #endif
     {
@@ -980,6 +1200,12 @@ static const struct test_conv convs[] = {
     { .src_chroma = VLC_CODEC_I420_10L,
       .dsts = { { VLC_CODEC_P010, -6, .conv16 = Copy420_16_P_to_SP } },
     },
+    { .src_chroma = VLC_CODEC_P016,
+      .dsts = { { VLC_CODEC_I420_16L, 0, .conv16 = Copy420_16_SP_to_P } },
+    },
+    { .src_chroma = VLC_CODEC_I420_16L,
+      .dsts = { { VLC_CODEC_P016, 0, .conv16 = Copy420_16_P_to_SP } },
+    },
 };
 #define NB_CONVS ARRAY_SIZE(convs)
 
@@ -1061,6 +1287,8 @@ static void piccheck(picture_t *pic, const vlc_chroma_description_t *dsc,
                     colors_16_P[i] <<= 6;
                 break;
             case VLC_CODEC_I420_10L:
+            case VLC_CODEC_P016:
+            case VLC_CODEC_I420_16L:
                 break;
             default:
                 vlc_assert_unreachable();
@@ -1105,20 +1333,27 @@ cleanup:
     return NULL;
 }
 
-int main(void)
+static void run_conv(const struct test_dst *test_dst, picture_t *dst,
+                     const picture_t *src, const copy_cache_t *cache)
 {
-    alarm(10);
-
-#ifndef COPY_TEST_NOOPTIM
-#ifdef CAN_COMPILE_SSE2
-    if (!vlc_CPU_SSE2())
-#endif
-    {
-        fprintf(stderr, "WARNING: could not test SSE\n");
-        return 77;
-    }
-#endif
+    const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
+                                      src->p[U_PLANE].p_pixels,
+                                      src->p[V_PLANE].p_pixels };
+    const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
+                                       src->p[U_PLANE].i_pitch,
+                                       src->p[V_PLANE].i_pitch };
+
+    if (dst->p[0].i_pixel_pitch == 1)
+        test_dst->conv(dst, src_planes, src_pitches,
+                       src->format.i_visible_height, cache);
+    else
+        test_dst->conv16(dst, src_planes, src_pitches,
+                         src->format.i_visible_height, test_dst->bitshift,
+                         cache);
+}
 
+static void test_convs(void)
+{
     for (size_t i = 0; i < NB_CONVS; ++i)
     {
         const struct test_conv *conv = &convs[i];
@@ -1157,25 +1392,12 @@ int main(void)
                 picture_t *dst = picture_NewFromFormat(&fmt);
                 assert(dst);
 
-                const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
-                                                  src->p[U_PLANE].p_pixels,
-                                                  src->p[V_PLANE].p_pixels };
-                const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
-                                                   src->p[U_PLANE].i_pitch,
-                                                   src->p[V_PLANE].i_pitch };
-
                 fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s\n",
                         size->i_width, size->i_height,
                         size->i_visible_width, size->i_visible_height,
                         (const char *) &src->format.i_chroma,
                         (const char *) &dst->format.i_chroma);
-                if (test_dst->bitshift == 0)
-                    test_dst->conv(dst, src_planes, src_pitches,
-                                   src->format.i_visible_height, &cache);
-                else
-                    test_dst->conv16(dst, src_planes, src_pitches,
-                                   src->format.i_visible_height, test_dst->bitshift,
-                                   &cache);
+                run_conv(test_dst, dst, src, &cache);
                 piccheck(dst, dst_dsc, false);
                 picture_Release(dst);
             }
@@ -1183,6 +1405,94 @@ int main(void)
             CopyCleanCache(&cache);
         }
     }
+}
+
+/* Set VLC_COPY_BENCH_ITERATIONS to run a longer benchmark. */
+#define BENCH_ITERATIONS 4
+
+static void bench_convs(const char *name, unsigned iterations)
+{
+    for (size_t i = 0; i < NB_CONVS; ++i)
+    {
+        const struct test_conv *conv = &convs[i];
+        const vlc_chroma_description_t *src_dsc =
+            vlc_fourcc_GetChromaDescription(conv->src_chroma);
+        assert(src_dsc);
+
+        video_format_t fmt;
+        video_format_Init(&fmt, 0);
+        video_format_Setup(&fmt, conv->src_chroma, 1920, 1088, 1920, 1080,
+                           1, 1);
+        picture_t *src = picture_NewFromFormat(&fmt);
+        assert(src);
+        piccheck(src, src_dsc, true);
+
+        copy_cache_t cache;
+        int ret = CopyInitCache(&cache, src->format.i_width
+                                * src_dsc->pixel_size);
+        assert(ret == VLC_SUCCESS);
+
+        for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
+        {
+            const struct test_dst *test_dst = &conv->dsts[f];
+
+            fmt.i_chroma = test_dst->chroma;
+            picture_t *dst = picture_NewFromFormat(&fmt);
+            assert(dst);
+
+            vlc_tick_t start = vlc_tick_now();
+            for (unsigned n = 0; n < iterations; n++)
+                run_conv(test_dst, dst, src, &cache);
+            vlc_tick_t duration = vlc_tick_now() - start;
+
+            printf("bench %-4s: 1920 x 1080 %4.4s -> %4.4s: %"PRId64" us/frame\n",
+                   name, (const char *) &src->format.i_chroma,
+                   (const char *) &dst->format.i_chroma,
+                   US_FROM_VLC_TICK(duration) / iterations);
+            picture_Release(dst);
+        }
+        picture_Release(src);
+        CopyCleanCache(&cache);
+    }
+}
+
+int main(void)
+{
+    alarm(10);
+
+#ifndef COPY_TEST_NOOPTIM
+#ifdef CAN_COMPILE_SSE2
+    if (!vlc_CPU_SSE2())
+#endif
+    {
+        fprintf(stderr, "WARNING: could not test SSE\n");
+        return 77;
+    }
+#endif
+
+    const char *env = getenv("VLC_COPY_BENCH_ITERATIONS");
+    unsigned iterations = env != NULL ? strtoul(env, NULL, 10) : 0;
+    if (iterations == 0)
+        iterations = BENCH_ITERATIONS;
+
+#ifdef COPY_TEST_NOOPTIM
+    test_convs();
+    bench_convs("C", iterations);
+#else
+# ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+    {
+        test_convs();
+        bench_convs("AVX2", iterations);
+        alarm(10);
+    }
+    else
+        fprintf(stderr, "WARNING: could not test AVX2\n");
+    copy_test_avx2 = false;
+# endif
+    test_convs();
+    bench_convs("SSE", iterations);
+#endif
     return 0;
 }
 
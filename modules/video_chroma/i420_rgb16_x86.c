@@ -25,6 +25,10 @@
 # include "config.h"
 #endif
 
+#ifdef I420_RGB_TEST
+# undef NDEBUG
+#endif
+
 #include <vlc_common.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
@@ -33,9 +37,17 @@
 #include "i420_rgb.h"
 #ifdef PLUGIN_SSE2
 # include "i420_rgb_sse2.h"
+# include "i420_rgb_avx2.h"
 # define VLC_TARGET VLC_SSE
 #endif
 
+#if defined(I420_RGB_TEST) && defined(CAN_COMPILE_AVX2)
+/* Allows comparing the SSE2 and AVX2 versions */
+static bool i420_rgb_test_avx2 = true;
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() (i420_rgb_test_avx2 && (vlc_CPU() & VLC_CPU_AVX2) != 0)
+#endif
+
 /*****************************************************************************
  * SetOffset: build offset array for conversion functions
  *****************************************************************************
@@ -160,6 +172,16 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
 #ifdef PLUGIN_SSE2
 
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() &&
+        (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+    {
+        AVX2_CONVERT( AVX2_UNPACK_15, SSE2_INIT_16_UNALIGNED,
+                      SSE2_UNPACK_15_UNALIGNED, 2 );
+        return;
+    }
+#endif
+
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
     /*
@@ -344,6 +366,16 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
 #ifdef PLUGIN_SSE2
 
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() &&
+        (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+    {
+        AVX2_CONVERT( AVX2_UNPACK_16, SSE2_INIT_16_UNALIGNED,
+                      SSE2_UNPACK_16_UNALIGNED, 2 );
+        return;
+    }
+#endif
+
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
     /*
@@ -528,6 +560,16 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
 
 #ifdef PLUGIN_SSE2
 
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() &&
+        (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+    {
+        AVX2_CONVERT( AVX2_UNPACK_32_ARGB, SSE2_INIT_32_UNALIGNED,
+                      SSE2_UNPACK_32_ARGB_UNALIGNED, 4 );
+        return;
+    }
+#endif
+
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
     /*
@@ -711,6 +753,16 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
 #ifdef PLUGIN_SSE2
 
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() &&
+        (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+    {
+        AVX2_CONVERT( AVX2_UNPACK_32_RGBA, SSE2_INIT_32_UNALIGNED,
+                      SSE2_UNPACK_32_RGBA_UNALIGNED, 4 );
+        return;
+    }
+#endif
+
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
     /*
@@ -894,6 +946,16 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
 #ifdef PLUGIN_SSE2
 
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() &&
+        (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+    {
+        AVX2_CONVERT( AVX2_UNPACK_32_BGRA, SSE2_INIT_32_UNALIGNED,
+                      SSE2_UNPACK_32_BGRA_UNALIGNED, 4 );
+        return;
+    }
+#endif
+
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
     /*
@@ -1077,6 +1139,16 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
 #ifdef PLUGIN_SSE2
 
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() &&
+        (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) >= 32 )
+    {
+        AVX2_CONVERT( AVX2_UNPACK_32_ABGR, SSE2_INIT_32_UNALIGNED,
+                      SSE2_UNPACK_32_ABGR_UNALIGNED, 4 );
+        return;
+    }
+#endif
+
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
     /*
@@ -1196,3 +1268,244 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     SSE2_END;
 #endif
 }
+
+#ifdef I420_RGB_TEST
+
+#include <stdio.h>
+#include <unistd.h>
+
+struct test_conv
+{
+    vlc_fourcc_t chroma;
+    uint8_t i_bytespp;
+    void (*conv)(filter_t *, picture_t *, picture_t *);
+};
+
+static const struct test_conv convs[] = {
+    { VLC_CODEC_RGB555, 2, I420_R5G5B5 },
+    { VLC_CODEC_RGB565, 2, I420_R5G6B5 },
+    { VLC_CODEC_XRGB,   4, I420_A8R8G8B8 },
+    { VLC_CODEC_RGBX,   4, I420_R8G8B8A8 },
+    { VLC_CODEC_BGRX,   4, I420_B8G8R8A8 },
+    { VLC_CODEC_XBGR,   4, I420_A8B8G8R8 },
+};
+#define NB_CONVS ARRAY_SIZE(convs)
+
+struct test_size
+{
+    unsigned i_width;
+    unsigned i_height;
+    unsigned i_out_width;
+    unsigned i_out_height;
+};
+
+/* Visible sizes. Lines narrower than 32 pixels always use SSE2, the others
+ * cover the AVX2 main loop, the tails and the horizontal and vertical
+ * scaling. The output size must be even, as checked by Activate(). */
+static const struct test_size sizes[] = {
+    { 16, 4, 16, 4 },
+    { 31, 3, 31, 3 },
+    { 32, 2, 32, 2 },
+    { 33, 5, 33, 5 },
+    { 47, 7, 47, 7 },
+    { 63, 4, 63, 4 },
+    { 64, 6, 64, 6 },
+    { 65, 9, 65, 9 },
+    { 129, 11, 129, 11 },
+    { 1921, 17, 1921, 17 },
+    { 65, 9, 100, 14 },
+    { 130, 10, 96, 12 },
+};
+#define NB_SIZES ARRAY_SIZE(sizes)
+
+static void pic_rsc_destroy(picture_t *pic)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+        free(pic->p[i].p_pixels);
+}
+
+static picture_t *pic_new_unaligned(const video_format_t *fmt)
+{
+    /* Allocate a picture with tight pitches in order to run the unaligned
+     * stores and to ease buffer overflow detection */
+    unsigned i = 0;
+    const vlc_chroma_description_t *dsc = vlc_fourcc_GetChromaDescription(fmt->i_chroma);
+    assert(dsc);
+    picture_resource_t rsc = { .pf_destroy = pic_rsc_destroy };
+    for (; i < dsc->plane_count; i++)
+    {
+        rsc.p[i].i_lines = ((fmt->i_visible_height + (dsc->p[i].h.den - 1)) / dsc->p[i].h.den) * dsc->p[i].h.num;
+        rsc.p[i].i_pitch = ((fmt->i_visible_width + (dsc->p[i].w.den - 1)) / dsc->p[i].w.den) * dsc->p[i].w.num * dsc->pixel_size;
+        rsc.p[i].p_pixels = malloc(rsc.p[i].i_lines * rsc.p[i].i_pitch);
+        if (rsc.p[i].p_pixels == NULL)
+            goto cleanup;
+    }
+    picture_t *pic = picture_NewFromResource(fmt, &rsc);
+    if (pic == NULL)
+        goto cleanup;
+    return pic;
+
+cleanup:
+    while (i != 0)
+        free(rsc.p[--i].p_pixels);
+    return NULL;
+}
+
+static picture_t *pic_new(const video_format_t *fmt, bool aligned)
+{
+    picture_t *pic = aligned ? picture_NewFromFormat(fmt)
+                             : pic_new_unaligned(fmt);
+    assert(pic);
+    /* Also compare whatever is written outside of the visible area */
+    for (int i = 0; i < pic->i_planes; i++)
+        memset(pic->p[i].p_pixels, 0x5a, pic->p[i].i_lines * pic->p[i].i_pitch);
+    return pic;
+}
+
+static picture_t *src_new(unsigned width, unsigned height, bool aligned)
+{
+    video_format_t fmt;
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, (width + 1) & ~1,
+                       (height + 1) & ~1, width, height, 1, 1);
+    picture_t *pic = pic_new(&fmt, aligned);
+    for (int i = 0; i < pic->i_planes; i++)
+        for (int j = 0; j < pic->p[i].i_lines * pic->p[i].i_pitch; j++)
+            pic->p[i].p_pixels[j] = rand();
+    return pic;
+}
+
+static void run_conv(const struct test_conv *conv, picture_t *dst,
+                     picture_t *src)
+{
+    filter_sys_t sys = { .i_bytespp = conv->i_bytespp };
+    filter_t filter = { .p_sys = &sys };
+
+    filter.fmt_in.video = src->format;
+    filter.fmt_out.video = dst->format;
+    sys.p_offset = malloc(dst->format.i_width * sizeof (*sys.p_offset));
+    assert(sys.p_offset);
+
+    conv->conv(&filter, src, dst);
+
+    free(sys.p_offset);
+    free(sys.p_buffer);
+}
+
+#ifdef CAN_COMPILE_AVX2
+static void test_convs(void)
+{
+    for (size_t i = 0; i < NB_CONVS; ++i)
+    {
+        const struct test_conv *conv = &convs[i];
+
+        for (size_t j = 0; j < NB_SIZES; ++j)
+        {
+            const struct test_size *size = &sizes[j];
+
+            for (int aligned = 0; aligned < 2; aligned++)
+            {
+                picture_t *src = src_new(size->i_width, size->i_height,
+                                         aligned);
+
+                video_format_t fmt;
+                video_format_Init(&fmt, conv->chroma);
+                video_format_Setup(&fmt, conv->chroma,
+                                   (size->i_out_width + 1) & ~1,
+                                   (size->i_out_height + 1) & ~1,
+                                   size->i_out_width, size->i_out_height,
+                                   1, 1);
+                picture_t *dst_avx2 = pic_new(&fmt, aligned);
+                picture_t *dst_sse2 = pic_new(&fmt, aligned);
+
+                fprintf(stderr, "testing: %u x %u -> %u x %u %4.4s%s\n",
+                        size->i_width, size->i_height,
+                        size->i_out_width, size->i_out_height,
+                        (const char *) &conv->chroma,
+                        aligned ? "" : " (unaligned)");
+
+                i420_rgb_test_avx2 = true;
+                run_conv(conv, dst_avx2, src);
+                i420_rgb_test_avx2 = false;
+                run_conv(conv, dst_sse2, src);
+
+                const plane_t *a = &dst_avx2->p[0], *b = &dst_sse2->p[0];
+                assert(a->i_pitch == b->i_pitch && a->i_lines == b->i_lines);
+                for (int y = 0; y < a->i_lines; y++)
+                    if (memcmp(&a->p_pixels[y * a->i_pitch],
+                               &b->p_pixels[y * b->i_pitch], a->i_pitch))
+                    {
+                        fprintf(stderr, "error: line %d doesn't match\n", y);
+                        assert(!"error: AVX2 and SSE2 outputs differ");
+                    }
+
+                picture_Release(dst_sse2);
+                picture_Release(dst_avx2);
+                picture_Release(src);
+            }
+        }
+    }
+}
+#endif
+
+/* Set VLC_I420_RGB_BENCH_ITERATIONS to run a longer benchmark. */
+#define BENCH_ITERATIONS 4
+
+static void bench_convs(const char *name, unsigned iterations)
+{
+    picture_t *src = src_new(1920, 1080, true);
+
+    for (size_t i = 0; i < NB_CONVS; ++i)
+    {
+        const struct test_conv *conv = &convs[i];
+
+        video_format_t fmt;
+        video_format_Init(&fmt, conv->chroma);
+        video_format_Setup(&fmt, conv->chroma, 1920, 1080, 1920, 1080, 1, 1);
+        picture_t *dst = pic_new(&fmt, true);
+
+        vlc_tick_t start = vlc_tick_now();
+        for (unsigned n = 0; n < iterations; n++)
+            run_conv(conv, dst, src);
+        vlc_tick_t duration = vlc_tick_now() - start;
+
+        printf("bench %-4s: 1920 x 1080 I420 -> %4.4s: %"PRId64" us/frame\n",
+               name, (const char *) &conv->chroma,
+               US_FROM_VLC_TICK(duration) / iterations);
+        picture_Release(dst);
+    }
+    picture_Release(src);
+}
+
+int main(void)
+{
+    alarm(10);
+
+    if (!vlc_CPU_SSE2())
+    {
+        fprintf(stderr, "WARNING: could not test SSE2\n");
+        return 77;
+    }
+
+    const char *env = getenv("VLC_I420_RGB_BENCH_ITERATIONS");
+    unsigned iterations = env != NULL ? strtoul(env, NULL, 10) : 0;
+    if (iterations == 0)
+        iterations = BENCH_ITERATIONS;
+
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+    {
+        test_convs();
+        i420_rgb_test_avx2 = true;
+        bench_convs("AVX2", iterations);
+        i420_rgb_test_avx2 = false;
+        bench_convs("SSE2", iterations);
+        return 0;
+    }
+#endif
+    bench_convs("SSE2", iterations);
+    fprintf(stderr, "WARNING: could not test AVX2\n");
+    return 77;
+}
+
+#endif
@@ -0,0 +1,298 @@
+/*****************************************************************************
+ * i420_rgb_avx2.h: AVX2 YUV transformation assembly
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#if defined(CAN_COMPILE_AVX2)
+
+/* AVX2 assembly
+ *
+ * This is the SSE2 conversion widened to 32 pixels per call. The arithmetic
+ * is the same, so that both paths give the same output. 256-bit unpack and
+ * pack instructions work within each 128-bit lane: the chroma samples are
+ * zero-extended so that the lower lane holds pixels 0-15 and the upper lane
+ * pixels 16-31, and the lanes are swapped back in place before storing. */
+
+/* The compiler does not know about the upper halves of the registers unless
+ * it generates AVX code itself, in which case it also handles the
+ * transitions. */
+#ifdef __AVX__
+# define AVX2_VZEROUPPER ""
+#else
+# define AVX2_VZEROUPPER "vzeroupper \n"
+#endif
+
+#define AVX2_CALL(AVX2_INSTRUCTIONS)    \
+    do {                                \
+    __asm__ __volatile__(               \
+        ".p2align 3 \n\t"               \
+        AVX2_INSTRUCTIONS               \
+        AVX2_VZEROUPPER                 \
+        :                               \
+        : "r" (p_y), "r" (p_u),         \
+          "r" (p_v), "r" (p_buffer)     \
+        : "eax", "xmm0", "xmm1", "xmm2", "xmm3", \
+                 "xmm4", "xmm5", "xmm6", "xmm7", "memory" ); \
+    } while(0)
+
+#define AVX2_END  __asm__ __volatile__ ( "sfence" ::: "memory" )
+
+#define AVX2_INIT_32 "                                                      \n\
+vpmovzxbw   (%1), %%ymm0    # Load 16 Cb      00 uF ... 00 u1 00 u0     \n\
+vpmovzxbw   (%2), %%ymm1    # Load 16 Cr      00 vF ... 00 v1 00 v0     \n\
+vmovdqu     (%0), %%ymm6    # Load 32 Y       Y31 ... Y2 Y1 Y0          \n\
+"
+
+#define AVX2_YUV_MUL "                                                      \n\
+# convert the chroma part                                                   \n\
+movl      $0x00800080, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5             # Set ymm5 to 00 80 ... 00 80       \n\
+vpsubsw   %%ymm5, %%ymm0, %%ymm0        # Cb -= 128                         \n\
+vpsubsw   %%ymm5, %%ymm1, %%ymm1        # Cr -= 128                         \n\
+vpsllw    $3, %%ymm0, %%ymm0            # Promote precision                 \n\
+vpsllw    $3, %%ymm1, %%ymm1            # Promote precision                 \n\
+movl      $0xf37df37d, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5                                                 \n\
+vpmulhw   %%ymm5, %%ymm0, %%ymm2        # Mul Cb with green coeff -> Cb green \n\
+movl      $0xe5fce5fc, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5                                                 \n\
+vpmulhw   %%ymm5, %%ymm1, %%ymm3        # Mul Cr with green coeff -> Cr green \n\
+movl      $0x40934093, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5                                                 \n\
+vpmulhw   %%ymm5, %%ymm0, %%ymm0        # Mul Cb -> Cblue                   \n\
+movl      $0x33123312, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5                                                 \n\
+vpmulhw   %%ymm5, %%ymm1, %%ymm1        # Mul Cr -> Cred                    \n\
+vpaddsw   %%ymm3, %%ymm2, %%ymm2        # Cb green + Cr green -> Cgreen     \n\
+                                                                            \n\
+# convert the luma part                                                     \n\
+movl      $0x10101010, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5                                                 \n\
+vpsubusb  %%ymm5, %%ymm6, %%ymm6        # Y -= 16                           \n\
+movl      $0x00ff00ff, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5                                                 \n\
+vpsrlw    $8, %%ymm6, %%ymm7            # get Y odd                         \n\
+vpand     %%ymm5, %%ymm6, %%ymm6        # get Y even                        \n\
+vpsllw    $3, %%ymm6, %%ymm6            # Promote precision                 \n\
+vpsllw    $3, %%ymm7, %%ymm7            # Promote precision                 \n\
+movl      $0x253f253f, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5                                                 \n\
+vpmulhw   %%ymm5, %%ymm6, %%ymm6        # Mul 16 Y even                     \n\
+vpmulhw   %%ymm5, %%ymm7, %%ymm7        # Mul 16 Y odd                      \n\
+"
+
+#define AVX2_YUV_ADD "                                                      \n\
+# Do horizontal and vertical scaling                                        \n\
+vpaddsw   %%ymm7, %%ymm0, %%ymm3        # Y odd  + Cblue                    \n\
+vpaddsw   %%ymm7, %%ymm1, %%ymm4        # Y odd  + Cred                     \n\
+vpaddsw   %%ymm7, %%ymm2, %%ymm5        # Y odd  + Cgreen                   \n\
+vpaddsw   %%ymm6, %%ymm0, %%ymm0        # Y even + Cblue                    \n\
+vpaddsw   %%ymm6, %%ymm1, %%ymm1        # Y even + Cred                     \n\
+vpaddsw   %%ymm6, %%ymm2, %%ymm2        # Y even + Cgreen                   \n\
+                                                                            \n\
+# Limit RGB even and odd to 0..255                                          \n\
+vpackuswb %%ymm0, %%ymm0, %%ymm0                                            \n\
+vpackuswb %%ymm1, %%ymm1, %%ymm1                                            \n\
+vpackuswb %%ymm2, %%ymm2, %%ymm2                                            \n\
+vpackuswb %%ymm3, %%ymm3, %%ymm3                                            \n\
+vpackuswb %%ymm4, %%ymm4, %%ymm4                                            \n\
+vpackuswb %%ymm5, %%ymm5, %%ymm5                                            \n\
+                                                                            \n\
+# Interleave RGB even and odd                                               \n\
+vpunpcklbw %%ymm3, %%ymm0, %%ymm0       # B31 ... B2 B1 B0                  \n\
+vpunpcklbw %%ymm4, %%ymm1, %%ymm1       # R31 ... R2 R1 R0                  \n\
+vpunpcklbw %%ymm5, %%ymm2, %%ymm2       # G31 ... G2 G1 G0                  \n\
+"
+
+/* Stores the 15/16 bits pixels of ymm0 (pixels 0-7 | 16-23) and
+ * ymm5 (pixels 8-15 | 24-31) */
+#define AVX2_STORE_16(STORE) "                                              \n\
+vperm2i128 $0x20, %%ymm5, %%ymm0, %%ymm6 # pixels 0-15                      \n\
+vperm2i128 $0x31, %%ymm5, %%ymm0, %%ymm7 # pixels 16-31                     \n\
+" STORE "   %%ymm6, (%3)                                                    \n\
+" STORE "   %%ymm7, 32(%3)                                                  \n\
+"
+
+#define AVX2_UNPACK_15(STORE) "                                             \n\
+movl      $0xf8f8f8f8, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5             # set ymm5 to f8 f8 ... f8 f8       \n\
+vpand     %%ymm5, %%ymm0, %%ymm0        # b7b6b5b4 b3______                 \n\
+vpsrlw    $3, %%ymm0, %%ymm0            # ______b7 b6b5b4b3                 \n\
+vpand     %%ymm5, %%ymm2, %%ymm2        # g7g6g5g4 g3______                 \n\
+vpand     %%ymm5, %%ymm1, %%ymm1        # r7r6r5r4 r3______                 \n\
+vpsrlw    $1, %%ymm1, %%ymm1            # __r7r6r5 r4r3____                 \n\
+vpxor     %%ymm4, %%ymm4, %%ymm4        # zero ymm4                         \n\
+                                                                            \n\
+vpunpckhbw %%ymm4, %%ymm2, %%ymm7       # ________ ________ g7g6g5g4 g3______ \n\
+vpunpckhbw %%ymm1, %%ymm0, %%ymm5       # __r7r6r5 r4r3____ ______b7 b6b5b4b3 \n\
+vpsllw    $2, %%ymm7, %%ymm7            # ________ ____g7g6 g5g4g3__ ________ \n\
+vpor      %%ymm7, %%ymm5, %%ymm5        # __r7r6r5 r4r3g7g6 g5g4g3b7 b6b5b4b3 \n\
+vpunpcklbw %%ymm4, %%ymm2, %%ymm2                                           \n\
+vpunpcklbw %%ymm1, %%ymm0, %%ymm0                                           \n\
+vpsllw    $2, %%ymm2, %%ymm2                                                \n\
+vpor      %%ymm2, %%ymm0, %%ymm0                                            \n\
+" AVX2_STORE_16(STORE)
+
+#define AVX2_UNPACK_16(STORE) "                                             \n\
+movl      $0xf8f8f8f8, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5             # set ymm5 to f8 f8 ... f8 f8       \n\
+vpand     %%ymm5, %%ymm0, %%ymm0        # b7b6b5b4 b3______                 \n\
+vpand     %%ymm5, %%ymm1, %%ymm1        # r7r6r5r4 r3______                 \n\
+movl      $0xfcfcfcfc, %%eax                                                \n\
+vmovd     %%eax, %%xmm5                                                     \n\
+vpbroadcastd %%xmm5, %%ymm5             # set ymm5 to fc fc ... fc fc       \n\
+vpand     %%ymm5, %%ymm2, %%ymm2        # g7g6g5g4 g3g2____                 \n\
+vpsrlw    $3, %%ymm0, %%ymm0            # ______b7 b6b5b4b3                 \n\
+vpxor     %%ymm4, %%ymm4, %%ymm4        # zero ymm4                         \n\
+                                                                            \n\
+vpunpckhbw %%ymm4, %%ymm2, %%ymm7       # ________ ________ g7g6g5g4 g3g2____ \n\
+vpunpckhbw %%ymm1, %%ymm0, %%ymm5       # r7r6r5r4 r3______ ______b7 b6b5b4b3 \n\
+vpsllw    $3, %%ymm7, %%ymm7            # ________ __g7g6g5 g4g3g2__ ________ \n\
+vpor      %%ymm7, %%ymm5, %%ymm5        # r7r6r5r4 r3g7g6g5 g4g3g2b7 b6b5b4b3 \n\
+vpunpcklbw %%ymm4, %%ymm2, %%ymm2                                           \n\
+vpunpcklbw %%ymm1, %%ymm0, %%ymm0                                           \n\
+vpsllw    $3, %%ymm2, %%ymm2                                                \n\
+vpor      %%ymm2, %%ymm0, %%ymm0                                            \n\
+" AVX2_STORE_16(STORE)
+
+/* Interleaves 4 registers (given by number, ymm3 is zero) into 32 bits
+ * pixels, A being the lowest byte in memory. */
+#define AVX2_UNPACK_32(A, B, C, D, STORE) "                                 \n\
+vpxor     %%ymm3, %%ymm3, %%ymm3        # zero ymm3                         \n\
+vpunpcklbw %%ymm" B ", %%ymm" A ", %%ymm4 # AB pairs, pixels 0-7 | 16-23    \n\
+vpunpcklbw %%ymm" D ", %%ymm" C ", %%ymm5 # CD pairs, pixels 0-7 | 16-23    \n\
+vpunpckhbw %%ymm" B ", %%ymm" A ", %%ymm6 # AB pairs, pixels 8-15 | 24-31   \n\
+vpunpckhbw %%ymm" D ", %%ymm" C ", %%ymm7 # CD pairs, pixels 8-15 | 24-31   \n\
+vpunpcklwd %%ymm5, %%ymm4, %%ymm0       # pixels 0-3 | 16-19                \n\
+vpunpckhwd %%ymm5, %%ymm4, %%ymm1       # pixels 4-7 | 20-23                \n\
+vpunpcklwd %%ymm7, %%ymm6, %%ymm2       # pixels 8-11 | 24-27               \n\
+vpunpckhwd %%ymm7, %%ymm6, %%ymm3       # pixels 12-15 | 28-31              \n\
+vperm2i128 $0x20, %%ymm1, %%ymm0, %%ymm4 # pixels 0-7                       \n\
+vperm2i128 $0x20, %%ymm3, %%ymm2, %%ymm5 # pixels 8-15                      \n\
+vperm2i128 $0x31, %%ymm1, %%ymm0, %%ymm6 # pixels 16-23                     \n\
+vperm2i128 $0x31, %%ymm3, %%ymm2, %%ymm7 # pixels 24-31                     \n\
+" STORE "   %%ymm4, (%3)                                                    \n\
+" STORE "   %%ymm5, 32(%3)                                                  \n\
+" STORE "   %%ymm6, 64(%3)                                                  \n\
+" STORE "   %%ymm7, 96(%3)                                                  \n\
+"
+
+/* ymm0 = B, ymm1 = R, ymm2 = G, ymm3 = 0 */
+#define AVX2_UNPACK_32_ARGB(STORE) AVX2_UNPACK_32("0", "2", "1", "3", STORE)
+#define AVX2_UNPACK_32_RGBA(STORE) AVX2_UNPACK_32("3", "0", "2", "1", STORE)
+#define AVX2_UNPACK_32_BGRA(STORE) AVX2_UNPACK_32("3", "1", "2", "0", STORE)
+#define AVX2_UNPACK_32_ABGR(STORE) AVX2_UNPACK_32("1", "2", "0", "3", STORE)
+
+#define AVX2_ALIGNED   "vmovntdq"
+#define AVX2_UNALIGNED "vmovdqu "
+
+/*
+ * Converts and scales the whole picture, 32 pixels at a time. This is used
+ * by the conversion functions in place of the SSE2 loops, as long as the
+ * lines are at least 32 pixels wide. The first vector of each line is always
+ * loaded unaligned, only the stores need to be aligned. The last pixels of
+ * each line are converted with the SSE2 instructions, including the rewind
+ * which shifts the chroma for odd widths, so that the output is the same.
+ */
+#define AVX2_CONVERT( UNPACK, SSE2_INIT, SSE2_UNPACK, BPP )                   \
+    i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15; \
+    p_buffer = b_hscale ? p_buffer_start : p_pic;                             \
+    const bool b_avx2_aligned = 0 == (31 & (p_dest->p->i_pitch|               \
+                                            ((intptr_t)p_buffer)));          \
+    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ ) \
+    {                                                                         \
+        p_pic_start = p_pic;                                                  \
+                                                                              \
+        for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32; i_x--; ) \
+        {                                                                     \
+            if( b_avx2_aligned )                                              \
+                AVX2_CALL (                                                   \
+                    AVX2_INIT_32                                              \
+                    AVX2_YUV_MUL                                              \
+                    AVX2_YUV_ADD                                              \
+                    UNPACK( AVX2_ALIGNED )                                    \
+                );                                                            \
+            else                                                              \
+                AVX2_CALL (                                                   \
+                    AVX2_INIT_32                                              \
+                    AVX2_YUV_MUL                                              \
+                    AVX2_YUV_ADD                                              \
+                    UNPACK( AVX2_UNALIGNED )                                  \
+                );                                                            \
+            p_y += 32;                                                        \
+            p_u += 16;                                                        \
+            p_v += 16;                                                        \
+            p_buffer += 32;                                                   \
+        }                                                                     \
+                                                                              \
+        if( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) & 16 ) \
+        {                                                                     \
+            SSE2_CALL (                                                       \
+                SSE2_INIT                                                     \
+                SSE2_YUV_MUL                                                  \
+                SSE2_YUV_ADD                                                  \
+                SSE2_UNPACK                                                   \
+            );                                                                \
+            p_y += 16;                                                        \
+            p_u += 8;                                                         \
+            p_v += 8;                                                         \
+            p_buffer += 16;                                                   \
+        }                                                                     \
+                                                                              \
+        /* Here we do some unaligned reads and duplicate conversions, but     \
+         * at least we have all the pixels */                                 \
+        if( i_rewind )                                                        \
+        {                                                                     \
+            p_y -= i_rewind;                                                  \
+            p_u -= i_rewind >> 1;                                             \
+            p_v -= i_rewind >> 1;                                             \
+            p_buffer -= i_rewind;                                             \
+            SSE2_CALL (                                                       \
+                SSE2_INIT                                                     \
+                SSE2_YUV_MUL                                                  \
+                SSE2_YUV_ADD                                                  \
+                SSE2_UNPACK                                                   \
+            );                                                                \
+            p_y += 16;                                                        \
+            p_u += 8;                                                         \
+            p_v += 8;                                                         \
+        }                                                                     \
+        SCALE_WIDTH;                                                          \
+        SCALE_HEIGHT( 420, BPP );                                             \
+                                                                              \
+        p_y += i_source_margin;                                               \
+        if( i_y % 2 )                                                         \
+        {                                                                     \
+            p_u += i_source_margin_c;                                         \
+            p_v += i_source_margin_c;                                         \
+        }                                                                     \
+        p_buffer = b_hscale ? p_buffer_start : p_pic;                         \
+    }                                                                         \
+    /* make sure all non-temporal stores are visible thereafter */            \
+    AVX2_END;
+
+#endif
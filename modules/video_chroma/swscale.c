@@ -37,6 +37,8 @@
 
 #include <libswscale/swscale.h>
 #include <libswscale/version.h>
+#include <libavutil/frame.h>
+#include <libavutil/opt.h>
 
 #ifdef __APPLE__
 # include <TargetConditionals.h>
@@ -53,6 +55,10 @@ static void CloseScaler( filter_t * );
 #define SCALEMODE_TEXT N_("Scaling mode")
 #define SCALEMODE_LONGTEXT NULL
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads used to scale each picture " \
+    "by horizontal slices, 0 meaning auto")
+
 static const int pi_mode_values[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
 static const char *const ppsz_mode_descriptions[] =
 { N_("Fast bilinear"), N_("Bilinear"), N_("Bicubic (good quality)"),
@@ -67,13 +73,37 @@ vlc_module_begin ()
     set_callback_video_converter( OpenScaler, 150 )
     add_integer( "swscale-mode", 2, SCALEMODE_TEXT, SCALEMODE_LONGTEXT )
         change_integer_list( pi_mode_values, ppsz_mode_descriptions )
+    add_integer_with_range( "swscale-threads", 1, 0, 64,
+                            THREADS_TEXT, THREADS_LONGTEXT )
 vlc_module_end ()
 
+/* Slice threading within libswscale requires the AVFrame based API */
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT( 6, 1, 100 )
+# define SWSCALE_SLICE_THREADS 1
+#endif
+
 /* Version checking */
 /****************************************************************************
  * Local prototypes
  ****************************************************************************/
 
+/**
+ * Parameters of the scaling contexts.
+ *
+ * The contexts are kept when the video format changes in a way that does not
+ * affect them (cropping offsets, colorimetry, UV order, ...), as creating
+ * them, and their threads, is expensive.
+ */
+typedef struct
+{
+    enum AVPixelFormat i_fmti;
+    enum AVPixelFormat i_fmto;
+    unsigned i_widthi, i_heighti;
+    unsigned i_widtho, i_heighto;
+    int i_sws_flags;
+    bool b_has_a;
+} ContextParameters;
+
 /**
  * Internal swscale filter structure.
  */
@@ -81,6 +111,7 @@ typedef struct
 {
     SwsFilter *p_filter;
     int i_sws_flags;
+    unsigned i_threads;
 
     video_format_t fmt_in;
     video_format_t fmt_out;
@@ -89,6 +120,7 @@ typedef struct
 
     struct SwsContext *ctx;
     struct SwsContext *ctxA;
+    ContextParameters ctx_params;
     picture_t *p_src_a;
     picture_t *p_dst_a;
     int i_extend_factor;
@@ -103,6 +135,7 @@ typedef struct
 static picture_t *Filter( filter_t *, picture_t * );
 static int  Init( filter_t * );
 static void Clean( filter_t * );
+static void CleanPictures( filter_sys_t * );
 
 typedef struct
 {
@@ -222,6 +255,15 @@ static int OpenScaler( filter_t *p_filter )
     default: p_sys->i_sws_flags = SWS_BICUBIC; i_sws_mode = 2; break;
     }
 
+    p_sys->i_threads = var_InheritInteger( p_filter, "swscale-threads" );
+#ifndef SWSCALE_SLICE_THREADS
+    if( p_sys->i_threads != 1 )
+    {
+        msg_Dbg( p_filter, "slice threading requires libswscale 6.1.100" );
+        p_sys->i_threads = 1;
+    }
+#endif
+
     /* Misc init */
     memset( &p_sys->fmt_in,  0, sizeof(p_sys->fmt_in) );
     memset( &p_sys->fmt_out, 0, sizeof(p_sys->fmt_out) );
@@ -366,6 +408,55 @@ static int GetParameters( ScalerConfiguration *p_cfg,
     return VLC_SUCCESS;
 }
 
+static struct SwsContext *GetContext( filter_sys_t *p_sys,
+                                      const ContextParameters *params,
+                                      enum AVPixelFormat i_fmti,
+                                      enum AVPixelFormat i_fmto )
+{
+#ifdef SWSCALE_SLICE_THREADS
+    if( p_sys->i_threads != 1 )
+    {
+        struct SwsContext *ctx = sws_alloc_context();
+        if( ctx == NULL )
+            return NULL;
+
+        av_opt_set_int( ctx, "srcw", params->i_widthi, 0 );
+        av_opt_set_int( ctx, "srch", params->i_heighti, 0 );
+        av_opt_set_int( ctx, "src_format", i_fmti, 0 );
+        av_opt_set_int( ctx, "dstw", params->i_widtho, 0 );
+        av_opt_set_int( ctx, "dsth", params->i_heighto, 0 );
+        av_opt_set_int( ctx, "dst_format", i_fmto, 0 );
+        av_opt_set_int( ctx, "sws_flags", params->i_sws_flags, 0 );
+        av_opt_set_int( ctx, "threads", p_sys->i_threads, 0 );
+
+        if( sws_init_context( ctx, p_sys->p_filter, NULL ) < 0 )
+        {
+            sws_freeContext( ctx );
+            return NULL;
+        }
+        return ctx;
+    }
+#endif
+    return sws_getContext( params->i_widthi, params->i_heighti, i_fmti,
+                           params->i_widtho, params->i_heighto, i_fmto,
+                           params->i_sws_flags, p_sys->p_filter, NULL, 0 );
+}
+
+static bool IsContextReusable( const filter_sys_t *p_sys,
+                               const ContextParameters *params )
+{
+    const ContextParameters *cur = &p_sys->ctx_params;
+
+    return p_sys->ctx != NULL &&
+           cur->i_fmti == params->i_fmti && cur->i_fmto == params->i_fmto &&
+           cur->i_widthi == params->i_widthi &&
+           cur->i_heighti == params->i_heighti &&
+           cur->i_widtho == params->i_widtho &&
+           cur->i_heighto == params->i_heighto &&
+           cur->i_sws_flags == params->i_sws_flags &&
+           cur->b_has_a == params->b_has_a;
+}
+
 static int Init( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -382,7 +473,8 @@ static int Init( filter_t *p_filter )
         return VLC_SUCCESS;
     }
 
-    Clean( p_filter );
+    /* The contexts are released later, only if they cannot be reused */
+    CleanPictures( p_sys );
 
     /* Init with new parameters */
     ScalerConfiguration cfg;
@@ -391,7 +483,7 @@ static int Init( filter_t *p_filter )
         msg_Err( p_filter, "format not supported '%4.4s' %ux%u -> '%4.4s' %ux%u",
                  (const char *)&p_fmti->i_chroma, p_fmti->i_visible_width, p_fmti->i_visible_height,
                  (const char *)&p_fmto->i_chroma, p_fmto->i_visible_width, p_fmto->i_visible_height );
-        return VLC_EGENERIC;
+        goto error;
     }
     if( p_fmti->i_visible_width == 0 || p_fmti->i_visible_height == 0 ||
         p_fmto->i_visible_width == 0 || p_fmto->i_visible_height == 0 )
@@ -399,16 +491,16 @@ static int Init( filter_t *p_filter )
         msg_Err( p_filter, "invalid scaling: %ix%i -> %ix%i",
                  p_fmti->i_visible_width, p_fmti->i_visible_height,
                  p_fmto->i_visible_width, p_fmto->i_visible_height);
-        return VLC_EGENERIC;
+        goto error;
     }
 
     p_sys->desc_in = vlc_fourcc_GetChromaDescription( p_fmti->i_chroma );
     p_sys->desc_out = vlc_fourcc_GetChromaDescription( p_fmto->i_chroma );
     if( p_sys->desc_in == NULL || p_sys->desc_out == NULL )
-        return VLC_EGENERIC;
+        goto error;
 
     if( p_sys->desc_in->plane_count == 0 || p_sys->desc_out->plane_count == 0 )
-        return VLC_EGENERIC;
+        goto error;
 
     /* swscale does not like too small width */
     p_sys->i_extend_factor = 1;
@@ -417,20 +509,28 @@ static int Init( filter_t *p_filter )
 
     const unsigned i_fmti_visible_width = p_fmti->i_visible_width * p_sys->i_extend_factor;
     const unsigned i_fmto_visible_width = p_fmto->i_visible_width * p_sys->i_extend_factor;
-    for( int n = 0; n < (cfg.b_has_a ? 2 : 1); n++ )
+    const ContextParameters params = {
+        .i_fmti = cfg.i_fmti,
+        .i_fmto = cfg.i_fmto,
+        .i_widthi = i_fmti_visible_width,
+        .i_heighti = p_fmti->i_visible_height,
+        .i_widtho = i_fmto_visible_width,
+        .i_heighto = p_fmto->i_visible_height,
+        .i_sws_flags = cfg.i_sws_flags,
+        .b_has_a = cfg.b_has_a,
+    };
+
+    if( IsContextReusable( p_sys, &params ) )
+        msg_Dbg( p_filter, "reusing the scaling contexts" );
+    else
     {
-        const int i_fmti = n == 0 ? cfg.i_fmti : AV_PIX_FMT_GRAY8;
-        const int i_fmto = n == 0 ? cfg.i_fmto : AV_PIX_FMT_GRAY8;
-        struct SwsContext *ctx;
-
-        ctx = sws_getContext( i_fmti_visible_width, p_fmti->i_visible_height, i_fmti,
-                              i_fmto_visible_width, p_fmto->i_visible_height, i_fmto,
-                              cfg.i_sws_flags,
-                              p_sys->p_filter, NULL, 0 );
-        if( n == 0 )
-            p_sys->ctx = ctx;
-        else
-            p_sys->ctxA = ctx;
+        Clean( p_filter );
+
+        p_sys->ctx = GetContext( p_sys, &params, cfg.i_fmti, cfg.i_fmto );
+        if( cfg.b_has_a )
+            p_sys->ctxA = GetContext( p_sys, &params,
+                                      AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY8 );
+        p_sys->ctx_params = params;
     }
     if( p_sys->ctxA )
     {
@@ -453,8 +553,7 @@ static int Init( filter_t *p_filter )
         ( p_sys->i_extend_factor != 1 && ( !p_sys->p_src_e || !p_sys->p_dst_e ) ) )
     {
         msg_Err( p_filter, "could not init SwScaler and/or allocate memory" );
-        Clean( p_filter );
-        return VLC_EGENERIC;
+        goto error;
     }
 
     if (p_filter->b_allow_fmt_out_change)
@@ -487,12 +586,14 @@ static int Init( filter_t *p_filter )
     SetColorspace( p_sys );
 
     return VLC_SUCCESS;
+
+error:
+    Clean( p_filter );
+    return VLC_EGENERIC;
 }
 
-static void Clean( filter_t *p_filter )
+static void CleanPictures( filter_sys_t *p_sys )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
-
     if( p_sys->p_src_e )
         picture_Release( p_sys->p_src_e );
     if( p_sys->p_dst_e )
@@ -503,6 +604,18 @@ static void Clean( filter_t *p_filter )
     if( p_sys->p_dst_a )
         picture_Release( p_sys->p_dst_a );
 
+    p_sys->p_src_a = NULL;
+    p_sys->p_dst_a = NULL;
+    p_sys->p_src_e = NULL;
+    p_sys->p_dst_e = NULL;
+}
+
+static void Clean( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    CleanPictures( p_sys );
+
     if( p_sys->ctxA )
         sws_freeContext( p_sys->ctxA );
 
@@ -512,10 +625,6 @@ static void Clean( filter_t *p_filter )
     /* We have to set it to null has we call be called again :( */
     p_sys->ctx = NULL;
     p_sys->ctxA = NULL;
-    p_sys->p_src_a = NULL;
-    p_sys->p_dst_a = NULL;
-    p_sys->p_src_e = NULL;
-    p_sys->p_dst_e = NULL;
 }
 
 static void GetPixels( uint8_t *pp_pixel[4], int pi_pitch[4],
@@ -605,6 +714,65 @@ static void SwapUV( picture_t *p_dst, const picture_t *p_src )
     picture_CopyPixels( p_dst, &tmp );
 }
 
+#ifdef SWSCALE_SLICE_THREADS
+static void NoRelease( void *opaque, uint8_t *data )
+{
+    VLC_UNUSED(opaque); VLC_UNUSED(data);
+}
+
+static AVFrame *WrapFrame( uint8_t *const data[4], const int linesize[4],
+                           int i_width, int i_height, enum AVPixelFormat i_fmt )
+{
+    AVFrame *frame = av_frame_alloc();
+    if( frame == NULL )
+        return NULL;
+
+    /* libswscale references the frames, which would copy the pixels of
+     * frames without buffers. The pictures outlive the frames. */
+    frame->buf[0] = av_buffer_create( NULL, 0, NoRelease, NULL, 0 );
+    if( frame->buf[0] == NULL )
+    {
+        av_frame_free( &frame );
+        return NULL;
+    }
+
+    for( int i = 0; i < 4; i++ )
+    {
+        frame->data[i] = data[i];
+        frame->linesize[i] = linesize[i];
+    }
+    frame->width = i_width;
+    frame->height = i_height;
+    frame->format = i_fmt;
+    return frame;
+}
+
+/* Scales with the frame API, which splits the picture in horizontal slices
+ * processed by the threads of the context. */
+static int ScaleSlices( filter_sys_t *p_sys, struct SwsContext *ctx,
+                        uint8_t *const src[4], const int src_stride[4],
+                        int i_height, uint8_t *const dst[4],
+                        const int dst_stride[4] )
+{
+    const ContextParameters *params = &p_sys->ctx_params;
+    const bool b_alpha = ctx == p_sys->ctxA;
+    int ret = -1;
+
+    AVFrame *src_frame = WrapFrame( src, src_stride, params->i_widthi,
+                                    i_height,
+                                    b_alpha ? AV_PIX_FMT_GRAY8 : params->i_fmti );
+    AVFrame *dst_frame = WrapFrame( dst, dst_stride, params->i_widtho,
+                                    params->i_heighto,
+                                    b_alpha ? AV_PIX_FMT_GRAY8 : params->i_fmto );
+    if( src_frame != NULL && dst_frame != NULL )
+        ret = sws_scale_frame( ctx, dst_frame, src_frame );
+
+    av_frame_free( &src_frame );
+    av_frame_free( &dst_frame );
+    return ret;
+}
+#endif
+
 static void Convert( filter_t *p_filter, struct SwsContext *ctx,
                      picture_t *p_dst, picture_t *p_src, int i_height,
                      int i_plane_count, bool b_swap_uvi, bool b_swap_uvo )
@@ -653,6 +821,13 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
     GetPixels( dst, dst_stride, p_sys->desc_out, &p_filter->fmt_out.video,
                p_dst, i_plane_count, b_swap_uvo );
 
+#ifdef SWSCALE_SLICE_THREADS
+    if( p_sys->i_threads != 1 &&
+        ScaleSlices( p_sys, ctx, src, src_stride, i_height,
+                     dst, dst_stride ) >= 0 )
+        return;
+#endif
+
     for (size_t i = 0; i < ARRAY_SIZE(src); i++)
         csrc[i] = src[i];
 
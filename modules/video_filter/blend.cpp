@@ -31,8 +31,14 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#if defined(HAVE_SSE2_INTRINSICS) && defined(__SSE2__)
+# include <emmintrin.h>
+# define HAVE_BLEND_SSE2 1
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -42,6 +48,9 @@ static void Close(filter_t *);
 vlc_module_begin()
     set_description(N_("Video pictures blending"))
     set_callback_video_blending(Open, 100)
+    /* Allows comparing the vectorized and generic kernels */
+    add_bool("blend-simd", true, NULL, NULL)
+        change_private()
 vlc_module_end()
 
 static inline unsigned div255(unsigned v)
@@ -79,6 +88,10 @@ public:
     {
         return fmt;
     }
+    CPicture offset(unsigned dx) const
+    {
+        return CPicture(picture, fmt, x + dx, y);
+    }
     bool isFull(unsigned) const
     {
         return true;
@@ -428,9 +441,18 @@ typedef CPictureRGBX<4> CPictureBGRA;
 typedef CPictureRGBX<4> CPictureRGB32;
 typedef CPictureRGBX<3> CPictureRGB24;
 
+#ifdef HAVE_BLEND_SSE2
+/* 8 pixels, one per 16-bits lane */
+struct CVector {
+    __m128i i, j, k;
+    __m128i a;
+};
+#endif
+
 struct convertNone {
     convertNone(const video_format_t *, const video_format_t *) {}
-    void operator()(CPixel &)
+    template <typename P>
+    void operator()(P &)
     {
     }
 };
@@ -441,6 +463,12 @@ struct convertAddOpaque {
     {
         p.a = 0xFF;
     }
+#ifdef HAVE_BLEND_SSE2
+    void operator()(CVector &p)
+    {
+        p.a = _mm_set1_epi16(0xFF);
+    }
+#endif
 };
 
 template <unsigned dst, unsigned src>
@@ -467,6 +495,32 @@ struct convertRgbToYuv8 {
         p.j = u;
         p.k = v;
     }
+#ifdef HAVE_BLEND_SSE2
+    void operator()(CVector &p)
+    {
+        /* Same as rgb_to_yuv(): the sums fit in 16 bits, signed for the
+         * chroma and unsigned for the luma */
+        const __m128i y = _mm_add_epi16(
+            _mm_add_epi16(_mm_mullo_epi16(p.i, _mm_set1_epi16(66)),
+                          _mm_mullo_epi16(p.j, _mm_set1_epi16(129))),
+            _mm_add_epi16(_mm_mullo_epi16(p.k, _mm_set1_epi16(25)),
+                          _mm_set1_epi16(128)));
+        const __m128i u = _mm_add_epi16(
+            _mm_sub_epi16(_mm_mullo_epi16(p.k, _mm_set1_epi16(112)),
+                          _mm_mullo_epi16(p.i, _mm_set1_epi16(38))),
+            _mm_sub_epi16(_mm_set1_epi16(128),
+                          _mm_mullo_epi16(p.j, _mm_set1_epi16(74))));
+        const __m128i v = _mm_add_epi16(
+            _mm_sub_epi16(_mm_mullo_epi16(p.i, _mm_set1_epi16(112)),
+                          _mm_mullo_epi16(p.j, _mm_set1_epi16(94))),
+            _mm_sub_epi16(_mm_set1_epi16(128),
+                          _mm_mullo_epi16(p.k, _mm_set1_epi16(18))));
+
+        p.i = _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+        p.j = _mm_add_epi16(_mm_srai_epi16(u, 8), _mm_set1_epi16(128));
+        p.k = _mm_add_epi16(_mm_srai_epi16(v, 8), _mm_set1_epi16(128));
+    }
+#endif
 };
 
 struct convertYuv8ToRgb {
@@ -479,6 +533,48 @@ struct convertYuv8ToRgb {
         p.j = g;
         p.k = b;
     }
+#ifdef HAVE_BLEND_SSE2
+    void operator()(CVector &p)
+    {
+        /* Same coefficients and rounding as yuv_to_rgb() */
+#define FIX(x) ((int) ((x) * (1<<10) + 0.5))
+        const int cy  = FIX(255.0/219.0);
+        const int crr = FIX(1.40200*255.0/224.0);
+        const int cbg = FIX(0.34414*255.0/224.0);
+        const int crg = FIX(0.71414*255.0/224.0);
+        const int cbb = FIX(1.77200*255.0/224.0);
+#undef FIX
+        const __m128i y  = _mm_sub_epi16(p.i, _mm_set1_epi16(16));
+        const __m128i cb = _mm_sub_epi16(p.j, _mm_set1_epi16(128));
+        const __m128i cr = _mm_sub_epi16(p.k, _mm_set1_epi16(128));
+
+        p.i = component(y, cb, cr, cy, 0, crr);
+        p.j = component(y, cb, cr, cy, -cbg, -crg);
+        p.k = component(y, cb, cr, cy, cbb, 0);
+    }
+private:
+    /* Computes clip((y * cy + cb * fb + cr * fr + 512) >> 10) */
+    static __m128i component(__m128i y, __m128i cb, __m128i cr,
+                             int cy, int fb, int fr)
+    {
+        const __m128i fyb = _mm_setr_epi16(cy, fb, cy, fb, cy, fb, cy, fb);
+        const __m128i fr0 = _mm_setr_epi16(fr, 0, fr, 0, fr, 0, fr, 0);
+        const __m128i half = _mm_set1_epi32(1 << 9);
+        const __m128i zero = _mm_setzero_si128();
+
+        __m128i lo = _mm_add_epi32(
+            _mm_madd_epi16(_mm_unpacklo_epi16(y, cb), fyb),
+            _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cr, zero), fr0),
+                          half));
+        __m128i hi = _mm_add_epi32(
+            _mm_madd_epi16(_mm_unpackhi_epi16(y, cb), fyb),
+            _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cr, zero), fr0),
+                          half));
+        __m128i v = _mm_packs_epi32(_mm_srai_epi32(lo, 10),
+                                    _mm_srai_epi32(hi, 10));
+        return _mm_min_epi16(_mm_max_epi16(v, zero), _mm_set1_epi16(255));
+    }
+#endif
 };
 
 struct convertRgbToRgbSmall {
@@ -563,7 +659,8 @@ struct convertYuvpToRgba : public convertYuvpToAny {
 template <class G, class F>
 struct compose {
     compose(const video_format_t *dst, const video_format_t *src) : f(dst, src), g(dst, src) {}
-    void operator()(CPixel &p)
+    template <typename P>
+    void operator()(P &p)
     {
         f(p);
         g(p);
@@ -573,6 +670,340 @@ private:
     G g;
 };
 
+#ifdef HAVE_BLEND_SSE2
+static inline __m128i div255(__m128i v)
+{
+    /* Same as div255() on 16-bits lanes */
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_srli_epi16(v, 8), v),
+                                        _mm_set1_epi16(1)), 8);
+}
+
+static inline __m128i merge(__m128i dst, __m128i src, __m128i f)
+{
+    /* (255 - f) * dst + src * f <= 255 * 255 fits in 16 bits */
+    return div255(_mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_set1_epi16(255), f), dst),
+                                _mm_mullo_epi16(src, f)));
+}
+
+static inline __m128i bitselect(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i load8(const uint8_t *p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p),
+                             _mm_setzero_si128());
+}
+
+/* Loads the even bytes of 16 bytes */
+static inline __m128i load8Even(const uint8_t *p)
+{
+    return _mm_and_si128(_mm_loadu_si128((const __m128i *)p),
+                         _mm_set1_epi16(0x00ff));
+}
+
+static inline void store8(uint8_t *p, __m128i v)
+{
+    _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(v, v));
+}
+
+/*
+ * The vector pictures get() and blend() 8 or 16 pixels at once, the
+ * blended width being a multiple of 16. The same pixels as with the
+ * corresponding CPicture classes are blended, with the same rounding.
+ */
+class CVectorYUVA : public CPicture {
+public:
+    CVectorYUVA(const CPicture &cfg) : CPicture(cfg)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] = CPicture::getLine<1>(i) + x;
+    }
+    void get(CVector *px, unsigned dx) const
+    {
+        px->i = load8(&data[0][dx]);
+        px->j = load8(&data[1][dx]);
+        px->k = load8(&data[2][dx]);
+        px->a = load8(&data[3][dx]);
+    }
+    /* Gets the pixels dx, dx + 2, ..., dx + 14 */
+    void getEven(CVector *px, unsigned dx) const
+    {
+        px->i = load8Even(&data[0][dx]);
+        px->j = load8Even(&data[1][dx]);
+        px->k = load8Even(&data[2][dx]);
+        px->a = load8Even(&data[3][dx]);
+    }
+    void nextLine()
+    {
+        y++;
+        for (unsigned i = 0; i < 4; i++)
+            data[i] += picture->p[i].i_pitch;
+    }
+private:
+    const uint8_t *data[4];
+};
+
+class CVectorRGBA : public CPicture {
+public:
+    CVectorRGBA(const CPicture &cfg) : CPicture(cfg)
+    {
+        data = CPicture::getLine<1>(0) + 4 * x;
+    }
+    void get(CVector *px, unsigned dx) const
+    {
+        const uint8_t *src = &data[4 * dx];
+        split(px, _mm_loadu_si128((const __m128i *)&src[ 0]),
+                  _mm_loadu_si128((const __m128i *)&src[16]));
+    }
+    /* Gets the pixels dx, dx + 2, ..., dx + 14 */
+    void getEven(CVector *px, unsigned dx) const
+    {
+        const uint8_t *src = &data[4 * dx];
+        split(px, even(_mm_loadu_si128((const __m128i *)&src[ 0]),
+                       _mm_loadu_si128((const __m128i *)&src[16])),
+                  even(_mm_loadu_si128((const __m128i *)&src[32]),
+                       _mm_loadu_si128((const __m128i *)&src[48])));
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    static __m128i even(__m128i lo, __m128i hi)
+    {
+        return _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 0, 2, 0)),
+                                  _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+    static void split(CVector *px, __m128i lo, __m128i hi)
+    {
+        const __m128i mask = _mm_set1_epi32(0xff);
+
+        px->i = _mm_packs_epi32(_mm_and_si128(lo, mask),
+                                _mm_and_si128(hi, mask));
+        px->j = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask),
+                                _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+        px->k = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask),
+                                _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+        px->a = _mm_packs_epi32(_mm_srli_epi32(lo, 24),
+                                _mm_srli_epi32(hi, 24));
+    }
+    const uint8_t *data;
+};
+
+template <unsigned ry, bool swap_uv>
+class CVectorYUVPlanar : public CPicture {
+public:
+    CVectorYUVPlanar(const CPicture &cfg) : CPicture(cfg)
+    {
+        data[0] = CPicture::getLine< 1>(0);
+        data[1] = CPicture::getLine<ry>(swap_uv ? 2 : 1);
+        data[2] = CPicture::getLine<ry>(swap_uv ? 1 : 2);
+    }
+    template <class TSrc, class TConvert>
+    void blend(const TSrc &src, TConvert &convert, unsigned width,
+               __m128i alpha)
+    {
+        CVector spx;
+
+        for (unsigned dx = 0; dx < width; dx += 8) {
+            src.get(&spx, dx);
+            convert(spx);
+
+            uint8_t *dst = &data[0][x + dx];
+            __m128i a = div255(_mm_mullo_epi16(alpha, spx.a));
+            store8(dst, merge(load8(dst), spx.i, a));
+        }
+
+        if ((y % ry) != 0)
+            return;
+
+        /* Chroma samples are blended with the pixels of even columns */
+        for (unsigned dx = x & 1; dx < width; dx += 16) {
+            src.getEven(&spx, dx);
+            convert(spx);
+
+            uint8_t *u = &data[1][(x + dx) / 2];
+            uint8_t *v = &data[2][(x + dx) / 2];
+            __m128i a = div255(_mm_mullo_epi16(alpha, spx.a));
+            store8(u, merge(load8(u), spx.j, a));
+            store8(v, merge(load8(v), spx.k, a));
+        }
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % ry) == 0) {
+            data[1] += picture->p[swap_uv ? 2 : 1].i_pitch;
+            data[2] += picture->p[swap_uv ? 1 : 2].i_pitch;
+        }
+    }
+private:
+    uint8_t *data[3];
+};
+
+template <bool swap_uv>
+class CVectorYUVSemiPlanar : public CPicture {
+public:
+    CVectorYUVSemiPlanar(const CPicture &cfg) : CPicture(cfg)
+    {
+        data[0] = CPicture::getLine<1>(0);
+        data[1] = CPicture::getLine<2>(1);
+    }
+    template <class TSrc, class TConvert>
+    void blend(const TSrc &src, TConvert &convert, unsigned width,
+               __m128i alpha)
+    {
+        CVector spx;
+
+        for (unsigned dx = 0; dx < width; dx += 8) {
+            src.get(&spx, dx);
+            convert(spx);
+
+            uint8_t *dst = &data[0][x + dx];
+            __m128i a = div255(_mm_mullo_epi16(alpha, spx.a));
+            store8(dst, merge(load8(dst), spx.i, a));
+        }
+
+        if ((y % 2) != 0)
+            return;
+
+        for (unsigned dx = x & 1; dx < width; dx += 16) {
+            src.getEven(&spx, dx);
+            convert(spx);
+
+            uint8_t *dst = &data[1][(x + dx) / 2 * 2];
+            __m128i a = div255(_mm_mullo_epi16(alpha, spx.a));
+            __m128i uv = _mm_loadu_si128((const __m128i *)dst);
+            __m128i lo = merge(_mm_and_si128(uv, _mm_set1_epi16(0x00ff)),
+                               swap_uv ? spx.k : spx.j, a);
+            __m128i hi = merge(_mm_srli_epi16(uv, 8),
+                               swap_uv ? spx.j : spx.k, a);
+            _mm_storeu_si128((__m128i *)dst,
+                             _mm_or_si128(lo, _mm_slli_epi16(hi, 8)));
+        }
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0)
+            data[1] += picture->p[1].i_pitch;
+    }
+private:
+    uint8_t *data[2];
+};
+
+template <unsigned offset_r, unsigned offset_g, unsigned offset_b,
+          unsigned offset_a, bool has_alpha>
+class CVectorRGB32 : public CPicture {
+public:
+    CVectorRGB32(const CPicture &cfg) : CPicture(cfg)
+    {
+        data = CPicture::getLine<1>(0);
+    }
+    template <class TSrc, class TConvert>
+    void blend(const TSrc &src, TConvert &convert, unsigned width,
+               __m128i alpha)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        /* Lanes of the alpha (or padding) component */
+        const __m128i amask = _mm_setr_epi16(
+            offset_a == 0 ? -1 : 0, offset_a == 1 ? -1 : 0,
+            offset_a == 2 ? -1 : 0, offset_a == 3 ? -1 : 0,
+            offset_a == 0 ? -1 : 0, offset_a == 1 ? -1 : 0,
+            offset_a == 2 ? -1 : 0, offset_a == 3 ? -1 : 0);
+        CVector spx;
+
+        for (unsigned dx = 0; dx < width; dx += 8) {
+            src.get(&spx, dx);
+            convert(spx);
+
+            __m128i a = div255(_mm_mullo_epi16(alpha, spx.a));
+
+            /* Interleave the components in the destination order, with
+             * the alpha component blended toward opaque */
+            __m128i c[4];
+            c[offset_r] = spx.i;
+            c[offset_g] = spx.j;
+            c[offset_b] = spx.k;
+            c[offset_a] = _mm_set1_epi16(255);
+
+            __m128i c01l = _mm_unpacklo_epi16(c[0], c[1]);
+            __m128i c01h = _mm_unpackhi_epi16(c[0], c[1]);
+            __m128i c23l = _mm_unpacklo_epi16(c[2], c[3]);
+            __m128i c23h = _mm_unpackhi_epi16(c[2], c[3]);
+            __m128i aal = _mm_unpacklo_epi16(a, a);
+            __m128i aah = _mm_unpackhi_epi16(a, a);
+
+            const __m128i s[4] = {
+                _mm_unpacklo_epi32(c01l, c23l), _mm_unpackhi_epi32(c01l, c23l),
+                _mm_unpacklo_epi32(c01h, c23h), _mm_unpackhi_epi32(c01h, c23h),
+            };
+            const __m128i f[4] = {
+                _mm_unpacklo_epi32(aal, aal), _mm_unpackhi_epi32(aal, aal),
+                _mm_unpacklo_epi32(aah, aah), _mm_unpackhi_epi32(aah, aah),
+            };
+
+            uint8_t *dst = &data[(x + dx) * 4];
+            __m128i d0 = _mm_loadu_si128((const __m128i *)&dst[ 0]);
+            __m128i d1 = _mm_loadu_si128((const __m128i *)&dst[16]);
+            __m128i d[4] = {
+                _mm_unpacklo_epi8(d0, zero), _mm_unpackhi_epi8(d0, zero),
+                _mm_unpacklo_epi8(d1, zero), _mm_unpackhi_epi8(d1, zero),
+            };
+
+            for (unsigned i = 0; i < 4; i++) {
+                if (has_alpha) {
+                    /* See CPictureRGBX::merge() */
+                    __m128i da = _mm_shufflehi_epi16(
+                        _mm_shufflelo_epi16(d[i], _MM_SHUFFLE(offset_a, offset_a,
+                                                              offset_a, offset_a)),
+                        _MM_SHUFFLE(offset_a, offset_a, offset_a, offset_a));
+                    __m128i rgb = merge(d[i], s[i],
+                                        _mm_sub_epi16(_mm_set1_epi16(255), da));
+                    rgb = merge(rgb, s[i], f[i]);
+                    __m128i px = bitselect(amask, merge(d[i], s[i], f[i]), rgb);
+                    /* Fully transparent pixels are skipped */
+                    d[i] = bitselect(_mm_cmpeq_epi16(f[i], zero), d[i], px);
+                } else {
+                    /* The padding byte is left untouched */
+                    d[i] = merge(d[i], s[i], _mm_andnot_si128(amask, f[i]));
+                }
+            }
+
+            _mm_storeu_si128((__m128i *)&dst[ 0], _mm_packus_epi16(d[0], d[1]));
+            _mm_storeu_si128((__m128i *)&dst[16], _mm_packus_epi16(d[2], d[3]));
+        }
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    uint8_t *data;
+};
+
+typedef CVectorYUVPlanar<2, false>   CVectorI420_8;
+typedef CVectorYUVPlanar<2, true>    CVectorYV12;
+typedef CVectorYUVPlanar<1, false>   CVectorI422_8;
+typedef CVectorYUVSemiPlanar<false>  CVectorNV12;
+typedef CVectorYUVSemiPlanar<true>   CVectorNV21;
+
+typedef CVectorRGB32<0, 1, 2, 3, true>  CVectorRGBA32;
+typedef CVectorRGB32<1, 2, 3, 0, true>  CVectorARGB32;
+typedef CVectorRGB32<2, 1, 0, 3, true>  CVectorBGRA32;
+typedef CVectorRGB32<3, 2, 1, 0, true>  CVectorABGR32;
+typedef CVectorRGB32<0, 1, 2, 3, false> CVectorRGBX32;
+typedef CVectorRGB32<1, 2, 3, 0, false> CVectorXRGB32;
+typedef CVectorRGB32<2, 1, 0, 3, false> CVectorBGRX32;
+typedef CVectorRGB32<3, 2, 1, 0, false> CVectorXBGR32;
+#endif
+
 } // namespace
 
 template <class TDst, class TSrc, class TConvert>
@@ -607,6 +1038,35 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
+#ifdef HAVE_BLEND_SSE2
+template <class TDst, class TSrc, class TDstPicture, class TSrcPicture,
+          class TConvert>
+void BlendSSE2(const CPicture &dst_data, const CPicture &src_data,
+               unsigned width, unsigned height, int alpha)
+{
+    /* Blend vectors of 16 pixels, keeping at least one pixel for the
+     * generic code so that the vectors never read past the lines. */
+    unsigned vwidth = (width - 1) & ~15u;
+
+    if (vwidth > 0) {
+        TSrc src(src_data);
+        TDst dst(dst_data);
+        TConvert convert(dst_data.getFormat(), src_data.getFormat());
+        const __m128i valpha = _mm_set1_epi16(alpha);
+
+        for (unsigned y = 0; y < height; y++) {
+            dst.blend(src, convert, vwidth, valpha);
+            src.nextLine();
+            dst.nextLine();
+        }
+    }
+
+    Blend<TDstPicture, TSrcPicture, TConvert>(dst_data.offset(vwidth),
+                                              src_data.offset(vwidth),
+                                              width - vwidth, height, alpha);
+}
+#endif
+
 namespace {
 
 static const struct {
@@ -687,6 +1147,39 @@ static const struct {
 #undef YUV
 };
 
+#ifdef HAVE_BLEND_SSE2
+static const struct {
+    vlc_fourcc_t     dst;
+    vlc_fourcc_t     src;
+    blend_function_t blend;
+} blends_sse2[] = {
+#define RGB(csp, vector, picture, cvt) \
+    { csp, VLC_CODEC_YUVA, BlendSSE2<vector, CVectorYUVA, picture, CPictureYUVA, compose<cvt, convertYuv8ToRgb> > }, \
+    { csp, VLC_CODEC_RGBA, BlendSSE2<vector, CVectorRGBA, picture, CPictureRGBA, compose<cvt, convertNone> > }
+#define YUV(csp, vector, picture) \
+    { csp, VLC_CODEC_YUVA, BlendSSE2<vector, CVectorYUVA, picture, CPictureYUVA, compose<convertNone, convertNone> > }, \
+    { csp, VLC_CODEC_RGBA, BlendSSE2<vector, CVectorRGBA, picture, CPictureRGBA, compose<convertNone, convertRgbToYuv8> > }
+
+    RGB(VLC_CODEC_RGBA,     CVectorRGBA32,    CPictureRGBA,     convertNone),
+    RGB(VLC_CODEC_ARGB,     CVectorARGB32,    CPictureRGBA,     convertNone),
+    RGB(VLC_CODEC_BGRA,     CVectorBGRA32,    CPictureBGRA,     convertNone),
+    RGB(VLC_CODEC_ABGR,     CVectorABGR32,    CPictureBGRA,     convertNone),
+    RGB(VLC_CODEC_RGBX,     CVectorRGBX32,    CPictureRGB32,    convertAddOpaque),
+    RGB(VLC_CODEC_XRGB,     CVectorXRGB32,    CPictureRGB32,    convertAddOpaque),
+    RGB(VLC_CODEC_BGRX,     CVectorBGRX32,    CPictureRGB32,    convertAddOpaque),
+    RGB(VLC_CODEC_XBGR,     CVectorXBGR32,    CPictureRGB32,    convertAddOpaque),
+
+    YUV(VLC_CODEC_YV12,     CVectorYV12,      CPictureYV12),
+    YUV(VLC_CODEC_NV12,     CVectorNV12,      CPictureNV12),
+    YUV(VLC_CODEC_NV21,     CVectorNV21,      CPictureNV21),
+    YUV(VLC_CODEC_I420,     CVectorI420_8,    CPictureI420_8),
+    YUV(VLC_CODEC_I422,     CVectorI422_8,    CPictureI422_8),
+
+#undef RGB
+#undef YUV
+};
+#endif
+
 struct filter_sys_t {
     filter_sys_t() : blend(NULL)
     {
@@ -742,7 +1235,15 @@ static int Open(filter_t *filter)
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
     filter_sys_t *sys = new filter_sys_t();
-    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
+#ifdef HAVE_BLEND_SSE2
+    if (vlc_CPU_SSE2() && var_InheritBool(filter, "blend-simd")) {
+        for (size_t i = 0; i < sizeof(blends_sse2) / sizeof(*blends_sse2); i++) {
+            if (blends_sse2[i].src == src && blends_sse2[i].dst == dst)
+                sys->blend = blends_sse2[i].blend;
+        }
+    }
+#endif
+    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends) && !sys->blend; i++) {
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
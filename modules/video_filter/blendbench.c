@@ -59,15 +59,20 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define BASE_IMAGE_TEXT N_("Image to be blended onto")
 #define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto")
 
+#define SIZES_TEXT N_("Sizes of the generated images")
+#define SIZES_LONGTEXT N_("Comma-separated list of WIDTHxHEIGHT sizes of the " \
+                          "images generated when no image file is given")
+
 #define BASE_CHROMA_TEXT N_("Chroma for the base image")
-#define BASE_CHROMA_LONGTEXT N_("Chroma which the base image will be loaded in")
+#define BASE_CHROMA_LONGTEXT N_("Comma-separated list of chromas which the " \
+                                "base image will be benchmarked in")
 
 #define BLEND_IMAGE_TEXT N_("Image which will be blended")
 #define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image")
 
 #define BLEND_CHROMA_TEXT N_("Chroma for the blend image")
-#define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
-                                 " in")
+#define BLEND_CHROMA_LONGTEXT N_("Comma-separated list of chromas which the " \
+                                 "blend image will be benchmarked in")
 
 #define CFG_PREFIX "blendbench-"
 
@@ -81,6 +86,7 @@ vlc_module_begin ()
               LOOPS_LONGTEXT )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT )
+    add_string( CFG_PREFIX "sizes", "1920x1080", SIZES_TEXT, SIZES_LONGTEXT )
 
     set_section( N_("Base image"), NULL )
     add_loadfile(CFG_PREFIX "base-image", NULL,
@@ -98,10 +104,13 @@ vlc_module_begin ()
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
+    "loops", "alpha", "sizes", "base-image", "base-chroma", "blend-image",
     "blend-chroma", NULL
 };
 
+#define MAX_CHROMAS 16
+#define MAX_SIZES   16
+
 /*****************************************************************************
  * filter_sys_t: filter method descriptor
  *****************************************************************************/
@@ -110,11 +119,18 @@ typedef struct
     bool b_done;
     int i_loops, i_alpha;
 
-    picture_t *p_base_image;
-    picture_t *p_blend_image;
+    char *psz_base_image;
+    char *psz_blend_image;
+
+    vlc_fourcc_t pi_base_chroma[MAX_CHROMAS];
+    vlc_fourcc_t pi_blend_chroma[MAX_CHROMAS];
+    unsigned i_base_chroma, i_blend_chroma;
 
-    vlc_fourcc_t i_base_chroma;
-    vlc_fourcc_t i_blend_chroma;
+    struct
+    {
+        unsigned i_width, i_height;
+    } sizes[MAX_SIZES];
+    unsigned i_sizes;
 } filter_sys_t;
 
 static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
@@ -143,6 +159,166 @@ static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
     return VLC_SUCCESS;
 }
 
+/* Generates a deterministic image: noise, with blocks of transparent,
+ * opaque and translucent pixels if the chroma has an alpha channel. */
+static picture_t *blendbench_NewImage( vlc_object_t *p_this,
+                                       vlc_fourcc_t i_chroma,
+                                       unsigned i_width, unsigned i_height,
+                                       uint64_t i_seed )
+{
+    video_format_t fmt;
+    int i_alpha_plane = -1, i_alpha_byte = -1;
+
+    switch( i_chroma )
+    {
+        case VLC_CODEC_YUVP:
+            msg_Err( p_this, "%4.4s needs an image file", (const char *)&i_chroma );
+            return NULL;
+        case VLC_CODEC_YUVA:
+            i_alpha_plane = A_PLANE;
+            break;
+        case VLC_CODEC_RGBA:
+        case VLC_CODEC_BGRA:
+            i_alpha_byte = 3;
+            break;
+        case VLC_CODEC_ARGB:
+        case VLC_CODEC_ABGR:
+            i_alpha_byte = 0;
+            break;
+    }
+
+    video_format_Init( &fmt, i_chroma );
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    video_format_Clean( &fmt );
+    if( p_pic == NULL )
+    {
+        msg_Err( p_this, "Unable to create a %4.4s image",
+                 (const char *)&i_chroma );
+        return NULL;
+    }
+
+    uint64_t i_state = i_seed;
+    for( int i_plane = 0; i_plane < p_pic->i_planes; i_plane++ )
+    {
+        plane_t *p = &p_pic->p[i_plane];
+        const int i_pixel_pitch = i_alpha_byte >= 0 ? p->i_pixel_pitch : 1;
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+        {
+            uint8_t *p_line = &p->p_pixels[y * p->i_pitch];
+
+            for( int x = 0; x < p->i_visible_pitch; x++ )
+            {
+                i_state = i_state * 6364136223846793005ULL
+                        + 1442695040888963407ULL;
+                p_line[x] = i_state >> 56;
+
+                if( i_plane != i_alpha_plane
+                 && ( i_alpha_byte < 0 || x % i_pixel_pitch != i_alpha_byte ) )
+                    continue;
+
+                /* 16x16 blocks of each kind */
+                switch( ( x / i_pixel_pitch / 16 + y / 16 ) % 3 )
+                {
+                    case 0: p_line[x] = 0x00; break;
+                    case 1: p_line[x] = 0xff; break;
+                }
+            }
+        }
+    }
+    return p_pic;
+}
+
+static picture_t *blendbench_GetImage( vlc_object_t *p_this, char *psz_file,
+                                       vlc_fourcc_t i_chroma,
+                                       unsigned i_width, unsigned i_height,
+                                       uint64_t i_seed, const char *psz_name )
+{
+    picture_t *p_pic;
+
+    if( psz_file == NULL || *psz_file == '\0' )
+        return blendbench_NewImage( p_this, i_chroma, i_width, i_height,
+                                    i_seed );
+    if( blendbench_LoadImage( p_this, &p_pic, i_chroma, psz_file,
+                              psz_name ) != VLC_SUCCESS )
+        return NULL;
+    return p_pic;
+}
+
+static uint64_t blendbench_Checksum( const picture_t *p_pic )
+{
+    uint64_t i_hash = 0xcbf29ce484222325ULL;
+
+    for( int i_plane = 0; i_plane < p_pic->i_planes; i_plane++ )
+    {
+        const plane_t *p = &p_pic->p[i_plane];
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+            for( int x = 0; x < p->i_visible_pitch; x++ )
+                i_hash = ( i_hash ^ p->p_pixels[y * p->i_pitch + x] )
+                       * 0x100000001b3ULL;
+    }
+    return i_hash;
+}
+
+static unsigned blendbench_ParseChromas( vlc_object_t *p_this,
+                                         vlc_fourcc_t *pi_chroma,
+                                         const char *psz_option )
+{
+    char *psz_list = var_CreateGetStringCommand( p_this, psz_option );
+    char *psz_save;
+    unsigned i_count = 0;
+
+    if( psz_list == NULL )
+        return 0;
+
+    for( char *psz = strtok_r( psz_list, ",", &psz_save ); psz != NULL;
+         psz = strtok_r( NULL, ",", &psz_save ) )
+    {
+        if( strlen( psz ) != 4 || i_count >= MAX_CHROMAS )
+        {
+            msg_Err( p_this, "Invalid chroma \"%s\" in %s", psz, psz_option );
+            i_count = 0;
+            break;
+        }
+        pi_chroma[i_count++] = VLC_FOURCC( psz[0], psz[1], psz[2], psz[3] );
+    }
+    free( psz_list );
+    return i_count;
+}
+
+static unsigned blendbench_ParseSizes( vlc_object_t *p_this,
+                                       filter_sys_t *p_sys )
+{
+    char *psz_list = var_CreateGetStringCommand( p_this, CFG_PREFIX "sizes" );
+    char *psz_save;
+    unsigned i_count = 0;
+
+    if( psz_list == NULL )
+        return 0;
+
+    for( char *psz = strtok_r( psz_list, ",", &psz_save ); psz != NULL;
+         psz = strtok_r( NULL, ",", &psz_save ) )
+    {
+        unsigned i_width, i_height;
+
+        if( sscanf( psz, "%ux%u", &i_width, &i_height ) != 2
+         || i_width == 0 || i_height == 0 || i_count >= MAX_SIZES )
+        {
+            msg_Err( p_this, "Invalid size \"%s\"", psz );
+            i_count = 0;
+            break;
+        }
+        p_sys->sizes[i_count].i_width = i_width;
+        p_sys->sizes[i_count].i_height = i_height;
+        i_count++;
+    }
+    free( psz_list );
+    return i_count;
+}
+
 static const struct vlc_filter_operations filter_ops =
 {
     .filter_video = Filter, .close = Destroy,
@@ -154,8 +330,6 @@ static const struct vlc_filter_operations filter_ops =
 static int Create( filter_t *p_filter )
 {
     filter_sys_t *p_sys;
-    char *psz_temp, *psz_cmd;
-    int i_ret;
 
     /* Allocate structure */
     p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
@@ -165,8 +339,6 @@ static int Create( filter_t *p_filter )
     p_sys = p_filter->p_sys;
     p_sys->b_done = false;
 
-    p_filter->ops = &filter_ops;
-
     /* needed to get options passed in transcode using the
      * adjust{name=value} syntax */
     config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
@@ -177,39 +349,26 @@ static int Create( filter_t *p_filter )
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
 
-    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
-    p_sys->i_base_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
-        VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( VLC_OBJECT(p_filter), &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
-    free( psz_temp );
-    free( psz_cmd );
-    if( i_ret != VLC_SUCCESS )
-    {
-        free( p_sys );
-        return i_ret;
-    }
-
-    psz_temp = var_CreateGetStringCommand( p_filter,
-                                           CFG_PREFIX "blend-chroma" );
-    p_sys->i_blend_chroma = !psz_temp || strlen( psz_temp ) != 4
-        ? 0 : VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    i_ret = blendbench_LoadImage( VLC_OBJECT(p_filter), &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                                  psz_cmd, "Blend" );
-
-    free( psz_temp );
-    free( psz_cmd );
-
-    if( i_ret != VLC_SUCCESS )
+    p_sys->i_base_chroma = blendbench_ParseChromas( VLC_OBJECT(p_filter),
+                                                    p_sys->pi_base_chroma,
+                                                    CFG_PREFIX "base-chroma" );
+    p_sys->i_blend_chroma = blendbench_ParseChromas( VLC_OBJECT(p_filter),
+                                                     p_sys->pi_blend_chroma,
+                                                     CFG_PREFIX "blend-chroma" );
+    p_sys->i_sizes = blendbench_ParseSizes( VLC_OBJECT(p_filter), p_sys );
+    if( p_sys->i_base_chroma == 0 || p_sys->i_blend_chroma == 0
+     || p_sys->i_sizes == 0 )
     {
-        picture_Release( p_sys->p_base_image );
         free( p_sys );
-
         return VLC_EGENERIC;
     }
 
+    p_sys->psz_base_image = var_CreateGetStringCommand( p_filter,
+                                                        CFG_PREFIX "base-image" );
+    p_sys->psz_blend_image = var_CreateGetStringCommand( p_filter,
+                                                         CFG_PREFIX "blend-image" );
+
+    p_filter->ops = &filter_ops;
     return VLC_SUCCESS;
 }
 
@@ -220,59 +379,109 @@ static void Destroy( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_base_image );
+    free( p_sys->psz_blend_image );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * Benchmark: blends one combination of chromas and sizes
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void Benchmark( filter_t *p_filter, vlc_fourcc_t i_base_chroma,
+                       vlc_fourcc_t i_blend_chroma,
+                       unsigned i_width, unsigned i_height )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_base, *p_blend_image;
     filter_t *p_blend;
 
-    if( p_sys->b_done )
-        return p_pic;
+    p_base = blendbench_GetImage( VLC_OBJECT(p_filter), p_sys->psz_base_image,
+                                  i_base_chroma, i_width, i_height,
+                                  1, "Base" );
+    if( p_base == NULL )
+        return;
+
+    /* The generated blend image covers the whole base image */
+    p_blend_image = blendbench_GetImage( VLC_OBJECT(p_filter),
+                                         p_sys->psz_blend_image, i_blend_chroma,
+                                         p_base->format.i_visible_width,
+                                         p_base->format.i_visible_height,
+                                         2, "Blend" );
+    if( p_blend_image == NULL )
+        goto error;
 
     p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
+        goto error;
+    p_blend->fmt_out.video = p_base->format;
+    p_blend->fmt_in.video = p_blend_image->format;
     p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
+        msg_Err( p_filter, "Cannot blend %4.4s onto %4.4s",
+                 (const char *)&i_blend_chroma, (const char *)&i_base_chroma );
         vlc_object_delete(p_blend);
-        return NULL;
+        goto error;
     }
     assert( p_blend->ops != NULL );
 
+    /* The checksum of the first blend allows comparing implementations */
+    filter_Blend( p_blend, p_base, 0, 0, p_blend_image, p_sys->i_alpha );
+    uint64_t i_checksum = blendbench_Checksum( p_base );
+
     vlc_tick_t time = vlc_tick_now();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
     {
-        filter_Blend( p_blend, p_sys->p_base_image,
-                      0, 0, p_sys->p_blend_image, p_sys->i_alpha );
+        filter_Blend( p_blend, p_base,
+                      0, 0, p_blend_image, p_sys->i_alpha );
     }
     time = vlc_tick_now() - time;
 
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              secf_from_vlc_tick(time) );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * CLOCK_FREQ,
-              (float) p_sys->i_loops / time * CLOCK_FREQ *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+    const double f_pixels = (double)p_blend_image->format.i_visible_width
+                          * p_blend_image->format.i_visible_height;
+    msg_Info( p_filter, "%4.4s onto %4.4s %ux%u: blended %d images in %f sec",
+              (const char *)&i_blend_chroma, (const char *)&i_base_chroma,
+              p_base->format.i_visible_width, p_base->format.i_visible_height,
+              p_sys->i_loops, secf_from_vlc_tick(time) );
+    if( time > 0 )
+        msg_Info( p_filter, "Speed is: %f ms/image, %f Mpixels/second, "
+                  "checksum %016"PRIx64,
+                  secf_from_vlc_tick(time) * 1000. / p_sys->i_loops,
+                  p_sys->i_loops * f_pixels / 1e6 / secf_from_vlc_tick(time),
+                  i_checksum );
 
     filter_Close( p_blend );
     module_unneed( p_blend, p_blend->p_module );
 
     vlc_object_delete(p_blend);
 
+error:
+    if( p_blend_image != NULL )
+        picture_Release( p_blend_image );
+    picture_Release( p_base );
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    /* The sizes only apply to generated base images */
+    const unsigned i_sizes = p_sys->psz_base_image != NULL
+                          && *p_sys->psz_base_image != '\0' ? 1 : p_sys->i_sizes;
+
+    for( unsigned i = 0; i < p_sys->i_base_chroma; i++ )
+        for( unsigned j = 0; j < p_sys->i_blend_chroma; j++ )
+            for( unsigned k = 0; k < i_sizes; k++ )
+                Benchmark( p_filter, p_sys->pi_base_chroma[i],
+                           p_sys->pi_blend_chroma[j],
+                           p_sys->sizes[k].i_width, p_sys->sizes[k].i_height );
+
     p_sys->b_done = true;
     return p_pic;
 }
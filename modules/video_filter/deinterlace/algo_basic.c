@@ -129,58 +129,44 @@ int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
  * RenderLinear: BOB with linear interpolation
  *****************************************************************************/
 
-int RenderLinear( filter_t *p_filter,
-                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+struct linear_args
 {
-    VLC_UNUSED(order);
-    int i_plane;
+    const picture_t *p_pic;
+    int i_field;
+};
 
+static void RenderLinearSlice( filter_t *p_filter, picture_t *p_outpic,
+                               const void *p_args, int i_plane,
+                               int i_start, int i_end )
+{
     filter_sys_t *p_sys = p_filter->p_sys;
+    const struct linear_args *args = p_args;
+    const plane_t *p_in = &args->p_pic->p[i_plane];
+    plane_t *p_out = &p_outpic->p[i_plane];
+    const int i_lines = p_out->i_visible_lines;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int y = i_start; y < i_end; y++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
-
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
-        {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        }
+        uint8_t *p_dst = &p_out->p_pixels[y * p_out->i_pitch];
+        const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+        /* Lines of the other field are interpolated, except at the edges */
+        if( (y % 2) != args->i_field && y > 0 && y < i_lines - 1 )
+            Merge( p_dst, p_src - p_in->i_pitch, p_src + p_in->i_pitch,
+                   p_in->i_pitch );
+        else
+            memcpy( p_dst, p_src, p_in->i_pitch );
     }
     EndMerge();
+}
+
+int RenderLinear( filter_t *p_filter,
+                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+{
+    VLC_UNUSED(order);
+    const struct linear_args args = { p_pic, i_field };
+
+    RenderSlices( p_filter, p_outpic, RenderLinearSlice, &args, 1 );
     return VLC_SUCCESS;
 }
 
@@ -188,34 +174,29 @@ int RenderLinear( filter_t *p_filter,
  * RenderMean: Half-resolution blender
  *****************************************************************************/
 
-int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void RenderMeanSlice( filter_t *p_filter, picture_t *p_outpic,
+                             const void *p_args, int i_plane,
+                             int i_start, int i_end )
 {
-    int i_plane;
-
     filter_sys_t *p_sys = p_filter->p_sys;
+    const picture_t *p_pic = p_args;
+    const plane_t *p_in = &p_pic->p[i_plane];
+    plane_t *p_out = &p_outpic->p[i_plane];
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    /* All lines: mean value */
+    for( int y = i_start; y < i_end; y++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* All lines: mean value */
-        for( ; p_out < p_out_end ; )
-        {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+        const uint8_t *p_src = &p_in->p_pixels[2 * y * p_in->i_pitch];
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-        }
+        Merge( &p_out->p_pixels[y * p_out->i_pitch],
+               p_src, p_src + p_in->i_pitch, p_in->i_pitch );
     }
     EndMerge();
+}
+
+int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderSlices( p_filter, p_outpic, RenderMeanSlice, p_pic, 1 );
     return VLC_SUCCESS;
 }
 
@@ -223,37 +204,36 @@ int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
  * RenderBlend: Full-resolution blender
  *****************************************************************************/
 
-int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void RenderBlendSlice( filter_t *p_filter, picture_t *p_outpic,
+                              const void *p_args, int i_plane,
+                              int i_start, int i_end )
 {
-    int i_plane;
-
     filter_sys_t *p_sys = p_filter->p_sys;
+    const picture_t *p_pic = p_args;
+    const plane_t *p_in = &p_pic->p[i_plane];
+    plane_t *p_out = &p_outpic->p[i_plane];
+    int y = i_start;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    /* First line: simple copy */
+    if( y == 0 )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* First line: simple copy */
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        p_out += p_outpic->p[i_plane].i_pitch;
+        memcpy( p_out->p_pixels, p_in->p_pixels, p_in->i_pitch );
+        y++;
+    }
 
-        /* Remaining lines: mean value */
-        for( ; p_out < p_out_end ; )
-        {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+    /* Remaining lines: mean value */
+    for( ; y < i_end; y++ )
+    {
+        const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in  += p_pic->p[i_plane].i_pitch;
-        }
+        Merge( &p_out->p_pixels[y * p_out->i_pitch],
+               p_src - p_in->i_pitch, p_src, p_in->i_pitch );
     }
     EndMerge();
+}
+
+int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderSlices( p_filter, p_outpic, RenderBlendSlice, p_pic, 1 );
     return VLC_SUCCESS;
 }
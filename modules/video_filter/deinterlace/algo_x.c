@@ -295,51 +295,56 @@ static inline void XDeintBand8x8C( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+/* Renders the 8-line bands of the lines [i_start, i_end). i_start is a
+ * multiple of 8. The last band of the plane may be shorter. */
+static void RenderXSlice( filter_t *p_filter, picture_t *p_outpic,
+                          const void *p_args, int i_plane,
+                          int i_start, int i_end )
 {
     VLC_UNUSED(p_filter);
-    int i_plane;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        const int i_mby = ( p_outpic->p[i_plane].i_visible_lines + 7 )/8 - 1;
-        const int i_mbx = p_outpic->p[i_plane].i_visible_pitch/8;
+    const picture_t *p_pic = p_args;
 
-        const int i_mody = p_outpic->p[i_plane].i_visible_lines - 8*i_mby;
-        const int i_modx = p_outpic->p[i_plane].i_visible_pitch - 8*i_mbx;
+    const int i_mby = ( p_outpic->p[i_plane].i_visible_lines + 7 )/8 - 1;
+    const int i_mbx = p_outpic->p[i_plane].i_visible_pitch/8;
 
-        const int i_dst = p_outpic->p[i_plane].i_pitch;
-        const int i_src = p_pic->p[i_plane].i_pitch;
+    const int i_mody = p_outpic->p[i_plane].i_visible_lines - 8*i_mby;
+    const int i_modx = p_outpic->p[i_plane].i_visible_pitch - 8*i_mbx;
 
-        int y, x;
+    const int i_dst = p_outpic->p[i_plane].i_pitch;
+    const int i_src = p_pic->p[i_plane].i_pitch;
 
-        for( y = 0; y < i_mby; y++ )
-        {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+    const int i_end_mby = ( i_end + 7 )/8;
+    int y, x;
 
-            XDeintBand8x8C( dst, i_dst, src, i_src, i_mbx, i_modx );
-        }
+    for( y = i_start/8; y < __MIN( i_mby, i_end_mby ); y++ )
+    {
+        uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
+        uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
 
-        /* Last line (C only)*/
-        if( i_mody )
-        {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+        XDeintBand8x8C( dst, i_dst, src, i_src, i_mbx, i_modx );
+    }
 
-            for( x = 0; x < i_mbx; x++ )
-            {
-                XDeintNxN( dst, i_dst, src, i_src, 8, i_mody );
+    /* Last line (C only)*/
+    if( i_mody && y == i_mby && y < i_end_mby )
+    {
+        uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
+        uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
 
-                dst += 8;
-                src += 8;
-            }
+        for( x = 0; x < i_mbx; x++ )
+        {
+            XDeintNxN( dst, i_dst, src, i_src, 8, i_mody );
 
-            if( i_modx )
-                XDeintNxN( dst, i_dst, src, i_src, i_modx, i_mody );
+            dst += 8;
+            src += 8;
         }
+
+        if( i_modx )
+            XDeintNxN( dst, i_dst, src, i_src, i_modx, i_mody );
     }
+}
 
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderSlices( p_filter, p_outpic, RenderXSlice, p_pic, 8 );
     return VLC_SUCCESS;
 }
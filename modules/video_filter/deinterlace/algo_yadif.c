@@ -46,6 +46,71 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+typedef void (*yadif_filter_t)(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                               uint8_t *next, int w, int prefs, int mrefs,
+                               int parity, int mode);
+
+struct yadif_args
+{
+    const picture_t *p_prev;
+    const picture_t *p_cur;
+    const picture_t *p_next;
+    yadif_filter_t filter;
+    int i_field;
+    int i_parity;
+};
+
+static void RenderYadifSlice( filter_t *p_filter, picture_t *p_dst,
+                              const void *p_args, int n,
+                              int i_start, int i_end )
+{
+    VLC_UNUSED(p_filter);
+    const struct yadif_args *args = p_args;
+    const plane_t *prevp = &args->p_prev->p[n];
+    const plane_t *curp  = &args->p_cur->p[n];
+    const plane_t *nextp = &args->p_next->p[n];
+    plane_t *dstp        = &p_dst->p[n];
+
+    /* The first and last lines are duplicated from their neighbours, which
+     * are always in the same slice. */
+    for( int y = __MAX( i_start, 1 );
+         y < __MIN( i_end, dstp->i_visible_lines - 1 ); y++ )
+    {
+        if( (y % 2) == args->i_field  ||  args->i_parity == 2 )
+        {
+            memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                        &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+            assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+            args->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                          &prevp->p_pixels[y * prevp->i_pitch],
+                          &curp->p_pixels[y * curp->i_pitch],
+                          &nextp->p_pixels[y * nextp->i_pitch],
+                          dstp->i_visible_pitch,
+                          y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                          y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                          args->i_parity,
+                          mode );
+        }
+
+        /* We duplicate the first and last lines */
+        if( y == 1 )
+            memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+        else if( y == dstp->i_visible_lines - 2 )
+            memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -109,8 +174,7 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     if( p_prev && p_cur && p_next )
     {
         /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
+        yadif_filter_t filter;
 
 #if defined(HAVE_X86ASM)
         if( vlc_CPU_SSSE3() )
@@ -125,49 +189,10 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         if( p_sys->chroma->pixel_size == 2 )
             filter = yadif_filter_line_c_16bit;
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        const struct yadif_args args = {
+            p_prev, p_cur, p_next, filter, i_field, yadif_parity,
+        };
+        RenderSlices( p_filter, p_dst, RenderYadifSlice, &args, 1 );
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
@@ -281,6 +281,12 @@ static int Mouse( filter_t *p_filter,
                                     "Best simulation, but requires more CPU "\
                                     "and memory bandwidth.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads used to render each picture "\
+                            "by horizontal slices with the Linear, Mean, "\
+                            "Blend, X and Yadif algorithms "\
+                            "(1 = single thread, 0 = one per CPU).")
+
 #define PHOSPHOR_DIMMER_TEXT N_("Phosphor old field dimmer strength")
 #define PHOSPHOR_DIMMER_LONGTEXT N_("This controls the strength of the "\
                                     "darkening filter that simulates CRT TV "\
@@ -305,6 +311,8 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "threads", 1, 0, SLICES_MAX,
+                            THREADS_TEXT, THREADS_LONGTEXT )
     set_deinterlace_callback( Open )
 vlc_module_end ()
 
@@ -319,7 +327,7 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "threads",
     NULL
 };
 
@@ -338,30 +346,31 @@ struct filter_mode_t
     deinterlace_algo     settings;
     bool                 can_pack;         /**< can handle packed pixel */
     bool                 b_high_bit_depth; /**< can handle high bit depth */
+    bool                 b_slices;         /**< renders by slices */
 };
 static struct filter_mode_t filter_mode [] = {
     { "discard", .pf_render_single_pic = RenderDiscard,
-                 { false, false, false, true }, true, true },
+                 { false, false, false, true }, true, true, false },
     { "bob", .pf_render_ordered = RenderBob,
-                 { true, false, false, false }, true, true },
+                 { true, false, false, false }, true, true, false },
     { "progressive-scan", .pf_render_ordered = RenderBob,
-                 { true, false, false, false }, true, true },
+                 { true, false, false, false }, true, true, false },
     { "linear", .pf_render_ordered = RenderLinear,
-                 { true, false, false, false }, true, true },
+                 { true, false, false, false }, true, true, true },
     { "mean", .pf_render_single_pic = RenderMean,
-                 { false, false, false, true }, true, true },
+                 { false, false, false, true }, true, true, true },
     { "blend", .pf_render_single_pic = RenderBlend,
-                 { false, false, false, false }, true, true },
+                 { false, false, false, false }, true, true, true },
     { "yadif", .pf_render_single_pic = RenderYadifSingle,
-                 { false, true, false, false }, false, true },
+                 { false, true, false, false }, false, true, true },
     { "yadif2x", .pf_render_ordered = RenderYadif,
-                 { true, true, false, false }, false, true },
+                 { true, true, false, false }, false, true, true },
     { "x", .pf_render_single_pic = RenderX,
-                 { false, false, false, false }, false, false },
+                 { false, false, false, false }, false, false, true },
     { "phosphor", .pf_render_ordered = RenderPhosphor,
-                 { true, true, false, false }, false, false },
+                 { true, true, false, false }, false, false, false },
     { "ivtc", .pf_render_single_pic = RenderIVTC,
-                 { false, true, true, false }, false, false },
+                 { false, true, true, false }, false, false, false },
 };
 
 /**
@@ -371,9 +380,12 @@ static struct filter_mode_t filter_mode [] = {
  *
  * @param p_filter The filter instance.
  * @param mode Desired method. See mode_list for available choices.
+ * @param pack Whether the input format is packed.
+ * @param[out] pb_slices Whether the method renders by slices.
  * @see mode_list
  */
-static int SetFilterMethod( filter_t *p_filter, const char *mode, bool pack )
+static int SetFilterMethod( filter_t *p_filter, const char *mode, bool pack,
+                            bool *pb_slices )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
@@ -388,18 +400,19 @@ static int SetFilterMethod( filter_t *p_filter, const char *mode, bool pack )
             {
                 msg_Err( p_filter, "unknown or incompatible deinterlace mode \"%s\""
                         " for packed format", mode );
-                return SetFilterMethod( p_filter, "blend", pack );
+                return SetFilterMethod( p_filter, "blend", pack, pb_slices );
             }
             if( p_sys->chroma->pixel_size > 1 && !filter_mode[i].b_high_bit_depth )
             {
                 msg_Err( p_filter, "unknown or incompatible deinterlace mode \"%s\""
                         " for high depth format", mode );
-                return SetFilterMethod( p_filter, "blend", pack );
+                return SetFilterMethod( p_filter, "blend", pack, pb_slices );
             }
 
             msg_Dbg( p_filter, "using %s deinterlace method", mode );
             p_sys->context.settings = filter_mode[i].settings;
             p_sys->context.pf_render_ordered = filter_mode[i].pf_render_ordered;
+            *pb_slices = filter_mode[i].b_slices;
             return VLC_SUCCESS;
         }
     }
@@ -478,8 +491,11 @@ int Mouse( filter_t *p_filter,
  */
 static void Close( filter_t *p_filter )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
+
     Flush( p_filter );
-    free( p_filter->p_sys );
+    SlicesClean( &p_sys->slices );
+    free( p_sys );
 }
 
 static const struct vlc_filter_operations filter_ops = {
@@ -543,7 +559,8 @@ notsupp:
     config_ChainParse( p_filter, FILTER_CFG_PREFIX, ppsz_filter_options,
                        p_filter->p_cfg );
     char *psz_mode = var_InheritString( p_filter, FILTER_CFG_PREFIX "mode" );
-    int ret = SetFilterMethod( p_filter, psz_mode, packed );
+    bool b_slices;
+    int ret = SetFilterMethod( p_filter, psz_mode, packed, &b_slices );
     if (ret != VLC_SUCCESS)
     {
         free(psz_mode);
@@ -551,6 +568,13 @@ notsupp:
         return ret;
     }
 
+    unsigned i_threads = 1;
+    if( b_slices )
+        i_threads = var_GetInteger( p_filter, FILTER_CFG_PREFIX "threads" );
+    i_threads = SlicesInit( &p_sys->slices, i_threads );
+    if( i_threads > 1 )
+        msg_Dbg( p_filter, "rendering with %u slices", i_threads );
+
     IVTCClearState( p_filter );
 
 #if defined(CAN_COMPILE_C_ALTIVEC)
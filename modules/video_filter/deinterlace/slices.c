@@ -0,0 +1,188 @@
+/*****************************************************************************
+ * slices.c : Slice-threaded rendering for the VLC deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+
+#include "deinterlace.h"
+
+#include "slices.h"
+
+/*****************************************************************************
+ * Band splitting
+ *****************************************************************************/
+
+/* Number of bands for a plane with i_lines lines. */
+static unsigned BandCount( const struct deinterlace_slices *p_slices,
+                           int i_lines )
+{
+    unsigned i_count = i_lines / SLICES_MIN_LINES;
+    if( i_count > p_slices->i_count )
+        i_count = p_slices->i_count;
+    return i_count > 0 ? i_count : 1;
+}
+
+/* First line of the band i_band out of i_count. */
+static int BandStart( int i_lines, unsigned i_band, unsigned i_count,
+                      int i_align )
+{
+    if( i_band >= i_count )
+        return i_lines;
+    return ( (int64_t)i_lines * i_band / i_count ) & ~(i_align - 1);
+}
+
+static void RenderSlice( struct deinterlace_slices *p_slices, unsigned i_index )
+{
+    picture_t *p_dst = p_slices->p_dst;
+
+    for( int i_plane = 0; i_plane < p_dst->i_planes; i_plane++ )
+    {
+        const int i_lines = p_dst->p[i_plane].i_visible_lines;
+        const unsigned i_count = BandCount( p_slices, i_lines );
+
+        if( i_index >= i_count )
+            continue;
+
+        int i_start = BandStart( i_lines, i_index, i_count,
+                                 p_slices->i_align );
+        int i_end = BandStart( i_lines, i_index + 1, i_count,
+                               p_slices->i_align );
+        if( i_start < i_end )
+            p_slices->pf_render( p_slices->p_filter, p_dst, p_slices->p_args,
+                                 i_plane, i_start, i_end );
+    }
+}
+
+static void RunSlice( void *opaque )
+{
+    struct deinterlace_slice *p_slice = opaque;
+    struct deinterlace_slices *p_slices = p_slice->p_owner;
+
+    RenderSlice( p_slices, p_slice->i_index );
+
+    vlc_mutex_lock( &p_slices->lock );
+    assert( p_slices->i_pending > 0 );
+    if( --p_slices->i_pending == 0 )
+        vlc_cond_signal( &p_slices->wait );
+    vlc_mutex_unlock( &p_slices->lock );
+}
+
+/*****************************************************************************
+ * Slice threading setup
+ *****************************************************************************/
+
+unsigned SlicesInit( struct deinterlace_slices *p_slices, unsigned i_threads )
+{
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    if( i_threads > SLICES_MAX )
+        i_threads = SLICES_MAX;
+
+    p_slices->executor = NULL;
+    p_slices->i_count = 1;
+    p_slices->i_pending = 0;
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( &p_slices->wait );
+
+    if( i_threads <= 1 )
+        return 1;
+
+    /* The calling thread renders one of the slices itself. */
+    p_slices->executor = vlc_executor_New( i_threads - 1 );
+    if( p_slices->executor == NULL )
+        return 1;
+
+    p_slices->i_count = i_threads;
+    for( unsigned i = 0; i < i_threads; i++ )
+    {
+        struct deinterlace_slice *p_slice = &p_slices->slice[i];
+
+        p_slice->runnable.run = RunSlice;
+        p_slice->runnable.userdata = p_slice;
+        p_slice->p_owner = p_slices;
+        p_slice->i_index = i;
+    }
+    return i_threads;
+}
+
+void SlicesClean( struct deinterlace_slices *p_slices )
+{
+    assert( p_slices->i_pending == 0 );
+    if( p_slices->executor != NULL )
+        vlc_executor_Delete( p_slices->executor );
+}
+
+/*****************************************************************************
+ * Rendering
+ *****************************************************************************/
+
+void RenderSlices( filter_t *p_filter, picture_t *p_dst,
+                   slice_render_t pf_render, const void *p_args,
+                   int i_align )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct deinterlace_slices *p_slices = &p_sys->slices;
+
+    assert( i_align > 0 && (i_align & (i_align - 1)) == 0 );
+
+    p_slices->p_filter = p_filter;
+    p_slices->p_dst = p_dst;
+    p_slices->pf_render = pf_render;
+    p_slices->p_args = p_args;
+    p_slices->i_align = i_align;
+
+    if( p_slices->executor == NULL )
+    {
+        RenderSlice( p_slices, 0 );
+        return;
+    }
+
+    /* Only submit as many slices as the largest plane has bands. */
+    unsigned i_count = 1;
+    for( int i_plane = 0; i_plane < p_dst->i_planes; i_plane++ )
+    {
+        unsigned i_bands = BandCount( p_slices,
+                                      p_dst->p[i_plane].i_visible_lines );
+        if( i_bands > i_count )
+            i_count = i_bands;
+    }
+
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->i_pending = i_count - 1;
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( unsigned i = 1; i < i_count; i++ )
+        vlc_executor_Submit( p_slices->executor,
+                             &p_slices->slice[i].runnable );
+
+    RenderSlice( p_slices, 0 );
+
+    vlc_mutex_lock( &p_slices->lock );
+    while( p_slices->i_pending > 0 )
+        vlc_cond_wait( &p_slices->wait, &p_slices->lock );
+    vlc_mutex_unlock( &p_slices->lock );
+}
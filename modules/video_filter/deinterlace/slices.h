@@ -0,0 +1,133 @@
+/*****************************************************************************
+ * slices.h : Slice-threaded rendering for the VLC deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEINTERLACE_SLICES_H
+#define VLC_DEINTERLACE_SLICES_H 1
+
+#include <vlc_threads.h>
+#include <vlc_executor.h>
+
+/* Forward declarations */
+struct filter_t;
+struct picture_t;
+
+/**
+ * \file
+ * Slice threading for the line-based deinterlace algorithms.
+ *
+ * Each plane of the output picture is split into horizontal bands, which are
+ * rendered concurrently. The bands never overlap in the output picture.
+ * The lines above and below a band are read directly from the input
+ * picture(s), which are shared read-only by all the slices.
+ */
+
+/** Maximum number of slices (and thus threads) per picture. */
+#define SLICES_MAX 16
+
+/** Planes are not split into bands smaller than this many lines. */
+#define SLICES_MIN_LINES 32
+
+/**
+ * Renders the lines [i_start, i_end) of one plane of the output picture.
+ *
+ * This is called concurrently for the different bands of a picture, so it
+ * must only write to its own lines of p_dst. If the Merge() macro is used,
+ * EndMerge() must be called before returning, as the slice may have run on
+ * a different thread.
+ *
+ * @param p_filter The filter instance.
+ * @param p_dst Output picture.
+ * @param p_args Algorithm-specific arguments given to RenderSlices().
+ * @param i_plane Index of the plane to render.
+ * @param i_start First line of the band.
+ * @param i_end Line after the last line of the band.
+ */
+typedef void (*slice_render_t)( filter_t *p_filter, picture_t *p_dst,
+                                 const void *p_args, int i_plane,
+                                 int i_start, int i_end );
+
+struct deinterlace_slices;
+
+/** A slice that can be run by the executor. */
+struct deinterlace_slice
+{
+    struct vlc_runnable runnable;
+    struct deinterlace_slices *p_owner;
+    unsigned i_index;
+};
+
+/**
+ * Slice threading state.
+ */
+struct deinterlace_slices
+{
+    vlc_executor_t *executor; /**< NULL if slice threading is disabled */
+    unsigned i_count;         /**< Number of slices per picture */
+
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_pending;    /**< Slices not rendered yet */
+
+    /* Picture being rendered. This does not change while slices are pending. */
+    filter_t      *p_filter;
+    picture_t     *p_dst;
+    slice_render_t pf_render;
+    const void    *p_args;
+    int            i_align;
+
+    struct deinterlace_slice slice[SLICES_MAX];
+};
+
+/**
+ * Sets up slice threading.
+ *
+ * If threads cannot be created, this falls back to rendering
+ * on the calling thread only.
+ *
+ * @param p_slices Slice threading state to initialize.
+ * @param i_threads Number of threads, or 0 to use as many as there are CPUs.
+ * @return Number of slices per picture.
+ */
+unsigned SlicesInit( struct deinterlace_slices *p_slices, unsigned i_threads );
+
+/**
+ * Stops the threads and releases the resources of slice threading.
+ *
+ * @param p_slices Slice threading state to clean.
+ */
+void SlicesClean( struct deinterlace_slices *p_slices );
+
+/**
+ * Renders an output picture by slices.
+ *
+ * Calls pf_render for the bands of each plane of p_dst, and waits until all
+ * of them are rendered. One of the bands is rendered on the calling thread.
+ *
+ * @param p_filter The filter instance.
+ * @param p_dst Output picture.
+ * @param pf_render Band rendering function.
+ * @param p_args Arguments passed to pf_render.
+ * @param i_align Alignment of the first line of each band (a power of two).
+ */
+void RenderSlices( filter_t *p_filter, picture_t *p_dst,
+                   slice_render_t pf_render, const void *p_args,
+                   int i_align );
+
+#endif
@@ -139,7 +139,9 @@ int vlc_param_SetString(struct vlc_param *param, const char *value)
     atomic_store_explicit(&param->value.str, str, memory_order_release);
     param->item.value.psz = str;
     vlc_rcu_synchronize();
-    free(oldstr);
+    /* The cache loader uses the default value in place */
+    if (oldstr != param->item.orig.psz)
+        free(oldstr);
     return 0;
 }
 
@@ -136,6 +136,7 @@ struct vlc_input_decoder_t
     decoder_t *p_packetizer;
     es_format_t pktz_fmt_in;
     bool b_packetizer;
+    struct pktz_thread *pktz; /* packetizer thread, if enabled */
 
     /* Current format in use by the output */
     es_format_t    fmt;
@@ -149,6 +150,16 @@ struct vlc_input_decoder_t
     /* fifo */
     block_fifo_t *p_fifo;
 
+    /* Lock-free queue of frames from vlc_input_decoder_Decode() (producer) to
+     * the DecoderThread (consumer). The frames queued before the last flush
+     * are counted and discarded by the consumer. The consumer side is only
+     * accessed with the fifo lock. */
+    vlc_spsc_fifo_t *p_input;
+    size_t input_queued; /* written by the producer only */
+    size_t input_dequeued; /* written with the fifo lock */
+    size_t input_discard; /* written with the fifo lock */
+    atomic_bool input_wait; /* the DecoderThread waits for input */
+
     /* Lock for communication with decoder thread */
     vlc_cond_t  wait_request;
     vlc_cond_t  wait_acknowledge;
@@ -1003,6 +1014,46 @@ static float ModuleThread_GetDisplayRate( decoder_t *p_dec )
     return rate;
 }
 
+/* Number of input frames queued and not discarded */
+static size_t DecoderPendingInputLocked( vlc_input_decoder_t *p_owner )
+{
+    vlc_fifo_Assert( p_owner->p_fifo );
+
+    size_t done = __MAX( p_owner->input_dequeued, p_owner->input_discard );
+    return p_owner->input_queued - done;
+}
+
+/* Dequeue the next input frame, skipping those queued before a flush */
+static vlc_frame_t *DecoderThread_DequeueInput( vlc_input_decoder_t *p_owner )
+{
+    vlc_fifo_Assert( p_owner->p_fifo );
+
+    for( ;; )
+    {
+        vlc_frame_t *frame = vlc_spsc_fifo_TryGet( p_owner->p_input );
+        if( frame == NULL )
+            return NULL;
+        if( p_owner->input_dequeued++ >= p_owner->input_discard )
+            return frame;
+        block_Release( frame );
+    }
+}
+
+/* Release the input frames queued before a flush */
+static void DecoderDiscardInputLocked( vlc_input_decoder_t *p_owner )
+{
+    vlc_fifo_Assert( p_owner->p_fifo );
+
+    while( p_owner->input_dequeued < p_owner->input_discard )
+    {
+        vlc_frame_t *frame = vlc_spsc_fifo_TryGet( p_owner->p_input );
+        if( frame == NULL )
+            break;
+        p_owner->input_dequeued++;
+        block_Release( frame );
+    }
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -1653,6 +1704,429 @@ static void DecoderThread_DecodeBlock( vlc_input_decoder_t *p_owner, vlc_frame_t
     }
 }
 
+/*
+ * Packetizer thread
+ *
+ * When enabled, the packetizer runs in its own thread, pipelined with the
+ * DecoderThread. Frames to packetize and packetized frames go through
+ * bounded queues. The DecoderThread still handles the decoder module, the
+ * format changes, the CC and the flushes.
+ *
+ * Lock order: the fifo lock may be held when taking pktz->lock, but the
+ * packetizer thread never takes the fifo lock with pktz->lock held.
+ */
+
+/* Maximum number of queued items on either side of the packetizer thread */
+#define PKTZ_QUEUE_MAX 16
+
+/* Output of one pf_packetize() call */
+struct pktz_output
+{
+    vlc_frame_t *frames;
+    es_format_t *fmt; /* new packetizer output format, or NULL */
+    vlc_frame_t *cc;
+    decoder_cc_desc_t cc_desc;
+    struct pktz_output *next;
+};
+
+struct pktz_thread
+{
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait_input; /* the packetizer thread waits for input or room */
+    vlc_cond_t wait_output; /* the DecoderThread waits for output or room */
+
+    vlc_frame_t *input;
+    vlc_frame_t **input_last;
+    size_t input_count;
+    bool drain; /* drain the packetizer once the input is empty */
+    bool drained;
+
+    struct pktz_output *output;
+    struct pktz_output **output_last;
+    size_t output_count;
+
+    bool busy; /* the packetizer module is being used by the thread */
+    bool flushing; /* outputs are discarded */
+    bool closing;
+
+    es_format_t fmt; /* last format sent, only used by the busy thread */
+};
+
+static void PktzOutputDelete( struct pktz_output *out )
+{
+    block_ChainRelease( out->frames );
+    if( out->cc != NULL )
+        block_Release( out->cc );
+    if( out->fmt != NULL )
+    {
+        es_format_Clean( out->fmt );
+        free( out->fmt );
+    }
+    free( out );
+}
+
+static struct pktz_output *PktzPopOutputLocked( struct pktz_thread *pktz )
+{
+    struct pktz_output *out = pktz->output;
+    if( out == NULL )
+        return NULL;
+
+    pktz->output = out->next;
+    if( pktz->output == NULL )
+        pktz->output_last = &pktz->output;
+    pktz->output_count--;
+    vlc_cond_signal( &pktz->wait_input );
+    return out;
+}
+
+static void PktzDiscardLocked( struct pktz_thread *pktz )
+{
+    block_ChainRelease( pktz->input );
+    pktz->input = NULL;
+    pktz->input_last = &pktz->input;
+    pktz->input_count = 0;
+
+    struct pktz_output *out;
+    while( (out = PktzPopOutputLocked( pktz )) != NULL )
+        PktzOutputDelete( out );
+}
+
+static void PktzThread_Send( vlc_input_decoder_t *p_owner,
+                             struct pktz_output *out )
+{
+    struct pktz_thread *pktz = p_owner->pktz;
+
+    vlc_mutex_lock( &pktz->lock );
+    while( pktz->output_count >= PKTZ_QUEUE_MAX
+        && !pktz->flushing && !pktz->closing )
+        vlc_cond_wait( &pktz->wait_input, &pktz->lock );
+
+    if( pktz->flushing || pktz->closing )
+    {
+        vlc_mutex_unlock( &pktz->lock );
+        PktzOutputDelete( out );
+        return;
+    }
+
+    *pktz->output_last = out;
+    pktz->output_last = &out->next;
+    pktz->output_count++;
+    vlc_cond_signal( &pktz->wait_output );
+    vlc_mutex_unlock( &pktz->lock );
+
+    /* Wake the DecoderThread up if it is waiting for input */
+    vlc_fifo_Lock( p_owner->p_fifo );
+    vlc_fifo_Signal( p_owner->p_fifo );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
+static void PktzThread_Packetize( vlc_input_decoder_t *p_owner,
+                                  vlc_frame_t *frame )
+{
+    struct pktz_thread *pktz = p_owner->pktz;
+    decoder_t *p_packetizer = p_owner->p_packetizer;
+    vlc_frame_t **ppframe = frame ? &frame : NULL;
+    vlc_frame_t *packetized_frame;
+
+    while( (packetized_frame =
+            p_packetizer->pf_packetize( p_packetizer, ppframe ) ) )
+    {
+        struct pktz_output *out = malloc( sizeof( *out ) );
+        if( unlikely(out == NULL) )
+        {
+            block_ChainRelease( packetized_frame );
+            continue;
+        }
+        out->frames = packetized_frame;
+        out->fmt = NULL;
+        out->cc = NULL;
+        out->next = NULL;
+
+        /* Format changes are detected by the DecoderThread */
+        if( !es_format_IsSimilar( &pktz->fmt, &p_packetizer->fmt_out ) )
+        {
+            out->fmt = malloc( sizeof( *out->fmt ) );
+            if( likely(out->fmt != NULL) &&
+                es_format_Copy( out->fmt, &p_packetizer->fmt_out ) == VLC_SUCCESS )
+            {
+                es_format_Clean( &pktz->fmt );
+                es_format_Copy( &pktz->fmt, &p_packetizer->fmt_out );
+            }
+            else
+            {
+                free( out->fmt );
+                out->fmt = NULL;
+            }
+        }
+
+        if( p_owner->cc.b_supported && p_packetizer->pf_get_cc != NULL )
+            out->cc = p_packetizer->pf_get_cc( p_packetizer, &out->cc_desc );
+
+        PktzThread_Send( p_owner, out );
+    }
+}
+
+static void *PktzThread( void *data )
+{
+    vlc_input_decoder_t *p_owner = data;
+    struct pktz_thread *pktz = p_owner->pktz;
+
+    vlc_thread_set_name( "vlc-packetizer" );
+
+    vlc_mutex_lock( &pktz->lock );
+    for( ;; )
+    {
+        while( pktz->input == NULL && !pktz->drain && !pktz->closing )
+            vlc_cond_wait( &pktz->wait_input, &pktz->lock );
+        if( pktz->closing )
+            break;
+
+        vlc_frame_t *frame = pktz->input;
+        if( frame != NULL )
+        {
+            pktz->input = frame->p_next;
+            if( pktz->input == NULL )
+                pktz->input_last = &pktz->input;
+            pktz->input_count--;
+            frame->p_next = NULL;
+        }
+        else
+            pktz->drain = false;
+        pktz->busy = true;
+        vlc_cond_signal( &pktz->wait_output );
+        vlc_mutex_unlock( &pktz->lock );
+
+        PktzThread_Packetize( p_owner, frame );
+
+        vlc_mutex_lock( &pktz->lock );
+        pktz->busy = false;
+        if( frame == NULL )
+            pktz->drained = true;
+        vlc_cond_signal( &pktz->wait_output );
+    }
+    vlc_mutex_unlock( &pktz->lock );
+    return NULL;
+}
+
+static int PktzStart( vlc_input_decoder_t *p_owner )
+{
+    struct pktz_thread *pktz = malloc( sizeof( *pktz ) );
+    if( unlikely(pktz == NULL) )
+        return VLC_ENOMEM;
+
+    vlc_mutex_init( &pktz->lock );
+    vlc_cond_init( &pktz->wait_input );
+    vlc_cond_init( &pktz->wait_output );
+    pktz->input = NULL;
+    pktz->input_last = &pktz->input;
+    pktz->input_count = 0;
+    pktz->drain = false;
+    pktz->drained = false;
+    pktz->output = NULL;
+    pktz->output_last = &pktz->output;
+    pktz->output_count = 0;
+    pktz->busy = false;
+    pktz->flushing = false;
+    pktz->closing = false;
+    /* The decoder was created with the packetizer output format */
+    if( es_format_Copy( &pktz->fmt, &p_owner->p_packetizer->fmt_out ) )
+        es_format_Init( &pktz->fmt, UNKNOWN_ES, 0 );
+
+    p_owner->pktz = pktz;
+    if( vlc_clone( &pktz->thread, PktzThread, p_owner ) )
+    {
+        p_owner->pktz = NULL;
+        es_format_Clean( &pktz->fmt );
+        free( pktz );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void PktzStop( vlc_input_decoder_t *p_owner )
+{
+    struct pktz_thread *pktz = p_owner->pktz;
+
+    vlc_mutex_lock( &pktz->lock );
+    pktz->closing = true;
+    vlc_cond_signal( &pktz->wait_input );
+    vlc_mutex_unlock( &pktz->lock );
+
+    vlc_join( pktz->thread, NULL );
+
+    PktzDiscardLocked( pktz );
+    es_format_Clean( &pktz->fmt );
+    free( pktz );
+    p_owner->pktz = NULL;
+}
+
+/* Discard the queued frames and wait for the packetizer module to be idle,
+ * so that it can be flushed from the DecoderThread */
+static void PktzFlush( struct pktz_thread *pktz )
+{
+    vlc_mutex_lock( &pktz->lock );
+    pktz->flushing = true;
+    pktz->drain = false;
+    block_ChainRelease( pktz->input );
+    pktz->input = NULL;
+    pktz->input_last = &pktz->input;
+    pktz->input_count = 0;
+    vlc_cond_signal( &pktz->wait_input );
+
+    while( pktz->busy )
+        vlc_cond_wait( &pktz->wait_output, &pktz->lock );
+
+    PktzDiscardLocked( pktz );
+    /* The discarded outputs may have carried a format change */
+    es_format_Clean( &pktz->fmt );
+    es_format_Init( &pktz->fmt, UNKNOWN_ES, 0 );
+    pktz->flushing = false;
+    vlc_mutex_unlock( &pktz->lock );
+}
+
+static bool PktzIsEmpty( struct pktz_thread *pktz )
+{
+    vlc_mutex_lock( &pktz->lock );
+    bool empty = pktz->input == NULL && pktz->output == NULL && !pktz->busy;
+    vlc_mutex_unlock( &pktz->lock );
+    return empty;
+}
+
+static void DecoderThread_DecodePacketized( vlc_input_decoder_t *p_owner,
+                                            struct pktz_output *out )
+{
+    decoder_t *p_dec = &p_owner->dec;
+    vlc_frame_t *packetized_frame = out->frames;
+
+    out->frames = NULL;
+    if( p_owner->error )
+        goto end;
+
+    if( out->fmt != NULL && !es_format_IsSimilar( p_dec->fmt_in, out->fmt ) )
+    {
+        msg_Dbg( p_dec, "restarting module due to input format change");
+        es_format_LogDifferences( vlc_object_logger(p_dec),
+                                  "decoder in", p_dec->fmt_in,
+                                  "packetizer out", out->fmt );
+
+        /* Drain the decoder module */
+        DecoderThread_DecodeBlock( p_owner, NULL );
+
+        if( DecoderThread_Reload( p_owner, out->fmt,
+                                  RELOAD_DECODER ) != VLC_SUCCESS )
+            goto end;
+    }
+
+    if( out->cc != NULL )
+    {
+        DecoderPlayCcLocked( p_owner, out->cc, &out->cc_desc );
+        out->cc = NULL;
+    }
+
+    while( packetized_frame )
+    {
+        vlc_frame_t *p_next = packetized_frame->p_next;
+        packetized_frame->p_next = NULL;
+
+        DecoderThread_DecodeBlock( p_owner, packetized_frame );
+
+        packetized_frame = p_next;
+        if( p_owner->error )
+            break;
+    }
+
+end:
+    block_ChainRelease( packetized_frame );
+    PktzOutputDelete( out );
+}
+
+/* Decode the packetized frames already available, with the fifo locked */
+static bool DecoderThread_DecodeAvailable( vlc_input_decoder_t *p_owner )
+{
+    struct pktz_thread *pktz = p_owner->pktz;
+    bool decoded = false;
+
+    for( ;; )
+    {
+        vlc_mutex_lock( &pktz->lock );
+        struct pktz_output *out = PktzPopOutputLocked( pktz );
+        vlc_mutex_unlock( &pktz->lock );
+        if( out == NULL )
+            return decoded;
+
+        DecoderThread_DecodePacketized( p_owner, out );
+        decoded = true;
+    }
+}
+
+/* Queue a frame to the packetizer thread, or drain it if the frame is NULL,
+ * with the fifo locked */
+static void DecoderThread_PacketizeAsync( vlc_input_decoder_t *p_owner,
+                                          vlc_frame_t *frame )
+{
+    struct pktz_thread *pktz = p_owner->pktz;
+    struct pktz_output *out;
+
+    vlc_fifo_Unlock( p_owner->p_fifo );
+    vlc_mutex_lock( &pktz->lock );
+
+    if( frame != NULL )
+    {
+        /* Keep decoding while waiting for room, as the packetizer thread
+         * may be waiting for room as well */
+        while( pktz->input_count >= PKTZ_QUEUE_MAX )
+        {
+            out = PktzPopOutputLocked( pktz );
+            if( out == NULL )
+            {
+                vlc_cond_wait( &pktz->wait_output, &pktz->lock );
+                continue;
+            }
+            vlc_mutex_unlock( &pktz->lock );
+            vlc_fifo_Lock( p_owner->p_fifo );
+            DecoderThread_DecodePacketized( p_owner, out );
+            vlc_fifo_Unlock( p_owner->p_fifo );
+            vlc_mutex_lock( &pktz->lock );
+        }
+
+        *pktz->input_last = frame;
+        pktz->input_last = &frame->p_next;
+        pktz->input_count++;
+    }
+    else
+    {
+        pktz->drain = true;
+        pktz->drained = false;
+    }
+    vlc_cond_signal( &pktz->wait_input );
+
+    /* When draining, wait for all the outputs */
+    for( ;; )
+    {
+        out = PktzPopOutputLocked( pktz );
+        if( out == NULL )
+        {
+            if( frame != NULL || pktz->drained )
+                break;
+            vlc_cond_wait( &pktz->wait_output, &pktz->lock );
+            continue;
+        }
+        vlc_mutex_unlock( &pktz->lock );
+        vlc_fifo_Lock( p_owner->p_fifo );
+        DecoderThread_DecodePacketized( p_owner, out );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+        vlc_mutex_lock( &pktz->lock );
+    }
+
+    vlc_mutex_unlock( &pktz->lock );
+    vlc_fifo_Lock( p_owner->p_fifo );
+
+    /* Drain the decoder after the packetizer is drained */
+    if( frame == NULL )
+        DecoderThread_DecodeBlock( p_owner, NULL );
+}
+
 /**
  * Decode a frame
  *
@@ -1701,7 +2175,9 @@ static void DecoderThread_ProcessInput( vlc_input_decoder_t *p_owner, vlc_frame_
         vlc_fifo_Lock(p_owner->p_fifo);
         return;
     }
-    if( packetize )
+    if( packetize && p_owner->pktz != NULL )
+        DecoderThread_PacketizeAsync( p_owner, frame );
+    else if( packetize )
     {
         vlc_frame_t *packetized_frame;
         vlc_frame_t **ppframe = frame ? &frame : NULL;
@@ -1765,6 +2241,9 @@ static void DecoderThread_Flush( vlc_input_decoder_t *p_owner )
     decoder_t *p_dec = &p_owner->dec;
     decoder_t *p_packetizer = p_owner->p_packetizer;
 
+    if( p_owner->pktz != NULL )
+        PktzFlush( p_owner->pktz );
+
     if( p_owner->error )
         return;
 
@@ -1810,6 +2289,7 @@ static void *DecoderThread( void *p_data )
             DecoderThread_Flush( p_owner );
 
             vlc_fifo_Lock( p_owner->p_fifo );
+            DecoderDiscardInputLocked( p_owner );
 
             /* Reset flushing after DecoderThread_ProcessInput in case vlc_input_decoder_Flush
              * is called again. This will avoid a second useless flush (but
@@ -1848,15 +2328,29 @@ static void *DecoderThread( void *p_data )
 
         vlc_cond_signal( &p_owner->wait_fifo );
 
+        /* Frames queued by the owner (CC sub decoders) go first, they are
+         * never mixed with frames from vlc_input_decoder_Decode(). */
         vlc_frame_t *frame = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        if( frame == NULL )
+            frame = DecoderThread_DequeueInput( p_owner );
+        if( frame == NULL && p_owner->pktz != NULL
+         && DecoderThread_DecodeAvailable( p_owner ) )
+            continue;
         if( frame == NULL )
         {
             if( likely(!p_owner->b_draining) )
             {   /* Wait for a block to decode (or a request to drain) */
+                atomic_store( &p_owner->input_wait, true );
+                if( !vlc_spsc_fifo_IsEmpty( p_owner->p_input ) )
+                {   /* Raced with the producer (see DecodeWithStatus) */
+                    atomic_store( &p_owner->input_wait, false );
+                    continue;
+                }
                 p_owner->b_idle = true;
                 vlc_cond_signal( &p_owner->wait_acknowledge );
                 vlc_fifo_Wait( p_owner->p_fifo );
                 p_owner->b_idle = false;
+                atomic_store( &p_owner->input_wait, false );
                 continue;
             }
             /* We have emptied the FIFO and there is a pending request to
@@ -1964,6 +2458,7 @@ CreateDecoder( vlc_object_t *p_parent, const struct vlc_input_decoder_cfg *cfg )
     p_owner->p_sout = cfg->sout;
     p_owner->p_sout_input = NULL;
     p_owner->p_packetizer = NULL;
+    p_owner->pktz = NULL;
 
     p_owner->b_fmt_description = false;
     p_owner->p_description = NULL;
@@ -1998,6 +2493,18 @@ CreateDecoder( vlc_object_t *p_parent, const struct vlc_input_decoder_cfg *cfg )
         return NULL;
     }
 
+    p_owner->p_input = vlc_spsc_fifo_New();
+    if( unlikely(p_owner->p_input == NULL) )
+    {
+        block_FifoRelease( p_owner->p_fifo );
+        vlc_object_delete(p_dec);
+        return NULL;
+    }
+    p_owner->input_queued = 0;
+    p_owner->input_dequeued = 0;
+    p_owner->input_discard = 0;
+    atomic_init( &p_owner->input_wait, false );
+
     vlc_mutex_init( &p_owner->mouse_lock );
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
@@ -2097,6 +2604,11 @@ static void DeleteDecoder( vlc_input_decoder_t *p_owner, enum es_format_category
     msg_Dbg( p_dec, "killing decoder fourcc `%4.4s'",
              (char*)&p_dec->fmt_in->i_codec );
 
+    /* The packetizer thread signals the fifo, stop it before anything
+     * it uses is released */
+    if( p_owner->pktz != NULL )
+        PktzStop( p_owner );
+
     decoder_Clean( p_dec );
 
     if ( p_owner->out_pool )
@@ -2110,6 +2622,8 @@ static void DeleteDecoder( vlc_input_decoder_t *p_owner, enum es_format_category
 
     /* Free all packets still in the decoder fifo. */
     block_FifoEmpty( p_owner->p_fifo );
+    vlc_spsc_fifo_Delete( p_owner->p_input );
+    p_owner->p_input = NULL;
 
     /* Cleanup */
     if( p_owner->p_sout_input )
@@ -2240,6 +2754,11 @@ decoder_New( vlc_object_t *p_parent, const struct vlc_input_decoder_cfg *cfg )
         }
     }
 
+    if( p_owner->p_packetizer != NULL
+     && var_InheritBool( p_dec, "packetizer-thread" )
+     && PktzStart( p_owner ) != VLC_SUCCESS )
+        msg_Warn( p_dec, "cannot spawn packetizer thread" );
+
     if( !vlc_input_decoder_IsSynchronous( p_owner ) )
     {
         /* Spawn the decoder thread in asynchronous scenario. */
@@ -2435,33 +2954,50 @@ void vlc_input_decoder_DecodeWithStatus(vlc_input_decoder_t *p_owner, vlc_frame_
         return;
     }
 
-    vlc_fifo_Lock( p_owner->p_fifo );
+    /* The input queue counters include frames waiting to be discarded, so
+     * they are upper bounds: only take the lock if a limit may be hit. */
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
          * in the FIFO instead of its size. */
         /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
+        if( vlc_spsc_fifo_GetBytes( p_owner->p_input ) > 400*1024*1024 )
         {
             msg_Warn( &p_owner->dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+            vlc_fifo_Lock( p_owner->p_fifo );
+            p_owner->input_discard = p_owner->input_queued;
+            DecoderDiscardInputLocked( p_owner );
+            vlc_fifo_Unlock( p_owner->p_fifo );
             frame->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
     }
     else
-    if( !p_owner->b_waiting )
+    if( !p_owner->b_waiting
+     && vlc_spsc_fifo_GetCount( p_owner->p_input ) >= 10 )
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
+        vlc_fifo_Lock( p_owner->p_fifo );
+        while( DecoderPendingInputLocked( p_owner ) >= 10 )
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
     }
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, frame );
-    if (status != NULL)
-        GetStatusLocked(p_owner, status);
-    vlc_fifo_Unlock( p_owner->p_fifo );
+    for( vlc_frame_t *b = frame; b != NULL; b = b->p_next )
+        p_owner->input_queued++;
+    vlc_spsc_fifo_Put( p_owner->p_input, frame );
+
+    /* Pairs with the check in DecoderThread: either it sees the new frame
+     * before sleeping, or this sees it waiting and wakes it up. */
+    if( atomic_load( &p_owner->input_wait ) || status != NULL )
+    {
+        vlc_fifo_Lock( p_owner->p_fifo );
+        vlc_fifo_Signal( p_owner->p_fifo );
+        if (status != NULL)
+            GetStatusLocked(p_owner, status);
+        vlc_fifo_Unlock( p_owner->p_fifo );
+    }
 }
 
 void vlc_input_decoder_Decode(vlc_input_decoder_t *p_owner, vlc_frame_t *frame,
@@ -2475,7 +3011,9 @@ bool vlc_input_decoder_IsEmpty( vlc_input_decoder_t * p_owner )
     assert( !p_owner->b_waiting );
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
+    if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining
+     || DecoderPendingInputLocked( p_owner ) > 0
+     || ( p_owner->pktz != NULL && !PktzIsEmpty( p_owner->pktz ) ) )
     {
         vlc_fifo_Unlock( p_owner->p_fifo );
         return false;
@@ -2520,6 +3058,9 @@ void vlc_input_decoder_Flush( vlc_input_decoder_t *p_owner )
 
     /* Empty the fifo */
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    /* The input queue belongs to the DecoderThread: its frames are discarded
+     * there */
+    p_owner->input_discard = p_owner->input_queued;
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
@@ -2693,7 +3234,8 @@ void vlc_input_decoder_Wait( vlc_input_decoder_t *p_owner )
          * owner */
         if( p_owner->paused )
             break;
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo )
+         && DecoderPendingInputLocked( p_owner ) == 0 )
         {
             msg_Err( &p_owner->dec, "buffer deadlock prevented" );
             break;
@@ -2723,7 +3265,8 @@ void vlc_input_decoder_FrameNext( vlc_input_decoder_t *p_owner )
 
 size_t vlc_input_decoder_GetFifoSize( vlc_input_decoder_t *p_owner )
 {
-    return block_FifoSize( p_owner->p_fifo );
+    return block_FifoSize( p_owner->p_fifo )
+         + vlc_spsc_fifo_GetBytes( p_owner->p_input );
 }
 
 static bool DecoderHasVbi( decoder_t *dec )
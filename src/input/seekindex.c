@@ -0,0 +1,425 @@
+/*****************************************************************************
+ * seekindex.c: persistent seek index cache
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+# include <utime.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_hash.h>
+#include <vlc_strings.h>
+#include <vlc_stream.h>
+#include <vlc_seekindex.h>
+
+/*
+ * File layout, all integers little endian:
+ *   8 bytes   magic and version
+ *   8 bytes   stream size
+ *   8 bytes   stream modification time
+ *   4 bytes   URL length, followed by the URL
+ *   4 bytes   tag length, followed by the tag
+ *   4 bytes   entries count, followed by the entries
+ */
+static const char magic[8] = { 'V', 'L', 'C', 'S', 'I', 'D', 'X', 1 };
+
+#define ENTRY_SIZE 28
+
+/* Indexes larger than this fraction of the cache are not stored */
+#define MAX_INDEX_SHARE 4
+
+struct seekindex_key
+{
+    const char *url;
+    const char *tag;
+    uint64_t size;
+    uint64_t mtime;
+};
+
+static int GetKey(stream_t *s, const char *tag, struct seekindex_key *key)
+{
+    if (s->psz_url == NULL
+     || vlc_stream_GetSize(s, &key->size)
+     || vlc_stream_GetMTime(s, &key->mtime))
+        return VLC_EGENERIC;
+
+    key->url = s->psz_url;
+    key->tag = tag;
+    return VLC_SUCCESS;
+}
+
+static char *GetCacheDir(void)
+{
+    char *cachedir = config_GetUserDir(VLC_CACHE_DIR);
+    char *dir;
+
+    if (unlikely(cachedir == NULL))
+        return NULL;
+    if (asprintf(&dir, "%s" DIR_SEP "seekindex", cachedir) == -1)
+        dir = NULL;
+    free(cachedir);
+    return dir;
+}
+
+/* Creates the directory and its missing parents */
+static int MakeDir(char *dir)
+{
+    for (char *p = strchr(dir + 1, DIR_SEP_CHAR); p != NULL;
+         p = strchr(p + 1, DIR_SEP_CHAR))
+    {
+        *p = '\0';
+        vlc_mkdir(dir, 0700);
+        *p = DIR_SEP_CHAR;
+    }
+
+    if (vlc_mkdir(dir, 0700) && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+static char *GetCachePath(const char *dir, const struct seekindex_key *key)
+{
+    char hex[VLC_HASH_MD5_DIGEST_HEX_SIZE];
+    uint8_t buf[16];
+    vlc_hash_md5_t md5;
+    char *path;
+
+    vlc_hash_md5_Init(&md5);
+    vlc_hash_md5_Update(&md5, key->tag, strlen(key->tag) + 1);
+    vlc_hash_md5_Update(&md5, key->url, strlen(key->url) + 1);
+    SetQWLE(buf, key->size);
+    SetQWLE(buf + 8, key->mtime);
+    vlc_hash_md5_Update(&md5, buf, sizeof (buf));
+    vlc_hash_FinishHex(&md5, hex);
+
+    if (asprintf(&path, "%s" DIR_SEP "%s.idx", dir, hex) == -1)
+        path = NULL;
+    return path;
+}
+
+static bool ReadString(FILE *file, const char *expected)
+{
+    uint8_t buf[4];
+
+    if (fread(buf, 1, 4, file) != 4)
+        return false;
+
+    size_t len = GetDWLE(buf);
+    if (len != strlen(expected))
+        return false;
+
+    char str[len > 0 ? len : 1];
+    return fread(str, 1, len, file) == len && memcmp(str, expected, len) == 0;
+}
+
+static bool WriteString(FILE *file, const char *str)
+{
+    uint8_t buf[4];
+    size_t len = strlen(str);
+
+    SetDWLE(buf, len);
+    return fwrite(buf, 1, 4, file) == 4 && fwrite(str, 1, len, file) == len;
+}
+
+static ssize_t ReadIndex(FILE *file, const struct seekindex_key *key,
+                         vlc_seekindex_entry_t **entriesp)
+{
+    uint8_t buf[24];
+
+    if (fread(buf, 1, 24, file) != 24
+     || memcmp(buf, magic, sizeof (magic))
+     || GetQWLE(buf + 8) != key->size
+     || GetQWLE(buf + 16) != key->mtime)
+        return -1;
+
+    /* Guard against hash collisions */
+    if (!ReadString(file, key->url) || !ReadString(file, key->tag))
+        return -1;
+
+    if (fread(buf, 1, 4, file) != 4)
+        return -1;
+
+    uint32_t count = GetDWLE(buf);
+    struct stat st;
+    long pos = ftell(file);
+
+    /* Do not trust the count before allocating */
+    if (pos < 0 || fstat(fileno(file), &st)
+     || (uint64_t)count * ENTRY_SIZE != (uint64_t)(st.st_size - pos))
+        return -1;
+
+    vlc_seekindex_entry_t *entries = vlc_alloc(count ? count : 1,
+                                               sizeof (*entries));
+    if (unlikely(entries == NULL))
+        return -1;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t rec[ENTRY_SIZE];
+
+        if (fread(rec, 1, ENTRY_SIZE, file) != ENTRY_SIZE)
+        {
+            free(entries);
+            return -1;
+        }
+        entries[i].i_time = (int64_t)GetQWLE(rec);
+        entries[i].i_offset = GetQWLE(rec + 8);
+        entries[i].i_size = GetDWLE(rec + 16);
+        entries[i].i_track = GetDWLE(rec + 20);
+        entries[i].i_flags = GetDWLE(rec + 24);
+    }
+
+    *entriesp = entries;
+    return count;
+}
+
+static int WriteIndex(FILE *file, const struct seekindex_key *key,
+                      const vlc_seekindex_entry_t *entries, uint32_t count)
+{
+    uint8_t buf[24];
+
+    memcpy(buf, magic, sizeof (magic));
+    SetQWLE(buf + 8, key->size);
+    SetQWLE(buf + 16, key->mtime);
+    if (fwrite(buf, 1, 24, file) != 24
+     || !WriteString(file, key->url) || !WriteString(file, key->tag))
+        return -1;
+
+    SetDWLE(buf, count);
+    if (fwrite(buf, 1, 4, file) != 4)
+        return -1;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t rec[ENTRY_SIZE];
+
+        SetQWLE(rec, entries[i].i_time);
+        SetQWLE(rec + 8, entries[i].i_offset);
+        SetDWLE(rec + 16, entries[i].i_size);
+        SetDWLE(rec + 20, entries[i].i_track);
+        SetDWLE(rec + 24, entries[i].i_flags);
+        if (fwrite(rec, 1, ENTRY_SIZE, file) != ENTRY_SIZE)
+            return -1;
+    }
+    return 0;
+}
+
+#undef vlc_seekindex_Load
+ssize_t vlc_seekindex_Load(vlc_object_t *obj, stream_t *s, const char *tag,
+                           vlc_seekindex_entry_t **entries)
+{
+    struct seekindex_key key;
+
+    if (!var_InheritBool(obj, "seekindex-cache")
+     || GetKey(s, tag, &key))
+        return -1;
+
+    char *dir = GetCacheDir();
+    if (unlikely(dir == NULL))
+        return -1;
+
+    char *path = GetCachePath(dir, &key);
+    free(dir);
+    if (unlikely(path == NULL))
+        return -1;
+
+    ssize_t count = -1;
+    FILE *file = vlc_fopen(path, "rb");
+    if (file != NULL)
+    {
+        count = ReadIndex(file, &key, entries);
+        fclose(file);
+
+        if (count >= 0)
+        {
+            msg_Dbg(obj, "loaded %zd seek index entries from %s", count,
+                    path);
+#ifndef _WIN32
+            /* Mark as recently used for the eviction */
+            utime(path, NULL);
+#endif
+        }
+        else
+        {
+            msg_Warn(obj, "discarding invalid seek index %s", path);
+            vlc_unlink(path);
+        }
+    }
+
+    free(path);
+    return count;
+}
+
+struct cache_file
+{
+    char *name;
+    off_t size;
+    time_t mtime;
+};
+
+static int CompareAge(const void *a, const void *b)
+{
+    const struct cache_file *fa = a, *fb = b;
+
+    return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+/* Evicts the least recently used indexes until the cache fits its limit */
+static void Evict(vlc_object_t *obj, const char *dir, uint64_t limit)
+{
+    vlc_DIR *handle = vlc_opendir(dir);
+    if (handle == NULL)
+        return;
+
+    struct cache_file *files = NULL;
+    size_t count = 0, alloc = 0;
+    uint64_t total = 0;
+    const char *name;
+
+    while ((name = vlc_readdir(handle)) != NULL)
+    {
+        size_t len = strlen(name);
+        char *path;
+        struct stat st;
+
+        if (len < 4 || strcmp(name + len - 4, ".idx"))
+            continue;
+        if (asprintf(&path, "%s" DIR_SEP "%s", dir, name) == -1)
+            break;
+        if (vlc_stat(path, &st))
+        {
+            free(path);
+            continue;
+        }
+
+        if (count == alloc)
+        {
+            size_t n = alloc ? alloc * 2 : 64;
+            struct cache_file *tab = realloc(files, n * sizeof (*files));
+            if (unlikely(tab == NULL))
+            {
+                free(path);
+                break;
+            }
+            files = tab;
+            alloc = n;
+        }
+        files[count].name = path;
+        files[count].size = st.st_size;
+        files[count].mtime = st.st_mtime;
+        count++;
+        total += st.st_size;
+    }
+    vlc_closedir(handle);
+
+    if (total > limit)
+    {
+        qsort(files, count, sizeof (*files), CompareAge);
+
+        for (size_t i = 0; i < count && total > limit; i++)
+        {
+            msg_Dbg(obj, "evicting seek index %s", files[i].name);
+            if (vlc_unlink(files[i].name) == 0)
+                total -= files[i].size;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+        free(files[i].name);
+    free(files);
+}
+
+#undef vlc_seekindex_Store
+int vlc_seekindex_Store(vlc_object_t *obj, stream_t *s, const char *tag,
+                        const vlc_seekindex_entry_t *entries, size_t count)
+{
+    struct seekindex_key key;
+
+    if (!var_InheritBool(obj, "seekindex-cache")
+     || GetKey(s, tag, &key))
+        return VLC_EGENERIC;
+
+    uint64_t limit = (uint64_t)var_InheritInteger(obj, "seekindex-cache-size")
+                     << 20;
+    if (count > UINT32_MAX
+     || (uint64_t)count * ENTRY_SIZE > limit / MAX_INDEX_SHARE)
+    {
+        msg_Dbg(obj, "seek index too large to be cached");
+        return VLC_EGENERIC;
+    }
+
+    char *dir = GetCacheDir();
+    if (unlikely(dir == NULL))
+        return VLC_ENOMEM;
+
+    int ret = VLC_EGENERIC;
+    char *path = GetCachePath(dir, &key);
+    char *tmppath = NULL;
+    if (unlikely(path == NULL)
+     || asprintf(&tmppath, "%s.tmp", path) == -1)
+    {
+        tmppath = NULL;
+        ret = VLC_ENOMEM;
+        goto out;
+    }
+
+    if (MakeDir(dir))
+    {
+        msg_Warn(obj, "cannot create %s: %s", dir, vlc_strerror_c(errno));
+        goto out;
+    }
+
+    /* Write to a temporary file, so that readers never see partial data */
+    FILE *file = vlc_fopen(tmppath, "wb");
+    if (file == NULL)
+    {
+        msg_Warn(obj, "cannot create %s: %s", tmppath, vlc_strerror_c(errno));
+        goto out;
+    }
+
+    int val = WriteIndex(file, &key, entries, count);
+    if (fclose(file))
+        val = -1;
+    if (val || vlc_rename(tmppath, path))
+    {
+        msg_Warn(obj, "cannot write %s: %s", path, vlc_strerror_c(errno));
+        vlc_unlink(tmppath);
+        goto out;
+    }
+
+    msg_Dbg(obj, "stored %zu seek index entries to %s", count, path);
+    Evict(obj, dir, limit);
+    ret = VLC_SUCCESS;
+out:
+    free(tmppath);
+    free(path);
+    free(dir);
+    return ret;
+}
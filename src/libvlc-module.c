@@ -701,6 +701,16 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define SEEKINDEX_CACHE_TEXT N_("Cache seek indexes")
+#define SEEKINDEX_CACHE_LONGTEXT N_( \
+    "Save the indexes that demuxers have to build by scanning files with " \
+    "a missing or broken index, and reuse them the next time." )
+
+#define SEEKINDEX_CACHE_SIZE_TEXT N_("Seek indexes cache size (MiB)")
+#define SEEKINDEX_CACHE_SIZE_LONGTEXT N_( \
+    "Maximum disk space used by the cached seek indexes. The least " \
+    "recently used indexes are removed first." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -906,6 +916,11 @@ static const char* const ppsz_restore_playback_desc[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the HTTP clients. " \
+    "0 uses one thread per CPU." )
+
 #define HTTPS_PORT_TEXT N_( "HTTPS server port" )
 #define HTTPS_PORT_LONGTEXT N_( \
     "The HTTPS server will listen on this TCP port. " \
@@ -1001,6 +1016,12 @@ static const char* const ppsz_restore_playback_desc[] = {
     "VLC will fallback automatically to software decoders in case of " \
     "hardware decoder failure." )
 
+#define PACKETIZER_THREAD_TEXT N_("Packetize in a separate thread")
+#define PACKETIZER_THREAD_LONGTEXT N_( \
+    "Run the packetizer of each elementary stream in its own thread, " \
+    "pipelined with the decoder. This helps with high bitrate streams " \
+    "where parsing takes a significant share of the decoding time." )
+
 #define DEC_DEV_TEXT N_("Preferred decoder hardware device")
 #define DEC_DEV_LONGTEXT N_("This allows hardware decoding when available.")
 
@@ -1854,6 +1875,11 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT )
         change_safe ()
+    add_bool( "seekindex-cache", true,
+              SEEKINDEX_CACHE_TEXT, SEEKINDEX_CACHE_LONGTEXT )
+    add_integer_with_range( "seekindex-cache-size", 64, 0, 4096,
+                            SEEKINDEX_CACHE_SIZE_TEXT,
+                            SEEKINDEX_CACHE_SIZE_LONGTEXT )
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT )
 
@@ -1890,6 +1916,8 @@ vlc_module_begin ()
     add_string( "http-host", NULL, HTTP_HOST_TEXT, HOST_LONGTEXT )
     add_integer( "http-port", 8080, HTTP_PORT_TEXT, HTTP_PORT_LONGTEXT )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 1, HTTP_THREADS_TEXT, HTTP_THREADS_LONGTEXT )
+        change_integer_range( 0, 16 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT )
         change_integer_range( 1, 65535 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT )
@@ -2004,6 +2032,8 @@ vlc_module_begin ()
 
     add_string( "codec", "any", CODEC_TEXT, CODEC_LONGTEXT )
     add_bool( "hw-dec", true, HW_DEC_TEXT, HW_DEC_LONGTEXT )
+    add_bool( "packetizer-thread", false, PACKETIZER_THREAD_TEXT,
+              PACKETIZER_THREAD_LONGTEXT )
     add_obsolete_string( "encoder" ) /* since 4.0.0 */
     add_module("dec-dev", "decoder device", "any", DEC_DEV_TEXT, DEC_DEV_LONGTEXT)
 
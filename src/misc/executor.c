@@ -29,6 +29,21 @@
 #include <vlc_threads.h>
 #include "libvlc.h"
 
+/**
+ * Queue of runnables owned by one executor thread.
+ *
+ * Runnables are pushed to the queue of one thread, and taken either by that
+ * thread or, when it is busy, stolen by an idle thread. Each queue has its own
+ * lock, so that submitting, taking and canceling tasks do not contend on a
+ * single executor-wide lock.
+ */
+struct vlc_executor_deque {
+    vlc_mutex_t lock;
+
+    /** One list of vlc_runnable per priority */
+    struct vlc_list queues[VLC_EXECUTOR_PRIORITY_COUNT];
+};
+
 /**
  * An executor can spawn several threads.
  *
@@ -44,8 +59,8 @@ struct vlc_executor_thread {
     /** The system thread */
     vlc_thread_t thread;
 
-    /** The current task executed by the thread, NULL if none */
-    struct vlc_runnable *current_task;
+    /** Index of the thread, and of its queue in vlc_executor.deques */
+    unsigned index;
 };
 
 /**
@@ -53,6 +68,7 @@ struct vlc_executor_thread {
  * header).
  */
 struct vlc_executor {
+    /** Protects threads, closing and the waits below */
     vlc_mutex_t lock;
 
     /** Maximum number of threads to run the tasks */
@@ -62,57 +78,142 @@ struct vlc_executor {
     struct vlc_list threads;
 
     /** Thread count (in a separate field to quickly compare to max_threads) */
-    unsigned nthreads;
+    atomic_uint nthreads;
 
     /* Number of tasks requested but not finished. */
-    unsigned unfinished;
+    atomic_uint unfinished;
 
     /** Wait for the executor to be idle (i.e. unfinished == 0) */
     vlc_cond_t idle_wait;
 
-    /** Queue of vlc_runnable */
-    struct vlc_list queue;
+    /** Queues of vlc_runnable, one per (possible) thread */
+    struct vlc_executor_deque *deques;
 
-    /** Wait for the queue to be non-empty */
+    /** Number of queued runnables, per priority */
+    atomic_uint pending[VLC_EXECUTOR_PRIORITY_COUNT];
+
+    /** Number of threads waiting for runnables to be queued */
+    atomic_uint sleepers;
+
+    /** Next queue to submit to, from outside the executor threads */
+    atomic_uint next_deque;
+
+    /** Wait for a runnable to be queued */
     vlc_cond_t queue_wait;
 
     /** True if executor deletion is requested */
     bool closing;
 };
 
+/** The executor thread running on the current thread, if any */
+static thread_local struct vlc_executor_thread *current_thread;
+
 static void
-QueuePush(vlc_executor_t *executor, struct vlc_runnable *runnable)
+DequePush(vlc_executor_t *executor, struct vlc_executor_deque *deque,
+          struct vlc_runnable *runnable)
 {
-    vlc_mutex_assert(&executor->lock);
-
-    vlc_list_append(&runnable->node, &executor->queue);
-    vlc_cond_signal(&executor->queue_wait);
+    vlc_mutex_lock(&deque->lock);
+    runnable->deque = deque;
+    vlc_list_append(&runnable->node, &deque->queues[runnable->priority]);
+    atomic_fetch_add(&executor->pending[runnable->priority], 1);
+    vlc_mutex_unlock(&deque->lock);
 }
 
 static struct vlc_runnable *
-QueueTake(vlc_executor_t *executor)
+DequeTake(vlc_executor_t *executor, struct vlc_executor_deque *deque,
+          enum vlc_executor_priority priority)
 {
-    vlc_mutex_assert(&executor->lock);
-
-    while (!executor->closing && vlc_list_is_empty(&executor->queue))
-        vlc_cond_wait(&executor->queue_wait, &executor->lock);
-
-    if (executor->closing)
-        return NULL;
+    vlc_mutex_lock(&deque->lock);
 
     struct vlc_runnable *runnable =
-        vlc_list_first_entry_or_null(&executor->queue, struct vlc_runnable,
-                                     node);
-    assert(runnable);
-    vlc_list_remove(&runnable->node);
+        vlc_list_first_entry_or_null(&deque->queues[priority],
+                                     struct vlc_runnable, node);
+    if (runnable)
+    {
+        vlc_list_remove(&runnable->node);
 
-    /* Set links to NULL to know that it has been taken by a thread in
-     * vlc_executor_Cancel() */
-    runnable->node.prev = runnable->node.next = NULL;
+        /* Set links to NULL to know that it has been taken by a thread in
+         * vlc_executor_Cancel() */
+        runnable->node.prev = runnable->node.next = NULL;
+        atomic_fetch_sub(&executor->pending[priority], 1);
+    }
 
+    vlc_mutex_unlock(&deque->lock);
     return runnable;
 }
 
+static bool
+HasPending(vlc_executor_t *executor)
+{
+    for (int i = 0; i < VLC_EXECUTOR_PRIORITY_COUNT; ++i)
+        if (atomic_load(&executor->pending[i]))
+            return true;
+    return false;
+}
+
+/**
+ * Take the next runnable to execute, without waiting.
+ *
+ * The runnables of the highest priority are taken first, from the thread's own
+ * queue if possible, or stolen from the queues of the other threads.
+ */
+static struct vlc_runnable *
+QueueTake(vlc_executor_t *executor, struct vlc_executor_thread *thread)
+{
+    for (int prio = VLC_EXECUTOR_PRIORITY_COUNT - 1; prio >= 0; --prio)
+    {
+        if (!atomic_load_explicit(&executor->pending[prio],
+                                  memory_order_relaxed))
+            continue;
+
+        for (unsigned i = 0; i < executor->max_threads; ++i)
+        {
+            unsigned index = (thread->index + i) % executor->max_threads;
+            struct vlc_runnable *runnable =
+                DequeTake(executor, &executor->deques[index], prio);
+            if (runnable)
+                return runnable;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Wait for runnables to be queued.
+ *
+ * \retval true if there may be queued runnables
+ * \retval false if the executor is closing
+ */
+static bool
+QueueWait(vlc_executor_t *executor)
+{
+    vlc_mutex_lock(&executor->lock);
+
+    /* Submitters check sleepers after queuing, and this checks the queues
+     * after registering as a sleeper: either side sees the other. */
+    atomic_fetch_add(&executor->sleepers, 1);
+    while (!executor->closing && !HasPending(executor))
+        vlc_cond_wait(&executor->queue_wait, &executor->lock);
+    atomic_fetch_sub(&executor->sleepers, 1);
+
+    bool closing = executor->closing;
+    vlc_mutex_unlock(&executor->lock);
+    return !closing;
+}
+
+static void
+TaskFinished(vlc_executor_t *executor)
+{
+    unsigned unfinished = atomic_fetch_sub(&executor->unfinished, 1);
+    assert(unfinished > 0);
+    if (unfinished == 1)
+    {
+        vlc_mutex_lock(&executor->lock);
+        vlc_cond_broadcast(&executor->idle_wait);
+        vlc_mutex_unlock(&executor->lock);
+    }
+}
+
 static void *
 ThreadRun(void *userdata)
 {
@@ -120,46 +221,45 @@ ThreadRun(void *userdata)
     vlc_executor_t *executor = thread->owner;
 
     vlc_thread_set_name("vlc-exec-runner");
+    current_thread = thread;
 
-    vlc_mutex_lock(&executor->lock);
-
-    struct vlc_runnable *runnable;
-    /* When the executor is closing, QueueTake() returns NULL */
-    while ((runnable = QueueTake(executor)))
+    for (;;)
     {
-        thread->current_task = runnable;
-        vlc_mutex_unlock(&executor->lock);
-
-        /* Execute the user-provided runnable, without the executor lock */
+        struct vlc_runnable *runnable = QueueTake(executor, thread);
+        if (!runnable)
+        {
+            /* When the executor is closing, QueueWait() returns false */
+            if (!QueueWait(executor))
+                break;
+            continue;
+        }
+
+        /* Execute the user-provided runnable, without any executor lock */
         runnable->run(runnable->userdata);
 
-        vlc_mutex_lock(&executor->lock);
-        thread->current_task = NULL;
-
         vlc_thread_set_name("vlc-exec-runner");
 
-        assert(executor->unfinished > 0);
-        --executor->unfinished;
-        if (!executor->unfinished)
-            vlc_cond_signal(&executor->idle_wait);
+        TaskFinished(executor);
     }
 
-    vlc_mutex_unlock(&executor->lock);
-
     return NULL;
 }
 
 static int
 SpawnThread(vlc_executor_t *executor)
 {
-    assert(executor->nthreads < executor->max_threads);
+    vlc_mutex_assert(&executor->lock);
+
+    unsigned nthreads = atomic_load_explicit(&executor->nthreads,
+                                             memory_order_relaxed);
+    assert(nthreads < executor->max_threads);
 
     struct vlc_executor_thread *thread = malloc(sizeof(*thread));
     if (!thread)
         return VLC_ENOMEM;
 
     thread->owner = executor;
-    thread->current_task = NULL;
+    thread->index = nthreads;
 
     if (vlc_clone(&thread->thread, ThreadRun, thread))
     {
@@ -167,7 +267,7 @@ SpawnThread(vlc_executor_t *executor)
         return VLC_EGENERIC;
     }
 
-    executor->nthreads++;
+    atomic_store(&executor->nthreads, nthreads + 1);
     vlc_list_append(&thread->node, &executor->threads);
 
     return VLC_SUCCESS;
@@ -181,14 +281,32 @@ vlc_executor_New(unsigned max_threads)
     if (!executor)
         return NULL;
 
+    executor->deques = vlc_alloc(max_threads, sizeof(*executor->deques));
+    if (!executor->deques)
+    {
+        free(executor);
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < max_threads; ++i)
+    {
+        struct vlc_executor_deque *deque = &executor->deques[i];
+        vlc_mutex_init(&deque->lock);
+        for (int prio = 0; prio < VLC_EXECUTOR_PRIORITY_COUNT; ++prio)
+            vlc_list_init(&deque->queues[prio]);
+    }
+
     vlc_mutex_init(&executor->lock);
 
     executor->max_threads = max_threads;
-    executor->nthreads = 0;
-    executor->unfinished = 0;
+    atomic_init(&executor->nthreads, 0);
+    atomic_init(&executor->unfinished, 0);
+    atomic_init(&executor->sleepers, 0);
+    atomic_init(&executor->next_deque, 0);
+    for (int prio = 0; prio < VLC_EXECUTOR_PRIORITY_COUNT; ++prio)
+        atomic_init(&executor->pending[prio], 0);
 
     vlc_list_init(&executor->threads);
-    vlc_list_init(&executor->queue);
 
     vlc_cond_init(&executor->idle_wait);
     vlc_cond_init(&executor->queue_wait);
@@ -196,9 +314,12 @@ vlc_executor_New(unsigned max_threads)
     executor->closing = false;
 
     /* Create one thread on init so that vlc_executor_Submit() may never fail */
+    vlc_mutex_lock(&executor->lock);
     int ret = SpawnThread(executor);
+    vlc_mutex_unlock(&executor->lock);
     if (ret != VLC_SUCCESS)
     {
+        free(executor->deques);
         free(executor);
         return NULL;
     }
@@ -207,26 +328,61 @@ vlc_executor_New(unsigned max_threads)
 }
 
 void
-vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable)
+vlc_executor_SubmitPriority(vlc_executor_t *executor,
+                            struct vlc_runnable *runnable,
+                            enum vlc_executor_priority priority)
 {
-    vlc_mutex_lock(&executor->lock);
-
     assert(!executor->closing);
+    assert(priority < VLC_EXECUTOR_PRIORITY_COUNT);
 
-    QueuePush(executor, runnable);
+    unsigned unfinished = atomic_fetch_add(&executor->unfinished, 1) + 1;
+    unsigned nthreads = atomic_load(&executor->nthreads);
 
-    if (++executor->unfinished > executor->nthreads
-            && executor->nthreads < executor->max_threads)
-        /* If it fails, this is not an error, there is at least one thread */
-        SpawnThread(executor);
+    /* Tasks submitted by a task go to the queue of the current thread, other
+     * tasks are spread over the queues of all threads */
+    unsigned index;
+    struct vlc_executor_thread *thread = current_thread;
+    if (thread && thread->owner == executor)
+        index = thread->index;
+    else
+        index = atomic_fetch_add_explicit(&executor->next_deque, 1,
+                                          memory_order_relaxed) % nthreads;
 
-    vlc_mutex_unlock(&executor->lock);
+    runnable->priority = priority;
+    DequePush(executor, &executor->deques[index], runnable);
+
+    if (atomic_load(&executor->sleepers))
+    {
+        vlc_mutex_lock(&executor->lock);
+        vlc_cond_signal(&executor->queue_wait);
+        vlc_mutex_unlock(&executor->lock);
+    }
+
+    if (unfinished > nthreads && nthreads < executor->max_threads)
+    {
+        vlc_mutex_lock(&executor->lock);
+        if (atomic_load(&executor->nthreads) < executor->max_threads)
+            /* If it fails, this is not an error, there is at least one
+             * thread */
+            SpawnThread(executor);
+        vlc_mutex_unlock(&executor->lock);
+    }
+}
+
+void
+vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable)
+{
+    vlc_executor_SubmitPriority(executor, runnable,
+                                VLC_EXECUTOR_PRIORITY_NORMAL);
 }
 
 bool
 vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable)
 {
-    vlc_mutex_lock(&executor->lock);
+    /* The queue of a runnable does not change until it is taken, so only the
+     * lock of that queue is needed */
+    struct vlc_executor_deque *deque = runnable->deque;
+    vlc_mutex_lock(&deque->lock);
 
     /* Either both prev and next are set, either both are NULL */
     assert(!runnable->node.prev == !runnable->node.next);
@@ -235,14 +391,14 @@ vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable)
     if (in_queue)
     {
         vlc_list_remove(&runnable->node);
-
-        assert(executor->unfinished > 0);
-        --executor->unfinished;
-        if (!executor->unfinished)
-            vlc_cond_signal(&executor->idle_wait);
+        runnable->node.prev = runnable->node.next = NULL;
+        atomic_fetch_sub(&executor->pending[runnable->priority], 1);
     }
 
-    vlc_mutex_unlock(&executor->lock);
+    vlc_mutex_unlock(&deque->lock);
+
+    if (in_queue)
+        TaskFinished(executor);
 
     return in_queue;
 }
@@ -251,7 +407,7 @@ void
 vlc_executor_WaitIdle(vlc_executor_t *executor)
 {
     vlc_mutex_lock(&executor->lock);
-    while (executor->unfinished)
+    while (atomic_load(&executor->unfinished))
         vlc_cond_wait(&executor->idle_wait, &executor->lock);
     vlc_mutex_unlock(&executor->lock);
 }
@@ -264,7 +420,7 @@ vlc_executor_Delete(vlc_executor_t *executor)
     executor->closing = true;
 
     /* All the tasks must be canceled on delete */
-    assert(vlc_list_is_empty(&executor->queue));
+    assert(!HasPending(executor));
 
     vlc_mutex_unlock(&executor->lock);
 
@@ -282,11 +438,12 @@ vlc_executor_Delete(vlc_executor_t *executor)
         free(thread);
     }
 
-    /* The queue must still be empty (no runnable submitted a new runnable) */
-    assert(vlc_list_is_empty(&executor->queue));
+    /* The queues must still be empty (no runnable submitted a new runnable) */
+    assert(!HasPending(executor));
 
     /* There are no tasks anymore */
-    assert(!executor->unfinished);
+    assert(!atomic_load(&executor->unfinished));
 
+    free(executor->deques);
     free(executor);
 }
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include "libvlc.h"
 
@@ -141,3 +142,222 @@ block_t *vlc_fifo_Show( block_fifo_t *p_fifo )
 
     return b;
 }
+
+/*** Single-producer single-consumer FIFO ***/
+
+#define SPSC_FIFO_SIZE 256
+
+struct vlc_spsc_fifo
+{
+    /* Ring of blocks, written by the producer and read by the consumer */
+    vlc_frame_t *ring[SPSC_FIFO_SIZE];
+    atomic_size_t head; /**< Next slot to read, written by the consumer */
+    atomic_size_t tail; /**< Next slot to write, written by the producer */
+
+    /* Blocks queued while the ring was full. Once this list is not empty, the
+     * producer appends to it until the consumer takes the whole list, so that
+     * the order of the blocks is preserved. */
+    vlc_mutex_t overflow_lock;
+    vlc_frame_t *overflow;
+    vlc_frame_t **overflow_last;
+    atomic_bool overflowing;
+
+    /* Blocks taken from the overflow list, private to the consumer */
+    vlc_frame_t *taken;
+
+    /* Accounting: each counter has a single writer, so that no read-modify-
+     * write operation is needed */
+    atomic_size_t in_count; /**< Blocks queued, written by the producer */
+    atomic_size_t in_bytes;
+    atomic_size_t out_count; /**< Blocks dequeued, written by the consumer */
+    atomic_size_t out_bytes;
+
+    /* Consumer sleep and wake-up */
+    atomic_uint seq;
+    atomic_bool sleeping;
+    atomic_bool woken;
+};
+
+vlc_spsc_fifo_t *vlc_spsc_fifo_New(void)
+{
+    vlc_spsc_fifo_t *fifo = malloc(sizeof (*fifo));
+
+    if (likely(fifo != NULL)) {
+        atomic_init(&fifo->head, 0);
+        atomic_init(&fifo->tail, 0);
+        vlc_mutex_init(&fifo->overflow_lock);
+        fifo->overflow = NULL;
+        fifo->overflow_last = &fifo->overflow;
+        atomic_init(&fifo->overflowing, false);
+        fifo->taken = NULL;
+        atomic_init(&fifo->in_count, 0);
+        atomic_init(&fifo->in_bytes, 0);
+        atomic_init(&fifo->out_count, 0);
+        atomic_init(&fifo->out_bytes, 0);
+        atomic_init(&fifo->seq, 0);
+        atomic_init(&fifo->sleeping, false);
+        atomic_init(&fifo->woken, false);
+    }
+
+    return fifo;
+}
+
+void vlc_spsc_fifo_Delete(vlc_spsc_fifo_t *fifo)
+{
+    vlc_frame_t *frame;
+
+    while ((frame = vlc_spsc_fifo_TryGet(fifo)) != NULL)
+        vlc_frame_Release(frame);
+    free(fifo);
+}
+
+static void SpscPush(vlc_spsc_fifo_t *fifo, vlc_frame_t *frame)
+{
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_relaxed);
+
+    if (!atomic_load_explicit(&fifo->overflowing, memory_order_relaxed)
+     && tail - atomic_load_explicit(&fifo->head, memory_order_acquire)
+            < SPSC_FIFO_SIZE) {
+        fifo->ring[tail % SPSC_FIFO_SIZE] = frame;
+        atomic_store_explicit(&fifo->tail, tail + 1, memory_order_release);
+        return;
+    }
+
+    vlc_mutex_lock(&fifo->overflow_lock);
+    *fifo->overflow_last = frame;
+    fifo->overflow_last = &frame->p_next;
+    atomic_store(&fifo->overflowing, true);
+    vlc_mutex_unlock(&fifo->overflow_lock);
+}
+
+void vlc_spsc_fifo_Put(vlc_spsc_fifo_t *fifo, vlc_frame_t *frame)
+{
+    size_t count = atomic_load_explicit(&fifo->in_count, memory_order_relaxed);
+    size_t bytes = atomic_load_explicit(&fifo->in_bytes, memory_order_relaxed);
+
+    while (frame != NULL) {
+        vlc_frame_t *next = frame->p_next;
+
+        frame->p_next = NULL;
+        /* Account before publishing, so that out_count <= in_count */
+        atomic_store_explicit(&fifo->in_count, ++count, memory_order_relaxed);
+        atomic_store_explicit(&fifo->in_bytes, bytes += frame->i_buffer,
+                              memory_order_relaxed);
+        SpscPush(fifo, frame);
+        frame = next;
+    }
+
+    /* Pairs with the fence in vlc_spsc_fifo_Get(): either the consumer sees
+     * the new blocks, or this sees that the consumer is sleeping. Only the
+     * first producer call after the consumer fell asleep wakes it up. */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&fifo->sleeping, memory_order_relaxed)
+     && atomic_exchange(&fifo->sleeping, false)) {
+        atomic_fetch_add(&fifo->seq, 1);
+        vlc_atomic_notify_one(&fifo->seq);
+    }
+}
+
+vlc_frame_t *vlc_spsc_fifo_TryGet(vlc_spsc_fifo_t *fifo)
+{
+    vlc_frame_t *frame = fifo->taken;
+
+    if (frame == NULL) {
+        size_t head = atomic_load_explicit(&fifo->head, memory_order_relaxed);
+
+        if (head != atomic_load_explicit(&fifo->tail, memory_order_acquire)) {
+            frame = fifo->ring[head % SPSC_FIFO_SIZE];
+            atomic_store_explicit(&fifo->head, head + 1,
+                                  memory_order_release);
+            goto out;
+        }
+
+        if (!atomic_load(&fifo->overflowing))
+            return NULL;
+
+        vlc_mutex_lock(&fifo->overflow_lock);
+        /* The producer may have filled the ring, then started the overflow
+         * list, since the ring was seen empty. The ring frames are older,
+         * and the producer does not add to the ring while overflowing. */
+        if (head != atomic_load_explicit(&fifo->tail, memory_order_acquire)) {
+            vlc_mutex_unlock(&fifo->overflow_lock);
+            frame = fifo->ring[head % SPSC_FIFO_SIZE];
+            atomic_store_explicit(&fifo->head, head + 1,
+                                  memory_order_release);
+            goto out;
+        }
+
+        /* The ring is empty: the overflow list is the oldest data, and the
+         * producer cannot fill the ring until it is taken. */
+        frame = fifo->overflow;
+        fifo->overflow = NULL;
+        fifo->overflow_last = &fifo->overflow;
+        atomic_store(&fifo->overflowing, false);
+        vlc_mutex_unlock(&fifo->overflow_lock);
+        assert(frame != NULL);
+    }
+
+    fifo->taken = frame->p_next;
+    frame->p_next = NULL;
+out:
+    atomic_store_explicit(&fifo->out_count,
+        atomic_load_explicit(&fifo->out_count, memory_order_relaxed) + 1,
+        memory_order_release);
+    atomic_store_explicit(&fifo->out_bytes,
+        atomic_load_explicit(&fifo->out_bytes, memory_order_relaxed)
+        + frame->i_buffer, memory_order_release);
+    return frame;
+}
+
+static bool SpscIsEmptyConsumer(vlc_spsc_fifo_t *fifo)
+{
+    return fifo->taken == NULL
+        && atomic_load_explicit(&fifo->head, memory_order_relaxed)
+           == atomic_load_explicit(&fifo->tail, memory_order_acquire)
+        && !atomic_load(&fifo->overflowing);
+}
+
+vlc_frame_t *vlc_spsc_fifo_Get(vlc_spsc_fifo_t *fifo)
+{
+    for (;;) {
+        vlc_frame_t *frame = vlc_spsc_fifo_TryGet(fifo);
+        if (frame != NULL)
+            return frame;
+
+        if (atomic_exchange(&fifo->woken, false))
+            return NULL;
+
+        unsigned seq = atomic_load(&fifo->seq);
+
+        atomic_store_explicit(&fifo->sleeping, true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (SpscIsEmptyConsumer(fifo) && !atomic_load(&fifo->woken))
+            vlc_atomic_wait(&fifo->seq, seq);
+        atomic_store_explicit(&fifo->sleeping, false, memory_order_relaxed);
+    }
+}
+
+void vlc_spsc_fifo_Wake(vlc_spsc_fifo_t *fifo)
+{
+    atomic_store(&fifo->woken, true);
+    atomic_fetch_add(&fifo->seq, 1);
+    vlc_atomic_notify_one(&fifo->seq);
+}
+
+size_t vlc_spsc_fifo_GetCount(const vlc_spsc_fifo_t *fifo)
+{
+    /* Load the dequeued count first: it never exceeds the queued count */
+    size_t out = atomic_load(&fifo->out_count);
+    return atomic_load(&fifo->in_count) - out;
+}
+
+size_t vlc_spsc_fifo_GetBytes(const vlc_spsc_fifo_t *fifo)
+{
+    size_t out = atomic_load(&fifo->out_bytes);
+    return atomic_load(&fifo->in_bytes) - out;
+}
+
+bool vlc_spsc_fifo_IsEmpty(const vlc_spsc_fifo_t *fifo)
+{
+    return vlc_spsc_fifo_GetCount(fifo) == 0;
+}
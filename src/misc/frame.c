@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
 #ifdef _WIN32
@@ -38,6 +39,8 @@
 #include <vlc_atomic.h>
 #include <vlc_frame.h>
 #include <vlc_fs.h>
+#include <vlc_list.h>
+#include <vlc_threads.h>
 
 #include "ancillary.h"
 
@@ -112,6 +115,334 @@ vlc_frame_t *vlc_frame_Init(vlc_frame_t *restrict f, const struct vlc_frame_call
 /** Initial reserved header and footer size. */
 #define VLC_FRAME_PADDING      32
 
+/*
+ * Slab allocator for small and medium frames
+ *
+ * Frames with a capacity up to 64 KiB are allocated in one piece (frame
+ * header and buffer) from power-of-two size classes. Released frames are kept
+ * in a cache of the releasing thread. When a thread cache is full, half of it
+ * goes to a shared depot, where other threads can refill from. Both the
+ * thread caches and the depot are capped, and the excess goes back to the
+ * system allocator.
+ */
+#if defined (HAVE_ALIGNED_ALLOC) && !defined (__SANITIZE_ADDRESS__)
+# define FRAME_SLAB 1
+
+#define SLAB_MIN_SHIFT     8 /* 256 bytes */
+#define SLAB_CLASSES       9 /* up to 64 KiB */
+#define SLAB_CACHE_BYTES   (256 << 10) /* per thread and per class */
+#define SLAB_DEPOT_BYTES   (16 << 20) /* for all threads and classes */
+
+struct vlc_frame_slab
+{
+    vlc_frame_t frame;
+    unsigned size_class;
+};
+
+#define SLAB_HEADER_SIZE \
+    ((sizeof (struct vlc_frame_slab) + VLC_FRAME_ALIGN - 1) \
+     & ~(size_t)(VLC_FRAME_ALIGN - 1))
+
+struct slab_list
+{
+    vlc_frame_t *first; /* linked by p_next */
+    unsigned count;
+};
+
+struct slab_cache
+{
+    struct vlc_list node;
+    struct slab_list lists[SLAB_CLASSES];
+    /* Statistics, written by the owner thread only */
+    atomic_ullong hits;
+    atomic_ullong misses;
+    atomic_size_t bytes;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct slab_list lists[SLAB_CLASSES];
+    size_t bytes;
+    struct vlc_list caches;
+    /* Statistics of the exited threads */
+    unsigned long long hits;
+    unsigned long long misses;
+} slab_depot = {
+    .lock = VLC_STATIC_MUTEX,
+    .caches = VLC_LIST_INITIALIZER(&slab_depot.caches),
+};
+
+static vlc_once_t slab_once = VLC_STATIC_ONCE;
+static vlc_threadvar_t slab_key;
+static bool slab_key_ok;
+static thread_local struct slab_cache *slab_current;
+
+static size_t SlabClassSize(unsigned size_class)
+{
+    return (size_t)1 << (SLAB_MIN_SHIFT + size_class);
+}
+
+static unsigned SlabCacheMax(unsigned size_class)
+{
+    return __MAX(SLAB_CACHE_BYTES / SlabClassSize(size_class), 4);
+}
+
+static vlc_frame_t *SlabPop(struct slab_list *list)
+{
+    vlc_frame_t *frame = list->first;
+
+    if (frame != NULL)
+    {
+        list->first = frame->p_next;
+        list->count--;
+    }
+    return frame;
+}
+
+static void SlabPush(struct slab_list *list, vlc_frame_t *frame)
+{
+    frame->p_next = list->first;
+    list->first = frame;
+    list->count++;
+}
+
+static void SlabFreeList(vlc_frame_t *frame)
+{
+    while (frame != NULL)
+    {
+        vlc_frame_t *next = frame->p_next;
+
+        free(container_of(frame, struct vlc_frame_slab, frame));
+        frame = next;
+    }
+}
+
+static void SlabCacheAddBytes(struct slab_cache *cache, ssize_t delta)
+{
+    size_t bytes = atomic_load_explicit(&cache->bytes, memory_order_relaxed);
+    atomic_store_explicit(&cache->bytes, bytes + delta, memory_order_relaxed);
+}
+
+/* Moves up to count frames from a thread cache list to the depot */
+static void SlabDrain(struct slab_cache *cache, unsigned size_class,
+                      unsigned count)
+{
+    struct slab_list *list = &cache->lists[size_class];
+    const size_t size = SlabClassSize(size_class);
+    vlc_frame_t *excess = NULL;
+
+    vlc_mutex_lock(&slab_depot.lock);
+    while (count-- > 0)
+    {
+        vlc_frame_t *frame = SlabPop(list);
+        if (frame == NULL)
+            break;
+
+        if (slab_depot.bytes + size <= SLAB_DEPOT_BYTES)
+        {
+            SlabPush(&slab_depot.lists[size_class], frame);
+            slab_depot.bytes += size;
+        }
+        else
+        {
+            frame->p_next = excess;
+            excess = frame;
+        }
+        SlabCacheAddBytes(cache, -(ssize_t)size);
+    }
+    vlc_mutex_unlock(&slab_depot.lock);
+
+    SlabFreeList(excess);
+}
+
+/* Moves up to half of a thread cache capacity from the depot */
+static void SlabRefill(struct slab_cache *cache, unsigned size_class)
+{
+    struct slab_list *list = &cache->lists[size_class];
+    struct slab_list *depot = &slab_depot.lists[size_class];
+    const size_t size = SlabClassSize(size_class);
+    unsigned count = SlabCacheMax(size_class) / 2;
+
+    vlc_mutex_lock(&slab_depot.lock);
+    while (count-- > 0)
+    {
+        vlc_frame_t *frame = SlabPop(depot);
+        if (frame == NULL)
+            break;
+
+        slab_depot.bytes -= size;
+        SlabPush(list, frame);
+        SlabCacheAddBytes(cache, size);
+    }
+    vlc_mutex_unlock(&slab_depot.lock);
+}
+
+static void SlabCacheDestroy(void *data)
+{
+    struct slab_cache *cache = data;
+
+    for (unsigned i = 0; i < SLAB_CLASSES; i++)
+        SlabDrain(cache, i, UINT_MAX);
+
+    vlc_mutex_lock(&slab_depot.lock);
+    vlc_list_remove(&cache->node);
+    slab_depot.hits += atomic_load_explicit(&cache->hits,
+                                            memory_order_relaxed);
+    slab_depot.misses += atomic_load_explicit(&cache->misses,
+                                              memory_order_relaxed);
+    vlc_mutex_unlock(&slab_depot.lock);
+
+    if (slab_current == cache)
+        slab_current = NULL;
+    free(cache);
+}
+
+static void SlabInit(void *data)
+{
+    (void) data;
+    slab_key_ok = vlc_threadvar_create(&slab_key, SlabCacheDestroy) == 0;
+}
+
+static struct slab_cache *SlabCacheGet(void)
+{
+    struct slab_cache *cache = slab_current;
+
+    if (likely(cache != NULL))
+        return cache;
+
+    /* The thread-specific variable destroys the cache on thread exit */
+    vlc_once(&slab_once, SlabInit, NULL);
+    if (unlikely(!slab_key_ok))
+        return NULL;
+
+    cache = malloc(sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    for (unsigned i = 0; i < SLAB_CLASSES; i++)
+    {
+        cache->lists[i].first = NULL;
+        cache->lists[i].count = 0;
+    }
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->bytes, 0);
+
+    if (vlc_threadvar_set(slab_key, cache))
+    {
+        free(cache);
+        return NULL;
+    }
+
+    vlc_mutex_lock(&slab_depot.lock);
+    vlc_list_append(&cache->node, &slab_depot.caches);
+    vlc_mutex_unlock(&slab_depot.lock);
+
+    slab_current = cache;
+    return cache;
+}
+
+static void vlc_frame_slab_Release(vlc_frame_t *frame)
+{
+    struct vlc_frame_slab *slab =
+        container_of(frame, struct vlc_frame_slab, frame);
+    struct slab_cache *cache = SlabCacheGet();
+
+    if (unlikely(cache == NULL))
+    {
+        free(slab);
+        return;
+    }
+
+    unsigned size_class = slab->size_class;
+    struct slab_list *list = &cache->lists[size_class];
+
+    if (list->count >= SlabCacheMax(size_class))
+        SlabDrain(cache, size_class, list->count / 2);
+
+    SlabPush(list, frame);
+    SlabCacheAddBytes(cache, SlabClassSize(size_class));
+}
+
+static const struct vlc_frame_callbacks vlc_frame_slab_cbs =
+{
+    vlc_frame_slab_Release,
+};
+
+static vlc_frame_t *vlc_frame_slab_Alloc(size_t capacity)
+{
+    unsigned size_class = 0;
+
+    while (SlabClassSize(size_class) < capacity)
+        if (++size_class >= SLAB_CLASSES)
+            return NULL;
+
+    const size_t size = SlabClassSize(size_class);
+    struct slab_cache *cache = SlabCacheGet();
+    struct vlc_frame_slab *slab = NULL;
+
+    if (likely(cache != NULL))
+    {
+        struct slab_list *list = &cache->lists[size_class];
+
+        if (list->first == NULL)
+            SlabRefill(cache, size_class);
+
+        vlc_frame_t *frame = SlabPop(list);
+        if (frame != NULL)
+        {
+            slab = container_of(frame, struct vlc_frame_slab, frame);
+            SlabCacheAddBytes(cache, -(ssize_t)size);
+        }
+
+        atomic_ullong *counter = (slab != NULL) ? &cache->hits
+                                                : &cache->misses;
+        atomic_store_explicit(counter,
+            atomic_load_explicit(counter, memory_order_relaxed) + 1,
+            memory_order_relaxed);
+    }
+
+    if (slab == NULL)
+    {
+        slab = aligned_alloc(VLC_FRAME_ALIGN, SLAB_HEADER_SIZE + size);
+        if (unlikely(slab == NULL))
+            return NULL;
+        slab->size_class = size_class;
+    }
+
+    return vlc_frame_Init(&slab->frame, &vlc_frame_slab_cbs,
+                          (unsigned char *)slab + SLAB_HEADER_SIZE, size);
+}
+
+void vlc_frame_GetAllocStats(struct vlc_frame_alloc_stats *stats)
+{
+    vlc_mutex_lock(&slab_depot.lock);
+    stats->hits = slab_depot.hits;
+    stats->misses = slab_depot.misses;
+    stats->cached_bytes = slab_depot.bytes;
+
+    struct slab_cache *cache;
+    vlc_list_foreach(cache, &slab_depot.caches, node)
+    {
+        stats->hits += atomic_load_explicit(&cache->hits,
+                                            memory_order_relaxed);
+        stats->misses += atomic_load_explicit(&cache->misses,
+                                              memory_order_relaxed);
+        stats->cached_bytes += atomic_load_explicit(&cache->bytes,
+                                                    memory_order_relaxed);
+    }
+    vlc_mutex_unlock(&slab_depot.lock);
+}
+#else
+void vlc_frame_GetAllocStats(struct vlc_frame_alloc_stats *stats)
+{
+    stats->hits = 0;
+    stats->misses = 0;
+    stats->cached_bytes = 0;
+}
+#endif
+
 vlc_frame_t *vlc_frame_Alloc (size_t size)
 {
     if (unlikely(size >> 28))
@@ -126,6 +457,17 @@ vlc_frame_t *vlc_frame_Alloc (size_t size)
     /* 2 * VLC_FRAME_PADDING: pre + post padding */
     size_t capacity = (2 * VLC_FRAME_PADDING) + size;
     unsigned char *buf;
+
+#ifdef FRAME_SLAB
+    vlc_frame_t *slab = vlc_frame_slab_Alloc(capacity);
+    if (slab != NULL)
+    {
+        /* Header reserve */
+        slab->p_buffer += VLC_FRAME_PADDING;
+        slab->i_buffer = size;
+        return slab;
+    }
+#endif
 #ifdef HAVE_ALIGNED_ALLOC
     capacity += (-size) % VLC_FRAME_ALIGN;
     buf = aligned_alloc(VLC_FRAME_ALIGN, capacity);
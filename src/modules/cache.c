@@ -43,6 +43,9 @@
 
 #include <vlc_plugin.h>
 #include <errno.h>
+#ifdef HAVE_SEARCH_H
+# include <search.h>
+#endif
 
 #include "config/configuration.h"
 
@@ -57,13 +60,103 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 36
+#define CACHE_SUBVERSION_NUM 37
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
 /* Magic for the cache filename */
 #define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
 
+/*
+ * After the magic strings, the cache consists of fixed-size record tables,
+ * and of a pool of nul-terminated strings. The records do not contain any
+ * pointer: strings are referred to by their offset within the pool (or zero
+ * for NULL), and other records by their index within their table. This
+ * way, the file mapping is used in place: strings and integer choices are
+ * never copied, and each plug-in is materialized with a single allocation.
+ */
+
+/** Cache tables header */
+struct vlc_cache_header
+{
+    uint32_t plugins; /**< Number of plug-in records */
+    uint32_t modules; /**< Number of module records */
+    uint32_t params; /**< Number of configuration item records */
+    uint32_t refs; /**< Number of string references */
+    uint32_t ints; /**< Number of integer choices */
+    uint32_t strings; /**< Size of the string pool (bytes) */
+};
+
+/** Plug-in record */
+struct vlc_cache_plugin
+{
+    int64_t mtime; /**< Last modification time */
+    uint64_t size; /**< File size */
+    uint32_t module; /**< Index of the first module record */
+    uint32_t modules_count; /**< Number of module records */
+    uint32_t param; /**< Index of the first configuration item record */
+    uint32_t params_count; /**< Number of configuration item records */
+    uint32_t textdomain;
+    uint32_t path;
+    uint32_t unloadable;
+};
+
+/** Module record */
+struct vlc_cache_module
+{
+    uint32_t shortname;
+    uint32_t longname;
+    uint32_t help;
+    uint32_t help_html;
+    uint32_t shortcut; /**< Index of the first shortcut string reference */
+    uint32_t shortcuts_count;
+    uint32_t activate;
+    uint32_t deactivate;
+    uint32_t capability;
+    int32_t score;
+};
+
+union vlc_cache_value
+{
+    int64_t i;
+    float f;
+    uint32_t str;
+};
+
+#define VLC_CACHE_PARAM_INTERNAL 0x1
+#define VLC_CACHE_PARAM_UNSAVED  0x2
+#define VLC_CACHE_PARAM_SAFE     0x4
+#define VLC_CACHE_PARAM_OBSOLETE 0x8
+
+/** Configuration item record */
+struct vlc_cache_param
+{
+    union vlc_cache_value orig;
+    union vlc_cache_value min;
+    union vlc_cache_value max;
+    uint32_t type_name;
+    uint32_t name;
+    uint32_t text;
+    uint32_t longtext;
+    uint32_t list; /**< Index of the first choice (string reference or integer) */
+    uint32_t list_text; /**< Index of the first choice name string reference */
+    uint16_t list_count;
+    uint8_t type;
+    uint8_t shortname;
+    uint8_t flags;
+};
+
+/** Cache tables, as mapped in memory */
+struct vlc_cache_tables
+{
+    struct vlc_cache_header header;
+    const struct vlc_cache_plugin *plugins;
+    const struct vlc_cache_module *modules;
+    const struct vlc_cache_param *params;
+    const uint32_t *refs;
+    const int *ints;
+    const char *strings;
+};
 
 static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
 {
@@ -76,17 +169,6 @@ static int vlc_cache_load_immediate(void *out, block_t *in, size_t size)
     return 0;
 }
 
-static int vlc_cache_load_bool(bool *out, block_t *in)
-{
-    unsigned char b;
-
-    if (vlc_cache_load_immediate(&b, in, 1) || b > 1)
-        return -1;
-
-    *out = b;
-    return 0;
-}
-
 static int vlc_cache_load_array(const void **p, size_t size, size_t n,
                                 block_t *file)
 {
@@ -110,30 +192,6 @@ static int vlc_cache_load_array(const void **p, size_t size, size_t n,
     return 0;
 }
 
-static int vlc_cache_load_string(const char **restrict p, block_t *file)
-{
-    uint16_t size;
-
-    if (vlc_cache_load_immediate(&size, file, sizeof (size)) || size > 16384)
-        return -1;
-
-    if (size == 0)
-    {
-        *p = NULL;
-        return 0;
-    }
-
-    const char *str = (char *)file->p_buffer;
-
-    if (file->i_buffer < size || str[size - 1] != '\0')
-        return -1;
-
-    file->p_buffer += size;
-    file->i_buffer -= size;
-    *p = str;
-    return 0;
-}
-
 static int vlc_cache_load_align(size_t align, block_t *file)
 {
     assert(align > 0);
@@ -153,17 +211,36 @@ static int vlc_cache_load_align(size_t align, block_t *file)
     return 0;
 }
 
+/* Checks that the records [first, first + count) are within a table */
+static bool vlc_cache_in_range(uint32_t first, uint32_t count, uint32_t total)
+{
+    return count <= total && first <= total - count;
+}
+
+static int vlc_cache_load_string(const struct vlc_cache_tables *t,
+                                 uint32_t offset, const char **restrict p)
+{
+    if (offset >= t->header.strings)
+        return -1;
+
+    *p = (offset != 0) ? t->strings + offset : NULL;
+    return 0;
+}
+
+/* Choices cannot be NULL: offset zero is the empty string. */
+static int vlc_cache_load_choice(const struct vlc_cache_tables *t,
+                                 uint32_t offset, const char **restrict p)
+{
+    if (offset >= t->header.strings)
+        return -1;
+
+    *p = t->strings + offset;
+    return 0;
+}
+
 #define LOAD_IMMEDIATE(a) \
     if (vlc_cache_load_immediate(&(a), file, sizeof (a))) \
         goto error
-#define LOAD_FLAG(a) \
-    do \
-    { \
-        bool b; \
-        if (vlc_cache_load_bool(&b, file)) \
-            goto error; \
-        (a) = b; \
-    } while (0)
 #define LOAD_ARRAY(a,n) \
     do \
     { \
@@ -172,197 +249,299 @@ static int vlc_cache_load_align(size_t align, block_t *file)
             goto error; \
         (a) = base; \
     } while (0)
-#define LOAD_STRING(a) \
-    if (vlc_cache_load_string(&(a), file)) \
-        goto error
 #define LOAD_ALIGNOF(t) \
     if (vlc_cache_load_align(alignof(t), file)) \
         goto error
+#define LOAD_STRING(a,offset) \
+    if (vlc_cache_load_string(t, (offset), &(a))) \
+        goto error
+#define LOAD_CHOICE(a,offset) \
+    if (vlc_cache_load_choice(t, (offset), &(a))) \
+        goto error
 
-static int vlc_cache_load_config(struct vlc_param *param, block_t *file)
+static int vlc_cache_load_tables(struct vlc_cache_tables *t, block_t *file)
 {
-    module_config_t *cfg = &param->item;
+    LOAD_ALIGNOF(struct vlc_cache_header);
+    LOAD_IMMEDIATE(t->header);
+    LOAD_ALIGNOF(struct vlc_cache_plugin);
+    LOAD_ARRAY(t->plugins, t->header.plugins);
+    LOAD_ALIGNOF(struct vlc_cache_module);
+    LOAD_ARRAY(t->modules, t->header.modules);
+    LOAD_ALIGNOF(struct vlc_cache_param);
+    LOAD_ARRAY(t->params, t->header.params);
+    LOAD_ALIGNOF(uint32_t);
+    LOAD_ARRAY(t->refs, t->header.refs);
+    LOAD_ALIGNOF(int);
+    LOAD_ARRAY(t->ints, t->header.ints);
+    LOAD_ARRAY(t->strings, t->header.strings);
+
+    /* The pool starts with an empty string, and ends with a nul, so that
+     * any offset within the pool refers to a nul-terminated string. */
+    if (t->header.strings == 0 || t->strings[0] != '\0'
+     || t->strings[t->header.strings - 1] != '\0' || file->i_buffer > 0)
+        goto error;
+    return 0;
+error:
+    return -1;
+}
 
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (param->shortname);
-    LOAD_FLAG (param->internal);
-    LOAD_FLAG (param->unsaved);
-    LOAD_FLAG (param->safe);
-    LOAD_FLAG (param->obsolete);
-    LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
-    LOAD_STRING (cfg->psz_text);
-    LOAD_STRING (cfg->psz_longtext);
-    LOAD_IMMEDIATE (cfg->list_count);
+static int vlc_cache_load_module(const struct vlc_cache_tables *t,
+                                 const struct vlc_cache_module *rec,
+                                 module_t *module, const char **refs)
+{
+    LOAD_STRING(module->psz_shortname, rec->shortname);
+    LOAD_STRING(module->psz_longname, rec->longname);
+    LOAD_STRING(module->psz_help, rec->help);
+    LOAD_STRING(module->psz_help_html, rec->help_html);
+
+    module->i_shortcuts = rec->shortcuts_count;
+    module->pp_shortcuts = refs;
+    for (unsigned i = 0; i < rec->shortcuts_count; i++)
+        LOAD_STRING(refs[i], t->refs[rec->shortcut + i]);
+
+    LOAD_STRING(module->activate_name, rec->activate);
+    LOAD_STRING(module->deactivate_name, rec->deactivate);
+    LOAD_STRING(module->psz_capability, rec->capability);
+    module->i_score = rec->score;
+    return 0;
+error:
+    return -1;
+}
 
-    if (IsConfigStringType (cfg->i_type))
+static int vlc_cache_load_config(const struct vlc_cache_tables *t,
+                                 const struct vlc_cache_param *rec,
+                                 struct vlc_param *param, const char **refs)
+{
+    module_config_t *cfg = &param->item;
+
+    cfg->i_type = rec->type;
+    param->shortname = rec->shortname;
+    param->internal = (rec->flags & VLC_CACHE_PARAM_INTERNAL) != 0;
+    param->unsaved = (rec->flags & VLC_CACHE_PARAM_UNSAVED) != 0;
+    param->safe = (rec->flags & VLC_CACHE_PARAM_SAFE) != 0;
+    param->obsolete = (rec->flags & VLC_CACHE_PARAM_OBSOLETE) != 0;
+    LOAD_STRING(cfg->psz_type, rec->type_name);
+    LOAD_STRING(cfg->psz_name, rec->name);
+    LOAD_STRING(cfg->psz_text, rec->text);
+    LOAD_STRING(cfg->psz_longtext, rec->longtext);
+    cfg->list_count = rec->list_count;
+
+    if (IsConfigStringType(cfg->i_type))
     {
         const char *psz;
-        LOAD_STRING(psz);
+        LOAD_STRING(psz, rec->orig.str);
         cfg->orig.psz = (char *)psz;
-        atomic_init(&param->value.str, NULL);
-        vlc_param_SetString(param, psz);
 
-        if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        for (unsigned i = 0; i < cfg->list_count; i++)
+        /* The default value is used in place until it is changed, see
+         * vlc_param_SetString(). As there, empty strings are NULL. */
+        char *value = (psz != NULL && psz[0] != '\0') ? (char *)psz : NULL;
+        atomic_init(&param->value.str, value);
+        cfg->value.psz = value;
+
+        if (!vlc_cache_in_range(rec->list, rec->list_count, t->header.refs))
+            goto error;
+
+        if (cfg->list_count > 0)
         {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
-                goto error;
+            cfg->list.psz = refs;
+            for (unsigned i = 0; i < cfg->list_count; i++)
+                LOAD_CHOICE(refs[i], t->refs[rec->list + i]);
+            refs += cfg->list_count;
         }
     }
     else
     {
-        LOAD_IMMEDIATE (cfg->orig);
-        LOAD_IMMEDIATE (cfg->min);
-        LOAD_IMMEDIATE (cfg->max);
         if (IsConfigFloatType(cfg->i_type))
+        {
+            cfg->orig.f = rec->orig.f;
+            cfg->min.f = rec->min.f;
+            cfg->max.f = rec->max.f;
             atomic_store_explicit(&param->value.f, cfg->orig.f,
                                   memory_order_relaxed);
+        }
         else
+        {
+            cfg->orig.i = rec->orig.i;
+            cfg->min.i = rec->min.i;
+            cfg->max.i = rec->max.i;
             atomic_store_explicit(&param->value.i, cfg->orig.i,
                                   memory_order_relaxed);
+        }
         cfg->value = cfg->orig;
 
-        if (cfg->list_count)
-        {
-            LOAD_ALIGNOF(int);
-        }
+        if (!vlc_cache_in_range(rec->list, rec->list_count, t->header.ints))
+            goto error;
 
-        LOAD_ARRAY(cfg->list.i, cfg->list_count);
+        if (cfg->list_count > 0)
+            cfg->list.i = t->ints + rec->list;
     }
 
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
-    for (unsigned i = 0; i < cfg->list_count; i++)
+    if (!vlc_cache_in_range(rec->list_text, rec->list_count, t->header.refs))
+        goto error;
+
+    if (cfg->list_count > 0)
     {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
-            goto error;
+        cfg->list_text = refs;
+        for (unsigned i = 0; i < cfg->list_count; i++)
+            LOAD_CHOICE(refs[i], t->refs[rec->list_text + i]);
     }
-
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1;
 }
 
-static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
+static size_t vlc_cache_align(size_t size, size_t align)
 {
-    uint16_t lines;
+    return (size + align - 1) & ~(align - 1);
+}
 
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE (lines);
+/**
+ * Materializes a plug-in from its cache record.
+ *
+ * The plug-in, its modules, its configuration items, the tables of string
+ * pointers and the absolute path are all allocated in a single block, which
+ * vlc_plugin_destroy() releases with vlc_cache_release().
+ */
+static vlc_plugin_t *vlc_cache_load_plugin(const struct vlc_cache_tables *t,
+                                           const struct vlc_cache_plugin *rec,
+                                           const char *dir)
+{
+    if (!vlc_cache_in_range(rec->module, rec->modules_count, t->header.modules)
+     || !vlc_cache_in_range(rec->param, rec->params_count, t->header.params))
+        return NULL;
 
-    /* Allocate memory */
-    if (lines)
-    {
-        plugin->conf.params = calloc(sizeof (struct vlc_param), lines);
-        if (unlikely(plugin->conf.params == NULL))
-        {
-            plugin->conf.size = 0;
-            return -1;
-        }
-    }
-    else
-        plugin->conf.params = NULL;
+    const char *path;
+    if (vlc_cache_load_string(t, rec->path, &path) || path == NULL)
+        return NULL;
 
-    plugin->conf.size = lines;
+    /* Count the string pointers to materialize */
+    size_t refs_count = 0;
 
-    /* Do the duplication job */
-    for (size_t i = 0; i < lines; i++)
+    for (uint32_t i = 0; i < rec->modules_count; i++)
     {
-        struct vlc_param *param = plugin->conf.params + i;
-        module_config_t *item = &param->item;
-
-        if (vlc_cache_load_config(param, file))
-            return -1;
+        const struct vlc_cache_module *mrec = &t->modules[rec->module + i];
 
-        if (CONFIG_ITEM(item->i_type))
-        {
-            plugin->conf.count++;
-            if (item->i_type == CONFIG_ITEM_BOOL)
-                plugin->conf.booleans++;
-        }
-        param->owner = plugin;
+        if (mrec->shortcuts_count > MODULE_SHORTCUT_MAX
+         || !vlc_cache_in_range(mrec->shortcut, mrec->shortcuts_count,
+                                t->header.refs))
+            return NULL;
+        refs_count += mrec->shortcuts_count;
     }
 
-    return 0;
-error:
-    return -1; /* FIXME: leaks */
-}
+    for (uint32_t i = 0; i < rec->params_count; i++)
+    {
+        const struct vlc_cache_param *prec = &t->params[rec->param + i];
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
-{
-    module_t *module = vlc_module_create(plugin);
-    if (unlikely(module == NULL))
-        return -1;
+        refs_count += prec->list_count;
+        if (IsConfigStringType(prec->type))
+            refs_count += prec->list_count;
+    }
 
-    LOAD_STRING(module->psz_shortname);
-    LOAD_STRING(module->psz_longname);
-    LOAD_STRING(module->psz_help);
-    LOAD_STRING(module->psz_help_html);
+    size_t modules_offset = vlc_cache_align(sizeof (vlc_plugin_t),
+                                            alignof (module_t));
+    size_t params_offset = vlc_cache_align(modules_offset
+                                 + rec->modules_count * sizeof (module_t),
+                                           alignof (struct vlc_param));
+    size_t refs_offset = vlc_cache_align(params_offset
+                             + rec->params_count * sizeof (struct vlc_param),
+                                         alignof (const char *));
+    size_t abspath_offset = refs_offset + refs_count * sizeof (const char *);
+    size_t dirlen = strlen(dir), pathlen = strlen(path);
+
+    unsigned char *base = calloc(1, abspath_offset + dirlen
+                                    + strlen(DIR_SEP) + pathlen + 1);
+    if (unlikely(base == NULL))
+        return NULL;
 
-    LOAD_IMMEDIATE(module->i_shortcuts);
-    if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
-        goto error;
-    else
+    vlc_plugin_t *plugin = (vlc_plugin_t *)base;
+    module_t *modules = (module_t *)(base + modules_offset);
+    struct vlc_param *params = (struct vlc_param *)(base + params_offset);
+    const char **refs = (const char **)(base + refs_offset);
+    char *abspath = (char *)(base + abspath_offset);
+
+    /* Modules are linked in the same order as when described */
+    for (uint32_t i = 0; i < rec->modules_count; i++)
     {
-        module->pp_shortcuts =
-            xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
-        for (unsigned j = 0; j < module->i_shortcuts; j++)
-            LOAD_STRING(module->pp_shortcuts[j]);
-    }
+        const struct vlc_cache_module *mrec = &t->modules[rec->module + i];
+        module_t *module = modules + i;
 
-    LOAD_STRING(module->activate_name);
-    LOAD_STRING(module->deactivate_name);
-    LOAD_STRING(module->psz_capability);
-    LOAD_IMMEDIATE(module->i_score);
-    return 0;
-error:
-    return -1;
-}
+        module->plugin = plugin;
+        module->next = (i + 1 < rec->modules_count) ? module + 1 : NULL;
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
-{
-    vlc_plugin_t *plugin = vlc_plugin_create();
-    if (unlikely(plugin == NULL))
-        return NULL;
+        if (vlc_cache_load_module(t, mrec, module, refs))
+            goto error;
+        refs += mrec->shortcuts_count;
+    }
 
-    uint32_t modules;
-    LOAD_IMMEDIATE(modules);
+    for (uint32_t i = 0; i < rec->params_count; i++)
+    {
+        const struct vlc_cache_param *prec = &t->params[rec->param + i];
+        struct vlc_param *param = params + i;
 
-    for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+        param->owner = plugin;
+        if (vlc_cache_load_config(t, prec, param, refs))
             goto error;
 
-    if (vlc_cache_load_plugin_config(plugin, file))
-        goto error;
+        refs += prec->list_count;
+        if (IsConfigStringType(prec->type))
+            refs += prec->list_count;
 
-    LOAD_STRING(plugin->textdomain);
+        if (CONFIG_ITEM(param->item.i_type))
+        {
+            plugin->conf.count++;
+            if (param->item.i_type == CONFIG_ITEM_BOOL)
+                plugin->conf.booleans++;
+        }
+    }
 
-    const char *path;
-    LOAD_STRING(path);
-    if (path == NULL)
+    plugin->next = NULL;
+    plugin->module = (rec->modules_count > 0) ? modules : NULL;
+    plugin->modules_count = rec->modules_count;
+    if (vlc_cache_load_string(t, rec->textdomain, &plugin->textdomain)
+     || rec->unloadable > 1)
         goto error;
+    plugin->conf.params = (rec->params_count > 0) ? params : NULL;
+    plugin->conf.size = rec->params_count;
+    plugin->unloadable = rec->unloadable;
+    atomic_init(&plugin->handle, 0);
+    plugin->cached = true;
+
+    memcpy(abspath, dir, dirlen);
+    memcpy(abspath + dirlen, DIR_SEP, strlen(DIR_SEP));
+    memcpy(abspath + dirlen + strlen(DIR_SEP), path, pathlen + 1);
+    plugin->abspath = abspath;
+    plugin->path = (char *)path;
+    plugin->mtime = rec->mtime;
+    plugin->size = rec->size;
+    return plugin;
 
-    plugin->path = strdup(path);
-    if (unlikely(plugin->path == NULL))
-        goto error;
+error:
+    free(base);
+    return NULL;
+}
 
-    LOAD_FLAG(plugin->unloadable);
-    LOAD_IMMEDIATE(plugin->mtime);
-    LOAD_IMMEDIATE(plugin->size);
+/**
+ * Releases a plug-in loaded from the plugins cache.
+ */
+void vlc_cache_release(vlc_plugin_t *plugin)
+{
+    assert(plugin->cached);
 
-    if (plugin->textdomain != NULL)
-        vlc_bindtextdomain(plugin->textdomain);
+    /* Only the string values set at run-time were allocated separately. */
+    for (size_t i = 0; i < plugin->conf.size; i++)
+    {
+        struct vlc_param *param = plugin->conf.params + i;
 
-    return plugin;
+        if (IsConfigStringType(param->item.i_type))
+        {
+            char *str = atomic_load_explicit(&param->value.str,
+                                             memory_order_relaxed);
+            if (str != param->item.orig.psz)
+                free(str);
+        }
+    }
 
-error:
-    vlc_plugin_destroy(plugin);
-    return NULL;
+    free(plugin);
 }
 
 /**
@@ -372,6 +551,9 @@ error:
  * will in turn be queried by AllocateAllPlugins() to see if it needs to
  * actually load the dynamically loadable module.
  * This allows us to only fully load plugins when they are actually used.
+ *
+ * The cache file is memory-mapped, and the returned plug-ins refer to it:
+ * the file is kept in the backing chain until the module bank is released.
  */
 vlc_plugin_t *vlc_cache_load(libvlc_int_t *p_this, const char *dir,
                              block_t **backingp)
@@ -444,20 +626,25 @@ vlc_plugin_t *vlc_cache_load(libvlc_int_t *p_this, const char *dir,
         return NULL;
     }
 
+    struct vlc_cache_tables tables;
     vlc_plugin_t *cache = NULL;
+    const char *textdomain = NULL;
+
+    if (vlc_cache_load_tables(&tables, file))
+        goto error;
 
-    while (file->i_buffer > 0)
+    for (uint32_t i = 0; i < tables.header.plugins; i++)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(&tables,
+                                                     &tables.plugins[i], dir);
         if (plugin == NULL)
             goto error;
 
-        if (unlikely(asprintf(&plugin->abspath, "%s" DIR_SEP "%s", dir,
-                              plugin->path) == -1))
+        /* Strings are pooled: most plug-ins share the same text domain. */
+        if (plugin->textdomain != NULL && plugin->textdomain != textdomain)
         {
-            plugin->abspath = NULL;
-            vlc_plugin_destroy(plugin);
-            goto error;
+            vlc_bindtextdomain(plugin->textdomain);
+            textdomain = plugin->textdomain;
         }
 
         plugin->next = cache;
@@ -471,7 +658,13 @@ vlc_plugin_t *vlc_cache_load(libvlc_int_t *p_this, const char *dir,
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
-    /* TODO: cleanup */
+    while (cache != NULL)
+    {
+        vlc_plugin_t *plugin = cache;
+
+        cache = plugin->next;
+        vlc_plugin_destroy(plugin);
+    }
     block_Release(file);
     return NULL;
 }
@@ -479,27 +672,8 @@ error:
 #define SAVE_IMMEDIATE( a ) \
     if (fwrite (&(a), sizeof(a), 1, file) != 1) \
         goto error
-#define SAVE_FLAG(a) \
-    do { \
-        char b = (a); \
-        SAVE_IMMEDIATE(b); \
-    } while (0)
-
-static int CacheSaveString (FILE *file, const char *str)
-{
-    uint16_t size = (str != NULL) ? (strlen (str) + 1) : 0;
-
-    SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite(str, 1, size, file) != size)
-    {
-error:
-        return -1;
-    }
-    return 0;
-}
-
-#define SAVE_STRING( a ) \
-    if (CacheSaveString (file, (a))) \
+#define SAVE_ARRAY(a,n) \
+    if ((n) > 0 && fwrite ((a), sizeof (*(a)), (n), file) != (n)) \
         goto error
 
 static int CacheSaveAlign(FILE *file, size_t align)
@@ -518,89 +692,275 @@ static int CacheSaveAlign(FILE *file, size_t align)
     if (CacheSaveAlign(file, alignof (t))) \
         goto error
 
-static int CacheSaveConfig(FILE *file, const struct vlc_param *param)
+/** Cache tables, as built in memory before saving */
+struct vlc_cache_writer
 {
-    const module_config_t *cfg = &param->item;
+    struct vlc_cache_header header;
+    struct vlc_cache_plugin *plugins;
+    struct vlc_cache_module *modules;
+    struct vlc_cache_param *params;
+    uint32_t *refs;
+    int *ints;
+    char *strings;
+    size_t strings_size; /**< Allocated size of the string pool */
+    void *strings_tree; /**< Pooled strings, for deduplication */
+};
+
+struct vlc_cache_pooled_string
+{
+    const char *str;
+    uint32_t offset;
+};
+
+static int CacheStringCompare(const void *a, const void *b)
+{
+    const struct vlc_cache_pooled_string *sa = a, *sb = b;
+
+    return strcmp(sa->str, sb->str);
+}
+
+static int CacheSaveString(struct vlc_cache_writer *w, const char *str,
+                           uint32_t *restrict offset)
+{
+    if (str == NULL)
+    {
+        *offset = 0;
+        return 0;
+    }
+
+    struct vlc_cache_pooled_string *entry = malloc(sizeof (*entry));
+    if (unlikely(entry == NULL))
+        return -1;
+
+    entry->str = str;
+    entry->offset = w->header.strings;
+
+    void **entryp = tsearch(entry, &w->strings_tree, CacheStringCompare);
+    if (unlikely(entryp == NULL))
+    {
+        free(entry);
+        return -1;
+    }
+
+    if (*entryp != entry)
+    {   /* Already pooled */
+        free(entry);
+        *offset = ((const struct vlc_cache_pooled_string *)*entryp)->offset;
+        return 0;
+    }
+
+    size_t len = strlen(str) + 1;
+
+    if (len > UINT32_MAX - w->header.strings)
+        goto error;
+
+    if (w->header.strings + len > w->strings_size)
+    {
+        size_t size = 2 * (w->header.strings + len);
+        char *strings = realloc(w->strings, size);
+        if (unlikely(strings == NULL))
+            goto error;
 
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (param->shortname);
-    SAVE_FLAG (param->internal);
-    SAVE_FLAG (param->unsaved);
-    SAVE_FLAG (param->safe);
-    SAVE_FLAG (param->obsolete);
-    SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
-    SAVE_STRING (cfg->psz_text);
-    SAVE_STRING (cfg->psz_longtext);
-    SAVE_IMMEDIATE (cfg->list_count);
+        w->strings = strings;
+        w->strings_size = size;
+    }
+
+    memcpy(w->strings + w->header.strings, str, len);
+    w->header.strings += len;
+    *offset = entry->offset;
+    return 0;
+error:
+    tdelete(entry, &w->strings_tree, CacheStringCompare);
+    free(entry);
+    return -1;
+}
+
+#define SAVE_STRING(a,offset) \
+    if (CacheSaveString (w, (a), &(offset))) \
+        goto error
+
+static int CacheSaveConfig(struct vlc_cache_writer *w,
+                           const struct vlc_param *param)
+{
+    const module_config_t *cfg = &param->item;
+    struct vlc_cache_param *rec = &w->params[w->header.params++];
+
+    rec->type = cfg->i_type;
+    rec->shortname = param->shortname;
+    rec->flags = (param->internal ? VLC_CACHE_PARAM_INTERNAL : 0)
+               | (param->unsaved ? VLC_CACHE_PARAM_UNSAVED : 0)
+               | (param->safe ? VLC_CACHE_PARAM_SAFE : 0)
+               | (param->obsolete ? VLC_CACHE_PARAM_OBSOLETE : 0);
+    SAVE_STRING (cfg->psz_type, rec->type_name);
+    SAVE_STRING (cfg->psz_name, rec->name);
+    SAVE_STRING (cfg->psz_text, rec->text);
+    SAVE_STRING (cfg->psz_longtext, rec->longtext);
+    rec->list_count = cfg->list_count;
 
     if (IsConfigStringType (cfg->i_type))
     {
-        SAVE_STRING (cfg->orig.psz);
+        SAVE_STRING (cfg->orig.psz, rec->orig.str);
 
+        rec->list = w->header.refs;
         for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
+            SAVE_STRING (cfg->list.psz[i], w->refs[w->header.refs++]);
     }
     else
     {
-        SAVE_IMMEDIATE (cfg->orig);
-        SAVE_IMMEDIATE (cfg->min);
-        SAVE_IMMEDIATE (cfg->max);
-
-        if (cfg->list_count > 0)
+        if (IsConfigFloatType (cfg->i_type))
         {
-            SAVE_ALIGNOF(int);
+            rec->orig.f = cfg->orig.f;
+            rec->min.f = cfg->min.f;
+            rec->max.f = cfg->max.f;
+        }
+        else
+        {
+            rec->orig.i = cfg->orig.i;
+            rec->min.i = cfg->min.i;
+            rec->max.i = cfg->max.i;
         }
 
+        rec->list = w->header.ints;
         for (unsigned i = 0; i < cfg->list_count; i++)
-             SAVE_IMMEDIATE (cfg->list.i[i]);
+            w->ints[w->header.ints++] = cfg->list.i[i];
     }
+
+    rec->list_text = w->header.refs;
     for (unsigned i = 0; i < cfg->list_count; i++)
-        SAVE_STRING (cfg->list_text[i]);
+        SAVE_STRING (cfg->list_text[i], w->refs[w->header.refs++]);
 
     return 0;
 error:
     return -1;
 }
 
-static int CacheSaveModuleConfig(FILE *file, const vlc_plugin_t *plugin)
+static int CacheSaveModule(struct vlc_cache_writer *w, const module_t *module)
 {
-    uint16_t lines = plugin->conf.size;
+    struct vlc_cache_module *rec = &w->modules[w->header.modules++];
 
-    SAVE_IMMEDIATE (lines);
+    SAVE_STRING(module->psz_shortname, rec->shortname);
+    SAVE_STRING(module->psz_longname, rec->longname);
+    SAVE_STRING(module->psz_help, rec->help);
+    SAVE_STRING(module->psz_help_html, rec->help_html);
 
-    for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig(file, plugin->conf.params + i))
-           goto error;
+    rec->shortcut = w->header.refs;
+    rec->shortcuts_count = module->i_shortcuts;
+    for (size_t j = 0; j < module->i_shortcuts; j++)
+        SAVE_STRING(module->pp_shortcuts[j], w->refs[w->header.refs++]);
 
+    SAVE_STRING(module->activate_name, rec->activate);
+    SAVE_STRING(module->deactivate_name, rec->deactivate);
+    SAVE_STRING(module->psz_capability, rec->capability);
+    rec->score = module->i_score;
     return 0;
 error:
     return -1;
 }
 
-static int CacheSaveModule(FILE *file, const module_t *module)
+static int CacheSavePlugin(struct vlc_cache_writer *w,
+                           const vlc_plugin_t *plugin)
 {
-    SAVE_STRING(module->psz_shortname);
-    SAVE_STRING(module->psz_longname);
-    SAVE_STRING(module->psz_help);
-    SAVE_STRING(module->psz_help_html);
-    SAVE_IMMEDIATE(module->i_shortcuts);
+    struct vlc_cache_plugin *rec = &w->plugins[w->header.plugins++];
 
-    for (size_t j = 0; j < module->i_shortcuts; j++)
-         SAVE_STRING(module->pp_shortcuts[j]);
+    rec->module = w->header.modules;
+    for (const module_t *module = plugin->module;
+         module != NULL;
+         module = module->next)
+    {
+        if (CacheSaveModule(w, module))
+            goto error;
+        rec->modules_count++;
+    }
 
-    SAVE_STRING(module->activate_name);
-    SAVE_STRING(module->deactivate_name);
-    SAVE_STRING(module->psz_capability);
-    SAVE_IMMEDIATE(module->i_score);
+    /* Config stuff */
+    rec->param = w->header.params;
+    rec->params_count = plugin->conf.size;
+    for (size_t i = 0; i < plugin->conf.size; i++)
+        if (CacheSaveConfig(w, plugin->conf.params + i))
+            goto error;
+
+    /* Save common info */
+    SAVE_STRING(plugin->textdomain, rec->textdomain);
+    SAVE_STRING(plugin->path, rec->path);
+    rec->unloadable = plugin->unloadable;
+    rec->mtime = plugin->mtime;
+    rec->size = plugin->size;
     return 0;
 error:
     return -1;
 }
 
+/**
+ * Builds the cache tables of a set of plug-ins.
+ */
+static int CacheSaveTables(struct vlc_cache_writer *w,
+                           vlc_plugin_t *const *cache, size_t n)
+{
+    size_t modules = 0, params = 0, refs = 0, ints = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const vlc_plugin_t *plugin = cache[i];
+
+        for (const module_t *module = plugin->module;
+             module != NULL;
+             module = module->next)
+        {
+            modules++;
+            refs += module->i_shortcuts;
+        }
+
+        params += plugin->conf.size;
+        for (size_t j = 0; j < plugin->conf.size; j++)
+        {
+            const module_config_t *cfg = &plugin->conf.params[j].item;
+
+            refs += cfg->list_count;
+            if (IsConfigStringType(cfg->i_type))
+                refs += cfg->list_count;
+            else
+                ints += cfg->list_count;
+        }
+    }
+
+    if (n > UINT32_MAX || modules > UINT32_MAX || params > UINT32_MAX
+     || refs > UINT32_MAX || ints > UINT32_MAX)
+        return -1;
+
+    w->plugins = calloc(n ? n : 1, sizeof (*w->plugins));
+    w->modules = calloc(modules ? modules : 1, sizeof (*w->modules));
+    w->params = calloc(params ? params : 1, sizeof (*w->params));
+    w->refs = malloc((refs ? refs : 1) * sizeof (*w->refs));
+    w->ints = malloc((ints ? ints : 1) * sizeof (*w->ints));
+    w->strings_size = 4096;
+    w->strings = malloc(w->strings_size);
+    if (unlikely(w->plugins == NULL || w->modules == NULL
+              || w->params == NULL || w->refs == NULL || w->ints == NULL
+              || w->strings == NULL))
+        return -1;
+
+    /* Offset zero is NULL (or the empty string for choices) */
+    w->strings[0] = '\0';
+    w->header.strings = 1;
+
+    for (size_t i = 0; i < n; i++)
+        if (CacheSavePlugin(w, cache[i]))
+            return -1;
+
+    assert(w->header.plugins == n && w->header.modules == modules
+        && w->header.params == params && w->header.refs == refs
+        && w->header.ints == ints);
+    return 0;
+}
+
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
+    struct vlc_cache_writer w = { .strings_tree = NULL };
     uint32_t i_file_size = 0;
+    int ret = -1;
+
+    if (CacheSaveTables(&w, cache, n))
+        goto error;
 
     /* Contains version number */
     if (fputs (CACHE_STRING, file) == EOF)
@@ -621,37 +981,33 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
-    for (size_t i = 0; i < n; i++)
-    {
-        const vlc_plugin_t *plugin = cache[i];
-        uint32_t count = plugin->modules_count;
-
-        SAVE_IMMEDIATE(count);
-
-        for (module_t *module = plugin->module;
-             module != NULL;
-             module = module->next)
-            if (CacheSaveModule(file, module))
-                goto error;
-
-        /* Config stuff */
-        if (CacheSaveModuleConfig(file, plugin))
-            goto error;
-
-        /* Save common info */
-        SAVE_STRING(plugin->textdomain);
-        SAVE_STRING(plugin->path);
-        SAVE_FLAG(plugin->unloadable);
-        SAVE_IMMEDIATE(plugin->mtime);
-        SAVE_IMMEDIATE(plugin->size);
-    }
+    SAVE_ALIGNOF(struct vlc_cache_header);
+    SAVE_IMMEDIATE(w.header);
+    SAVE_ALIGNOF(struct vlc_cache_plugin);
+    SAVE_ARRAY(w.plugins, w.header.plugins);
+    SAVE_ALIGNOF(struct vlc_cache_module);
+    SAVE_ARRAY(w.modules, w.header.modules);
+    SAVE_ALIGNOF(struct vlc_cache_param);
+    SAVE_ARRAY(w.params, w.header.params);
+    SAVE_ALIGNOF(uint32_t);
+    SAVE_ARRAY(w.refs, w.header.refs);
+    SAVE_ALIGNOF(int);
+    SAVE_ARRAY(w.ints, w.header.ints);
+    SAVE_ARRAY(w.strings, w.header.strings);
 
     if (fflush (file)) /* flush libc buffers */
         goto error;
-    return 0; /* success! */
+    ret = 0; /* success! */
 
 error:
-    return -1;
+    tdestroy(w.strings_tree, free);
+    free(w.strings);
+    free(w.ints);
+    free(w.refs);
+    free(w.params);
+    free(w.modules);
+    free(w.plugins);
+    return ret;
 }
 
 /**
@@ -111,6 +111,7 @@ vlc_plugin_t *vlc_plugin_create(void)
     atomic_init(&plugin->handle, 0);
     plugin->abspath = NULL;
     plugin->path = NULL;
+    plugin->cached = false;
 #endif
     plugin->module = NULL;
 
@@ -127,6 +128,12 @@ void vlc_plugin_destroy(vlc_plugin_t *plugin)
     assert(plugin != NULL);
 #ifdef HAVE_DYNAMIC_PLUGINS
     assert(!plugin->unloadable || atomic_load(&plugin->handle) == 0);
+
+    if (plugin->cached)
+    {   /* Allocated in a single block by the cache loader */
+        vlc_cache_release(plugin);
+        return;
+    }
 #endif
 
     if (plugin->module != NULL)
@@ -56,6 +56,7 @@ typedef struct vlc_plugin_t
     char *path; /**< Relative path (within plug-in directory) */
     int64_t mtime; /**< Last modification time */
     uint64_t size; /**< File size */
+    bool cached; /**< Whether allocated by the plugins cache loader */
 #endif
 } vlc_plugin_t;
 
@@ -179,6 +180,7 @@ char *vlc_dlerror(void) VLC_USED;
 /* Plugins cache */
 vlc_plugin_t *vlc_cache_load(libvlc_int_t *, const char *, block_t **);
 vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **, const char *relpath);
+void vlc_cache_release(vlc_plugin_t *);
 
 void CacheSave(libvlc_int_t *, const char *, vlc_plugin_t *const *, size_t);
 
@@ -43,6 +43,7 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_fs.h>
 #include "../libvlc.h"
 
 #include <string.h>
@@ -55,6 +56,9 @@
 #ifdef HAVE_POLL_H
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -69,10 +73,43 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* Largest amount of stream data written to a client at once */
+#define HTTPD_STREAM_WRITE_MAX (256 * 1024)
+
+#define HTTPD_WORKERS_MAX 16
+
+/* Interval between two logs of the host statistics */
+#define HTTPD_STATS_PERIOD VLC_TICK_FROM_SEC(60)
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
-/* each host run in his own thread */
+/* each worker thread serves its own set of clients */
+typedef struct httpd_worker_t
+{
+    httpd_host_t *host;
+    vlc_thread_t thread;
+
+    vlc_mutex_t lock; /* protects the clients */
+    struct vlc_list clients;
+    size_t client_count;
+
+#ifndef _WIN32
+    int wakeup[2];           /* pipe to interrupt the wait for events */
+    atomic_bool woken;
+#endif
+    atomic_bool stream_data; /* new data was added to a stream */
+#ifdef HAVE_SYS_EPOLL_H
+    int epfd;
+    vlc_tick_t timeout_check; /* next check of the idle clients timeouts */
+#endif
+
+    /* statistics, protected by the lock */
+    uint64_t clients_total;
+    uint64_t bytes_sent;
+} httpd_worker_t;
+
+/* each host runs its own threads */
 struct httpd_host_t
 {
     struct vlc_object_t obj;
@@ -86,7 +123,6 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
 
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
@@ -95,9 +131,13 @@ struct httpd_host_t
      * */
     struct vlc_list urls;
 
-    size_t client_count;
-    struct vlc_list clients;
+    /* The first worker also accepts the new connections */
+    httpd_worker_t *workers;
+    unsigned worker_count;
+    unsigned next_worker;    /* worker of the next accepted client */
     unsigned timeout_sec;
+    vlc_tick_t start_date;
+    vlc_tick_t stats_date;   /* next statistics log, by the first worker */
 
     /* TLS data */
     vlc_tls_server_t *p_tls;
@@ -150,6 +190,20 @@ struct httpd_client_t
 
     vlc_tick_t i_timeout_date;
 
+    /* Stream sent straight from its circular buffer, or NULL */
+    httpd_stream_t *stream;
+
+    /* event loop state */
+    int     fd;
+    short   events;     /* poll events to wait for */
+    short   watched;    /* poll events registered with epoll */
+    bool    b_pending;  /* run again without waiting for events */
+    uint64_t i_sent;
+
+    /* Reservation of the stream data being sent without the stream lock */
+    struct vlc_list reader_node;
+    int64_t i_reader_pos;
+
     /* buffer for reading header */
     int     i_buffer_size;
     int     i_buffer;
@@ -648,6 +702,11 @@ struct httpd_stream_t
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
+    /* clients sending from the buffer without the lock; the data from their
+     * position on is not overwritten until they are done */
+    struct vlc_list readers;
+    vlc_cond_t  readers_wait;
+
     /* custom headers */
     size_t        i_http_headers;
     httpd_header * p_http_headers;
@@ -663,47 +722,8 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
-
-        if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
-                /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
-
-            /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
-            cl->i_keyframe_wait_to_pass = -1;
-        }
-
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
-
-        /* using HTTPD_MSG_ANSWER -> data available */
-        answer->i_proto  = HTTPD_PROTO_HTTP;
-        answer->i_version= 0;
-        answer->i_type   = HTTPD_MSG_ANSWER;
-
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
-
-        return VLC_SUCCESS;
+        /* The data is sent by httpd_StreamWrite() */
+        return VLC_EGENERIC;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
@@ -729,6 +749,7 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
 
         if (query->i_type != HTTPD_MSG_HEAD) {
             cl->b_stream_mode = true;
+            cl->stream = stream;
             vlc_mutex_lock(&stream->lock);
             /* Send the header */
             if (stream->i_header > 0) {
@@ -794,6 +815,8 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
         goto error;
 
     vlc_mutex_init(&stream->lock);
+    vlc_list_init(&stream->readers);
+    vlc_cond_init(&stream->readers_wait);
     if (psz_mime == NULL || psz_mime[0] == '\0')
         psz_mime = vlc_mime_Ext2Mime(psz_url);
 
@@ -872,6 +895,93 @@ static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data
     stream->i_buffer_pos += i_data;
 }
 
+/**
+ * Sends stream data to a client straight from the circular buffer.
+ *
+ * The stream lock is not held while sending, so that the clients of a stream
+ * are served in parallel. The data being sent is reserved instead, and
+ * httpd_StreamSend() waits for the write to complete before overwriting it.
+ * The socket is non-blocking, so this does not take long.
+ *
+ * @return the number of bytes sent, 0 if there is no data to send yet,
+ * or -1 on error (errno is EAGAIN if the socket is full)
+ */
+static ssize_t httpd_StreamWrite(httpd_stream_t *stream, httpd_client_t *cl)
+{
+    vlc_tls_t *sock = cl->sock;
+
+    vlc_mutex_lock(&stream->lock);
+
+    int64_t i_offset = cl->answer.i_body_offset;
+    if (i_offset >= stream->i_buffer_pos)
+        goto wait; /* wait, no data available */
+
+    if (cl->i_keyframe_wait_to_pass >= 0) {
+        if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            /* still waiting for the next keyframe */
+            goto wait;
+
+        /* seek to the new keyframe */
+        i_offset = stream->i_last_keyframe_seen_pos;
+        cl->i_keyframe_wait_to_pass = -1;
+    }
+
+    if (i_offset + stream->i_buffer_size < stream->i_buffer_pos)
+        i_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+
+    size_t i_write = __MIN(stream->i_buffer_pos - i_offset,
+                           HTTPD_STREAM_WRITE_MAX);
+
+    cl->i_reader_pos = i_offset;
+    vlc_list_append(&cl->reader_node, &stream->readers);
+    vlc_mutex_unlock(&stream->lock);
+
+    /* The buffer itself is never reallocated */
+    size_t i_pos = i_offset % stream->i_buffer_size;
+    struct iovec iov[2];
+    int iovcnt = 1;
+
+    /* Send both parts if the data wraps around the circular buffer */
+    iov[0].iov_base = &stream->p_buffer[i_pos];
+    iov[0].iov_len = __MIN(i_write, stream->i_buffer_size - i_pos);
+    if (iov[0].iov_len < i_write) {
+        iov[1].iov_base = stream->p_buffer;
+        iov[1].iov_len = i_write - iov[0].iov_len;
+        iovcnt = 2;
+    }
+
+    ssize_t val = sock->ops->writev(sock, iov, iovcnt);
+
+    vlc_mutex_lock(&stream->lock);
+    vlc_list_remove(&cl->reader_node);
+    vlc_cond_signal(&stream->readers_wait);
+    vlc_mutex_unlock(&stream->lock);
+
+    if (val > 0) {
+        i_offset += val;
+        cl->i_sent += val;
+    }
+    cl->answer.i_body_offset = i_offset;
+    return val;
+
+wait:
+    vlc_mutex_unlock(&stream->lock);
+    return 0;
+}
+
+/* Checks if a client is still sending data before the given position */
+static bool httpd_StreamIsReading(httpd_stream_t *stream, int64_t i_pos)
+{
+    httpd_client_t *cl;
+
+    vlc_list_foreach(cl, &stream->readers, reader_node)
+        if (cl->i_reader_pos < i_pos)
+            return true;
+    return false;
+}
+
+static void httpd_HostWakeStreams(httpd_host_t *host);
+
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
     if (!p_block || !p_block->p_buffer)
@@ -879,6 +989,12 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 
     vlc_mutex_lock(&stream->lock);
 
+    /* Wait for the clients sending the data about to be overwritten */
+    int64_t i_reuse = stream->i_buffer_pos + (int64_t)p_block->i_buffer
+                    - stream->i_buffer_size;
+    while (httpd_StreamIsReading(stream, i_reuse))
+        vlc_cond_wait(&stream->readers_wait, &stream->lock);
+
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
 
@@ -890,6 +1006,8 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
     httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
 
     vlc_mutex_unlock(&stream->lock);
+
+    httpd_HostWakeStreams(stream->url->host);
     return VLC_SUCCESS;
 }
 
@@ -910,7 +1028,7 @@ void httpd_StreamDelete(httpd_stream_t *stream)
 /*****************************************************************************
  * Low level
  *****************************************************************************/
-static void* httpd_HostThread(void *);
+static void* httpd_WorkerThread(void *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                       const char *, vlc_tls_server_t *,
                                       unsigned);
@@ -957,6 +1075,82 @@ static struct httpd
     struct vlc_list hosts;
 } httpd = { VLC_STATIC_MUTEX, VLC_LIST_INITIALIZER(&httpd.hosts) };
 
+static int httpd_WorkerInit(httpd_worker_t *w, httpd_host_t *host)
+{
+    w->host = host;
+    vlc_mutex_init(&w->lock);
+    vlc_list_init(&w->clients);
+    w->client_count = 0;
+    w->clients_total = 0;
+    w->bytes_sent = 0;
+    atomic_init(&w->stream_data, false);
+
+#ifndef _WIN32
+    if (vlc_pipe(w->wakeup))
+        return VLC_EGENERIC;
+    atomic_init(&w->woken, false);
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+    w->timeout_check = VLC_TICK_0;
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->epfd == -1)
+        goto error;
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wakeup[0], &ev))
+    {
+        vlc_close(w->epfd);
+        goto error;
+    }
+#endif
+    return VLC_SUCCESS;
+
+#ifdef HAVE_SYS_EPOLL_H
+error:
+    vlc_close(w->wakeup[1]);
+    vlc_close(w->wakeup[0]);
+    return VLC_EGENERIC;
+#endif
+}
+
+static void httpd_WorkerClean(httpd_worker_t *w)
+{
+    httpd_client_t *client;
+
+    vlc_list_foreach(client, &w->clients, node) {
+        msg_Warn(w->host, "client still connected");
+        httpd_ClientDestroy(client);
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    vlc_close(w->epfd);
+#endif
+#ifndef _WIN32
+    vlc_close(w->wakeup[1]);
+    vlc_close(w->wakeup[0]);
+#endif
+}
+
+/* Interrupts the wait for events of a worker */
+static void httpd_WorkerWake(httpd_worker_t *w)
+{
+#ifndef _WIN32
+    if (!atomic_exchange_explicit(&w->woken, true, memory_order_acq_rel))
+        vlc_write(w->wakeup[1], &(char){ 0 }, 1);
+#else
+    (void) w; /* the waiting clients are polled */
+#endif
+}
+
+static void httpd_HostWakeStreams(httpd_host_t *host)
+{
+    for (unsigned i = 0; i < host->worker_count; i++) {
+        httpd_worker_t *w = &host->workers[i];
+
+        atomic_store_explicit(&w->stream_data, true, memory_order_release);
+        httpd_WorkerWake(w);
+    }
+}
+
 static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
                                        const char *hostvar,
                                        const char *portvar,
@@ -992,6 +1186,8 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     vlc_mutex_init(&host->lock);
     atomic_init(&host->ref, 1);
+    host->workers = NULL;
+    host->worker_count = 0;
 
     char *hostname = var_InheritString(p_this, hostvar);
 
@@ -1006,16 +1202,53 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     host->port     = port;
     vlc_list_init(&host->urls);
-    host->client_count = 0;
-    vlc_list_init(&host->clients);
+    host->next_worker = 0;
     host->timeout_sec = timeout_sec;
+    host->start_date = vlc_tick_now();
+    host->stats_date = host->start_date + HTTPD_STATS_PERIOD;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host)) {
-        msg_Err(p_this, "cannot spawn http host thread");
+#ifndef _WIN32
+    unsigned workers = var_InheritInteger(p_this, "http-threads");
+    if (workers == 0)
+        workers = vlc_GetCPUCount();
+    workers = VLC_CLIP(workers, 1, HTTPD_WORKERS_MAX);
+#else
+    /* The workers cannot be woken up */
+    unsigned workers = 1;
+#endif
+
+    host->workers = vlc_alloc(workers, sizeof (*host->workers));
+    if (unlikely(host->workers == NULL))
         goto error;
+
+    for (; host->worker_count < workers; host->worker_count++)
+        if (httpd_WorkerInit(&host->workers[host->worker_count], host))
+            goto error;
+
+#ifdef HAVE_SYS_EPOLL_H
+    for (unsigned i = 0; i < host->nfd; i++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &host->fds[i] };
+
+        if (epoll_ctl(host->workers[0].epfd, EPOLL_CTL_ADD, host->fds[i], &ev))
+            goto error;
     }
+#endif
+
+    /* create the threads */
+    for (unsigned i = 0; i < host->worker_count; i++)
+        if (vlc_clone(&host->workers[i].thread, httpd_WorkerThread,
+                      &host->workers[i])) {
+            msg_Err(p_this, "cannot spawn http host thread");
+            atomic_store_explicit(&host->ref, 0, memory_order_relaxed);
+            while (i > 0) {
+                i--;
+                vlc_cancel(host->workers[i].thread);
+                vlc_join(host->workers[i].thread, NULL);
+            }
+            goto error;
+        }
+    msg_Dbg(p_this, "HTTP host with %u thread(s)", host->worker_count);
 
     /* now add it to httpd */
     vlc_list_append(&host->node, &httpd.hosts);
@@ -1027,6 +1260,9 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        for (unsigned i = 0; i < host->worker_count; i++)
+            httpd_WorkerClean(&host->workers[i]);
+        free(host->workers);
         net_ListenClose(host->fds);
         vlc_object_delete(host);
     }
@@ -1035,11 +1271,30 @@ error:
     return NULL;
 }
 
+static void httpd_HostLogStats(httpd_host_t *host)
+{
+    uint64_t clients = 0, bytes = 0;
+    size_t connected = 0;
+
+    for (unsigned i = 0; i < host->worker_count; i++) {
+        httpd_worker_t *w = &host->workers[i];
+
+        vlc_mutex_lock(&w->lock);
+        connected += w->client_count;
+        clients += w->clients_total;
+        bytes += w->bytes_sent;
+        vlc_mutex_unlock(&w->lock);
+    }
+
+    vlc_tick_t duration = vlc_tick_now() - host->start_date;
+    msg_Dbg(host, "%zu client(s) connected, %"PRIu64" in total, %"PRIu64
+            " bytes sent (%"PRIu64" kbit/s)", connected, clients, bytes,
+            duration > 0 ? bytes * 8 * CLOCK_FREQ / 1000 / duration : 0);
+}
+
 /* delete a host */
 void httpd_HostDelete(httpd_host_t *host)
 {
-    httpd_client_t *client;
-
     vlc_mutex_lock(&httpd.mutex);
 
     if (atomic_fetch_sub_explicit(&host->ref, 1, memory_order_relaxed) > 1) {
@@ -1050,17 +1305,17 @@ void httpd_HostDelete(httpd_host_t *host)
     }
 
     vlc_list_remove(&host->node);
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
-
-    msg_Dbg(host, "HTTP host removed");
-
-    vlc_list_foreach(client, &host->clients, node) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(client);
+    for (unsigned i = 0; i < host->worker_count; i++) {
+        vlc_cancel(host->workers[i].thread);
+        vlc_join(host->workers[i].thread, NULL);
     }
 
+    httpd_HostLogStats(host);
+    for (unsigned i = 0; i < host->worker_count; i++)
+        httpd_WorkerClean(&host->workers[i]);
+
     assert(vlc_list_is_empty(&host->urls));
+    free(host->workers);
     vlc_tls_ServerDelete(host->p_tls);
     net_ListenClose(host->fds);
     vlc_object_delete(host);
@@ -1147,22 +1402,37 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     vlc_list_remove(&url->node);
+    vlc_mutex_unlock(&host->lock);
 
     free(url->psz_url);
     free(url->psz_user);
     free(url->psz_password);
 
-    vlc_list_foreach(client, &host->clients, node) {
-        if (client->url != url)
-            continue;
+    /* No client can use the url anymore once it is removed from the list.
+     * The clients already using it are closed by their worker. */
+    for (unsigned i = 0; i < host->worker_count; i++) {
+        httpd_worker_t *w = &host->workers[i];
+        bool found = false;
 
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        host->client_count--;
-        httpd_ClientDestroy(client);
+        vlc_mutex_lock(&w->lock);
+        vlc_list_foreach(client, &w->clients, node) {
+            if (client->url != url)
+                continue;
+
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            client->url = NULL;
+            client->stream = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+            client->b_pending = true;
+            found = true;
+        }
+        vlc_mutex_unlock(&w->lock);
+
+        if (found)
+            httpd_WorkerWake(w);
     }
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1269,6 +1539,12 @@ static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->stream = NULL;
+    cl->fd = -1;
+    cl->events = 0;
+    cl->watched = 0;
+    cl->b_pending = true;
+    cl->i_sent = 0;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1651,9 +1927,11 @@ static int httpd_ClientSend(httpd_client_t *cl)
     }
 
     cl->i_buffer += i_len;
+    cl->i_sent += i_len;
 
     if (cl->i_buffer >= cl->i_buffer_size) {
-        if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
+        if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0
+         && cl->stream == NULL) {
             /* catch more body data */
             int64_t i_offset = cl->answer.i_body_offset;
 
@@ -1729,362 +2007,564 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Sends the stream data available to a client in stream mode */
+static int httpd_ClientStreamSend(httpd_client_t *cl, bool *blocked)
 {
-    struct pollfd ufd[host->nfd + host->client_count];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
-    }
+    assert(cl->stream != NULL);
 
-    vlc_mutex_lock(&host->lock);
-    /* add all socket that should be read/write and close dead connection */
-    vlc_tick_t now = vlc_tick_now();
-    int delay = -1;
-    httpd_client_t *cl;
+    ssize_t val = httpd_StreamWrite(cl->stream, cl);
+    if (val > 0)
+        return 0;
+    if (val == 0)
+        return -1; /* wait for more data */
 
-    int canc = vlc_savecancel();
-    vlc_list_foreach(cl, &host->clients, node) {
-        int val = -1;
+#if defined(_WIN32)
+    if (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+    if (errno == EAGAIN)
+#endif
+    {
+        *blocked = true;
+        return -1;
+    }
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-                val = httpd_ClientRecv(cl);
-                break;
-            case HTTPD_CLIENT_SENDING:
-                val = httpd_ClientSend(cl);
-                break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
+    /* Connection failed, or hung up (EPIPE) */
+    cl->i_state = HTTPD_CLIENT_DEAD;
+    return 0;
+}
 
-        if (cl->i_state == HTTPD_CLIENT_DEAD
-         || (host->timeout_sec > 0 && cl->i_timeout_date < now)) {
-            host->client_count--;
-            httpd_ClientDestroy(cl);
-            continue;
-        }
+static void httpd_WorkerDropClient(httpd_worker_t *w, httpd_client_t *cl)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (cl->watched != 0)
+        epoll_ctl(w->epfd, EPOLL_CTL_DEL, cl->fd, NULL);
+#endif
+    w->client_count--;
+    httpd_ClientDestroy(cl);
+}
 
-        if (val == 0) {
-            cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
-            delay = 0;
-        }
+/**
+ * Runs the state machine of a client.
+ *
+ * On return, cl->events are the poll events to wait for on cl->fd, and
+ * cl->b_pending is set if the client should run again without waiting.
+ *
+ * @return false if the client was destroyed
+ */
+static bool httpd_ClientProcess(httpd_worker_t *w, httpd_client_t *cl,
+                                vlc_tick_t now)
+{
+    httpd_host_t *host = w->host;
+    const uint8_t i_state = cl->i_state;
+    const uint64_t i_sent = cl->i_sent;
+    bool blocked = false;
+    int val = -1;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+            val = httpd_ClientRecv(cl);
+            break;
+        case HTTPD_CLIENT_SENDING:
+            val = httpd_ClientSend(cl);
+            break;
+        case HTTPD_CLIENT_WAITING:
+            val = httpd_ClientStreamSend(cl, &blocked);
+            break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(host, cl);
+            break;
+    }
+    w->bytes_sent += cl->i_sent - i_sent;
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + ARRAY_SIZE (ufd));
+    if (cl->i_state == HTTPD_CLIENT_DEAD
+     || (host->timeout_sec > 0 && cl->i_timeout_date < now)) {
+        httpd_WorkerDropClient(w, cl);
+        return false;
+    }
 
-        pufd->events = pufd->revents = 0;
+    cl->b_pending = false;
+    if (val == 0) {
+        cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
+        cl->b_pending = true;
+    }
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+    short events = 0;
 
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            events = POLLIN;
+            break;
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            events = POLLOUT;
+            break;
 
-                httpd_MsgInit(answer);
+        case HTTPD_CLIENT_WAITING:
+            /* Otherwise, the client is woken up by new stream data */
+            if (blocked)
+                events = POLLOUT;
+            break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
-                        cl->i_state = HTTPD_CLIENT_DEAD;
+        case HTTPD_CLIENT_RECEIVE_DONE: {
+            httpd_message_t *answer = &cl->answer;
+            httpd_message_t *query  = &cl->query;
+
+            httpd_MsgInit(answer);
+
+            /* Handle what we received */
+            switch (query->i_type) {
+                case HTTPD_MSG_ANSWER:
+                    cl->url     = NULL;
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    break;
+
+                case HTTPD_MSG_OPTIONS:
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_proto  = query->i_proto;
+                    answer->i_status = 200;
+                    answer->i_body = 0;
+                    answer->p_body = NULL;
+
+                    httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+                    httpd_MsgAdd(answer, "Content-Length", "0");
+
+                    switch(query->i_proto) {
+                    case HTTPD_PROTO_HTTP:
+                        answer->i_version = 1;
+                        httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
                         break;
 
-                    case HTTPD_MSG_OPTIONS:
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+                    case HTTPD_PROTO_RTSP:
+                        answer->i_version = 0;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+                        const char *p = httpd_MsgGet(query, "Cseq");
+                        if (p)
+                            httpd_MsgAdd(answer, "Cseq", "%s", p);
+                        p = httpd_MsgGet(query, "Timestamp");
+                        if (p)
+                            httpd_MsgAdd(answer, "Timestamp", "%s", p);
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+                        p = httpd_MsgGet(query, "Require");
+                        if (p) {
+                            answer->i_status = 551;
+                            httpd_MsgAdd(query, "Unsupported", "%s", p);
+                        }
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+                        httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                                "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                        break;
+                    }
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+                    if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                        httpd_MsgAdd(answer, "Connection", "close");
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+                    cl->i_buffer = -1;  /* Force the creation of the answer in
+                                         * httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
-                        }
+                case HTTPD_MSG_NONE:
+                    if (query->i_proto == HTTPD_PROTO_NONE) {
+                        cl->url = NULL;
+                        cl->i_state = HTTPD_CLIENT_DEAD;
+                    } else {
+                        /* unimplemented */
+                        answer->i_proto  = query->i_proto ;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+                        answer->i_status = 501;
 
-                        if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                            httpd_MsgAdd(answer, "Connection", "close");
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                        answer->p_body = (uint8_t *)p;
+                        httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
+                        httpd_MsgAdd(answer, "Connection", "close");
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
                         cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
-
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
-                            httpd_MsgAdd(answer, "Connection", "close");
+                    }
+                    break;
 
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+                default: {
+                    httpd_url_t *url;
+                    bool b_auth_failed = false;
 
-                    default: {
-                        httpd_url_t *url;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        vlc_list_foreach(url, &host->urls, node) {
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (httpd_UrlCatchCall(url, cl))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+                    /* Search the url and trigger callbacks */
+                    vlc_mutex_lock(&host->lock);
+                    vlc_list_foreach(url, &host->urls, node) {
+                        if (strcmp(url->psz_url, query->psz_url))
+                            continue;
 
                         if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                            if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                                httpd_MsgAdd(answer, "Connection", "close");
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                            if (b_auth_failed)
+                               break;
                         }
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
-                }
-                break;
-            }
+                        if (httpd_UrlCatchCall(url, cl))
+                            continue;
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    bool do_close = false;
+                        if (answer->i_proto == HTTPD_PROTO_NONE)
+                            cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                        else
+                            cl->i_buffer = -1;
 
-                    cl->url = NULL;
+                        /* only one url can answer */
+                        answer = NULL;
+                        if (!cl->url)
+                            cl->url = url;
+                    }
+                    vlc_mutex_unlock(&host->lock);
 
-                    if (cl->query.i_proto != HTTPD_PROTO_HTTP
-                     || cl->query.i_version > 0)
-                    {
-                        const char *psz_connection = httpd_MsgGet(&cl->answer,
-                                                                 "Connection");
-                        if (psz_connection != NULL)
-                            do_close = !strcasecmp(psz_connection, "close");
+                    if (answer) {
+                        answer->i_proto  = query->i_proto;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+
+                       if (b_auth_failed) {
+                            httpd_MsgAdd(answer, "WWW-Authenticate",
+                                    "Basic realm=\"VLC stream\"");
+                            answer->i_status = 401;
+                        } else
+                            answer->i_status = 404; /* no url registered */
+
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                                query->psz_url);
+                        answer->p_body = (uint8_t *)p;
+
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        httpd_MsgAdd(answer, "Content-Length", "%zu", answer->i_body);
+                        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+                        if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                            httpd_MsgAdd(answer, "Connection", "close");
                     }
-                    else
-                        do_close = true;
-
-                    if (!do_close) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        // Allocate an extra byte for the null terminating byte
-                        cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    int64_t i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                }
+            }
+            break;
+        }
+
+        case HTTPD_CLIENT_SEND_DONE:
+            if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+                bool do_close = false;
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
+                cl->url = NULL;
+
+                if (cl->query.i_proto != HTTPD_PROTO_HTTP
+                 || cl->query.i_version > 0)
+                {
+                    const char *psz_connection = httpd_MsgGet(&cl->answer,
+                                                             "Connection");
+                    if (psz_connection != NULL)
+                        do_close = !strcasecmp(psz_connection, "close");
                 }
-                break;
+                else
+                    do_close = true;
 
-            case HTTPD_CLIENT_WAITING: {
+                if (!do_close) {
+                    httpd_MsgClean(&cl->query);
+                    httpd_MsgInit(&cl->query);
+
+                    cl->i_buffer = 0;
+                    cl->i_buffer_size = 1000;
+                    free(cl->p_buffer);
+                    // Allocate an extra byte for the null terminating byte
+                    cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
+                    cl->i_state = HTTPD_CLIENT_RECEIVING;
+                } else
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_MsgClean(&cl->answer);
+            } else {
                 int64_t i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+                httpd_MsgClean(&cl->answer);
 
-                httpd_MsgInit(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+                cl->i_state = HTTPD_CLIENT_WAITING;
             }
+            break;
+    }
+
+    if (cl->i_state != i_state)
+        cl->b_pending = true;
+
+    cl->fd = vlc_tls_GetPollFD(cl->sock, &events);
+    cl->events = events;
+    return true;
+}
+
+static void httpd_HostAccept(httpd_host_t *host, int fd, vlc_tick_t now)
+{
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+    if (unlikely(sk == NULL))
+    {
+        vlc_close(fd);
+        return;
+    }
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        vlc_tls_t *tls;
+
+        tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+        if (tls == NULL)
+        {
+            vlc_tls_SessionDelete(sk);
+            return;
         }
+        sk = tls;
+    }
 
-        pufd->fd = vlc_tls_GetPollFD(cl->sock, &pufd->events);
+    httpd_client_t *cl = httpd_ClientNew(sk);
 
-        if (pufd->events != 0)
-            nfd++;
-        /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-        else if (delay != 0)
-            delay = 20;
+    if (unlikely(cl == NULL))
+    {
+        vlc_tls_Close(sk);
+        return;
     }
-    vlc_mutex_unlock(&host->lock);
+
+    if (host->p_tls != NULL)
+        cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+
+    cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
+
+    /* Only the first worker accepts connections */
+    httpd_worker_t *w = &host->workers[host->next_worker];
+    host->next_worker = (host->next_worker + 1) % host->worker_count;
+
+    vlc_mutex_lock(&w->lock);
+    w->client_count++;
+    w->clients_total++;
+    vlc_list_append(&cl->node, &w->clients);
+    vlc_mutex_unlock(&w->lock);
+
+    if (w != &host->workers[0])
+        httpd_WorkerWake(w);
+}
+
+#ifndef _WIN32
+static void httpd_WorkerDrain(httpd_worker_t *w)
+{
+    char dummy;
+
+    atomic_store_explicit(&w->woken, false, memory_order_relaxed);
+    if (read(w->wakeup[0], &dummy, 1) < 0)
+        msg_Err(w->host, "wakeup pipe error: %s", vlc_strerror_c(errno));
+}
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+static void httpd_WorkerWatch(httpd_worker_t *w, httpd_client_t *cl)
+{
+    if (cl->events == cl->watched)
+        return;
+
+    struct epoll_event ev = {
+        .events = ((cl->events & POLLIN) ? EPOLLIN : 0)
+                | ((cl->events & POLLOUT) ? EPOLLOUT : 0),
+        .data.ptr = cl,
+    };
+    int op = cl->events == 0 ? EPOLL_CTL_DEL
+           : cl->watched == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+
+    if (epoll_ctl(w->epfd, op, cl->fd, &ev)) {
+        msg_Err(w->host, "cannot watch client: %s", vlc_strerror_c(errno));
+        cl->i_state = HTTPD_CLIENT_DEAD;
+        cl->b_pending = true;
+        return;
+    }
+    cl->watched = cl->events;
+}
+
+static bool httpd_IsListenFd(const httpd_host_t *host, const void *ptr)
+{
+    const int *fd = ptr;
+    return fd >= host->fds && fd < host->fds + host->nfd;
+}
+
+/* Only the clients with events, progress or new stream data are run. */
+static void httpdLoop(httpd_worker_t *w)
+{
+    httpd_host_t *host = w->host;
+    struct epoll_event ev[64];
+    httpd_client_t *cl;
+
+    vlc_mutex_lock(&w->lock);
+    vlc_tick_t now = vlc_tick_now();
+    const bool stream_data =
+        atomic_exchange_explicit(&w->stream_data, false, memory_order_acquire);
+    const bool check_timeouts = host->timeout_sec > 0 && now >= w->timeout_check;
+    int delay = -1;
+
+    int canc = vlc_savecancel();
+    vlc_list_foreach(cl, &w->clients, node) {
+        if (!cl->b_pending
+         && !(stream_data && cl->i_state == HTTPD_CLIENT_WAITING
+              && cl->events == 0)) {
+            if (check_timeouts && cl->i_timeout_date < now)
+                httpd_WorkerDropClient(w, cl);
+            continue;
+        }
+
+        if (!httpd_ClientProcess(w, cl, now))
+            continue;
+
+        httpd_WorkerWatch(w, cl);
+        if (cl->b_pending)
+            delay = 0;
+    }
+
+    if (check_timeouts)
+        w->timeout_check = now + VLC_TICK_FROM_SEC(1);
+    /* wake up every second to close the idle clients */
+    if (delay != 0 && host->timeout_sec > 0 && w->client_count > 0)
+        delay = 1000;
+    vlc_mutex_unlock(&w->lock);
     vlc_restorecancel(canc);
 
-    while (poll(ufd, nfd, delay) < 0)
-    {
+    int n = epoll_wait(w->epfd, ev, ARRAY_SIZE(ev), delay);
+    if (n < 0) {
         if (errno != EINTR)
             msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+        return;
     }
 
     canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
+    now = vlc_tick_now();
+
+    /* Handle the wake up and server sockets (accept new connections) */
+    for (int i = 0; i < n; i++) {
+        if (ev[i].data.ptr == NULL)
+            httpd_WorkerDrain(w);
+        else if (httpd_IsListenFd(host, ev[i].data.ptr))
+            httpd_HostAccept(host, *(const int *)ev[i].data.ptr, now);
+    }
 
     /* Handle client sockets */
-    now = vlc_tick_now();
-    nfd = host->nfd;
+    vlc_mutex_lock(&w->lock);
+    for (int i = 0; i < n; i++) {
+        if (ev[i].data.ptr != NULL && !httpd_IsListenFd(host, ev[i].data.ptr)) {
+            cl = ev[i].data.ptr;
+            cl->b_pending = true;
+        }
+    }
+    vlc_mutex_unlock(&w->lock);
+    vlc_restorecancel(canc);
+}
+#else
+/* All the clients are run whenever any of them has an event. */
+static void httpdLoop(httpd_worker_t *w)
+{
+    httpd_host_t *host = w->host;
+    const unsigned nlisten = (w == &host->workers[0]) ? host->nfd : 0;
 
-    /* Handle server sockets (accept new connections) */
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        int fd = ufd[nfd].fd;
+    vlc_mutex_lock(&w->lock);
 
-        assert (fd == host->fds[nfd]);
+    struct pollfd ufd[nlisten + 1 + w->client_count];
+    unsigned nfd;
+    for (nfd = 0; nfd < nlisten; nfd++) {
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
+#ifndef _WIN32
+    ufd[nfd].fd = w->wakeup[0];
+    ufd[nfd].events = POLLIN;
+    ufd[nfd].revents = 0;
+    nfd++;
+#endif
 
-        if (ufd[nfd].revents == 0)
-            continue;
+    /* add all socket that should be read/write and close dead connection */
+    vlc_tick_t now = vlc_tick_now();
+    int delay = -1;
+    httpd_client_t *cl;
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
+    int canc = vlc_savecancel();
+    vlc_list_foreach(cl, &w->clients, node) {
+        if (!httpd_ClientProcess(w, cl, now))
             continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
 
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
-            continue;
-        }
+        if (cl->b_pending)
+            delay = 0;
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
+        if (cl->events != 0) {
+            struct pollfd *pufd = ufd + nfd;
+            assert (pufd < ufd + ARRAY_SIZE (ufd));
 
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
-                continue;
-            }
-            sk = tls;
+            pufd->fd = cl->fd;
+            pufd->events = cl->events;
+            pufd->revents = 0;
+            nfd++;
         }
+#ifdef _WIN32
+        /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+        else if (delay != 0)
+            delay = 20;
+#endif
+    }
+    vlc_mutex_unlock(&w->lock);
+    vlc_restorecancel(canc);
 
-        cl = httpd_ClientNew(sk);
+    while (poll(ufd, nfd, delay) < 0)
+    {
+        if (errno != EINTR)
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+    }
 
-        if (unlikely(cl == NULL))
-        {
-            vlc_tls_Close(sk);
-            continue;
-        }
+    canc = vlc_savecancel();
+#ifndef _WIN32
+    if (ufd[nlisten].revents)
+        httpd_WorkerDrain(w);
+#endif
 
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+    /* Handle server sockets (accept new connections) */
+    now = vlc_tick_now();
+    for (unsigned i = 0; i < nlisten; i++) {
+        assert (ufd[i].fd == host->fds[i]);
 
-        cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
-        host->client_count++;
-        vlc_list_append(&cl->node, &host->clients);
+        if (ufd[i].revents != 0)
+            httpd_HostAccept(host, ufd[i].fd, now);
     }
-
-    vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
 }
+#endif
 
-static void* httpd_HostThread(void *data)
+static void* httpd_WorkerThread(void *data)
 {
     vlc_thread_set_name("vlc-httpd");
 
-    httpd_host_t *host = data;
+    httpd_worker_t *w = data;
+    httpd_host_t *host = w->host;
+
+    while (atomic_load_explicit(&host->ref, memory_order_relaxed) > 0) {
+        httpdLoop(w);
 
-    while (atomic_load_explicit(&host->ref, memory_order_relaxed) > 0)
-        httpdLoop(host);
+        vlc_tick_t now = vlc_tick_now();
+        if (w == &host->workers[0] && now >= host->stats_date) {
+            int canc = vlc_savecancel();
+            httpd_HostLogStats(host);
+            vlc_restorecancel(canc);
+            host->stats_date = now + HTTPD_STATS_PERIOD;
+        }
+    }
     return NULL;
 }
 
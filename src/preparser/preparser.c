@@ -370,7 +370,12 @@ int vlc_preparser_Push( vlc_preparser_t *preparser,
 
     PreparserAddTask(preparser, task);
 
-    vlc_executor_Submit(preparser->executor, &task->runnable);
+    /* Requests on behalf of the user overtake background scans */
+    enum vlc_executor_priority priority =
+        i_options & META_REQUEST_OPTION_DO_INTERACT
+            ? VLC_EXECUTOR_PRIORITY_HIGH : VLC_EXECUTOR_PRIORITY_NORMAL;
+    vlc_executor_SubmitPriority(preparser->executor, &task->runnable,
+                                priority);
     return VLC_SUCCESS;
 }
 
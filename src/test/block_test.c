@@ -86,11 +86,46 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_cache (void)
+{
+    struct vlc_frame_alloc_stats before, after;
+
+    vlc_frame_GetAllocStats (&before);
+
+    /* Blocks of various sizes, all within the cached size classes */
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        size_t size = (i * 37) % 16384;
+        block_t *block = block_Alloc (size);
+        assert (block != NULL);
+        assert (block->i_buffer == size);
+        assert (((uintptr_t)block->p_buffer % 32) == 0);
+        memset (block->p_buffer, i, size);
+        block_Release (block);
+    }
+
+    /* Large blocks bypass the caches */
+    block_t *block = block_Alloc (1 << 20);
+    assert (block != NULL);
+    memset (block->p_buffer, 0, block->i_buffer);
+    block_Release (block);
+
+    vlc_frame_GetAllocStats (&after);
+    assert (after.hits >= before.hits);
+    assert (after.misses >= before.misses);
+    if (after.misses > before.misses)
+        /* Caching is enabled: recycled blocks must have been reused */
+        assert (after.hits - before.hits > 900);
+    printf ("frame allocator: %llu hits, %llu misses, %zu bytes cached\n",
+            after.hits, after.misses, after.cached_bytes);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_cache ();
     return 0;
 }
 
@@ -272,6 +272,94 @@ static void test_task_chain(void)
         assert(array[i] == 2 * i);
 }
 
+struct order_data
+{
+    vlc_mutex_t lock;
+    vlc_cond_t cond;
+    bool released;
+    int order[4];
+    int count;
+};
+
+struct order_task
+{
+    struct order_data *data;
+    int id;
+    struct vlc_runnable runnable;
+};
+
+static void RunBlocker(void *userdata)
+{
+    struct order_data *data = userdata;
+
+    vlc_mutex_lock(&data->lock);
+    while (!data->released)
+        vlc_cond_wait(&data->cond, &data->lock);
+    vlc_mutex_unlock(&data->lock);
+}
+
+static void RunOrdered(void *userdata)
+{
+    struct order_task *task = userdata;
+    struct order_data *data = task->data;
+
+    vlc_mutex_lock(&data->lock);
+    data->order[data->count++] = task->id;
+    vlc_mutex_unlock(&data->lock);
+}
+
+static void test_priority(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(1);
+    assert(executor);
+
+    struct order_data data = { .released = false, .count = 0 };
+    vlc_mutex_init(&data.lock);
+    vlc_cond_init(&data.cond);
+
+    /* Keep the single thread busy while the other tasks are queued */
+    struct vlc_runnable blocker = {
+        .run = RunBlocker,
+        .userdata = &data,
+    };
+    vlc_executor_Submit(executor, &blocker);
+
+    static const enum vlc_executor_priority priorities[] = {
+        VLC_EXECUTOR_PRIORITY_LOW,
+        VLC_EXECUTOR_PRIORITY_NORMAL,
+        VLC_EXECUTOR_PRIORITY_LOW,
+        VLC_EXECUTOR_PRIORITY_HIGH,
+    };
+
+    struct order_task tasks[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        tasks[i].data = &data;
+        tasks[i].id = i;
+        tasks[i].runnable.run = RunOrdered;
+        tasks[i].runnable.userdata = &tasks[i];
+        vlc_executor_SubmitPriority(executor, &tasks[i].runnable,
+                                    priorities[i]);
+    }
+
+    /* A canceled task must not affect the others */
+    assert(vlc_executor_Cancel(executor, &tasks[1].runnable));
+
+    vlc_mutex_lock(&data.lock);
+    data.released = true;
+    vlc_cond_signal(&data.cond);
+    vlc_mutex_unlock(&data.lock);
+
+    vlc_executor_WaitIdle(executor);
+    vlc_executor_Delete(executor);
+
+    /* Highest priority first, then submission order */
+    assert(data.count == 3);
+    assert(data.order[0] == 3);
+    assert(data.order[1] == 0);
+    assert(data.order[2] == 2);
+}
+
 int main(void)
 {
     test_single_runnable();
@@ -279,5 +367,6 @@ int main(void)
     test_blocking_delete();
     test_cancel();
     test_task_chain();
+    test_priority();
     return 0;
 }
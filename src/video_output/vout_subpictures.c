@@ -47,11 +47,19 @@
  * Local prototypes
  *****************************************************************************/
 
+/* Scaled and/or converted picture of a region. It is reused for the next
+ * frames as long as the region picture and the destination size and chroma
+ * do not change. */
+typedef struct {
+    picture_t *source; /* region picture the cache was made from (held) */
+    picture_t *scaled;
+} spu_scaled_region_t;
+
 /* Hold of subpicture with original ts */
 typedef struct {
     /* Shared with prerendering thread */
     subpicture_t *subpic; /* picture to be rendered */
-    struct VLC_VECTOR(picture_t *) scaled_region_pics;
+    struct VLC_VECTOR(spu_scaled_region_t) scaled_region_pics;
     /* */
     vlc_tick_t orgstart; /* original picture timestamp, for conversion updates */
     vlc_tick_t orgstop;
@@ -161,16 +169,27 @@ static int spu_channel_Push(struct spu_channel *channel, subpicture_t *subpic,
     return vlc_vector_push(&channel->entries, entry) ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
+static void spu_scaled_region_Clean(spu_scaled_region_t *cache)
+{
+    if (cache->scaled != NULL)
+    {
+        picture_Release(cache->scaled);
+        cache->scaled = NULL;
+    }
+    if (cache->source != NULL)
+    {
+        picture_Release(cache->source);
+        cache->source = NULL;
+    }
+}
+
 static void spu_Channel_CleanEntry(spu_private_t *sys, spu_render_entry_t *entry)
 {
     assert(entry->subpic);
 
-    picture_t *pic;
-    vlc_vector_foreach(pic, &entry->scaled_region_pics)
-    {
-        if (pic != NULL)
-            picture_Release(pic);
-    }
+    spu_scaled_region_t *cache;
+    vlc_vector_foreach_ref(cache, &entry->scaled_region_pics)
+        spu_scaled_region_Clean(cache);
     vlc_vector_clear(&entry->scaled_region_pics);
 
     spu_PrerenderCancel(sys, entry->subpic);
@@ -707,7 +726,8 @@ static int spu_entry_EnsureScaledSize(spu_render_entry_t *render_entry)
 
     while (region_count > render_entry->scaled_region_pics.size)
     {
-        if (unlikely(!vlc_vector_push(&render_entry->scaled_region_pics, NULL)))
+        const spu_scaled_region_t cache = { NULL, NULL };
+        if (unlikely(!vlc_vector_push(&render_entry->scaled_region_pics, cache)))
             return VLC_ENOMEM;
     }
     return VLC_SUCCESS;
@@ -857,7 +877,7 @@ spu_SelectSubpictures(spu_t *spu, vlc_tick_t system_now,
 
 static void SpuRescaleRegion(spu_t *spu,
                              const subpicture_region_t *region,
-                             picture_t **scaled_pic,
+                             spu_scaled_region_t *cache,
                              const spu_scale_t scale_size,
                              bool changed_palette, bool using_palette,
                              const vlc_fourcc_t *chroma_list)
@@ -877,10 +897,16 @@ static void SpuRescaleRegion(spu_t *spu,
         const unsigned dst_height = spu_scale_h(region->fmt.i_visible_height, scale_size);
 
         /* Destroy the cache if unusable */
-        if (*scaled_pic) {
-            picture_t *private = *scaled_pic;
+        if (cache->scaled) {
+            picture_t *private = cache->scaled;
             bool is_changed = false;
 
+            /* Check content changes: the region pictures are not modified
+             * once the region is rendered, but a subpicture updater may
+             * have replaced the region */
+            if (cache->source != region->p_picture)
+                is_changed = true;
+
             /* Check resize changes */
             if (dst_width  != private->format.i_visible_width ||
                 dst_height != private->format.i_visible_height)
@@ -893,14 +919,12 @@ static void SpuRescaleRegion(spu_t *spu,
             if (convert_chroma && private->format.i_chroma != chroma_list[0])
                 is_changed = true;
 
-            if (is_changed) {
-                picture_Release(*scaled_pic);
-                *scaled_pic = NULL;
-            }
+            if (is_changed)
+                spu_scaled_region_Clean(cache);
         }
 
         /* Scale if needed into cache */
-        if (!*scaled_pic && dst_width > 0 && dst_height > 0) {
+        if (!cache->scaled && dst_width > 0 && dst_height > 0) {
             filter_t *scale = sys->scale;
 
             picture_t *picture = region->p_picture;
@@ -962,12 +986,18 @@ static void SpuRescaleRegion(spu_t *spu,
 
             /* */
             if (picture) {
-                if (*scaled_pic)
-                    picture_Release(picture);
-                *scaled_pic = picture;
+                if (cache->source != NULL)
+                    picture_Release(cache->source);
+                cache->source = picture_Hold(region->p_picture);
+                cache->scaled = picture;
             }
         }
     }
+    else
+    {
+        /* The region is now used as is */
+        spu_scaled_region_Clean(cache);
+    }
 }
 
 /**
@@ -977,7 +1007,7 @@ static subpicture_region_t *SpuRenderRegion(spu_t *spu,
                             spu_area_t *dst_area,
                             const spu_render_entry_t *entry,
                             const subpicture_region_t *region,
-                            picture_t **scaled_pic,
+                            spu_scaled_region_t *scaled_region,
                             const spu_scale_t scale_size,
                             const vlc_fourcc_t *chroma_list,
                             const video_format_t *fmt,
@@ -1121,18 +1151,18 @@ static subpicture_region_t *SpuRenderRegion(spu_t *spu,
     }
 
     /* */
-    SpuRescaleRegion( spu, region, scaled_pic, scale_size,
+    SpuRescaleRegion( spu, region, scaled_region, scale_size,
                       changed_palette, using_palette,
                       chroma_list );
 
-    if (*scaled_pic == NULL)
+    if (scaled_region->scaled == NULL)
     {
         region_fmt = region->fmt;
         region_picture = region->p_picture;
     }
     else
     {
-        region_picture = *scaled_pic;
+        region_picture = scaled_region->scaled;
         region_fmt = region_picture->format;
     }
 
@@ -1298,7 +1328,7 @@ static vlc_render_subpicture *SpuRenderSubpictures(spu_t *spu,
         vlc_spu_regions_foreach(region, &subpic->regions) {
             spu_area_t area;
             assert(region_idx < entry->scaled_region_pics.size);
-            picture_t **scaled_region_pic = &entry->scaled_region_pics.data[region_idx];
+            spu_scaled_region_t *scaled_region_pic = &entry->scaled_region_pics.data[region_idx];
             region_idx++;
 
             /* Compute region scale AR */
@@ -1341,7 +1371,6 @@ static vlc_render_subpicture *SpuRenderSubpictures(spu_t *spu,
             assert(scale.w != 0 && scale.h != 0);
 
             /* last minute text rendering */
-            subpicture_region_t *rendered_region = region;
             if (unlikely(subpicture_region_IsText( region )))
             {
                 subpicture_region_t *rendered_text =
@@ -1351,20 +1380,24 @@ static vlc_render_subpicture *SpuRenderSubpictures(spu_t *spu,
                 if ( rendered_text  == NULL)
                     // not a rendering error for Text-To-Speech
                     continue;
-                rendered_region = rendered_text;
                 region_FixFmt(rendered_text);
+
+                /* Replace the text region like the prerenderer does, so that
+                 * the text is not rendered and scaled again for every frame
+                 * while the subpicture is unchanged */
+                vlc_list_replace(&region->node, &rendered_text->node);
+                subpicture_region_Delete(region);
+                region = rendered_text;
             }
 
             spu_scale_t virtual_scale = external_scale ? (spu_scale_t){ SCALE_UNIT, SCALE_UNIT } : scale;
 
             /* */
             output_last_ptr = SpuRenderRegion(spu, &area,
-                            entry, rendered_region, scaled_region_pic, virtual_scale,
+                            entry, region, scaled_region_pic, virtual_scale,
                             chroma_list, fmt_dst,
                             subtitle_area, subtitle_area_count,
                             subpic->b_subtitle ? render_subtitle_date : system_now);
-            if (rendered_region != region)
-                subpicture_region_Delete( rendered_region );
             if (unlikely(output_last_ptr == NULL))
                 continue;
 
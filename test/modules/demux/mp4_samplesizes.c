@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * mp4_samplesizes.c: MP4 compact sample sizes table tests
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc_common.h>
+
+#include "../../../modules/demux/mp4/samplesizes.h"
+
+#include "../../libvlc/test.h"
+
+#define ASSERT(a) do {\
+    if(!(a)) { \
+        fprintf(stderr, "failed line %d\n", __LINE__); \
+        return 1; } \
+    } while(0)
+
+/* Encodes the sizes as stsz (32 bits) or stz2 (4, 8, 16 bits) entries */
+static void Encode(uint8_t *p_entries, const uint32_t *p_sizes,
+                   unsigned i_field_size, uint32_t i_count)
+{
+    memset(p_entries, 0, (i_field_size * i_count + 7) / 8);
+    for(uint32_t i = 0; i < i_count; i++)
+    {
+        switch(i_field_size)
+        {
+            case 32: SetDWBE(&p_entries[4 * i], p_sizes[i]); break;
+            case 16: SetWBE(&p_entries[2 * i], p_sizes[i]); break;
+            case 8:  p_entries[i] = p_sizes[i]; break;
+            default: p_entries[i / 2] |= (i & 1) ? p_sizes[i] : p_sizes[i] << 4; break;
+        }
+    }
+}
+
+static int Check(const uint32_t *p_sizes, unsigned i_field_size, uint32_t i_count)
+{
+    mp4_samplesizes_t table;
+    uint8_t *p_entries = malloc(4 * i_count);
+    ASSERT(p_entries);
+
+    Encode(p_entries, p_sizes, i_field_size, i_count);
+    ASSERT(MP4_SampleSizes_Init(&table, p_entries, i_field_size, i_count) == VLC_SUCCESS);
+    free(p_entries);
+    ASSERT(table.i_count == i_count);
+    for(uint32_t i = 0; i < i_count; i++)
+        ASSERT(MP4_SampleSizes_Get(&table, i) == p_sizes[i]);
+    MP4_SampleSizes_Clean(&table);
+    return 0;
+}
+
+int main(void)
+{
+    test_init();
+
+    static const uint32_t i_counts[] = { 1, 63, 64, 65, 1000 };
+    uint32_t *p_sizes = malloc(1000 * sizeof(*p_sizes));
+    uint8_t *p_entries = malloc(1000 * 4);
+    ASSERT(p_sizes && p_entries);
+
+    /* Constant sizes need no packed data */
+    for(uint32_t i = 0; i < 1000; i++)
+        p_sizes[i] = 1234;
+    for(size_t i = 0; i < ARRAY_SIZE(i_counts); i++)
+        ASSERT(Check(p_sizes, 32, i_counts[i]) == 0);
+
+    mp4_samplesizes_t table;
+    Encode(p_entries, p_sizes, 32, 1000);
+    ASSERT(MP4_SampleSizes_Init(&table, p_entries, 32, 1000) == VLC_SUCCESS);
+    ASSERT(table.p_words == NULL);
+    MP4_SampleSizes_Clean(&table);
+
+    /* Every width, with values crossing words boundaries */
+    for(unsigned bits = 1; bits <= 32; bits++)
+    {
+        uint64_t state = bits;
+        for(uint32_t i = 0; i < 1000; i++)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint32_t i_delta = (state >> 32) & (UINT32_MAX >> (32 - bits));
+            p_sizes[i] = bits < 32 ? 100 + i_delta : i_delta;
+        }
+        for(size_t i = 0; i < ARRAY_SIZE(i_counts); i++)
+            ASSERT(Check(p_sizes, 32, i_counts[i]) == 0);
+    }
+
+    /* Extreme values */
+    for(uint32_t i = 0; i < 1000; i++)
+        p_sizes[i] = (i & 1) ? UINT32_MAX : 0;
+    ASSERT(Check(p_sizes, 32, 1000) == 0);
+
+    /* stz2 field sizes, with an odd count of 4 bits entries */
+    for(unsigned i_field_size = 4; i_field_size <= 16; i_field_size *= 2)
+    {
+        for(uint32_t i = 0; i < 1000; i++)
+            p_sizes[i] = (i * 7919) & ((1U << i_field_size) - 1);
+        for(size_t i = 0; i < ARRAY_SIZE(i_counts); i++)
+            ASSERT(Check(p_sizes, i_field_size, i_counts[i]) == 0);
+    }
+
+    free(p_entries);
+    free(p_sizes);
+    return 0;
+}
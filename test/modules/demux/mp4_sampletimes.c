@@ -0,0 +1,477 @@
+/*****************************************************************************
+ * mp4_sampletimes.c: MP4 demuxer stts/ctts timestamps test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc/vlc.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_block.h>
+#include <vlc_input_item.h>
+
+#define ASSERT(a) do {\
+    if(!(a)) { \
+        fprintf(stderr, "failed line %d\n", __LINE__); \
+        return 1; } \
+    } while(0)
+
+/* The timescale of the track, 1 ms, so that timestamps are exact */
+#define TIMESCALE 1000
+
+/* Samples per chunk: the stts and ctts entries below begin and end in the
+ * middle of chunks, span several chunks, or are shorter than a chunk */
+static const uint32_t chunks[] = { 4, 4, 4, 3, 3, 5, 5 };
+#define SAMPLES 28
+
+typedef struct
+{
+    uint32_t count;
+    int32_t value;
+} table_entry_t;
+
+static const table_entry_t stts[] = {
+    { 5, 40 }, { 7, 20 }, { 7, 33 }, { 1, 45 }, { 2, 25 }, { 6, 50 },
+};
+
+/* Composition offsets, positive only (ctts version 0) */
+static const table_entry_t ctts_positive[] = {
+    { 2, 80 }, { 3, 0 }, { 9, 40 }, { 1, 120 }, { 4, 20 }, { 1, 60 },
+    { 2, 0 }, { 6, 40 },
+};
+
+/* Composition offsets, negative as well (ctts version 1): the demuxer shifts
+ * all the offsets by the lowest one */
+static const table_entry_t ctts_negative[] = {
+    { 3, -40 }, { 1, 60 }, { 6, 0 }, { 11, -20 }, { 7, 100 },
+};
+
+typedef struct
+{
+    uint8_t *p;
+    size_t i;
+    size_t boxes[16];
+    unsigned depth;
+} writer_t;
+
+static void Put8(writer_t *w, uint8_t v)
+{
+    w->p[w->i++] = v;
+}
+
+static void Put16(writer_t *w, uint16_t v)
+{
+    SetWBE(&w->p[w->i], v);
+    w->i += 2;
+}
+
+static void Put32(writer_t *w, uint32_t v)
+{
+    SetDWBE(&w->p[w->i], v);
+    w->i += 4;
+}
+
+static void PutZeros(writer_t *w, size_t n)
+{
+    memset(&w->p[w->i], 0, n);
+    w->i += n;
+}
+
+static void PutFourCC(writer_t *w, const char *type)
+{
+    memcpy(&w->p[w->i], type, 4);
+    w->i += 4;
+}
+
+static void BoxStart(writer_t *w, const char *type)
+{
+    w->boxes[w->depth++] = w->i;
+    Put32(w, 0);
+    PutFourCC(w, type);
+}
+
+static void FullBoxStart(writer_t *w, const char *type, uint8_t version,
+                         uint32_t flags)
+{
+    BoxStart(w, type);
+    Put32(w, ((uint32_t)version << 24) | flags);
+}
+
+static void BoxEnd(writer_t *w)
+{
+    size_t start = w->boxes[--w->depth];
+    SetDWBE(&w->p[start], w->i - start);
+}
+
+static void PutTable(writer_t *w, const char *type, uint8_t version,
+                     const table_entry_t *entries, size_t count)
+{
+    FullBoxStart(w, type, version, 0);
+    Put32(w, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        Put32(w, entries[i].count);
+        Put32(w, entries[i].value);
+    }
+    BoxEnd(w);
+}
+
+static uint32_t SampleSize(unsigned i)
+{
+    return 8 + i % 5;
+}
+
+/* Writes a file with a single video track, each sample starting with its
+ * number */
+static size_t WriteFile(uint8_t *p, const table_entry_t *ctts,
+                        size_t ctts_count, uint8_t ctts_version)
+{
+    writer_t w = { .p = p };
+    uint64_t duration = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(stts); i++)
+        duration += stts[i].count * stts[i].value;
+
+    BoxStart(&w, "ftyp");
+    PutFourCC(&w, "isom");
+    Put32(&w, 0);
+    PutFourCC(&w, "isom");
+    BoxEnd(&w);
+
+    BoxStart(&w, "moov");
+    FullBoxStart(&w, "mvhd", 0, 0);
+    Put32(&w, 0); /* creation time */
+    Put32(&w, 0); /* modification time */
+    Put32(&w, TIMESCALE);
+    Put32(&w, duration);
+    Put32(&w, 0x00010000); /* rate */
+    Put16(&w, 0x0100); /* volume */
+    PutZeros(&w, 10);
+    Put32(&w, 0x00010000); PutZeros(&w, 12); /* matrix */
+    Put32(&w, 0x00010000); PutZeros(&w, 12);
+    Put32(&w, 0x40000000);
+    PutZeros(&w, 24);
+    Put32(&w, 2); /* next track ID */
+    BoxEnd(&w);
+
+    BoxStart(&w, "trak");
+    FullBoxStart(&w, "tkhd", 0, 0x3 /* enabled, in movie */);
+    Put32(&w, 0);
+    Put32(&w, 0);
+    Put32(&w, 1); /* track ID */
+    Put32(&w, 0);
+    Put32(&w, duration);
+    PutZeros(&w, 16);
+    Put32(&w, 0x00010000); PutZeros(&w, 12); /* matrix */
+    Put32(&w, 0x00010000); PutZeros(&w, 12);
+    Put32(&w, 0x40000000);
+    Put32(&w, 16 << 16); /* width */
+    Put32(&w, 16 << 16); /* height */
+    BoxEnd(&w);
+
+    BoxStart(&w, "mdia");
+    FullBoxStart(&w, "mdhd", 0, 0);
+    Put32(&w, 0);
+    Put32(&w, 0);
+    Put32(&w, TIMESCALE);
+    Put32(&w, duration);
+    Put16(&w, 0x55c4); /* undetermined language */
+    Put16(&w, 0);
+    BoxEnd(&w);
+
+    FullBoxStart(&w, "hdlr", 0, 0);
+    Put32(&w, 0);
+    PutFourCC(&w, "vide");
+    PutZeros(&w, 12);
+    Put8(&w, 0); /* name */
+    BoxEnd(&w);
+
+    BoxStart(&w, "minf");
+    FullBoxStart(&w, "vmhd", 0, 1);
+    PutZeros(&w, 8);
+    BoxEnd(&w);
+
+    BoxStart(&w, "stbl");
+    FullBoxStart(&w, "stsd", 0, 0);
+    Put32(&w, 1);
+    BoxStart(&w, "jpeg");
+    PutZeros(&w, 6);
+    Put16(&w, 1); /* data reference index */
+    PutZeros(&w, 16);
+    Put16(&w, 16); /* width */
+    Put16(&w, 16); /* height */
+    Put32(&w, 0x00480000); /* resolution */
+    Put32(&w, 0x00480000);
+    Put32(&w, 0);
+    Put16(&w, 1); /* frame count */
+    PutZeros(&w, 32); /* compressor name */
+    Put16(&w, 24); /* depth */
+    Put16(&w, 0xffff);
+    BoxEnd(&w);
+    BoxEnd(&w);
+
+    PutTable(&w, "stts", 0, stts, ARRAY_SIZE(stts));
+    if (ctts != NULL)
+        PutTable(&w, "ctts", ctts_version, ctts, ctts_count);
+
+    FullBoxStart(&w, "stsc", 0, 0);
+    Put32(&w, ARRAY_SIZE(chunks));
+    for (size_t i = 0; i < ARRAY_SIZE(chunks); i++)
+    {
+        Put32(&w, i + 1); /* first chunk */
+        Put32(&w, chunks[i]); /* samples per chunk */
+        Put32(&w, 1); /* sample description index */
+    }
+    BoxEnd(&w);
+
+    FullBoxStart(&w, "stsz", 0, 0);
+    Put32(&w, 0);
+    Put32(&w, SAMPLES);
+    for (unsigned i = 0; i < SAMPLES; i++)
+        Put32(&w, SampleSize(i));
+    BoxEnd(&w);
+
+    FullBoxStart(&w, "stco", 0, 0);
+    Put32(&w, ARRAY_SIZE(chunks));
+    size_t stco = w.i;
+    PutZeros(&w, 4 * ARRAY_SIZE(chunks));
+    BoxEnd(&w);
+
+    BoxEnd(&w); /* stbl */
+    BoxEnd(&w); /* minf */
+    BoxEnd(&w); /* mdia */
+    BoxEnd(&w); /* trak */
+    BoxEnd(&w); /* moov */
+
+    BoxStart(&w, "mdat");
+    unsigned sample = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(chunks); i++)
+    {
+        SetDWBE(&p[stco + 4 * i], w.i);
+        for (uint32_t j = 0; j < chunks[i]; j++, sample++)
+        {
+            Put8(&w, sample);
+            PutZeros(&w, SampleSize(sample) - 1);
+        }
+    }
+    BoxEnd(&w);
+
+    return w.i;
+}
+
+static int32_t TableValue(const table_entry_t *entries, unsigned sample)
+{
+    for (;; entries++)
+    {
+        if (sample < entries->count)
+            return entries->value;
+        sample -= entries->count;
+    }
+}
+
+static vlc_tick_t SampleDTS(unsigned sample)
+{
+    int64_t dts = 0;
+    for (unsigned i = 0; i < sample; i++)
+        dts += TableValue(stts, i);
+    return VLC_TICK_FROM_MS(dts);
+}
+
+static vlc_tick_t SamplePTS(const table_entry_t *ctts, size_t ctts_count,
+                            unsigned sample)
+{
+    if (ctts == NULL)
+        return VLC_TICK_INVALID;
+
+    int32_t shift = 0;
+    for (size_t i = 0; i < ctts_count; i++)
+        if (ctts[i].value < -shift)
+            shift = -ctts[i].value;
+
+    return SampleDTS(sample)
+         + VLC_TICK_FROM_MS(TableValue(ctts, sample) + shift);
+}
+
+struct test_es_out
+{
+    es_out_t out;
+    unsigned count;
+    unsigned sample[SAMPLES];
+    vlc_tick_t dts[SAMPLES];
+    vlc_tick_t pts[SAMPLES];
+    vlc_tick_t length[SAMPLES];
+};
+
+static es_out_id_t *EsOutAdd(es_out_t *out, input_source_t *in,
+                             const es_format_t *fmt)
+{
+    (void) out; (void) in;
+    return fmt->i_cat == VIDEO_ES ? (es_out_id_t *) 1 : NULL;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    struct test_es_out *es = container_of(out, struct test_es_out, out);
+    (void) id;
+
+    if (es->count < SAMPLES && block->i_buffer > 0)
+    {
+        es->sample[es->count] = block->p_buffer[0];
+        es->dts[es->count] = block->i_dts;
+        es->pts[es->count] = block->i_pts;
+        es->length[es->count] = block->i_length;
+        es->count++;
+    }
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *out, es_out_id_t *id)
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl(es_out_t *out, input_source_t *in, int query,
+                        va_list args)
+{
+    (void) out; (void) in;
+
+    switch (query)
+    {
+        case ES_OUT_GET_ES_STATE:
+            (void) va_arg(args, es_out_id_t *);
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy(es_out_t *out)
+{
+    (void) out;
+}
+
+static const struct es_out_callbacks es_out_cbs = {
+    .add = EsOutAdd,
+    .send = EsOutSend,
+    .del = EsOutDel,
+    .control = EsOutControl,
+    .destroy = EsOutDestroy,
+};
+
+/* Seeks to the given time, demuxes until the end, and checks the timestamps
+ * and the duration of every sample */
+static int Check(libvlc_instance_t *vlc, const uint8_t *file, size_t size,
+                 const table_entry_t *ctts, size_t ctts_count,
+                 vlc_tick_t time)
+{
+    struct test_es_out es = { .out = { .cbs = &es_out_cbs } };
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    stream_t *s = vlc_stream_MemoryNew(obj, (uint8_t *)file, size, true);
+    ASSERT(s != NULL);
+    demux_t *demux = demux_New(obj, "mp4", INPUT_ITEM_URI_NOP, s, &es.out);
+    if (demux == NULL)
+        vlc_stream_Delete(s);
+    ASSERT(demux != NULL);
+
+    if (time != VLC_TICK_INVALID)
+        ASSERT(demux_SetTime(demux, time, true, true) == VLC_SUCCESS);
+    while (demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+    demux_Delete(demux);
+
+    ASSERT(es.count > 0);
+
+    /* The first sample is at or before the requested time, and then
+     * all the following ones are output */
+    const unsigned first = es.sample[0];
+    if (time == VLC_TICK_INVALID)
+        ASSERT(first == 0);
+    else
+        ASSERT(SampleDTS(first) <= time);
+    ASSERT(es.count == SAMPLES - first);
+
+    for (unsigned i = 0; i < es.count; i++)
+    {
+        const unsigned sample = first + i;
+
+        ASSERT(es.sample[i] == sample);
+        ASSERT(es.dts[i] == VLC_TICK_0 + SampleDTS(sample));
+        ASSERT(es.length[i] == VLC_TICK_FROM_MS(TableValue(stts, sample)));
+        if (ctts == NULL)
+            ASSERT(es.pts[i] == VLC_TICK_INVALID);
+        else
+            ASSERT(es.pts[i] == VLC_TICK_0 + SamplePTS(ctts, ctts_count,
+                                                       sample));
+    }
+    return 0;
+}
+
+static int CheckFile(libvlc_instance_t *vlc, const table_entry_t *ctts,
+                     size_t ctts_count, uint8_t ctts_version)
+{
+    uint8_t file[2048];
+    size_t size = WriteFile(file, ctts, ctts_count, ctts_version);
+    ASSERT(size <= sizeof(file));
+
+    /* From the start, then from the start of each sample and from the
+     * middle of its duration */
+    ASSERT(Check(vlc, file, size, ctts, ctts_count, VLC_TICK_INVALID) == 0);
+    for (unsigned i = 0; i < SAMPLES; i++)
+    {
+        const vlc_tick_t dts = SampleDTS(i);
+        const vlc_tick_t duration = VLC_TICK_FROM_MS(TableValue(stts, i));
+
+        ASSERT(Check(vlc, file, size, ctts, ctts_count, dts) == 0);
+        ASSERT(Check(vlc, file, size, ctts, ctts_count,
+                     dts + duration / 2) == 0);
+    }
+    return 0;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    ASSERT(vlc != NULL);
+
+    test_log("Without composition offsets\n");
+    ASSERT(CheckFile(vlc, NULL, 0, 0) == 0);
+
+    test_log("With positive composition offsets\n");
+    ASSERT(CheckFile(vlc, ctts_positive, ARRAY_SIZE(ctts_positive), 0) == 0);
+
+    test_log("With negative composition offsets\n");
+    ASSERT(CheckFile(vlc, ctts_negative, ARRAY_SIZE(ctts_negative), 1) == 0);
+
+    libvlc_release(vlc);
+    return 0;
+}
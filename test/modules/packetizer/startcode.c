@@ -0,0 +1,258 @@
+/*****************************************************************************
+ * startcode.c: Annex B start code and emulation prevention lookup benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+
+#include "../modules/packetizer/startcode_helper.h"
+#include "../modules/packetizer/hxxx_ep3b.h"
+#include "../../libvlc/test.h"
+
+/* Set VLC_ANNEXB_BENCH_FILE to an H.264/HEVC elementary stream to benchmark
+ * real data. Otherwise, a synthetic stream of escaped NAL units is used. */
+#define DEFAULT_SIZE (8 << 20)
+
+typedef const uint8_t *(*startcode_find)(const uint8_t *, const uint8_t *);
+
+static uint8_t *LoadFile(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    uint8_t *buf = NULL;
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        long len = ftell(file);
+        if (len > 0 && fseek(file, 0, SEEK_SET) == 0)
+        {
+            buf = malloc(len);
+            if (buf != NULL && fread(buf, 1, len, file) != (size_t)len)
+            {
+                free(buf);
+                buf = NULL;
+            }
+            *size = len;
+        }
+    }
+    fclose(file);
+    return buf;
+}
+
+/* Random NAL units of a few kB, with emulation prevention bytes inserted
+ * as an encoder would, and frequent zero bytes as in real slice data. */
+static uint8_t *Generate(size_t *size)
+{
+    uint8_t *buf = malloc(DEFAULT_SIZE);
+    assert(buf != NULL);
+
+    uint64_t state = 42;
+    size_t i = 0;
+    while (i < DEFAULT_SIZE - 16)
+    {
+        memcpy(&buf[i], "\x00\x00\x00\x01\x41", 5);
+        i += 5;
+
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        size_t nal = 512 + (state >> 51);
+        unsigned zeros = 0;
+        for (size_t j = 0; j < nal && i < DEFAULT_SIZE - 16; j++)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint8_t byte = state >> 56;
+            if (byte < 0x30)
+                byte = 0;
+            if (zeros >= 2 && byte <= 3)
+            {
+                buf[i++] = 0x03;
+                zeros = 0;
+            }
+            buf[i++] = byte;
+            zeros = byte ? 0 : zeros + 1;
+        }
+        buf[i++] = 0x80; /* RBSP trailing bits */
+    }
+    *size = i;
+    return buf;
+}
+
+static size_t CountStartcodes(const uint8_t *buf, size_t size,
+                              startcode_find find, vlc_tick_t *duration)
+{
+    const uint8_t *p = buf, *end = buf + size;
+    size_t count = 0;
+    vlc_tick_t start = vlc_tick_now();
+
+    while ((p = find(p, end)) != NULL)
+    {
+        count++;
+        p += 3;
+    }
+
+    *duration = vlc_tick_now() - start;
+    return count;
+}
+
+static void BenchStartcode(const uint8_t *buf, size_t size, const char *name,
+                           startcode_find find, size_t expected)
+{
+    vlc_tick_t duration;
+    size_t count = CountStartcodes(buf, size, find, &duration);
+
+    assert(count == expected);
+    printf("startcode %-4s: %zu start codes, %8.1f MB/s\n", name, count,
+           size / (double) __MAX(US_FROM_VLC_TICK(duration), 1));
+}
+
+static const uint8_t *FindAnnexB_Prefix_C(const uint8_t *p, const uint8_t *end)
+{
+    return startcode_FindPrefix_C(p, end, 1);
+}
+
+/* Skips every NAL unit through the emulation prevention bitstream reader,
+ * by steps of the given size, and returns the total number of RBSP bytes. */
+static size_t SkipRBSP(const uint8_t *buf, size_t size, unsigned step,
+                       vlc_tick_t *duration)
+{
+    const uint8_t *p = startcode_FindAnnexB_Bits(buf, buf + size);
+    const uint8_t *end = buf + size;
+    size_t total = 0;
+    vlc_tick_t start = vlc_tick_now();
+
+    while (p != NULL)
+    {
+        p += 3;
+        const uint8_t *next = startcode_FindAnnexB(p, end);
+        const uint8_t *nal_end = next ? next : end;
+
+        struct hxxx_bsfw_ep3b_ctx_s bsctx;
+        hxxx_bsfw_ep3b_ctx_init(&bsctx);
+        bs_t bs;
+        bs_init_custom(&bs, p, nal_end - p, &hxxx_bsfw_ep3b_callbacks, &bsctx);
+        while (!bs_eof(&bs))
+        {
+            bs_skip(&bs, step * 8);
+            total += step;
+        }
+        p = next;
+    }
+
+    *duration = vlc_tick_now() - start;
+    return total;
+}
+
+static void test_ep3b(const uint8_t *buf, size_t size)
+{
+    /* Byte by byte reading never takes the lookup path */
+    vlc_tick_t ref_duration, duration;
+    size_t ref = SkipRBSP(buf, size, 1, &ref_duration);
+
+    printf("ep3b %4u B : %8.1f MB/s\n", 1,
+           size / (double) __MAX(US_FROM_VLC_TICK(ref_duration), 1));
+
+    for (unsigned step = HXXX_EP3B_SCAN_MIN; step <= 4096; step *= 4)
+    {
+        size_t total = SkipRBSP(buf, size, step, &duration);
+        /* The last step of each NAL may overshoot its end */
+        assert(total >= ref);
+        printf("ep3b %4u B : %8.1f MB/s\n", step,
+               size / (double) __MAX(US_FROM_VLC_TICK(duration), 1));
+    }
+}
+
+/* Checks that skipping gives the same positions as reading byte by byte */
+static void test_ep3b_positions(const uint8_t *buf, size_t size)
+{
+    size = __MIN(size, 1 << 20);
+
+    for (unsigned step = 2; step <= 256; step *= 2)
+    {
+        struct hxxx_bsfw_ep3b_ctx_s ctx_ref, ctx;
+        bs_t bs_ref, bs;
+        hxxx_bsfw_ep3b_ctx_init(&ctx_ref);
+        hxxx_bsfw_ep3b_ctx_init(&ctx);
+        bs_init_custom(&bs_ref, buf, size, &hxxx_bsfw_ep3b_callbacks, &ctx_ref);
+        bs_init_custom(&bs, buf, size, &hxxx_bsfw_ep3b_callbacks, &ctx);
+
+        while (!bs_eof(&bs))
+        {
+            for (unsigned i = 0; i < step; i++)
+                bs_skip(&bs_ref, 8);
+            bs_skip(&bs, step * 8);
+            assert(bs_ref.p == bs.p);
+        }
+    }
+}
+
+int main(void)
+{
+    test_init();
+
+    size_t size;
+    uint8_t *buf;
+    const char *path = getenv("VLC_ANNEXB_BENCH_FILE");
+
+    if (path != NULL)
+    {
+        buf = LoadFile(path, &size);
+        if (buf == NULL)
+        {
+            fprintf(stderr, "cannot load %s\n", path);
+            return 1;
+        }
+    }
+    else
+        buf = Generate(&size);
+
+    printf("%zu bytes\n", size);
+
+    vlc_tick_t duration;
+    size_t expected = CountStartcodes(buf, size, startcode_FindAnnexB_Bits,
+                                      &duration);
+    BenchStartcode(buf, size, "bits", startcode_FindAnnexB_Bits, expected);
+    BenchStartcode(buf, size, "C", FindAnnexB_Prefix_C, expected);
+#ifdef CAN_COMPILE_SSE2
+    if (vlc_CPU_SSE2())
+        BenchStartcode(buf, size, "SSE2", startcode_FindAnnexB_SSE2, expected);
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        BenchStartcode(buf, size, "AVX2", startcode_FindAnnexB_AVX2, expected);
+#endif
+#ifdef STARTCODE_NEON
+    if (vlc_CPU_ARM_NEON())
+        BenchStartcode(buf, size, "NEON", startcode_FindAnnexB_NEON, expected);
+#endif
+
+    test_ep3b_positions(buf, size);
+    test_ep3b(buf, size);
+
+    free(buf);
+    return 0;
+}
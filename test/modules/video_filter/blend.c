@@ -0,0 +1,220 @@
+/*****************************************************************************
+ * blend.c: blend filter vectorized kernels test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+/* Each picture is blended with the vectorized kernels and with the generic
+ * templates, and the outputs must be identical. The widths are not multiples
+ * of 16, so that the generic templates also blend the last columns. */
+static const vlc_fourcc_t dst_chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_YV12, VLC_CODEC_I422,
+    VLC_CODEC_NV12, VLC_CODEC_NV21,
+    VLC_CODEC_RGBA, VLC_CODEC_ARGB, VLC_CODEC_BGRA, VLC_CODEC_ABGR,
+    VLC_CODEC_RGBX, VLC_CODEC_XRGB, VLC_CODEC_BGRX, VLC_CODEC_XBGR,
+};
+
+static const vlc_fourcc_t src_chromas[] = {
+    VLC_CODEC_YUVA, VLC_CODEC_RGBA,
+};
+
+static const struct
+{
+    unsigned width, height;
+    int x, y;
+} sizes[] = {
+    { 15, 7, 0, 0 },
+    { 17, 9, 2, 2 },
+    { 70, 35, 0, 0 },
+    { 123, 50, 4, 2 },
+    { 330, 41, 6, 4 },
+};
+
+static const int alphas[] = { 255, 128, 1 };
+
+/* Noise, with 16x16 blocks of transparent, opaque and translucent pixels in
+ * the alpha channel if any, as blendbench generates */
+static void FillPicture(picture_t *pic, int alpha_plane, int alpha_byte,
+                        uint64_t state)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        const int pixel_pitch = alpha_byte >= 0 ? p->i_pixel_pitch : 1;
+
+        for (int y = 0; y < p->i_lines; y++)
+        {
+            uint8_t *line = &p->p_pixels[y * p->i_pitch];
+
+            for (int x = 0; x < p->i_pitch; x++)
+            {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                line[x] = state >> 56;
+
+                if (i != alpha_plane
+                 && (alpha_byte < 0 || x % pixel_pitch != alpha_byte))
+                    continue;
+
+                switch ((x / pixel_pitch / 16 + y / 16) % 3)
+                {
+                    case 0: line[x] = 0x00; break;
+                    case 1: line[x] = 0xff; break;
+                }
+            }
+        }
+    }
+}
+
+static picture_t *NewPicture(vlc_fourcc_t chroma, unsigned width,
+                             unsigned height, uint64_t seed)
+{
+    int alpha_plane = -1, alpha_byte = -1;
+
+    switch (chroma)
+    {
+        case VLC_CODEC_YUVA:
+            alpha_plane = A_PLANE;
+            break;
+        case VLC_CODEC_RGBA:
+        case VLC_CODEC_BGRA:
+            alpha_byte = 3;
+            break;
+        case VLC_CODEC_ARGB:
+        case VLC_CODEC_ABGR:
+            alpha_byte = 0;
+            break;
+    }
+
+    video_format_t fmt;
+    video_format_Init(&fmt, chroma);
+    video_format_Setup(&fmt, chroma, width, height, width, height, 1, 1);
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    video_format_Clean(&fmt);
+    assert(pic != NULL);
+
+    FillPicture(pic, alpha_plane, alpha_byte, seed);
+    return pic;
+}
+
+static int Blend(vlc_object_t *obj, bool simd, picture_t *dst,
+                 const picture_t *src, int x, int y, int alpha)
+{
+    var_SetBool(obj, "blend-simd", simd);
+
+    vlc_blender_t *blend = filter_NewBlend(obj, &dst->format);
+    assert(blend != NULL);
+
+    int ret = filter_ConfigureBlend(blend, dst->format.i_visible_width,
+                                    dst->format.i_visible_height,
+                                    &src->format);
+    if (ret == VLC_SUCCESS)
+        ret = filter_Blend(blend, dst, x, y, src, alpha);
+    filter_DeleteBlend(blend);
+    return ret;
+}
+
+static bool IsSamePicture(const picture_t *a, const picture_t *b)
+{
+    for (int i = 0; i < a->i_planes; i++)
+    {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+
+        for (int y = 0; y < pa->i_visible_lines; y++)
+            if (memcmp(&pa->p_pixels[y * pa->i_pitch],
+                       &pb->p_pixels[y * pb->i_pitch],
+                       pa->i_visible_pitch))
+                return false;
+    }
+    return true;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    var_Create(obj, "blend-simd", VLC_VAR_BOOL);
+
+    int ret = 0;
+    for (size_t d = 0; d < ARRAY_SIZE(dst_chromas); d++)
+        for (size_t s = 0; s < ARRAY_SIZE(src_chromas); s++)
+            for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+                for (size_t a = 0; a < ARRAY_SIZE(alphas); a++)
+                {
+                    const unsigned width = sizes[i].width;
+                    const unsigned height = sizes[i].height;
+                    const int x = sizes[i].x, y = sizes[i].y;
+
+                    picture_t *src = NewPicture(src_chromas[s], width, height,
+                                                2 + i);
+                    picture_t *simd = NewPicture(dst_chromas[d], width + x,
+                                                 height + y, 1 + i);
+                    picture_t *generic = NewPicture(dst_chromas[d], width + x,
+                                                    height + y, 1 + i);
+
+                    if (Blend(obj, false, generic, src, x, y, alphas[a]))
+                    {
+                        fprintf(stderr, "cannot blend %4.4s onto %4.4s\n",
+                                (const char *)&src_chromas[s],
+                                (const char *)&dst_chromas[d]);
+                        ret = 77;
+                    }
+                    else
+                    {
+                        ret = Blend(obj, true, simd, src, x, y, alphas[a]);
+                        assert(ret == VLC_SUCCESS);
+
+                        if (!IsSamePicture(simd, generic))
+                        {
+                            fprintf(stderr, "%4.4s onto %4.4s %ux%u at "
+                                    "%d,%d alpha %d differs\n",
+                                    (const char *)&src_chromas[s],
+                                    (const char *)&dst_chromas[d],
+                                    width, height, x, y, alphas[a]);
+                            ret = 1;
+                        }
+                    }
+
+                    picture_Release(generic);
+                    picture_Release(simd);
+                    picture_Release(src);
+                    if (ret != 0)
+                        goto out;
+                }
+out:
+    var_Destroy(obj, "blend-simd");
+    libvlc_release(vlc);
+    return ret;
+}
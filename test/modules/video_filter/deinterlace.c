@@ -0,0 +1,195 @@
+/*****************************************************************************
+ * deinterlace.c: deinterlace filter slice threading test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+#include <vlc_common.h>
+#include <vlc_configuration.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+/* Each algorithm is run on the same frames with a single thread and with
+ * slice threading, and the outputs must be identical. Set
+ * VLC_DEINTERLACE_BENCH_FRAMES to run a longer benchmark. */
+#define DEFAULT_FRAMES 16
+#define SLICE_THREADS "4"
+
+static const char *const modes[] = {
+    "linear", "mean", "blend", "x", "yadif", "yadif2x",
+};
+
+static void FillPicture(picture_t *pic, uint64_t *state)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+        {
+            uint8_t *line = &p->p_pixels[y * p->i_pitch];
+
+            /* Moving gradient with noise, different in each field */
+            for (int x = 0; x < p->i_visible_pitch; x++)
+            {
+                *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+                line[x] = ((x + y * 3 + (y & 1) * 64) & 0xff)
+                        ^ ((*state >> 59) & 0x0f);
+            }
+        }
+    }
+}
+
+static uint64_t HashPicture(const picture_t *pic, uint64_t hash)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        const plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+        {
+            const uint8_t *line = &p->p_pixels[y * p->i_pitch];
+
+            for (int x = 0; x < p->i_visible_pitch; x++)
+                hash = (hash ^ line[x]) * 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+static int Run(vlc_object_t *obj, const video_format_t *fmt,
+               const char *mode, const char *threads, unsigned frames,
+               uint64_t *hash, vlc_tick_t *duration)
+{
+    filter_chain_t *chain = filter_chain_NewVideo(obj, true, NULL);
+    assert(chain != NULL);
+
+    es_format_t es_fmt;
+    es_format_Init(&es_fmt, VIDEO_ES, fmt->i_chroma);
+    video_format_Copy(&es_fmt.video, fmt);
+    filter_chain_Reset(chain, &es_fmt, NULL, &es_fmt);
+
+    config_chain_t cfg_threads = {
+        .psz_name = (char *)"threads", .psz_value = (char *)threads,
+    };
+    config_chain_t cfg_mode = {
+        .p_next = &cfg_threads,
+        .psz_name = (char *)"mode", .psz_value = (char *)mode,
+    };
+
+    filter_t *filter = filter_chain_AppendFilter(chain, "deinterlace",
+                                                 &cfg_mode, NULL);
+    if (filter == NULL)
+    {
+        filter_chain_Delete(chain);
+        es_format_Clean(&es_fmt);
+        return VLC_EGENERIC;
+    }
+
+    uint64_t state = 42;
+    *hash = 0xcbf29ce484222325ULL;
+    *duration = 0;
+
+    for (unsigned i = 0; i < frames; i++)
+    {
+        picture_t *pic = picture_NewFromFormat(fmt);
+        assert(pic != NULL);
+        FillPicture(pic, &state);
+        pic->date = VLC_TICK_0 + i * VLC_TICK_FROM_MS(40);
+        pic->b_progressive = false;
+        pic->b_top_field_first = true;
+        pic->i_nb_fields = 2;
+
+        vlc_tick_t start = vlc_tick_now();
+        picture_t *out = filter_chain_VideoFilter(chain, pic);
+        while (out != NULL)
+        {
+            *duration += vlc_tick_now() - start;
+            *hash = HashPicture(out, *hash);
+            picture_Release(out);
+
+            start = vlc_tick_now();
+            out = filter_chain_VideoFilter(chain, NULL);
+        }
+    }
+
+    filter_chain_Delete(chain);
+    es_format_Clean(&es_fmt);
+    return VLC_SUCCESS;
+}
+
+int main(void)
+{
+    test_init();
+
+    const char *env = getenv("VLC_DEINTERLACE_BENCH_FRAMES");
+    unsigned frames = env != NULL ? strtoul(env, NULL, 10) : DEFAULT_FRAMES;
+    if (frames == 0)
+        frames = DEFAULT_FRAMES;
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    /* 1080 lines, so that the chroma planes end with a partial X block */
+    video_format_t fmt;
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, 1920, 1080, 1920, 1080, 1, 1);
+
+    int ret = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        uint64_t hash_single, hash_slices;
+        vlc_tick_t single, slices;
+
+        if (Run(obj, &fmt, modes[i], "1", frames, &hash_single, &single))
+        {
+            fprintf(stderr, "deinterlace filter not available\n");
+            ret = 77;
+            break;
+        }
+        ret = Run(obj, &fmt, modes[i], SLICE_THREADS, frames,
+                  &hash_slices, &slices);
+        assert(ret == VLC_SUCCESS);
+
+        printf("%-8s %u frames: 1 thread %"PRId64" us, "
+               SLICE_THREADS " threads %"PRId64" us (x%.2f)\n",
+               modes[i], frames, US_FROM_VLC_TICK(single),
+               US_FROM_VLC_TICK(slices),
+               slices > 0 ? (double)single / slices : 0.);
+
+        /* Slice threading must not change the output */
+        assert(hash_single == hash_slices);
+    }
+
+    video_format_Clean(&fmt);
+    libvlc_release(vlc);
+    return ret;
+}
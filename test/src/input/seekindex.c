@@ -0,0 +1,179 @@
+/*****************************************************************************
+ * seekindex.c: seek index cache test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc_seekindex.h>
+#include <vlc_fs.h>
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <unistd.h>
+
+#define ENTRY_COUNT 1000
+
+static void fill_entries(vlc_seekindex_entry_t *entries, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        entries[i].i_time = (i % 3) ? VLC_TICK_FROM_MS(40 * i)
+                                    : VLC_TICK_INVALID;
+        entries[i].i_offset = UINT64_C(0x100000000) + 1234 * i;
+        entries[i].i_size = 1000 + i;
+        entries[i].i_track = i % 4;
+        entries[i].i_flags = (i % 25) == 0;
+    }
+}
+
+static ssize_t load(libvlc_instance_t *vlc, const char *url, const char *tag,
+                    vlc_seekindex_entry_t **entries)
+{
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    stream_t *s = vlc_stream_NewURL(obj, url);
+    assert(s != NULL);
+
+    ssize_t count = vlc_seekindex_Load(obj, s, tag, entries);
+    vlc_stream_Delete(s);
+    return count;
+}
+
+static int store(libvlc_instance_t *vlc, const char *url, const char *tag,
+                 const vlc_seekindex_entry_t *entries, size_t count)
+{
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    stream_t *s = vlc_stream_NewURL(obj, url);
+    assert(s != NULL);
+
+    int ret = vlc_seekindex_Store(obj, s, tag, entries, count);
+    vlc_stream_Delete(s);
+    return ret;
+}
+
+static void remove_dir(const char *path)
+{
+    DIR *dir = vlc_opendir(path);
+    if (dir != NULL)
+    {
+        const char *name;
+        while ((name = vlc_readdir(dir)) != NULL)
+        {
+            char *child;
+            if (!strcmp(name, ".") || !strcmp(name, ".."))
+                continue;
+            assert(asprintf(&child, "%s/%s", path, name) != -1);
+            remove_dir(child);
+            free(child);
+        }
+        closedir(dir);
+    }
+    remove(path);
+}
+
+int main(void)
+{
+    test_init();
+
+    /* Keep the index files out of the user cache directory */
+    char cachedir[] = "/tmp/libvlc_seekindex_XXXXXX";
+    assert(mkdtemp(cachedir) != NULL);
+    setenv("XDG_CACHE_HOME", cachedir, 1);
+
+    char path[] = "/tmp/libvlc_XXXXXX";
+    int fd = vlc_mkstemp(path);
+    assert(fd != -1);
+    assert(write(fd, "RIFF", 4) == 4);
+    close(fd);
+
+    char *url;
+    assert(asprintf(&url, "file://%s", path) != -1);
+
+    const char *argv[] = {
+        "-v",
+        "--ignore-config",
+        "-I",
+        "dummy",
+        "--no-media-library",
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    vlc_seekindex_entry_t *entries = malloc(ENTRY_COUNT * sizeof (*entries));
+    assert(entries != NULL);
+    fill_entries(entries, ENTRY_COUNT);
+
+    vlc_seekindex_entry_t *loaded;
+
+    test_log("Nothing is cached yet\n");
+    assert(load(vlc, url, "test", &loaded) == -1);
+
+    test_log("Store and load an index\n");
+    assert(store(vlc, url, "test", entries, ENTRY_COUNT) == VLC_SUCCESS);
+    assert(load(vlc, url, "test", &loaded) == ENTRY_COUNT);
+    for (size_t i = 0; i < ENTRY_COUNT; i++)
+    {
+        assert(loaded[i].i_time == entries[i].i_time);
+        assert(loaded[i].i_offset == entries[i].i_offset);
+        assert(loaded[i].i_size == entries[i].i_size);
+        assert(loaded[i].i_track == entries[i].i_track);
+        assert(loaded[i].i_flags == entries[i].i_flags);
+    }
+    free(loaded);
+
+    test_log("Indexes are separated by tag\n");
+    assert(load(vlc, url, "other", &loaded) == -1);
+
+    test_log("An empty index is still an index\n");
+    assert(store(vlc, url, "empty", entries, 0) == VLC_SUCCESS);
+    assert(load(vlc, url, "empty", &loaded) == 0);
+    free(loaded);
+
+    test_log("A modified file does not match its old index\n");
+    struct utimbuf times = { .actime = 1000000000, .modtime = 1000000000 };
+    assert(utime(path, &times) == 0);
+    assert(load(vlc, url, "test", &loaded) == -1);
+
+    libvlc_release(vlc);
+
+    test_log("The cache can be disabled\n");
+    const char *argv_off[] = {
+        "-v",
+        "--ignore-config",
+        "-I",
+        "dummy",
+        "--no-media-library",
+        "--no-seekindex-cache",
+    };
+    vlc = libvlc_new(ARRAY_SIZE(argv_off), argv_off);
+    assert(vlc != NULL);
+    assert(store(vlc, url, "test", entries, ENTRY_COUNT) != VLC_SUCCESS);
+    assert(load(vlc, url, "test", &loaded) == -1);
+    libvlc_release(vlc);
+
+    free(entries);
+    free(url);
+    unlink(path);
+    remove_dir(cachedir);
+    return 0;
+}
@@ -34,7 +34,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-#ifndef TEST_NET
+#if defined(TEST_URING)
+/* Several times the io_uring read-ahead window, with a partial last chunk */
+#define RAND_FILE_SIZE (3 * 1024 * 1024 + 12345)
+#elif !defined(TEST_NET)
 #define RAND_FILE_SIZE (1024 * 1024)
 #else
 #define HTTP_URL "http://streams.videolan.org/streams/ogm/MJPEG.ogm"
@@ -196,6 +199,9 @@ stream_open( const char *psz_url )
         "--no-media-library",
         "--vout=dummy",
         "--aout=dummy",
+#ifdef TEST_URING
+        "--file-io-uring",
+#endif
     };
 
     p_reader = calloc( 1, sizeof(struct reader) );
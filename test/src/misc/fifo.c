@@ -0,0 +1,229 @@
+/*****************************************************************************
+ * fifo.c: block FIFO test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_threads.h>
+#include <vlc_tick.h>
+
+/* Number of blocks passed from the producer to the consumer per run.
+ * Set VLC_FIFO_BENCH_COUNT to run a longer benchmark. */
+#define DEFAULT_COUNT 200000
+
+struct bench
+{
+    vlc_fifo_t *fifo;
+    vlc_spsc_fifo_t *spsc;
+    block_t *blocks;
+    unsigned count;
+};
+
+static void NoRelease(block_t *block)
+{
+    (void) block;
+}
+
+static const struct vlc_block_callbacks no_release_cbs = { NoRelease };
+
+static void *ProduceLocked(void *data)
+{
+    struct bench *b = data;
+
+    for (unsigned i = 0; i < b->count; i++)
+        vlc_fifo_Put(b->fifo, &b->blocks[i]);
+    return NULL;
+}
+
+static void *ProduceSPSC(void *data)
+{
+    struct bench *b = data;
+
+    for (unsigned i = 0; i < b->count; i++)
+        vlc_spsc_fifo_Put(b->spsc, &b->blocks[i]);
+    return NULL;
+}
+
+static vlc_tick_t Run(struct bench *b, bool spsc)
+{
+    vlc_thread_t th;
+    vlc_tick_t start = vlc_tick_now();
+
+    int ret = vlc_clone(&th, spsc ? ProduceSPSC : ProduceLocked, b);
+    assert(ret == 0);
+
+    for (unsigned i = 0; i < b->count; i++)
+    {
+        block_t *block = spsc ? vlc_spsc_fifo_Get(b->spsc)
+                              : vlc_fifo_Get(b->fifo);
+        /* Blocks must come out in order, exactly once */
+        assert(block == &b->blocks[i]);
+        assert(block->p_next == NULL);
+    }
+
+    vlc_join(th, NULL);
+    return vlc_tick_now() - start;
+}
+
+static void test_spsc_accounting(void)
+{
+    vlc_spsc_fifo_t *fifo = vlc_spsc_fifo_New();
+    assert(fifo != NULL);
+    assert(vlc_spsc_fifo_IsEmpty(fifo));
+    assert(vlc_spsc_fifo_TryGet(fifo) == NULL);
+
+    /* Queue a chain larger than the internal ring */
+    block_t *chain = NULL, **pp = &chain;
+    size_t bytes = 0;
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        block_t *block = block_Alloc(i % 7);
+        assert(block != NULL);
+        bytes += block->i_buffer;
+        *pp = block;
+        pp = &block->p_next;
+    }
+    vlc_spsc_fifo_Put(fifo, chain);
+    assert(vlc_spsc_fifo_GetCount(fifo) == 1000);
+    assert(vlc_spsc_fifo_GetBytes(fifo) == bytes);
+
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        if (i == 500)
+        {   /* Queue more while the overflow list is being consumed */
+            block_t *block = block_Alloc(3);
+            assert(block != NULL);
+            block->i_dts = 1000;
+            vlc_spsc_fifo_Put(fifo, block);
+        }
+
+        block_t *block = vlc_spsc_fifo_TryGet(fifo);
+        assert(block != NULL);
+        assert(block->i_buffer == i % 7);
+        block_Release(block);
+    }
+
+    block_t *block = vlc_spsc_fifo_TryGet(fifo);
+    assert(block != NULL && block->i_dts == 1000);
+    block_Release(block);
+    assert(vlc_spsc_fifo_IsEmpty(fifo));
+    assert(vlc_spsc_fifo_GetBytes(fifo) == 0);
+
+    /* Waking up an empty FIFO */
+    vlc_spsc_fifo_Wake(fifo);
+    assert(vlc_spsc_fifo_Get(fifo) == NULL);
+
+    /* Remaining blocks are released on deletion */
+    vlc_spsc_fifo_Put(fifo, block_Alloc(16));
+    vlc_spsc_fifo_Delete(fifo);
+}
+
+static void *ProduceBursts(void *data)
+{
+    struct bench *b = data;
+    unsigned i = 0, burst = 1;
+
+    /* Queue chains of growing length, up to several times the ring size, so
+     * that the producer regularly fills the ring and overflows while the
+     * consumer is polling an empty ring */
+    while (i < b->count)
+    {
+        block_t *chain = NULL, **pp = &chain;
+
+        for (unsigned j = 0; j < burst && i < b->count; j++, i++)
+        {
+            *pp = &b->blocks[i];
+            pp = &b->blocks[i].p_next;
+        }
+        *pp = NULL;
+        vlc_spsc_fifo_Put(b->spsc, chain);
+        burst = (burst * 7 + 1) % 1000;
+    }
+    return NULL;
+}
+
+static void test_spsc_overflow_order(struct bench *b)
+{
+    vlc_thread_t th;
+
+    for (unsigned i = 0; i < b->count; i++)
+        b->blocks[i].i_dts = i;
+
+    int ret = vlc_clone(&th, ProduceBursts, b);
+    assert(ret == 0);
+
+    for (unsigned i = 0; i < b->count;)
+    {
+        block_t *block = vlc_spsc_fifo_TryGet(b->spsc);
+        if (block == NULL)
+            continue;
+        /* Blocks must come out in order across the ring and overflow list */
+        assert(block->i_dts == (vlc_tick_t)i);
+        assert(block->p_next == NULL);
+        i++;
+    }
+
+    vlc_join(th, NULL);
+    assert(vlc_spsc_fifo_IsEmpty(b->spsc));
+}
+
+int main(void)
+{
+    test_init();
+    test_spsc_accounting();
+
+    struct bench b;
+    const char *env = getenv("VLC_FIFO_BENCH_COUNT");
+
+    b.count = env != NULL ? strtoul(env, NULL, 10) : DEFAULT_COUNT;
+    if (b.count == 0)
+        b.count = DEFAULT_COUNT;
+
+    b.fifo = vlc_fifo_New();
+    b.spsc = vlc_spsc_fifo_New();
+    b.blocks = malloc(b.count * sizeof (*b.blocks));
+    assert(b.fifo != NULL && b.spsc != NULL && b.blocks != NULL);
+
+    for (unsigned i = 0; i < b.count; i++)
+        block_Init(&b.blocks[i], &no_release_cbs, NULL, 0);
+
+    test_spsc_overflow_order(&b);
+
+    vlc_tick_t locked = Run(&b, false);
+    vlc_tick_t spsc = Run(&b, true);
+
+    printf("%u blocks: locked FIFO %"PRId64" us (%.1f ns/block), "
+           "SPSC FIFO %"PRId64" us (%.1f ns/block)\n", b.count,
+           US_FROM_VLC_TICK(locked), 1000. * US_FROM_VLC_TICK(locked) / b.count,
+           US_FROM_VLC_TICK(spsc), 1000. * US_FROM_VLC_TICK(spsc) / b.count);
+
+    assert(vlc_spsc_fifo_IsEmpty(b.spsc));
+    vlc_spsc_fifo_Delete(b.spsc);
+    vlc_fifo_Delete(b.fifo);
+    free(b.blocks);
+    return 0;
+}